@@ -0,0 +1,314 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : Z80Bench.cpp
+//
+// Namespace   : -
+//
+// Class       : -
+//
+// Description : Z80 throughput benchmark: emulated MIPS, T-states per host second and host ns per instruction
+//               for each workload in each execution mode
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Model/Z80.h"
+
+static constexpr uint64_t ClockFreq = 3500000;
+static constexpr uint64_t TStatesPerFrame = 69888;
+static constexpr uint64_t InterruptLength = 32;
+static constexpr uint16_t ProgramAddress = 0x8000;
+static constexpr std::size_t MemorySize = 0x10000;
+static constexpr std::size_t ROMSize = 0x4000;
+// Best of, to filter out scheduler noise
+static constexpr int Repetitions = 3;
+
+// Reads as no key pressed on every port, ignores writes
+class FloatingBus
+    : public IIOAccess<uint16_t>
+{
+public:
+    void Read8(uint16_t /*address*/, uint8_t &value) override { value = 0xFF; }
+    void Read16(uint16_t /*address*/, uint16_t &value) override { value = 0xFFFF; }
+    void Read32(uint16_t /*address*/, uint32_t &value) override { value = 0xFFFFFFFF; }
+    void Read64(uint16_t /*address*/, uint64_t &value) override { value = 0xFFFFFFFFFFFFFFFF; }
+};
+
+struct Patch
+{
+    uint16_t Address;
+    std::vector<uint8_t> Code;
+};
+
+struct Workload
+{
+    const char *Name;
+    // Empty for workloads that run the ROM from reset
+    std::vector<Patch> Program;
+    // T-states between interrupts
+    uint64_t InterruptPeriod;
+};
+
+struct Result
+{
+    uint64_t Instructions;
+    uint64_t TStates;
+    double Seconds;
+};
+
+// Runs from the ROM reset vector until the frame count is spent, which covers the memory test and the
+// initialisation up to the BASIC prompt. Once there, the NOPs of HALT count as instructions
+static const Workload ROMBoot{ "rom-boot", {}, TStatesPerFrame };
+
+static const Workload ALULoop
+{
+    "alu-loop",
+    {
+        { ProgramAddress, {
+            0xF3,               //      DI
+            0x21, 0x00, 0x90,   //      LD HL,0x9000
+            0x06, 0x00,         //      LD B,0
+            0x80,               // loop ADD A,B
+            0x89,               //      ADC A,C
+            0x92,               //      SUB D
+            0x9B,               //      SBC A,E
+            0xA4,               //      AND H
+            0xAD,               //      XOR L
+            0xB0,               //      OR B
+            0xBE,               //      CP (HL)
+            0x3C,               //      INC A
+            0x0D,               //      DEC C
+            0x07,               //      RLCA
+            0xCB, 0x11,         //      RL C
+            0x27,               //      DAA
+            0x29,               //      ADD HL,HL
+            0xED, 0x52,         //      SBC HL,DE
+            0x10, 0xED,         //      DJNZ loop
+            0x18, 0xEB,         //      JR loop
+        } },
+    },
+    TStatesPerFrame
+};
+
+static const Workload LDIRLoop
+{
+    "ldir",
+    {
+        { ProgramAddress, {
+            0xF3,               //      DI
+            0x21, 0x00, 0xA0,   // loop LD HL,0xA000
+            0x11, 0x00, 0xC0,   //      LD DE,0xC000
+            0x01, 0x00, 0x20,   //      LD BC,0x2000
+            0xED, 0xB0,         //      LDIR
+            0x21, 0x00, 0x00,   //      LD HL,0x0000
+            0x11, 0x00, 0xE0,   //      LD DE,0xE000
+            0x01, 0x00, 0x10,   //      LD BC,0x1000
+            0xED, 0xB0,         //      LDIR
+            0x18, 0xE8,         //      JR loop
+        } },
+    },
+    TStatesPerFrame
+};
+
+static const Workload IOLoop
+{
+    "io-loop",
+    {
+        { ProgramAddress, {
+            0xF3,               //      DI
+            0x01, 0xFE, 0x00,   //      LD BC,0x00FE
+            0xDB, 0xFE,         // loop IN A,(0xFE)
+            0xD3, 0xFE,         //      OUT (0xFE),A
+            0xED, 0x78,         //      IN A,(C)
+            0xED, 0x79,         //      OUT (C),A
+            0xED, 0x50,         //      IN D,(C)
+            0xED, 0x59,         //      OUT (C),E
+            0x18, 0xF2,         //      JR loop
+        } },
+    },
+    TStatesPerFrame
+};
+
+// IM 2 with an interrupt every display line, the handler takes about half of the T-states
+static const Workload InterruptLoop
+{
+    "interrupt-heavy",
+    {
+        { ProgramAddress, {
+            0xF3,               //      DI
+            0x3E, 0x90,         //      LD A,0x90
+            0xED, 0x47,         //      LD I,A
+            0xED, 0x5E,         //      IM 2
+            0x31, 0x00, 0xFF,   //      LD SP,0xFF00
+            0xFB,               //      EI
+            0x13,               // loop INC DE
+            0x7B,               //      LD A,E
+            0xAA,               //      XOR D
+            0x18, 0xFB,         //      JR loop
+        } },
+        // Vector table: any byte on the data bus leads to 0x9191
+        { 0x9000, std::vector<uint8_t>(0x101, 0x91) },
+        { 0x9191, {
+            0xF5,               //      PUSH AF
+            0xE5,               //      PUSH HL
+            0x2A, 0x00, 0xA0,   //      LD HL,(0xA000)
+            0x23,               //      INC HL
+            0x22, 0x00, 0xA0,   //      LD (0xA000),HL
+            0xE1,               //      POP HL
+            0xF1,               //      POP AF
+            0xFB,               //      EI
+            0xED, 0x4D,         //      RETI
+        } },
+    },
+    224
+};
+
+static const ExecutionMode Modes[]{ ExecutionMode::Interpreter, ExecutionMode::BlockCache, ExecutionMode::Recompiler };
+
+static const char *ModeName(ExecutionMode mode)
+{
+    switch (mode)
+    {
+    case ExecutionMode::Interpreter:
+        return "interpreter";
+    case ExecutionMode::BlockCache:
+        return "blockcache";
+    case ExecutionMode::Recompiler:
+        return "recompiler";
+    case ExecutionMode::Lockstep:
+        return "lockstep";
+    }
+    return "unknown";
+}
+
+static Result Run(const Workload &workload, ExecutionMode mode, const ByteVector &rom, uint64_t frames)
+{
+    std::vector<uint8_t> memory(MemorySize);
+    std::copy_n(rom.begin(), std::min(rom.size(), ROMSize), memory.begin());
+    for (auto const &patch : workload.Program)
+        std::copy(patch.Code.begin(), patch.Code.end(), memory.begin() + patch.Address);
+
+    FloatingBus bus;
+    auto cpu = std::make_unique<Z80>(ClockFreq);
+    cpu->MapROM(0, ROMSize, memory.data());
+    cpu->MapRAM(static_cast<uint16_t>(ROMSize), MemorySize - ROMSize, memory.data() + ROMSize);
+    cpu->AddIOMapping(IOMapping<uint16_t>{ bus, IOAddressDecode<uint16_t>{ 0x0000, 0x0000 } });
+    cpu->SetExecutionMode(mode);
+    cpu->Reset();
+    if (!workload.Program.empty())
+        cpu->GetRegisters().PC = ProgramAddress;
+
+    uint64_t tstates = frames * TStatesPerFrame;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t clock = 0; clock < tstates; clock += workload.InterruptPeriod)
+    {
+        cpu->RequestInterrupt(InterruptLength);
+        if (cpu->ExecuteCycles(workload.InterruptPeriod) == RunExitReason::Error)
+            break;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return { cpu->GetInstructionCount(), cpu->GetCPUClock(), std::chrono::duration<double>(end - start).count() };
+}
+
+static void Usage()
+{
+    std::cout << "Usage: z80-bench [--json] [--frames <count>] [--rom <file>]\n"
+        "  --json    print the results as JSON instead of a table\n"
+        "  --frames  emulated frames per run, default 500 (10 seconds of emulated time)\n";
+}
+
+int main(int argc, char *argv[])
+{
+    bool json{};
+    uint64_t frames{ 500 };
+    std::string romPath{ std::string(ROM_DIR) + "/spec48.rom" };
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option{ argv[i] };
+        if (option == "--json")
+            json = true;
+        else if ((option == "--frames") && (i + 1 < argc))
+            frames = std::stoull(argv[++i]);
+        else if ((option == "--rom") && (i + 1 < argc))
+            romPath = argv[++i];
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    std::ifstream file{ romPath, std::ios::binary };
+    if (!file)
+    {
+        std::cerr << "Cannot open ROM " << romPath << std::endl;
+        return 1;
+    }
+    ByteVector rom{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    bool consistent{ true };
+    bool first{ true };
+    if (json)
+        std::cout << "{\n  \"benchmark\": \"z80-bench\",\n  \"frames\": " << frames << ",\n  \"results\": [";
+    else
+        std::cout << std::left << std::setw(16) << "workload" << std::setw(12) << "mode" << std::right
+            << std::setw(12) << "MIPS" << std::setw(16) << "T-states/s" << std::setw(12) << "ns/instr" << "\n";
+    for (const Workload *workload : { &ROMBoot, &ALULoop, &LDIRLoop, &IOLoop, &InterruptLoop })
+    {
+        Result reference{};
+        for (ExecutionMode mode : Modes)
+        {
+            Result best{};
+            for (int repetition = 0; repetition < Repetitions; ++repetition)
+            {
+                Result result = Run(*workload, mode, rom, frames);
+                if ((repetition == 0) || (result.Seconds < best.Seconds))
+                    best = result;
+            }
+            // All modes must run the exact same instruction stream, otherwise the numbers do not compare
+            if (mode == Modes[0])
+                reference = best;
+            else if ((best.Instructions != reference.Instructions) || (best.TStates != reference.TStates))
+            {
+                std::cerr << workload->Name << ": " << ModeName(mode) << " diverges from " << ModeName(Modes[0]) << std::endl;
+                consistent = false;
+            }
+
+            double seconds = std::max(best.Seconds, 1e-9);
+            double mips = static_cast<double>(best.Instructions) / seconds / 1e6;
+            double tstatesPerSecond = static_cast<double>(best.TStates) / seconds;
+            double nsPerInstruction = best.Instructions ? seconds * 1e9 / static_cast<double>(best.Instructions) : 0.0;
+            if (json)
+            {
+                std::cout << (first ? "\n" : ",\n") << "    { \"workload\": \"" << workload->Name
+                    << "\", \"mode\": \"" << ModeName(mode)
+                    << "\", \"instructions\": " << best.Instructions
+                    << ", \"tstates\": " << best.TStates
+                    << ", \"seconds\": " << std::setprecision(6) << best.Seconds
+                    << ", \"mips\": " << mips
+                    << ", \"tstates_per_second\": " << std::fixed << std::setprecision(0) << tstatesPerSecond << std::defaultfloat
+                    << ", \"ns_per_instruction\": " << std::setprecision(4) << nsPerInstruction << " }";
+            }
+            else
+            {
+                std::cout << std::left << std::setw(16) << workload->Name << std::setw(12) << ModeName(mode) << std::right
+                    << std::fixed << std::setprecision(1) << std::setw(12) << mips
+                    << std::setprecision(0) << std::setw(16) << tstatesPerSecond
+                    << std::setprecision(2) << std::setw(12) << nsPerInstruction << std::defaultfloat << "\n";
+            }
+            first = false;
+        }
+    }
+    if (json)
+        std::cout << "\n  ]\n}\n";
+    return consistent ? 0 : 1;
+}
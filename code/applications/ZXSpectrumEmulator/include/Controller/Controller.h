@@ -1,6 +1,11 @@
 #pragma once
 
+#include <memory>
+#include <string>
+
+#include "Controller/FramePacer.h"
 #include "Model/ISystem.h"
+#include "Model/ZXSpectrumModel.h"
 
 class Model;
 class MainView;
@@ -10,7 +15,9 @@ class Controller
 private:
     Model &m_model;
     MainView &m_mainView;
+    const ZXSpectrumModel *m_machine;
     std::shared_ptr<ISystem> m_system;
+    FramePacer m_framePacer;
     bool m_debug;
 
 public:
@@ -22,6 +29,16 @@ public:
 
     bool Init();
     void SetDebug(bool on);
+    void SetPacingMode(PacingMode mode);
+    // Model to emulate, takes effect in Init
+    void SetMachine(const ZXSpectrumModel &machine);
+    // Creates and initializes the system for the machine, with the ROM from romPath. Returns nullptr if the ROM cannot
+    // be loaded
+    static std::shared_ptr<ISystem> CreateSystem(const ZXSpectrumModel &machine, const std::string &romPath);
+    static std::shared_ptr<ISystem> CreateSystem(const ZXSpectrumModel &machine, const ByteVector &romContents);
+    static bool LoadROMFile(const std::string &romPath, ByteVector &romContents);
+    // ROM of the machine in the ROM directory of the build
+    static std::string DefaultROMPath(const ZXSpectrumModel &machine);
 
     bool Run();
     bool Thread();
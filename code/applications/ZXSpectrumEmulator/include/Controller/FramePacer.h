@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+enum class PacingMode
+{
+    // Emulated time runs at the speed of the real machine
+    RealTime,
+    // Fixed multiples of real time
+    Double,
+    Quadruple,
+    // Frames are run back to back without waiting
+    Unthrottled,
+};
+
+// Paces emulated frames against the host clock.
+// Deadlines are absolute (start + n * period), so rounding and scheduling jitter do not accumulate into drift.
+// If the host falls behind by more than a few frames (debugger, system stall), the schedule is restarted
+// instead of running a burst of catch-up frames.
+class FramePacer
+{
+private:
+    uint64_t m_framePeriodNanoSeconds;
+    PacingMode m_mode;
+    uint64_t m_startTime;
+    uint64_t m_frameCount;
+
+public:
+    FramePacer();
+    FramePacer(const FramePacer &) = delete;
+    FramePacer(FramePacer &&) = delete;
+
+    FramePacer &operator = (const FramePacer &) = delete;
+    FramePacer &operator = (FramePacer &&) = delete;
+
+    void SetFramePeriod(uint64_t frameTStates, uint64_t cpuClockFreq);
+    uint64_t GetFramePeriod() const { return m_framePeriodNanoSeconds; }
+    void SetMode(PacingMode mode);
+    PacingMode GetMode() const { return m_mode; }
+
+    // Restarts the schedule at the current host time
+    void Start();
+    // Waits until the deadline of the next frame
+    void WaitForNextFrame();
+
+private:
+    uint64_t ScaledFramePeriod() const;
+};
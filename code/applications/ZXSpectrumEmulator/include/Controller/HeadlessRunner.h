@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "Model/ISystem.h"
+#include "Model/ZXSpectrumModel.h"
+
+struct HeadlessOptions
+{
+    const ZXSpectrumModel *Machine;
+    // Empty for the machine's ROM in the ROM directory of the build
+    std::string ROMPath;
+    uint64_t FrameCount;
+    // Empty for no key input
+    std::string KeyScriptPath;
+    ExecutionMode Mode;
+    // More than one runs independent copies of the machine in a MachinePool, and only the state after the last frame
+    // is written, one line per instance
+    std::size_t Instances;
+};
+
+// Runs the emulator without window, video or audio device, for batch regression runs. Frames are run back to back.
+// After every frame a line with the frame number, a hash of the display memory and a hash of the CPU state (registers
+// and clock) is written, so two runs compare with diff
+class HeadlessRunner
+{
+public:
+    static constexpr uint64_t FNVOffsetBasis = 0xCBF29CE484222325;
+    static constexpr uint64_t FNVPrime = 0x00000100000001B3;
+
+private:
+    std::ostream &m_output;
+    // Sorted by frame
+    std::vector<KeyEvent> m_keyScript;
+
+public:
+    explicit HeadlessRunner(std::ostream &output);
+    HeadlessRunner(const HeadlessRunner &) = delete;
+    HeadlessRunner(HeadlessRunner &&) = delete;
+
+    HeadlessRunner &operator = (const HeadlessRunner &) = delete;
+    HeadlessRunner &operator = (HeadlessRunner &&) = delete;
+
+    // One event per line: frame number, key name as in ZXKey (A, Key1, Enter, CapsShift, ...) and "down" or "up".
+    // Empty lines and lines starting with # are skipped
+    bool LoadKeyScript(std::istream &script);
+    // False if the system cannot be created or the CPU fails
+    bool Run(const HeadlessOptions &options);
+
+    // 64 bit FNV-1a
+    static uint64_t Hash(const uint8_t *data, std::size_t size, uint64_t hash = FNVOffsetBasis);
+    static uint64_t ScreenHash(ISystem &system);
+    static uint64_t CPUHash(ISystem &system);
+
+private:
+    bool RunInstances(const HeadlessOptions &options, const std::string &romPath);
+    void WriteHashes(uint64_t index, uint64_t screenHash, uint64_t cpuHash);
+    void FeedKeyEvents(ISystem &system, std::size_t &nextEvent, uint64_t frame) const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Model/ISystem.h"
+#include "Model/ZXSpectrumModel.h"
+
+// One machine to run in the pool. The callbacks are called on the worker thread that runs the machine and may be empty
+struct MachineJob
+{
+    const ZXSpectrumModel *Machine;
+    // Empty for the machine's ROM in the ROM directory of the build
+    std::string ROMPath;
+    uint64_t FrameCount;
+    ExecutionMode Mode;
+    std::function<void (ISystem &system, uint64_t frame)> BeforeFrame;
+    // After the last frame, also when the machine stopped early
+    std::function<void (ISystem &system, uint64_t framesRun)> Finished;
+};
+
+struct MachineResult
+{
+    bool Succeeded;
+    uint64_t FramesRun;
+};
+
+// Runs independent machines on worker threads that are each pinned to a core. Machines share nothing but the ROM
+// images, which are read once per run. A worker runs one machine to completion before it takes the next job, so a
+// machine stays on one core
+class MachinePool
+{
+private:
+    std::size_t m_workerCount;
+
+public:
+    // Zero for one worker per hardware thread
+    explicit MachinePool(std::size_t workerCount = 0);
+    MachinePool(const MachinePool &) = delete;
+    MachinePool(MachinePool &&) = delete;
+
+    MachinePool &operator = (const MachinePool &) = delete;
+    MachinePool &operator = (MachinePool &&) = delete;
+
+    std::size_t GetWorkerCount() const;
+    // Blocks until all jobs are done, results are in job order
+    std::vector<MachineResult> Run(const std::vector<MachineJob> &jobs);
+
+private:
+    static MachineResult RunJob(const MachineJob &job, const ByteVector *romContents);
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model/AudioFilters.h"
+#include "Model/ICPU.h"
+#include "Model/IOGeneric.h"
+
+// AY-3-8912 programmable sound generator, as on the 128K models. Port 0xFFFD selects a register (and reads it back),
+// port 0xBFFD writes the selected register. The chip is clocked at half the CPU clock.
+// The tone, noise and envelope generators are run at the chip rate (one step per 8 chip clocks) in blocks: between
+// two register writes nothing changes but the counters, so a block is generated generator by generator into gate and
+// volume buffers, which are then mixed with straight multiply-adds. At the end of the frame the chip rate signal is
+// decimated to the host sample rate with a polyphase FIR, again a plain dot product per output sample
+class AY38912
+    : public IIOAccess<uint16_t>
+{
+public:
+    static constexpr std::size_t RegisterCount = 16;
+    // CPU T-states per generator step: 8 chip clocks at half the CPU clock
+    static constexpr uint64_t TStatesPerTick = 16;
+    // Generator steps done in one pass, small enough for the buffers to stay in the L1 cache
+    static constexpr std::size_t BlockSize = 256;
+    // Taps of the decimation filter, and number of filter phases between two chip samples
+    static constexpr std::size_t FilterTaps = 32;
+    static constexpr std::size_t FilterPhases = 64;
+
+    enum Register : uint8_t
+    {
+        ToneAFine, ToneACoarse, ToneBFine, ToneBCoarse, ToneCFine, ToneCCoarse,
+        NoisePeriod, Mixer, AmplitudeA, AmplitudeB, AmplitudeC,
+        EnvelopeFine, EnvelopeCoarse, EnvelopeShape, IOPortA, IOPortB,
+    };
+
+private:
+    struct ToneChannel
+    {
+        uint32_t Counter;
+        uint8_t Output;
+    };
+
+    ICPU &m_cpu;
+    uint64_t m_cpuClockFreq;
+    uint64_t m_sampleRate;
+    std::array<uint8_t, RegisterCount> m_registers;
+    uint8_t m_selectedRegister;
+
+    // Generator state
+    std::array<ToneChannel, 3> m_tones;
+    uint32_t m_noiseCounter;
+    uint32_t m_noiseShift;
+    uint32_t m_envelopeCounter;
+    int m_envelopeStep;
+    uint8_t m_envelopeAttack;
+    bool m_envelopeHold;
+    bool m_envelopeAlternate;
+    bool m_envelopeHolding;
+
+    // Per block: tone and noise gates (0 or 1), envelope volume
+    std::array<std::array<float, BlockSize>, 3> m_toneGates;
+    std::array<float, BlockSize> m_noiseGates;
+    std::array<float, BlockSize> m_envelopeVolumes;
+
+    std::array<std::array<float, FilterTaps>, FilterPhases> m_filter;
+    // Chip rate signal of the frame, after FilterTaps samples of the previous frame
+    std::vector<float> m_chipSamples;
+    std::size_t m_ticksDone;
+    // T-states from the frame start to the first generator step of the frame
+    uint64_t m_tickOffset;
+    uint64_t m_frameStartClock;
+    // Start of the frame on the output sample grid, in units of 1 / m_cpuClockFreq samples
+    uint64_t m_frameStartFraction;
+    std::vector<float> m_samples;
+    DCBlocker m_dcBlocker;
+
+public:
+    // maxFrameTStates limits the length of a frame, including instructions overrunning the end of the frame
+    AY38912(ICPU &cpu, uint64_t cpuClockFreq, uint64_t sampleRate, uint64_t maxFrameTStates);
+    AY38912(const AY38912 &) = delete;
+    AY38912(AY38912 &&) = delete;
+
+    AY38912 &operator = (const AY38912 &) = delete;
+    AY38912 &operator = (AY38912 &&) = delete;
+
+    void Reset();
+    // Starts a frame at the given CPU clock
+    void StartFrame(uint64_t frameStartClock);
+    // Generates the rest of the frame, which lasted the given number of T-states, and decimates it. Returns the number
+    // of samples, on the same sample grid as BandLimitedSynth with the same clock and sample rate. Samples are
+    // centred on zero, full scale is 1, and stay valid until the next call
+    std::size_t EndFrame(uint64_t frameTStates);
+    const float *Samples() const { return m_samples.data(); }
+
+    // Registers, generators and the position of the frame on the sample grid. The samples of the frame so far and the
+    // output filter are not saved, they only shape the sound for a moment after loading
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+
+    uint8_t GetRegister(uint8_t index) const { return m_registers[index & 0x0F]; }
+    void SetRegister(uint8_t index, uint8_t value);
+
+    void Write8(uint16_t address, uint8_t value) override;
+    void Read8(uint16_t address, uint8_t &value) override;
+    void Read16(uint16_t /*address*/, uint16_t & /*value*/) override {};
+    void Read32(uint16_t /*address*/, uint32_t & /*value*/) override {};
+    void Read64(uint16_t /*address*/, uint64_t & /*value*/) override {};
+
+private:
+    // Runs the generators up to (not including) the step at the given frame T-state
+    void RunUntil(uint64_t frameTState);
+    void RunTicks(std::size_t count);
+    void RunBlock(float *output, std::size_t count);
+    void ResetEnvelope();
+    uint32_t TonePeriod(std::size_t channel) const;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+// Fills taps with one phase of a Blackman windowed sinc low-pass kernel, normalised to sum to 1 so a step keeps its
+// height. cutoff is relative to the tap rate. The kernel is centred between taps tapCount / 2 - 1 and tapCount / 2,
+// moved right by offset taps (0 to 1)
+void BuildWindowedSincKernel(double cutoff, double offset, float *taps, std::size_t tapCount);
+
+// First order high-pass removing the DC offset of the output, the pole is about 8 Hz at 48 kHz
+class DCBlocker
+{
+private:
+    static constexpr float Pole = 0.999F;
+
+    float m_input;
+    float m_output;
+
+public:
+    DCBlocker()
+        : m_input{}
+        , m_output{}
+    {
+    }
+
+    void Reset()
+    {
+        m_input = {};
+        m_output = {};
+    }
+    float Process(float input)
+    {
+        m_output = input - m_input + Pole * m_output;
+        m_input = input;
+        return m_output;
+    }
+};
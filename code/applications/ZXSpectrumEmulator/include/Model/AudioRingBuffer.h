@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Carries 16 bit PCM samples from the emulation thread to the audio device callback.
+// Single producer, single consumer. Read and write positions only ever increase, so full and empty are told apart
+// without a spare slot, and neither side takes a lock. Samples that do not fit are dropped by the producer
+class AudioRingBuffer
+{
+public:
+    // Power of two, about 340 ms at 48 kHz
+    static constexpr std::size_t Capacity = 16384;
+
+private:
+    static constexpr std::size_t IndexMask = Capacity - 1;
+
+    std::array<int16_t, Capacity> m_samples;
+    std::atomic<uint64_t> m_writePosition;
+    std::atomic<uint64_t> m_readPosition;
+
+public:
+    AudioRingBuffer();
+    AudioRingBuffer(const AudioRingBuffer &) = delete;
+    AudioRingBuffer(AudioRingBuffer &&) = delete;
+
+    AudioRingBuffer &operator = (const AudioRingBuffer &) = delete;
+    AudioRingBuffer &operator = (AudioRingBuffer &&) = delete;
+
+    // Producer. Returns the number of samples written
+    std::size_t Write(const int16_t *samples, std::size_t count);
+    // Consumer. Returns the number of samples read
+    std::size_t Read(int16_t *samples, std::size_t count);
+    // Number of samples waiting to be read
+    std::size_t Available() const;
+};
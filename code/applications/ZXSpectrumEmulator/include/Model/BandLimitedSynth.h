@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model/AudioFilters.h"
+
+// Turns a square wave given as level changes at clock times into PCM samples without aliasing.
+// Every change adds a band-limited step: the change is spread over KernelWidth samples by a windowed sinc kernel,
+// chosen from PhaseCount kernels by where the change falls between two samples. Summing the spread changes gives the
+// output level, which is then high-pass filtered to remove the DC offset of the square wave.
+// Clock times are counted from the start of the current frame
+class BandLimitedSynth
+{
+public:
+    static constexpr std::size_t PhaseCount = 32;
+    static constexpr std::size_t KernelWidth = 16;
+
+private:
+    uint64_t m_clockRate;
+    uint64_t m_sampleRate;
+    uint64_t m_maxFrameClocks;
+    // Each kernel sums to 1, so a change of d moves the output by exactly d
+    std::array<std::array<float, KernelWidth>, PhaseCount> m_kernels;
+    // Level changes spread over the samples of the frame, plus the tail spilling into the next frame
+    std::vector<float> m_deltas;
+    std::vector<int16_t> m_samples;
+    // Start of the frame, as a fraction of a sample in units of 1 / m_clockRate
+    uint64_t m_frameStartFraction;
+    float m_level;
+    DCBlocker m_dcBlocker;
+
+public:
+    BandLimitedSynth(uint64_t clockRate, uint64_t sampleRate, uint64_t maxFrameClocks);
+    BandLimitedSynth(const BandLimitedSynth &) = delete;
+    BandLimitedSynth(BandLimitedSynth &&) = delete;
+
+    BandLimitedSynth &operator = (const BandLimitedSynth &) = delete;
+    BandLimitedSynth &operator = (BandLimitedSynth &&) = delete;
+
+    void Reset();
+    // Changes the output level by delta (full scale is 1) at the given clock time
+    void AddDelta(uint64_t clockTime, float delta);
+    // Produces the samples of a frame of the given length. Returns the number of samples, which stay valid until the
+    // next call
+    std::size_t EndFrame(uint64_t frameClocks);
+    const int16_t *Samples() const { return m_samples.data(); }
+};
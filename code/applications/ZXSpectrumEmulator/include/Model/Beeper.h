@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Model/BandLimitedSynth.h"
+#include "Model/ICPU.h"
+#include "Model/IOGeneric.h"
+
+// Speaker driven by bits 3 (MIC) and 4 (EAR) of port 0xFE. Every change of the speaker level is passed to the
+// synthesizer at the T-state it was written at, at the end of the frame the frame is converted to PCM
+class Beeper
+    : public IIOAccess<uint16_t>
+{
+public:
+    static constexpr uint64_t SampleRate = 48000;
+    static constexpr uint8_t MICBit = 0x08;
+    static constexpr uint8_t EARBit = 0x10;
+
+private:
+    ICPU &m_cpu;
+    BandLimitedSynth m_synth;
+    uint64_t m_frameStartClock;
+    // EAR and MIC bits last written
+    uint8_t m_bits;
+
+public:
+    // maxFrameTStates limits the length of a frame, including instructions overrunning the end of the frame
+    Beeper(ICPU &cpu, uint64_t cpuClockFreq, uint64_t maxFrameTStates);
+    Beeper(const Beeper &) = delete;
+    Beeper(Beeper &&) = delete;
+
+    Beeper &operator = (const Beeper &) = delete;
+    Beeper &operator = (Beeper &&) = delete;
+
+    void Reset();
+    // Starts a frame at the given CPU clock
+    void StartFrame(uint64_t frameStartClock);
+    // Converts the frame, which lasted the given number of T-states, to samples. Returns the number of samples, which
+    // stay valid until the next call
+    std::size_t EndFrame(uint64_t frameTStates);
+    const int16_t *Samples() const { return m_synth.Samples(); }
+    // Speaker bits and frame start. Loading moves the speaker to the loaded level at the current CPU clock, so load the
+    // CPU first
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+
+    void Write8(uint16_t address, uint8_t value) override;
+
+    void Read8(uint16_t /*address*/, uint8_t & /*value*/) override {};
+    void Read16(uint16_t /*address*/, uint16_t & /*value*/) override {};
+    void Read32(uint16_t /*address*/, uint32_t & /*value*/) override {};
+    void Read64(uint16_t /*address*/, uint64_t & /*value*/) override {};
+};
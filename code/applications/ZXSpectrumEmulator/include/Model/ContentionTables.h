@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model/ZXSpectrumModel.h"
+
+// How an I/O cycle meets the ULA: whether the port is the ULA's (A0 low), and whether the port is also an address in
+// contended memory. Ports that are neither are never delayed
+enum class IOContention
+{
+    ULAPort,
+    ULAPortContendedAddress,
+    ContendedAddress,
+    Count,
+};
+
+// Delays the ULA adds to a bus cycle of the CPU, by the T-state from the start of the frame the cycle starts at. While
+// the ULA fetches the display, each 8 T-state group of a display line holds the CPU for 6, 5, 4, 3, 2, 1, 0, 0
+// T-states. I/O cycles test for contention at up to four points, their total delay is also precomputed, so applying
+// contention is a single lookup
+class ContentionTables
+{
+public:
+    static constexpr std::array<uint8_t, 8> DelayPattern{ 6, 5, 4, 3, 2, 1, 0, 0 };
+    static constexpr uint32_t DisplayLines = 192;
+    static constexpr uint32_t ContendedTStatesPerLine = 128;
+
+private:
+    uint64_t m_frameTStates;
+    std::vector<uint8_t> m_memoryDelay;
+    std::array<std::vector<uint8_t>, static_cast<std::size_t>(IOContention::Count)> m_ioDelay;
+
+public:
+    explicit ContentionTables(const ZXSpectrumModel &model);
+    ContentionTables(const ContentionTables &) = delete;
+    ContentionTables(ContentionTables &&) = delete;
+
+    ContentionTables &operator = (const ContentionTables &) = delete;
+    ContentionTables &operator = (ContentionTables &&) = delete;
+
+    // T-states are taken modulo the frame length, instructions overrunning a frame are in the uncontended top border
+    uint8_t MemoryDelay(uint64_t frameTState) const
+    {
+        return m_memoryDelay[Index(frameTState)];
+    }
+    // Total delay of a 4 T-state I/O cycle
+    uint8_t IODelay(IOContention contention, uint64_t frameTState) const
+    {
+        return m_ioDelay[static_cast<std::size_t>(contention)][Index(frameTState)];
+    }
+
+private:
+    std::size_t Index(uint64_t frameTState) const
+    {
+        return static_cast<std::size_t>((frameTState < m_frameTStates) ? frameTState : frameTState % m_frameTStates);
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "Model/ULARenderer.h"
+
+// A completed video frame
+struct VideoFrame
+{
+    ULAScreen Screen;
+    // Counts from 1 after reset
+    uint64_t FrameNumber;
+    // Lines changed since frame FrameNumber - 1
+    ULADirtyLines ChangedLines;
+};
+
+// Hands completed frames from the emulation thread to the render thread, without either side ever waiting.
+// Triple buffered: the producer fills the back slot, the consumer reads the front slot, and the third slot holds the
+// latest completed frame. Publishing and acquiring swap a slot with the ready slot in one atomic exchange, so a frame
+// that is not acquired before the next one is published is dropped, never queued.
+// One thread may publish, one other thread may acquire
+class FrameMailbox
+{
+public:
+    static constexpr std::size_t SlotCount = 3;
+
+private:
+    // The ready slot index, with a flag set when it holds a frame the consumer has not seen
+    static constexpr uint8_t IndexMask = 0x03;
+    static constexpr uint8_t FreshFlag = 0x04;
+
+    std::array<VideoFrame, SlotCount> m_slots;
+    // Producer only: lines of each slot that are behind the screen being published
+    std::array<ULADirtyLines, SlotCount> m_slotPendingLines;
+    uint8_t m_back;
+    std::atomic<uint8_t> m_ready;
+    // Consumer only
+    uint8_t m_front;
+
+public:
+    FrameMailbox();
+    FrameMailbox(const FrameMailbox &) = delete;
+    FrameMailbox(FrameMailbox &&) = delete;
+
+    FrameMailbox &operator = (const FrameMailbox &) = delete;
+    FrameMailbox &operator = (FrameMailbox &&) = delete;
+
+    // Producer. Copies the changed part of screen into the back slot and makes it the latest frame.
+    // changedLines are the lines changed since the previous publish
+    void Publish(const ULAScreen &screen, const ULADirtyLines &changedLines, uint64_t frameNumber);
+    // Consumer. Returns the latest frame if it was published since the last call, nullptr otherwise. The frame stays
+    // valid until the next call
+    const VideoFrame *Acquire();
+};
@@ -5,6 +5,32 @@
 
 using ByteVector = std::vector<uint8_t>;
 
+// Reason for returning from a batch of instructions
+enum class RunExitReason
+{
+    // The T-state budget was used up
+    BudgetSpent,
+    // The next instruction is on a breakpoint
+    Breakpoint,
+    // The CPU is halted
+    Halted,
+    // An instruction could not be executed
+    Error,
+};
+
+// How the CPU executes code
+enum class ExecutionMode
+{
+    // Fetch and decode every instruction
+    Interpreter,
+    // Decode straight-line blocks once, and execute them from a cache
+    BlockCache,
+    // As BlockCache, hot blocks are translated to native code where the host supports it
+    Recompiler,
+    // As Recompiler, every native block is run again by the interpreter and the results are compared
+    Lockstep,
+};
+
 class ICPU
 {
 public:
@@ -15,8 +41,19 @@ public:
     virtual bool IsHalted() = 0;
     virtual std::string DumpRegisters() = 0;
 
-    virtual bool LoadROM(const ByteVector &romContents) = 0;
     virtual bool ExecuteInstruction() = 0;
+    // Executes instructions until at least the given number of T-states has passed, or another exit reason occurs
+    virtual RunExitReason ExecuteCycles(uint64_t tstates) = 0;
+
+    // Raises the maskable interrupt line for the given number of T-states. If interrupts are disabled during that
+    // time, the interrupt is lost
+    virtual void RequestInterrupt(uint64_t activeTStates) = 0;
+    // Raises the non-maskable interrupt
+    virtual void RequestNMI() = 0;
+
+    virtual void SetBreakpoint(uint64_t address) = 0;
+    virtual void ClearBreakpoint(uint64_t address) = 0;
+    virtual void SetExecutionMode(ExecutionMode mode) = 0;
 
     virtual uint64_t GetCPUClock() = 0;
     virtual uint64_t GetCPUClockFreq() = 0;
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 template<class AddressType>
@@ -19,6 +23,14 @@ public:
     virtual void Read64(AddressType address, uint64_t& value) = 0;
 };
 
+// Address line decoding: a mapping answers to all addresses where (address & mask) == match
+template<class AddressType>
+struct IOAddressDecode
+{
+    AddressType mask;
+    AddressType match;
+};
+
 template<class AddressType>
 class IOMapping
 {
@@ -26,18 +38,32 @@ private:
     IIOAccess<AddressType>& m_device;
     AddressType m_startAddress;
     AddressType m_endAddress;
+    AddressType m_mask;
+    AddressType m_match;
 
 public:
     IOMapping(IIOAccess<AddressType>& device, AddressType startAddress, AddressType endAddress)
         : m_device{ device }
         , m_startAddress{ startAddress }
         , m_endAddress{ endAddress }
+        , m_mask{}
+        , m_match{}
+    {
+    }
+    IOMapping(IIOAccess<AddressType>& device, IOAddressDecode<AddressType> decode)
+        : m_device{ device }
+        , m_startAddress{ std::numeric_limits<AddressType>::min() }
+        , m_endAddress{ std::numeric_limits<AddressType>::max() }
+        , m_mask{ decode.mask }
+        , m_match{ decode.match }
     {
     }
     IOMapping(const IOMapping &other)
         : m_device{ other.m_device }
         , m_startAddress{ other.m_startAddress }
         , m_endAddress{ other.m_endAddress }
+        , m_mask{ other.m_mask }
+        , m_match{ other.m_match }
     {
     }
     IOMapping(IOMapping &&) = delete;
@@ -45,9 +71,28 @@ public:
     IOMapping &operator =(const IOMapping &) = delete;
     IOMapping &operator =(IOMapping &&) = delete;
 
+    IIOAccess<AddressType> &Device()
+    {
+        return m_device;
+    }
+
     bool IsHit(AddressType address) const
     {
-        return ((address >= m_startAddress) || (address < m_endAddress));
+        return ((address >= m_startAddress) && (address <= m_endAddress) && ((address & m_mask) == m_match));
+    }
+    // Returns true if any address with the given low byte can hit this mapping
+    bool IsCandidateForLowByte(uint8_t lowByte) const
+    {
+        if ((lowByte & m_mask & 0xFF) != (m_match & 0xFF))
+            return false;
+        if (static_cast<std::size_t>(m_endAddress - m_startAddress) >= 0xFF)
+            return true;
+        for (std::size_t address = m_startAddress; address <= m_endAddress; ++address)
+        {
+            if ((address & 0xFF) == lowByte)
+                return true;
+        }
+        return false;
     }
 
     void Write8(AddressType address, uint8_t value)
@@ -84,69 +129,98 @@ public:
 template<class AddressType>
 using IOMappingSet = std::vector<IOMapping<AddressType>>;
 
+// I/O map with a precomputed decode table on the lower 8 address lines. Each entry holds the (usually single)
+// list of mappings that can answer for that low byte, so an access is an indexed lookup plus one mask compare.
+// The table is rebuilt whenever the mappings change.
 template<class AddressType>
 class GenericIOMap
 {
 private:
+    static constexpr std::size_t DecodeTableSize = 256;
+
     IOMappingSet<AddressType> m_mappings;
+    std::vector<IOMapping<AddressType> *> m_decodeCandidates;
+    std::array<uint16_t, DecodeTableSize + 1> m_decodeOffsets;
 
 public:
     GenericIOMap(const IOMappingSet<AddressType> &mappings)
         : m_mappings{ mappings}
+        , m_decodeCandidates{}
+        , m_decodeOffsets{}
     {
+        RebuildDecodeTable();
     }
+    GenericIOMap(const GenericIOMap &) = delete;
+    GenericIOMap(GenericIOMap &&) = delete;
+
+    GenericIOMap &operator =(const GenericIOMap &) = delete;
+    GenericIOMap &operator =(GenericIOMap &&) = delete;
+
     void AddIOMapping(const IOMapping<AddressType> &mapping)
     {
         m_mappings.push_back(mapping);
+        RebuildDecodeTable();
     }
 
     void Write8(AddressType address, uint8_t value)
     {
-        for (auto & mapping : m_mappings)
-        {
-            if (mapping.IsHit(address))
-            {
-                mapping.Write8(address, value);
-                break;
-            }
-        }
+        auto mapping = Decode(address);
+        if (mapping != nullptr)
+            mapping->Device().Write8(address, value);
     }
     void Write16(AddressType address, uint16_t value)
     {
-        for (auto & mapping : m_mappings)
-        {
-            if (mapping.IsHit(address))
-            {
-                mapping.Write16(address, value);
-                break;
-            }
-        }
+        auto mapping = Decode(address);
+        if (mapping != nullptr)
+            mapping->Device().Write16(address, value);
     }
     void Write32(AddressType address, uint32_t value);
     void Write64(AddressType address, uint64_t value);
 
+    // Unmapped ports read as a floating bus (all ones)
     void Read8(AddressType address, uint8_t& value)
     {
-        for (auto & mapping : m_mappings)
+        auto mapping = Decode(address);
+        if (mapping != nullptr)
+            mapping->Device().Read8(address, value);
+        else
+            value = 0xFF;
+    }
+    void Read16(AddressType address, uint16_t& value)
+    {
+        auto mapping = Decode(address);
+        if (mapping != nullptr)
+            mapping->Device().Read16(address, value);
+        else
+            value = 0xFFFF;
+    }
+    void Read32(AddressType address, uint32_t& value);
+    void Read64(AddressType address, uint64_t& value);
+
+private:
+    IOMapping<AddressType> *Decode(AddressType address)
+    {
+        auto index = static_cast<std::size_t>(address & 0xFF);
+        for (std::size_t i = m_decodeOffsets[index]; i < m_decodeOffsets[index + 1]; ++i)
         {
-            if (mapping.IsHit(address))
-            {
-                mapping.Read8(address, value);
-                break;
-            }
+            auto mapping = m_decodeCandidates[i];
+            if (mapping->IsHit(address))
+                return mapping;
         }
+        return nullptr;
     }
-    void Read16(AddressType address, uint16_t& value)
+    void RebuildDecodeTable()
     {
-        for (auto & mapping : m_mappings)
+        m_decodeCandidates.clear();
+        for (std::size_t lowByte = 0; lowByte < DecodeTableSize; ++lowByte)
         {
-            if (mapping.IsHit(address))
+            m_decodeOffsets[lowByte] = static_cast<uint16_t>(m_decodeCandidates.size());
+            for (auto &mapping : m_mappings)
             {
-                mapping.Read16(address, value);
-                break;
+                if (mapping.IsCandidateForLowByte(static_cast<uint8_t>(lowByte)))
+                    m_decodeCandidates.push_back(&mapping);
             }
         }
+        m_decodeOffsets[DecodeTableSize] = static_cast<uint16_t>(m_decodeCandidates.size());
     }
-    void Read32(AddressType address, uint32_t& value);
-    void Read64(AddressType address, uint64_t& value);
 };
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "Model/AudioRingBuffer.h"
+#include "Model/FrameMailbox.h"
 #include "Model/ICPU.h"
+#include "Model/KeyEventQueue.h"
+#include "Model/SystemState.h"
 
 #include <ostream>
 
@@ -17,8 +21,33 @@ public:
 
     virtual bool LoadROM(const ByteVector &romContents) = 0;
 
+    // Saves the CPU, memory and devices. RAM pages not written since the previous save are shared with that state
+    virtual void SaveState(SystemState &state) = 0;
+    // Continues from a saved state of the same model, fails for other models. Audio and frames already produced are
+    // not affected
+    virtual bool LoadState(const SystemState &state) = 0;
+    // Registers, clock and interrupt line, in the layout they have in SystemState::Data
+    virtual void SaveCPUState(ByteVector &buffer) = 0;
+
     virtual bool Disassemble(std::string &mnemonic) = 0;
     virtual bool ProcessInstruction() = 0;
+    virtual RunExitReason RunFor(uint64_t tstates) = 0;
+    // Runs the remainder of the current video frame, or a complete new frame
+    virtual RunExitReason RunFrame() = 0;
+    virtual uint64_t GetFrameTStates() = 0;
+    virtual uint64_t GetFrameCount() = 0;
+    virtual void SetExecutionMode(ExecutionMode mode) = 0;
+    // Completed frames are published here by the thread running the system, for one other thread to display
+    virtual FrameMailbox &GetFrames() = 0;
+    // Mono 16 bit PCM produced by the thread running the system, for one other thread to play
+    virtual AudioRingBuffer &GetAudio() = 0;
+    virtual uint64_t GetAudioSampleRate() = 0;
+    // Key transitions pushed by one other thread. The thread running the system applies them between runs of
+    // instructions, from the frame they are tagged with
+    virtual KeyEventQueue &GetKeyEvents() = 0;
+
+    // RAM bank shown by the ULA: display file followed by the attributes
+    virtual const uint8_t *GetDisplayMemory() = 0;
 
     virtual std::string DumpRegisters() = 0;
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "Model/KeyboardMatrix.h"
+
+// A key going down or up, applied to the matrix at the start of the given frame. Events tagged with a frame that has
+// already started are applied at the next point the system checks the queue
+struct KeyEvent
+{
+    uint64_t Frame;
+    ZXKey Key;
+    bool Pressed;
+};
+
+// Carries key events from the UI thread to the emulation thread.
+// Single producer, single consumer, with the same ever increasing positions as AudioRingBuffer. The consumer only
+// takes events that are due, so the emulation loop never waits for the UI and never takes a lock
+class KeyEventQueue
+{
+public:
+    // Power of two, far more than can be typed in a frame
+    static constexpr std::size_t Capacity = 256;
+
+private:
+    static constexpr std::size_t IndexMask = Capacity - 1;
+
+    std::array<KeyEvent, Capacity> m_events;
+    std::atomic<uint64_t> m_writePosition;
+    std::atomic<uint64_t> m_readPosition;
+
+public:
+    KeyEventQueue();
+    KeyEventQueue(const KeyEventQueue &) = delete;
+    KeyEventQueue(KeyEventQueue &&) = delete;
+
+    KeyEventQueue &operator = (const KeyEventQueue &) = delete;
+    KeyEventQueue &operator = (KeyEventQueue &&) = delete;
+
+    // Producer. Returns false if the queue is full, the event is dropped
+    bool Push(const KeyEvent &event);
+    // Consumer. Takes the oldest event if it is due in or before the given frame
+    bool PopDue(uint64_t frame, KeyEvent &event);
+    // Number of events waiting
+    std::size_t Available() const;
+};
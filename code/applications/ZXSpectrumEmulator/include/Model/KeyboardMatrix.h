@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Model/ICPU.h"
+
+// Keys of the 48K keyboard. The high nibble is the half-row, selected by a low address line A8 + row, the low nibble
+// is the data bit the key pulls low
+enum class ZXKey : uint8_t
+{
+    CapsShift = 0x00, Z = 0x01, X = 0x02, C = 0x03, V = 0x04,
+    A = 0x10, S = 0x11, D = 0x12, F = 0x13, G = 0x14,
+    Q = 0x20, W = 0x21, E = 0x22, R = 0x23, T = 0x24,
+    Key1 = 0x30, Key2 = 0x31, Key3 = 0x32, Key4 = 0x33, Key5 = 0x34,
+    Key0 = 0x40, Key9 = 0x41, Key8 = 0x42, Key7 = 0x43, Key6 = 0x44,
+    P = 0x50, O = 0x51, I = 0x52, U = 0x53, Y = 0x54,
+    Enter = 0x60, L = 0x61, K = 0x62, J = 0x63, H = 0x64,
+    Space = 0x70, SymbolShift = 0x71, M = 0x72, N = 0x73, B = 0x74,
+};
+
+// The 8 x 5 key matrix as seen by IN on port 0xFE. Every half-row whose address line is low drives the data bits of
+// its pressed keys low, so selecting several half-rows gives the AND of their rows
+class KeyboardMatrix
+{
+public:
+    static constexpr std::size_t RowCount = 8;
+    static constexpr uint8_t KeyBits = 0x1F;
+
+private:
+    // Pressed keys per half-row, a set bit is a pressed key
+    std::array<uint8_t, RowCount> m_rows;
+
+public:
+    KeyboardMatrix();
+    KeyboardMatrix(const KeyboardMatrix &) = delete;
+    KeyboardMatrix(KeyboardMatrix &&) = delete;
+
+    KeyboardMatrix &operator = (const KeyboardMatrix &) = delete;
+    KeyboardMatrix &operator = (KeyboardMatrix &&) = delete;
+
+    // Releases all keys
+    void Reset();
+    void SetKey(ZXKey key, bool pressed);
+    bool IsPressed(ZXKey key) const;
+    // Bits 0-4 as read from the port with the given high address byte, a pressed key reads 0. Bits 5-7 read 1
+    uint8_t Read(uint8_t addressHigh) const;
+
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+};
@@ -22,6 +22,19 @@ public:
     }
 };
 
+// 1 KB pages, fine grained enough for 16 KB banking and for trapping writes to display memory
+constexpr unsigned MemoryPageBits = 10;
+
+class PagedMemoryMap
+    : public GenericPagedMemoryMap<uint16_t, MemoryPageBits>
+{
+public:
+    PagedMemoryMap()
+        : GenericPagedMemoryMap<uint16_t, MemoryPageBits>{}
+    {
+    }
+};
+
 class ROM
     : public GenericROM<uint16_t>
 {
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model/ICPU.h"
+
+// ROM and RAM of the machine as 16 KB banks. The system maps banks into the CPU address space, switching a bank only
+// changes page pointers, the contents never move
+class MemoryBanks
+{
+public:
+    static constexpr std::size_t BankSize = 16384;
+
+private:
+    std::size_t m_romBankCount;
+    std::size_t m_ramBankCount;
+    uint8_t m_contendedRAMBanks;
+    std::vector<uint8_t> m_rom;
+    std::vector<uint8_t> m_ram;
+
+public:
+    // contendedRAMBanks has a bit set for every RAM bank shared with the ULA
+    MemoryBanks(std::size_t romBankCount, std::size_t ramBankCount, uint8_t contendedRAMBanks);
+    MemoryBanks(const MemoryBanks &) = delete;
+    MemoryBanks(MemoryBanks &&) = delete;
+
+    MemoryBanks &operator = (const MemoryBanks &) = delete;
+    MemoryBanks &operator = (MemoryBanks &&) = delete;
+
+    std::size_t ROMBankCount() const { return m_romBankCount; }
+    std::size_t RAMBankCount() const { return m_ramBankCount; }
+    uint8_t *ROMBank(std::size_t index) { return m_rom.data() + index * BankSize; }
+    uint8_t *RAMBank(std::size_t index) { return m_ram.data() + index * BankSize; }
+    const uint8_t *RAMBank(std::size_t index) const { return m_ram.data() + index * BankSize; }
+    bool IsContended(std::size_t ramBank) const { return (m_contendedRAMBanks >> ramBank) & 1; }
+
+    // Fills the ROM banks in order. Fails if the contents do not fit
+    bool LoadROM(const ByteVector &contents);
+};
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 template<class AddressType>
@@ -19,6 +24,39 @@ public:
     virtual void Read64(AddressType address, uint64_t& value) = 0;
 };
 
+// Notified of every CPU write to an observed RAM page, after the write
+template<class AddressType>
+class IMemoryWriteObserver
+{
+public:
+    virtual ~IMemoryWriteObserver() = default;
+
+    virtual void OnMemoryWrite(AddressType address) = 0;
+};
+
+enum class BusCycle
+{
+    OpcodeFetch,
+    MemoryRead,
+    MemoryWrite,
+    // A single T-state without a memory request, with the address still on the bus
+    Internal,
+};
+
+// Timing of a bus shared with another device, which holds the CPU clock while it uses the bus. Memory accesses are
+// only reported for contended pages, I/O cycles are all reported. The CPU clock is at the start of the cycle
+template<class AddressType>
+class IBusContention
+{
+public:
+    virtual ~IBusContention() = default;
+
+    // Called before the access
+    virtual void OnContendedAccess(AddressType address, BusCycle cycle) = 0;
+    // addressContended tells whether the port, taken as a memory address, is in a contended page
+    virtual void OnIOAccess(AddressType port, bool addressContended) = 0;
+};
+
 template<class AddressType>
 class MemoryMapping
 {
@@ -47,7 +85,7 @@ public:
 
     bool IsHit(AddressType address) const
     {
-        return ((address >= m_startAddress) || (address < m_endAddress));
+        return ((address >= m_startAddress) && (address <= m_endAddress));
     }
 
     void Write8(AddressType address, uint8_t value)
@@ -167,6 +205,10 @@ public:
         m_memory.reserve(m_maxAddress + 1);
         m_memory.resize(m_maxAddress + 1);
     }
+    uint8_t *Data(AddressType offset)
+    {
+        return m_memory.data() + static_cast<size_t>(offset);
+    }
     void Load(AddressType offset, AddressType size, const std::vector<uint8_t>& data)
     {
         std::copy(data.begin(), data.begin() + size, m_memory.begin() + offset);
@@ -287,6 +329,10 @@ public:
     {
         return m_size;
     }
+    uint8_t *Data()
+    {
+        return m_memorySpace.Data(m_offset);
+    }
     void Write8(AddressType /*address*/, uint8_t /*value*/)
     {
     }
@@ -352,6 +398,10 @@ public:
     {
         return m_size;
     }
+    uint8_t *Data()
+    {
+        return m_memorySpace.Data(m_offset);
+    }
 
     void Write8(AddressType address, uint8_t value)
     {
@@ -387,3 +437,323 @@ public:
         m_memorySpace.Read64(static_cast<AddressType>(address + m_offset), value);
     }
 };
+
+// Page granular memory map. Every page has a direct read and write pointer, so plain RAM / ROM accesses
+// take a shift, a load and an indexed access. Pages without direct pointers fall back to a device handler.
+// Writes to read-only pages go to a sink page. Contended RAM pages have no direct pointers either, their accesses
+// report to the bus contention first.
+template<class AddressType, unsigned PageBits>
+class GenericPagedMemoryMap
+{
+public:
+    static constexpr unsigned PageShift = PageBits;
+    static constexpr std::size_t PageSize = std::size_t{ 1 } << PageBits;
+    static constexpr std::size_t PageMask = PageSize - 1;
+    static constexpr std::size_t PageCount = (static_cast<std::size_t>(std::numeric_limits<AddressType>::max()) + 1) >> PageBits;
+
+private:
+    std::array<uint8_t *, PageCount> m_readPages;
+    std::array<uint8_t *, PageCount> m_writePages;
+    std::array<IMemoryAccess<AddressType> *, PageCount> m_handlers;
+    // Backing store of RAM pages whose writes go through WriteSlow, see TrapWrites and ObserveWrites
+    std::array<uint8_t *, PageCount> m_trappedPages;
+    // The next write to the page bumps its write generation
+    std::array<bool, PageCount> m_generationTraps;
+    std::array<IMemoryWriteObserver<AddressType> *, PageCount> m_writeObservers;
+    // Incremented on every trapped write and on every remap of a page
+    std::array<uint32_t, PageCount> m_writeGenerations;
+    // Backing store of contended RAM pages, see ContendAccesses
+    std::array<uint8_t *, PageCount> m_contendedPages;
+    IBusContention<AddressType> *m_contention;
+    // Incremented whenever pages are mapped or unmapped
+    uint32_t m_mappingGeneration;
+    std::vector<uint8_t> m_sinkPage;
+
+public:
+    GenericPagedMemoryMap()
+        : m_readPages{}
+        , m_writePages{}
+        , m_handlers{}
+        , m_trappedPages{}
+        , m_generationTraps{}
+        , m_writeObservers{}
+        , m_writeGenerations{}
+        , m_contendedPages{}
+        , m_contention{}
+        , m_mappingGeneration{}
+        , m_sinkPage(PageSize)
+    {
+    }
+    GenericPagedMemoryMap(const GenericPagedMemoryMap &) = delete;
+    GenericPagedMemoryMap(GenericPagedMemoryMap &&) = delete;
+
+    GenericPagedMemoryMap &operator = (const GenericPagedMemoryMap &) = delete;
+    GenericPagedMemoryMap &operator = (GenericPagedMemoryMap &&) = delete;
+
+    static std::size_t PageIndex(AddressType address)
+    {
+        return static_cast<std::size_t>(address) >> PageShift;
+    }
+
+    void MapReadWrite(AddressType startAddress, std::size_t size, uint8_t *data)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0));
+        ++m_mappingGeneration;
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            m_readPages[page] = data + offset;
+            m_writePages[page] = data + offset;
+            m_handlers[page] = nullptr;
+            ResetPage(page);
+        }
+    }
+    void MapReadOnly(AddressType startAddress, std::size_t size, uint8_t *data)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0));
+        ++m_mappingGeneration;
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            m_readPages[page] = data + offset;
+            m_writePages[page] = m_sinkPage.data();
+            m_handlers[page] = nullptr;
+            ResetPage(page);
+        }
+    }
+    void MapHandler(AddressType startAddress, std::size_t size, IMemoryAccess<AddressType> &handler)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0));
+        ++m_mappingGeneration;
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            m_readPages[page] = nullptr;
+            m_writePages[page] = nullptr;
+            m_handlers[page] = &handler;
+            ResetPage(page);
+        }
+    }
+    void Unmap(AddressType startAddress, std::size_t size)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0));
+        ++m_mappingGeneration;
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            m_readPages[page] = nullptr;
+            m_writePages[page] = nullptr;
+            m_handlers[page] = nullptr;
+            ResetPage(page);
+        }
+    }
+
+    // Sends writes to a RAM page through the slow path, so that the next write bumps its write generation. The trap
+    // is removed by that write, re-arm it to be notified again. Read-only and handler pages are not affected
+    void TrapWrites(std::size_t page)
+    {
+        if (SendWritesToSlowPath(page))
+            m_generationTraps[page] = true;
+    }
+    bool IsWriteTrapped(std::size_t page) const
+    {
+        return m_generationTraps[page];
+    }
+    // Calls the observer on every write to the RAM pages in the range, until the pages are remapped
+    void ObserveWrites(AddressType startAddress, std::size_t size, IMemoryWriteObserver<AddressType> &observer)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0));
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            if (SendWritesToSlowPath(page))
+                m_writeObservers[page] = &observer;
+        }
+    }
+    void SetContention(IBusContention<AddressType> *contention)
+    {
+        m_contention = contention;
+    }
+    // Reads and writes of the RAM pages in the range are reported to the bus contention, until the pages are
+    // remapped. Other pages stay on the fast path
+    void ContendAccesses(AddressType startAddress, std::size_t size)
+    {
+        assert(((startAddress & PageMask) == 0) && ((size & PageMask) == 0) && (m_contention != nullptr));
+        for (std::size_t offset = 0; offset < size; offset += PageSize)
+        {
+            auto page = PageIndex(static_cast<AddressType>(startAddress + offset));
+            if ((m_contendedPages[page] != nullptr) || !SendWritesToSlowPath(page))
+                continue;
+            m_contendedPages[page] = m_trappedPages[page];
+            m_readPages[page] = nullptr;
+            // Decoded code from the page does not report its fetches
+            ++m_writeGenerations[page];
+        }
+    }
+    bool IsContended(std::size_t page) const
+    {
+        return m_contendedPages[page] != nullptr;
+    }
+    // Backing store of a RAM page, whether or not its writes are trapped. nullptr for other pages
+    uint8_t *RAMPage(std::size_t page) const
+    {
+        if (m_trappedPages[page] != nullptr)
+            return m_trappedPages[page];
+        if ((m_writePages[page] != nullptr) && (m_writePages[page] == m_readPages[page]))
+            return m_writePages[page];
+        return nullptr;
+    }
+    uint32_t WriteGeneration(std::size_t page) const
+    {
+        return m_writeGenerations[page];
+    }
+    // For code that polls the generation without going through the map
+    const uint32_t *WriteGenerationAddress(std::size_t page) const
+    {
+        return &m_writeGenerations[page];
+    }
+    // For contents changed behind the map, such as a restored snapshot: code decoded from the page is dropped
+    void InvalidatePage(std::size_t page)
+    {
+        ++m_writeGenerations[page];
+    }
+    uint32_t MappingGeneration() const
+    {
+        return m_mappingGeneration;
+    }
+
+    void Write8(AddressType address, uint8_t value)
+    {
+        uint8_t *page = m_writePages[PageIndex(address)];
+        if (page != nullptr)
+            page[address & PageMask] = value;
+        else
+            WriteSlow(address, value);
+    }
+    void Write16(AddressType address, uint16_t value)
+    {
+        uint8_t *page = m_writePages[PageIndex(address)];
+        if ((page != nullptr) && ((address & PageMask) != PageMask))
+        {
+            page[(address & PageMask) + 0] = static_cast<uint8_t>((value >> 0) & 0xFF);
+            page[(address & PageMask) + 1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+        }
+        else
+        {
+            Write8(address, static_cast<uint8_t>((value >> 0) & 0xFF));
+            Write8(static_cast<AddressType>(address + 1), static_cast<uint8_t>((value >> 8) & 0xFF));
+        }
+    }
+
+    void Read8(AddressType address, uint8_t& value)
+    {
+        const uint8_t *page = m_readPages[PageIndex(address)];
+        if (page != nullptr)
+            value = page[address & PageMask];
+        else
+            ReadSlow(address, value, BusCycle::MemoryRead);
+    }
+    // Same as Read8, except for the bus cycle reported on contended pages
+    void Fetch8(AddressType address, uint8_t& value)
+    {
+        const uint8_t *page = m_readPages[PageIndex(address)];
+        if (page != nullptr)
+            value = page[address & PageMask];
+        else
+            ReadSlow(address, value, BusCycle::OpcodeFetch);
+    }
+    // Reads without a bus cycle, for decoders and debuggers
+    void Peek8(AddressType address, uint8_t& value)
+    {
+        auto index = PageIndex(address);
+        const uint8_t *page = (m_readPages[index] != nullptr) ? m_readPages[index] : m_contendedPages[index];
+        if (page != nullptr)
+            value = page[address & PageMask];
+        else
+            ReadSlow(address, value, BusCycle::MemoryRead);
+    }
+    void Read16(AddressType address, uint16_t& value)
+    {
+        const uint8_t *page = m_readPages[PageIndex(address)];
+        if ((page != nullptr) && ((address & PageMask) != PageMask))
+        {
+            value = static_cast<uint16_t>(page[(address & PageMask) + 0] | (page[(address & PageMask) + 1] << 8));
+        }
+        else
+        {
+            uint8_t low{};
+            uint8_t high{};
+            Read8(address, low);
+            Read8(static_cast<AddressType>(address + 1), high);
+            value = static_cast<uint16_t>(low | (high << 8));
+        }
+    }
+
+private:
+    void ResetPage(std::size_t page)
+    {
+        m_trappedPages[page] = nullptr;
+        m_generationTraps[page] = false;
+        m_writeObservers[page] = nullptr;
+        m_contendedPages[page] = nullptr;
+        ++m_writeGenerations[page];
+    }
+    // Returns false if the page is not RAM
+    bool SendWritesToSlowPath(std::size_t page)
+    {
+        if (m_trappedPages[page] != nullptr)
+            return true;
+        if ((m_writePages[page] == nullptr) || (m_writePages[page] != m_readPages[page]))
+            return false;
+        m_trappedPages[page] = m_writePages[page];
+        m_writePages[page] = nullptr;
+        return true;
+    }
+    void WriteSlow(AddressType address, uint8_t value)
+    {
+        auto page = PageIndex(address);
+        uint8_t *trappedPage = m_trappedPages[page];
+        if (trappedPage != nullptr)
+        {
+            if (m_contendedPages[page] != nullptr)
+                m_contention->OnContendedAccess(address, BusCycle::MemoryWrite);
+            trappedPage[address & PageMask] = value;
+            if (m_generationTraps[page])
+            {
+                ++m_writeGenerations[page];
+                m_generationTraps[page] = false;
+            }
+            auto observer = m_writeObservers[page];
+            if (observer != nullptr)
+            {
+                observer->OnMemoryWrite(address);
+            }
+            else if (m_contendedPages[page] == nullptr)
+            {
+                // Back to the fast path until the page is trapped again
+                m_writePages[page] = trappedPage;
+                m_trappedPages[page] = nullptr;
+            }
+            return;
+        }
+        auto handler = m_handlers[page];
+        if (handler != nullptr)
+            handler->Write8(address, value);
+    }
+    void ReadSlow(AddressType address, uint8_t& value, BusCycle cycle)
+    {
+        auto page = PageIndex(address);
+        const uint8_t *contendedPage = m_contendedPages[page];
+        if (contendedPage != nullptr)
+        {
+            m_contention->OnContendedAccess(address, cycle);
+            value = contendedPage[address & PageMask];
+            return;
+        }
+        auto handler = m_handlers[page];
+        if (handler != nullptr)
+            handler->Read8(address, value);
+        else
+            value = 0xFF;
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Model/IOGeneric.h"
+#include "Model/MemoryBanks.h"
+#include "Model/ULARenderer.h"
+#include "Model/Z80.h"
+
+// Port 0x7FFD of the 128K models, decoded on A15 and A1 low. The register is write only.
+//   bits 0-2: RAM bank at 0xC000
+//   bit 3: display the shadow screen in bank 7 instead of bank 5
+//   bit 4: ROM 1 (48K BASIC) instead of ROM 0 (128K editor)
+//   bit 5: ignore further writes until reset
+// Switching a bank only repoints the pages of its 16 KB slot, nothing is copied, so the bank switches of music players
+// (thousands per second) cost next to nothing.
+// When the displayed bank is also paged in at 0xC000, writes through that slot are passed on to the ULA renderer as
+// writes to 0x4000, so the dirty cell tracking still sees every change
+class MemoryPaging
+    : public IIOAccess<uint16_t>
+    , public IMemoryWriteObserver<uint16_t>
+{
+public:
+    static constexpr uint8_t RAMBankMask = 0x07;
+    static constexpr uint8_t ShadowScreenBit = 0x08;
+    static constexpr uint8_t ROMSelectBit = 0x10;
+    static constexpr uint8_t LockBit = 0x20;
+    static constexpr std::size_t NormalScreenBank = 5;
+    static constexpr std::size_t ShadowScreenBank = 7;
+    static constexpr uint16_t PagedSlotAddress = 0xC000;
+
+private:
+    Z80 &m_cpu;
+    MemoryBanks &m_memory;
+    ULARenderer &m_ula;
+    uint16_t m_displayAddress;
+    uint16_t m_displaySize;
+    uint8_t m_value;
+    bool m_locked;
+
+public:
+    // Writes to the displayed bank are reported to ula for displaySize bytes from displayAddress
+    MemoryPaging(Z80 &cpu, MemoryBanks &memory, ULARenderer &ula, uint16_t displayAddress, uint16_t displaySize);
+    MemoryPaging(const MemoryPaging &) = delete;
+    MemoryPaging(MemoryPaging &&) = delete;
+
+    MemoryPaging &operator = (const MemoryPaging &) = delete;
+    MemoryPaging &operator = (MemoryPaging &&) = delete;
+
+    // Back to bank 0 and ROM 0, normal screen, unlocked
+    void Reset();
+    uint8_t GetValue() const { return m_value; }
+    bool IsLocked() const { return m_locked; }
+    std::size_t GetPagedBank() const { return m_value & RAMBankMask; }
+    std::size_t GetDisplayBank() const { return (m_value & ShadowScreenBit) ? ShadowScreenBank : NormalScreenBank; }
+    const uint8_t *GetDisplayMemory() const { return m_memory.RAMBank(GetDisplayBank()); }
+    // The register value, including the lock. Loading only remaps the slots that change, like a write
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+
+    void Write8(uint16_t address, uint8_t value) override;
+    void Read8(uint16_t /*address*/, uint8_t & /*value*/) override {};
+    void Read16(uint16_t /*address*/, uint16_t & /*value*/) override {};
+    void Read32(uint16_t /*address*/, uint32_t & /*value*/) override {};
+    void Read64(uint16_t /*address*/, uint64_t & /*value*/) override {};
+
+    void OnMemoryWrite(uint16_t address) override;
+
+private:
+    void Select(uint8_t value, bool remapAll);
+    void MapPagedSlot();
+};
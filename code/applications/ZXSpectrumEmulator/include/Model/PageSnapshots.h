@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model/Memory.h"
+#include "Model/MemoryBanks.h"
+#include "Model/SystemState.h"
+#include "Model/Z80.h"
+
+// Copy-on-write pages of the RAM banks for SystemState. After every capture or restore the RAM pages mapped into the
+// CPU address space have their writes trapped, so the write generations tell which pages were written since. Those
+// pages are copied on the next capture, all others are shared with the previous state.
+// Remapping a page bumps its generation as well, and between remaps a bank may have been written through any slot, so
+// after a bank switch the pages are compared with their last copy instead. That costs a memcmp of the RAM, still far
+// less than copying it
+class PageSnapshots
+{
+public:
+    static constexpr std::size_t PageSize = SystemState::PageSize;
+    static_assert(PageSize == PagedMemoryMap::PageSize, "Snapshot pages must match the pages of the memory map");
+
+private:
+    static constexpr std::size_t NotMapped = ~std::size_t{ 0 };
+    Z80 &m_cpu;
+    MemoryBanks &m_memory;
+    // Contents of each RAM page at the last capture or restore, nullptr before the first
+    std::vector<SystemState::Page> m_pages;
+    // Mapping at the last capture or restore: RAM page and write generation per CPU page
+    uint32_t m_mappingGeneration;
+    std::array<std::size_t, PagedMemoryMap::PageCount> m_mappedPages;
+    std::array<uint32_t, PagedMemoryMap::PageCount> m_writeGenerations;
+    // Scratch, RAM pages changed since the last capture or restore
+    std::vector<bool> m_changed;
+
+public:
+    PageSnapshots(Z80 &cpu, MemoryBanks &memory);
+    PageSnapshots(const PageSnapshots &) = delete;
+    PageSnapshots(PageSnapshots &&) = delete;
+
+    PageSnapshots &operator = (const PageSnapshots &) = delete;
+    PageSnapshots &operator = (PageSnapshots &&) = delete;
+
+    std::size_t PageCount() const { return m_pages.size(); }
+    // Sets pages to the current RAM contents
+    void Capture(std::vector<SystemState::Page> &pages);
+    // Copies pages back into RAM, and drops the code decoded from the pages that changed. Fails without changing
+    // anything if the number of pages differs or a page has the wrong size
+    bool Restore(const std::vector<SystemState::Page> &pages);
+
+private:
+    uint8_t *RAMPage(std::size_t index) { return m_memory.RAMBank(0) + index * PageSize; }
+    // RAM page at a CPU page, NotMapped for ROM, devices and unmapped pages
+    std::size_t MappedPage(std::size_t cpuPage) const;
+    void FindChangedPages();
+    void TrackWrites();
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Implementations of the pixel kernels. All produce identical output, the fastest one the host supports is selected
+// at runtime
+enum class PixelKernelSet
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// Inner loops of screen rendering on 32 bit pixels
+struct PixelKernels
+{
+    // Expands an 8x8 character cell: 8 bitmap bytes, top line first, into 8 lines of 8 pixels. Set bits become ink,
+    // the leftmost pixel is bit 7. pitch is the distance between lines in pixels
+    void (*ExpandCell)(const uint8_t *bitmap, uint32_t ink, uint32_t paper, uint32_t *pixels, std::size_t pitch);
+    // Sets count pixels to value
+    void (*Fill)(uint32_t *pixels, std::size_t count, uint32_t value);
+    // Copies count pixels, source and destination do not overlap
+    void (*Copy)(uint32_t *destination, const uint32_t *source, std::size_t count);
+};
+
+bool IsPixelKernelSetSupported(PixelKernelSet set);
+PixelKernelSet BestPixelKernelSet();
+// Returns the scalar kernels if the set is not supported by the host
+const PixelKernels &GetPixelKernels(PixelKernelSet set);
+// Kernels for the best supported set, determined once
+const PixelKernels &GetPixelKernels();
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Model/ICPU.h"
+
+// Saved state of a system. Data holds the CPU and device state as a little endian blob, RAM is kept in pages of
+// PageSize bytes. Pages are shared between states: a page that was not written between two saves is the same object
+// in both, so a save copies only what changed and restoring a recent state only copies back what differs
+struct SystemState
+{
+    static constexpr std::size_t PageSize = 1024;
+    using Page = std::shared_ptr<const ByteVector>;
+
+    ByteVector Data;
+    std::vector<Page> Pages;
+};
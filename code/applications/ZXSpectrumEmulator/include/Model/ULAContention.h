@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Model/ContentionTables.h"
+#include "Model/MemoryGeneric.h"
+#include "Model/Z80.h"
+#include "Model/ZXSpectrumModel.h"
+
+// Holds the CPU clock while the ULA has the bus. The memory map only reports accesses to contended pages, all other
+// accesses keep their direct page pointers and cost nothing extra. Instruction handlers advance the clock cycle by
+// cycle, so every reported cycle is delayed by the T-state it starts at
+class ULAContention
+    : public IBusContention<uint16_t>
+{
+private:
+    Z80 &m_cpu;
+    ContentionTables m_tables;
+    uint64_t m_frameStartClock;
+
+public:
+    ULAContention(Z80 &cpu, const ZXSpectrumModel &model);
+    ULAContention(const ULAContention &) = delete;
+    ULAContention(ULAContention &&) = delete;
+
+    ULAContention &operator = (const ULAContention &) = delete;
+    ULAContention &operator = (ULAContention &&) = delete;
+
+    void Reset();
+    // Starts a frame at the given CPU clock
+    void StartFrame(uint64_t frameStartClock);
+    const ContentionTables &GetTables() const { return m_tables; }
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+
+    void OnContendedAccess(uint16_t address, BusCycle cycle) override;
+    void OnIOAccess(uint16_t port, bool addressContended) override;
+};
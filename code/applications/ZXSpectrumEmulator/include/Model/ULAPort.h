@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Model/Beeper.h"
+#include "Model/IOGeneric.h"
+#include "Model/KeyboardMatrix.h"
+#include "Model/VideoBorder.h"
+
+// Port 0xFE, the ULA answers on all even port addresses. A write sets the border colour (bits 0-2), MIC (bit 3) and
+// EAR (bit 4), so it is passed to both the border and the beeper. A read returns the keyboard half-rows selected by
+// the high address byte, with no tape signal on EAR
+class ULAPort
+    : public IIOAccess<uint16_t>
+{
+private:
+    VideoBorder &m_border;
+    Beeper &m_beeper;
+    const KeyboardMatrix &m_keyboard;
+
+public:
+    ULAPort(VideoBorder &border, Beeper &beeper, const KeyboardMatrix &keyboard)
+        : m_border{ border }
+        , m_beeper{ beeper }
+        , m_keyboard{ keyboard }
+    {
+    }
+    ULAPort(const ULAPort &) = delete;
+    ULAPort(ULAPort &&) = delete;
+
+    ULAPort &operator = (const ULAPort &) = delete;
+    ULAPort &operator = (ULAPort &&) = delete;
+
+    void Write8(uint16_t address, uint8_t value) override
+    {
+        m_border.Write8(address, value);
+        m_beeper.Write8(address, value);
+    }
+
+    void Read8(uint16_t address, uint8_t &value) override
+    {
+        value = m_keyboard.Read(static_cast<uint8_t>(address >> 8));
+    }
+    void Read16(uint16_t /*address*/, uint16_t & /*value*/) override {};
+    void Read32(uint16_t /*address*/, uint32_t & /*value*/) override {};
+    void Read64(uint16_t /*address*/, uint64_t & /*value*/) override {};
+};
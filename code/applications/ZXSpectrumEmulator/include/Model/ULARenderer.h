@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Model/MemoryGeneric.h"
+#include "Model/PixelKernels.h"
+
+// XRGB8888 pixels, indexed by bright * 8 + GRB colour number
+constexpr uint32_t ULAPalette[16] =
+{
+    0x000000, 0x0000D7, 0xD70000, 0xD700D7, 0x00D700, 0x00D7D7, 0xD7D700, 0xD7D7D7,
+    0x000000, 0x0000FF, 0xFF0000, 0xFF00FF, 0x00FF00, 0x00FFFF, 0xFFFF00, 0xFFFFFF,
+};
+
+// Paper area, generated from display memory
+constexpr int ULAScreenWidth = 256;
+constexpr int ULAScreenHeight = 192;
+// Visible border around the paper area
+constexpr int ULABorderWidth = 48;
+constexpr int ULABorderHeight = 48;
+constexpr int ULAFrameWidth = ULAScreenWidth + 2 * ULABorderWidth;
+constexpr int ULAFrameHeight = ULAScreenHeight + 2 * ULABorderHeight;
+
+// XRGB8888 pixels of the visible frame, paper and border, line by line
+using ULAScreen = std::array<uint32_t, ULAFrameWidth * ULAFrameHeight>;
+
+// Range of changed frame lines, empty if First > Last
+struct ULADirtyLines
+{
+    int First = ULAFrameHeight;
+    int Last = -1;
+
+    bool IsEmpty() const { return First > Last; }
+    void Add(const ULADirtyLines &other)
+    {
+        if (other.First < First)
+            First = other.First;
+        if (other.Last > Last)
+            Last = other.Last;
+    }
+};
+
+// Turns the display file and attributes into pixels. The attribute of a character cell is looked up once to get the
+// ink and paper pixels, then the cell is expanded by the pixel kernels.
+// The renderer observes writes to display memory, and only converts the 8x8 character cells written since the last
+// frame
+class ULARenderer
+    : public IMemoryWriteObserver<uint16_t>
+{
+public:
+    static constexpr uint16_t DisplayFileSize = 6144;
+    static constexpr uint16_t AttributeFileSize = 768;
+    static constexpr unsigned CellCount = 768;
+    // FLASH swaps ink and paper every 16 frames
+    static constexpr uint64_t FlashPeriodFrames = 16;
+
+private:
+    // Offset of every pixel line in the display file
+    std::array<uint16_t, ULAScreenHeight> m_lineOffsets;
+    // Ink and paper pixels for every attribute, for both FLASH phases. In the inverted phase, flashing attributes
+    // have ink and paper swapped
+    struct InkPaper
+    {
+        uint32_t Ink;
+        uint32_t Paper;
+    };
+    std::array<InkPaper, 256> m_colors[2];
+    const PixelKernels &m_kernels;
+    // One bit per character cell, row by row
+    std::array<uint64_t, CellCount / 64> m_dirtyCells;
+    uint16_t m_displayAddress;
+    bool m_fullRedraw;
+    uint64_t m_flashPhase;
+
+public:
+    // displayAddress is the CPU address of the display file, used to map observed writes to cells
+    explicit ULARenderer(uint16_t displayAddress, const PixelKernels &kernels = GetPixelKernels());
+    ULARenderer(const ULARenderer &) = delete;
+    ULARenderer(ULARenderer &&) = delete;
+
+    ULARenderer &operator = (const ULARenderer &) = delete;
+    ULARenderer &operator = (ULARenderer &&) = delete;
+
+    void OnMemoryWrite(uint16_t address) override;
+    // Converts everything on the next render
+    void Invalidate() { m_fullRedraw = true; }
+
+    // displayMemory points to the 6912 bytes of display file and attributes. Only the paper area of screen is written.
+    // Returns the lines that changed
+    ULADirtyLines Render(const uint8_t *displayMemory, uint64_t frameCount, ULAScreen &screen);
+
+private:
+    void MarkFlashingCells(const uint8_t *attributes);
+    void RenderCell(const uint8_t *displayMemory, const std::array<InkPaper, 256> &colors, unsigned cell, ULAScreen &screen) const;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Model/ICPU.h"
+#include "Model/IOGeneric.h"
+#include "Model/PixelKernels.h"
+#include "Model/ULARenderer.h"
+
+// Border colour change, in T-states from the start of the frame
+struct BorderEvent
+{
+    uint32_t TState;
+    uint8_t Color;
+};
+
+// Border colour, bits 0-2 of port 0xFE. Every change is recorded with the T-state it was written at. At the end of the
+// frame the changes are replayed line by line into the border area of the screen, so colour changes during a frame
+// (loading stripes, raster effects) appear where the beam was at the time of the write.
+// The CPU only appends to the event buffer, nothing is shared with the view
+class VideoBorder
+    : public IIOAccess<uint16_t>
+{
+public:
+    // Enough for an OUT every 11 T-states for a whole frame. Further changes overwrite the last event
+    static constexpr std::size_t MaxEventsPerFrame = 8192;
+
+private:
+    ICPU &m_cpu;
+    const PixelKernels &m_kernels;
+    uint32_t m_tstatesPerLine;
+    // Top left pixel of the visible border, 2 pixels per T-state
+    uint32_t m_firstVisibleTState;
+    std::vector<BorderEvent> m_events;
+    uint64_t m_frameStartClock;
+    uint8_t m_color;
+    // Colour at the start of the frame
+    uint8_t m_frameStartColor;
+    // Colour at the end of the last rendered frame, and whether that frame had changes
+    uint8_t m_renderedColor;
+    bool m_renderedEvents;
+    bool m_fullRedraw;
+
+public:
+    // The first line of the display file starts at firstScreenLineTState from the start of the frame
+    VideoBorder(ICPU &cpu, uint32_t tstatesPerLine, uint32_t firstScreenLineTState, const PixelKernels &kernels = GetPixelKernels());
+    VideoBorder(const VideoBorder &) = delete;
+    VideoBorder(VideoBorder &&) = delete;
+
+    VideoBorder &operator = (const VideoBorder &) = delete;
+    VideoBorder &operator = (VideoBorder &&) = delete;
+
+    void Reset();
+    // Starts recording the changes of a frame, beginning at the given CPU clock
+    void StartFrame(uint64_t frameStartClock);
+    const std::vector<BorderEvent> &GetEvents() const { return m_events; }
+    // Colours and frame start. The changes of the frame so far are not saved, after loading the border is drawn
+    // completely in the colour at the start of the frame
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+
+    // Writes the border of the frame recorded so far into screen. Returns the lines that changed
+    ULADirtyLines Render(ULAScreen &screen);
+
+    void Write8(uint16_t address, uint8_t value) override;
+
+    void Read8(uint16_t /*address*/, uint8_t & /*value*/) override {};
+    void Read16(uint16_t /*address*/, uint16_t & /*value*/) override {};
+    void Read32(uint16_t /*address*/, uint32_t & /*value*/) override {};
+    void Read64(uint16_t /*address*/, uint64_t & /*value*/) override {};
+
+private:
+    void FillLine(uint32_t *line, int startX, int endX, uint32_t pixel, bool paperLine) const;
+};
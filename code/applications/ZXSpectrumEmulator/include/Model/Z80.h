@@ -1,38 +1,60 @@
 #pragma once
 
+#include <array>
+#include <bitset>
 #include <cstdint>
-#include <functional>
-#include <map>
 #include <string>
 
 #include "Model/ICPU.h"
 #include "Model/Memory.h"
 #include "Model/IO.h"
+#include "Model/Z80BlockCache.h"
 #include "Model/Z80Disassembler.h"
+#include "Model/Z80Opcode.h"
+#include "Model/Z80Recompiler.h"
 #include "Model/Z80Registers.h"
 
 class Z80
     : public ICPU
 {
 public:
+    // Number of times a block runs before it is recompiled
+    static constexpr uint32_t RecompileThreshold = 16;
+    // Machine cycles, the bus helpers below advance the clock by these after the access
+    static constexpr uint8_t OpcodeFetchTStates = 4;
+    static constexpr uint8_t MemoryCycleTStates = 3;
+    static constexpr uint8_t IOCycleTStates = 4;
 
 private:
-    using OpcodeFunction = std::function<void ()>;
-    using OpcodeFuncionLookup = std::map<uint8_t, OpcodeFunction>;
-    static const OpcodeFuncionLookup OpcodeLookup;
+    using OpcodeTableSet = std::array<OpcodeTable, static_cast<std::size_t>(OpcodePrefix::Count)>;
+    using OpcodeInfoTableSet = std::array<OpcodeInfoTable, static_cast<std::size_t>(OpcodePrefix::Count)>;
+    using DecodedOpcodeTableSet = std::array<DecodedOpcodeTable, static_cast<std::size_t>(OpcodePrefix::Count)>;
+    static const OpcodeTableSet OpcodeTables;
+    static const DecodedOpcodeTableSet DecodedOpcodes;
+    static const OpcodeInfoTableSet OpcodeInfos;
 
-    static Z80 *m_instance;
     uint64_t m_cpuFreq;
     Z80Registers m_registers;
-    MemorySpace m_memory;
-    ROM m_rom;
-    RAM m_ram;
-    MemoryMap m_memoryMap;
-    VideoBorder m_videoBorder;
+    PagedMemoryMap m_memoryMap;
     IOMap m_ioMap;
+    IBusContention<uint16_t> *m_contention;
     uint8_t m_opcode;
+    int8_t m_displacement;
+    bool m_decodeError;
     Z80Disassembler m_disassembler;
     uint64_t m_cpuClock;
+    // Instructions executed since reset, including the NOPs of HALT and the skipped iterations of idle loops
+    uint64_t m_instructionCount;
+    uint64_t m_interruptEndClock;
+    std::bitset<65536> m_breakpoints;
+    bool m_haveBreakpoints;
+    ExecutionMode m_executionMode;
+    Z80BlockCache m_blockCache;
+    std::vector<Z80DecodedInstruction> m_decodeBuffer;
+    Z80Recompiler m_recompiler;
+    // Mapped RAM before and after a native block, in lockstep mode
+    ByteVector m_lockstepMemoryBefore;
+    ByteVector m_lockstepMemoryNative;
 
 public:
     Z80(uint64_t clockFreq);
@@ -41,7 +63,6 @@ public:
     Z80& operator =(const Z80 &) = delete;
     Z80& operator =(Z80 &&) = delete;
 
-    static Z80 *GetInstance();
     Z80Registers &GetRegisters() { return m_registers; }
     const Z80Registers &GetRegisters() const { return m_registers; }
 
@@ -50,18 +71,204 @@ public:
     bool IsHalted() override;
     std::string DumpRegisters() override;
 
-    bool LoadROM(const ByteVector &romContents) override;
-
     bool ExecuteInstruction() override;
+    RunExitReason ExecuteCycles(uint64_t tstates) override;
+    void RequestInterrupt(uint64_t activeTStates) override;
+    void RequestNMI() override;
+    void SetBreakpoint(uint64_t address) override;
+    void ClearBreakpoint(uint64_t address) override;
+    void SetExecutionMode(ExecutionMode mode) override;
+    void Dispatch(OpcodePrefix prefix, uint8_t opcode)
+    {
+        OpcodeTables[static_cast<std::size_t>(prefix)][opcode](*this);
+    }
+    void InvalidOpcode();
     bool Disassemble(std::string &mnemonic);
-    void IncrementCPUClock(uint8_t increment);
-    uint8_t ReadOpcodeByte();
-    uint8_t ReadByte();
-    uint16_t ReadWord();
-    void Out(uint8_t port, uint8_t value);
-    uint8_t GetOpcode();
+    // Instruction handlers run these on every instruction, so they are inline. Every bus access takes place at the
+    // clock the handler has reached, so contended accesses are held at the T-state they start at
+    void IncrementCPUClock(uint8_t increment)
+    {
+        m_cpuClock += increment;
+    }
+    // T-states without a bus access, while the address is still on the bus. On contended pages the ULA holds each of
+    // them like a memory cycle
+    void InternalCycles(uint16_t address, uint8_t count)
+    {
+        if (m_memoryMap.IsContended(PagedMemoryMap::PageIndex(address)))
+        {
+            for (uint8_t cycle = 0; cycle < count; ++cycle)
+            {
+                m_contention->OnContendedAccess(address, BusCycle::Internal);
+                ++m_cpuClock;
+            }
+            return;
+        }
+        m_cpuClock += count;
+    }
+    uint8_t ReadOpcodeByte()
+    {
+        // Every M1 cycle increments the lower 7 bits of the refresh register
+        IncrementRefresh(1);
+        m_memoryMap.Fetch8(m_registers.PC, m_opcode);
+        m_registers.PC++;
+        m_cpuClock += OpcodeFetchTStates;
+        return m_opcode;
+    }
+    uint8_t ReadByte()
+    {
+        uint8_t byte = ReadMemory(m_registers.PC);
+        m_registers.PC++;
+        return byte;
+    }
+    uint16_t ReadWord()
+    {
+        uint8_t low = ReadByte();
+        uint8_t high = ReadByte();
+        return static_cast<uint16_t>(low | (high << 8));
+    }
+    uint8_t ReadMemory(uint16_t address)
+    {
+        uint8_t value{};
+        m_memoryMap.Read8(address, value);
+        m_cpuClock += MemoryCycleTStates;
+        return value;
+    }
+    uint16_t ReadMemoryWord(uint16_t address)
+    {
+        uint8_t low = ReadMemory(address);
+        uint8_t high = ReadMemory(static_cast<uint16_t>(address + 1));
+        return static_cast<uint16_t>(low | (high << 8));
+    }
+    // Reads without a bus cycle, so without contention or T-states
+    uint8_t PeekMemory(uint16_t address)
+    {
+        uint8_t value{};
+        m_memoryMap.Peek8(address, value);
+        return value;
+    }
+    // The memory is owned by the system, which maps it into the address space. Remapping only swaps page pointers, and
+    // removes the write observers of the pages
+    void MapROM(uint16_t address, std::size_t size, uint8_t *data)
+    {
+        m_memoryMap.MapReadOnly(address, size, data);
+    }
+    void MapRAM(uint16_t address, std::size_t size, uint8_t *data)
+    {
+        m_memoryMap.MapReadWrite(address, size, data);
+    }
+    // Contended pages and I/O cycles are reported to contention, pass nullptr for a bus without contention
+    void SetContention(IBusContention<uint16_t> *contention)
+    {
+        m_contention = contention;
+        m_memoryMap.SetContention(contention);
+    }
+    // Accesses to the RAM pages in the range go through the contention until the pages are remapped. Code in contended
+    // pages is always interpreted, so that every opcode fetch is reported
+    void ContendAccesses(uint16_t address, std::size_t size)
+    {
+        m_memoryMap.ContendAccesses(address, size);
+    }
+    // Devices watching memory contents (video) are called on every CPU write in the range
+    void ObserveWrites(uint16_t address, uint16_t size, IMemoryWriteObserver<uint16_t> &observer)
+    {
+        m_memoryMap.ObserveWrites(address, size, observer);
+    }
+    void WriteMemory(uint16_t address, uint8_t value)
+    {
+        m_memoryMap.Write8(address, value);
+        m_cpuClock += MemoryCycleTStates;
+    }
+    void WriteMemoryWord(uint16_t address, uint16_t value)
+    {
+        WriteMemory(address, static_cast<uint8_t>(value & 0xFF));
+        WriteMemory(static_cast<uint16_t>(address + 1), static_cast<uint8_t>(value >> 8));
+    }
+    // The high byte is written first
+    void Push(uint16_t value)
+    {
+        m_registers.SP = static_cast<uint16_t>(m_registers.SP - 1);
+        WriteMemory(m_registers.SP, static_cast<uint8_t>(value >> 8));
+        m_registers.SP = static_cast<uint16_t>(m_registers.SP - 1);
+        WriteMemory(m_registers.SP, static_cast<uint8_t>(value & 0xFF));
+    }
+    uint16_t Pop()
+    {
+        uint16_t value = ReadMemoryWord(m_registers.SP);
+        m_registers.SP = static_cast<uint16_t>(m_registers.SP + 2);
+        return value;
+    }
+    // Devices on the I/O bus are owned by the system
+    void AddIOMapping(const IOMapping<uint16_t> &mapping)
+    {
+        m_ioMap.AddIOMapping(mapping);
+    }
+    void Out(uint16_t port, uint8_t value);
+    uint8_t In(uint16_t port);
+    uint8_t GetOpcode() const { return m_opcode; }
+    int8_t GetDisplacement() const { return m_displacement; }
     uint64_t GetCPUClock();
     uint64_t GetCPUClockFreq();
+    uint64_t GetInstructionCount() const { return m_instructionCount; }
+    // Needed after changing memory contents behind the CPU's back, such as loading a ROM
+    void FlushCodeCaches();
+    // Registers, clock and interrupt line. The memory belongs to the system, which saves it separately
+    void SaveState(ByteVector &buffer, std::size_t &offset) const;
+    // Fails if the buffer ends early
+    bool LoadState(const ByteVector &buffer, std::size_t &offset);
+    // For snapshots, which follow the pages written between two captures through the write generations
+    PagedMemoryMap &GetMemoryMap() { return m_memoryMap; }
 
 private:
+    static OpcodeTableSet BuildOpcodeTables();
+    static OpcodeInfoTableSet BuildOpcodeInfos();
+    static DecodedOpcodeTableSet BuildDecodedOpcodes();
+    RunExitReason ExecuteNextInstruction(uint64_t deadline);
+    RunExitReason ExecuteNextBlock(uint64_t deadline);
+    template <bool CheckDeadline>
+    bool RunDecodedBlock(const Z80DecodedBlock &block, uint64_t deadline);
+    // Whether a loop inside a block can be taken without leaving it, i.e. the interpreter would do nothing else before
+    // the next instruction. Without CheckDeadline, the whole block has to fit before the deadline again
+    template <bool CheckDeadline>
+    bool CanContinueBlock(const Z80DecodedBlock &block, uint64_t deadline) const
+    {
+        const uint64_t clock = CheckDeadline ? m_cpuClock : m_cpuClock + block.MaxTStates;
+        return (clock < deadline) && !m_registers.NMIPending && !m_registers.IntPending &&
+            !(m_haveBreakpoints && m_breakpoints[m_registers.PC]) &&
+            ((!block.IsWritable && !block.AccessesIO) || Z80BlockCache::IsValid(block, m_memoryMap));
+    }
+    bool UsesRecompiler() const
+    {
+        return (m_executionMode != ExecutionMode::BlockCache) && !m_haveBreakpoints && m_recompiler.IsAvailable();
+    }
+    RunExitReason ExecuteNativeBlock(const Z80DecodedBlock &block, uint64_t deadline);
+    uint32_t RunNativeBlockLockstep(const Z80DecodedBlock &block, uint64_t deadline);
+    Z80DecodedBlock *DecodeBlock(uint16_t address);
+    void SaveMappedRAM(ByteVector &contents) const;
+    void RestoreMappedRAM(const ByteVector &contents);
+    Z80NativeLayout NativeLayout() const;
+    // JR $ / JP $: the CPU spins until the next interrupt, nothing changes but the clock and R. Called after every
+    // branch, so the common case of a jump elsewhere stays inline
+    void CheckIdleLoop(uint16_t instructionAddress, uint8_t opcode, uint64_t deadline)
+    {
+        if ((m_registers.PC == instructionAddress) && !m_registers.NMIPending && !(m_registers.IntPending && m_registers.IFF1))
+        {
+            if (opcode == 0x18)
+                FastForwardIdleLoop(deadline, 12);
+            else if (opcode == 0xC3)
+                FastForwardIdleLoop(deadline, 10);
+        }
+    }
+    void AcceptInterrupt();
+    RunExitReason FastForwardHalted(uint64_t deadline);
+    void FastForwardIdleLoop(uint64_t deadline, uint8_t instructionTStates);
+    void IncrementRefresh(uint64_t count)
+    {
+        m_registers.R = static_cast<uint8_t>((m_registers.R & 0x80) | ((m_registers.R + count) & 0x7F));
+    }
+    static void ExecutePrefixCB(Z80 &cpu);
+    static void ExecutePrefixED(Z80 &cpu);
+    static void ExecutePrefixDD(Z80 &cpu);
+    static void ExecutePrefixFD(Z80 &cpu);
+    static void ExecutePrefixDDCB(Z80 &cpu);
+    static void ExecutePrefixFDCB(Z80 &cpu);
 };
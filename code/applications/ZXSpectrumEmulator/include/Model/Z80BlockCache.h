@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Model/Memory.h"
+#include "Model/Z80Opcode.h"
+
+// Native code generated for a block by Z80Recompiler. Runs the block on the given CPU until it ends, the deadline is
+// reached or the block is invalidated. Returns the number of instructions executed in the last pass through the block,
+// those of earlier passes of a loop back to its start are added to the instruction count of the CPU
+using Z80NativeBlock = uint32_t (*)(Z80 *cpu, uint64_t deadline);
+
+// A pre-decoded instruction: prefixes and opcode have been walked, and the operands extracted
+struct Z80DecodedInstruction
+{
+    // Runs the instruction from the fields below
+    DecodedOpcodeHandler Execute;
+    // Handler fetching the operands itself
+    OpcodeHandler Handler;
+    // PC when Handler runs, i.e. the first operand byte
+    uint16_t OperandAddress;
+    // PC after the instruction when it does not branch
+    uint16_t NextAddress;
+    // Immediate byte or word, or the displacement of a relative jump
+    uint16_t Operand;
+    uint8_t Opcode;
+    // Of an (IX+d) / (IY+d) operand
+    int8_t Displacement;
+    // T-states of the prefix bytes, which the prefix dispatchers would add
+    uint8_t PrefixTStates;
+    // T-states Execute adds before the first data access: those of the prefixes plus the DecodedOpcode ones
+    uint8_t TStates;
+    // M1 cycles of the block up to and including this instruction, modulo 128. R is only updated when the block is
+    // left, instructions reading or writing R are not put in a block
+    uint8_t RefreshCount;
+    // The block has to be checked for writes to its own pages after this instruction
+    bool MayWriteCode;
+    // LDIR and the other block instructions, which repeat by setting PC back to themselves
+    bool Repeats;
+};
+
+// A straight-line run of instructions. The block is valid as long as the pages it was decoded from have not been
+// written or remapped since
+struct Z80DecodedBlock
+{
+    uint32_t FirstInstruction;
+    uint32_t InstructionCount;
+    // Upper bound of the T-states the block takes. While the deadline is further away, it is not checked per instruction
+    uint32_t MaxTStates;
+    uint32_t FirstPageGeneration;
+    uint32_t LastPageGeneration;
+    uint16_t Address;
+    uint16_t FirstPage;
+    uint16_t LastPage;
+    // False for blocks in ROM, which can only be invalidated while they run by a port write that pages memory
+    bool IsWritable;
+    // Contains IN / OUT instructions, these blocks are never recompiled
+    bool AccessesIO;
+    // Number of times the block was entered, used to find hot blocks
+    uint32_t ExecutionCount;
+    Z80NativeBlock NativeCode;
+};
+
+// Decoded blocks by start address
+class Z80BlockCache
+{
+public:
+    static constexpr uint32_t MaxBlockLength = 64;
+    // Longest instruction after its prefixes, RES / SET (IX+d)
+    static constexpr uint32_t MaxInstructionTStates = 23;
+    // Above this number of decoded instructions the cache is flushed, to drop blocks that were replaced
+    static constexpr std::size_t MaxInstructions = 65536;
+
+private:
+    static constexpr int32_t NoBlock = -1;
+    std::vector<int32_t> m_blockIndex;
+    std::vector<Z80DecodedBlock> m_blocks;
+    std::vector<Z80DecodedInstruction> m_instructions;
+
+public:
+    Z80BlockCache();
+    Z80BlockCache(const Z80BlockCache &) = delete;
+    Z80BlockCache(Z80BlockCache &&) = delete;
+
+    Z80BlockCache &operator = (const Z80BlockCache &) = delete;
+    Z80BlockCache &operator = (Z80BlockCache &&) = delete;
+
+    void Flush();
+
+    // Returns the block starting at address, or nullptr if there is none or it has been invalidated
+    Z80DecodedBlock *Find(uint16_t address, const PagedMemoryMap &memoryMap)
+    {
+        int32_t index = m_blockIndex[address];
+        if (index == NoBlock)
+            return nullptr;
+        Z80DecodedBlock &block = m_blocks[static_cast<std::size_t>(index)];
+        return IsValid(block, memoryMap) ? &block : nullptr;
+    }
+    static bool IsValid(const Z80DecodedBlock &block, const PagedMemoryMap &memoryMap)
+    {
+        return (memoryMap.WriteGeneration(block.FirstPage) == block.FirstPageGeneration) &&
+            (memoryMap.WriteGeneration(block.LastPage) == block.LastPageGeneration);
+    }
+    const Z80DecodedInstruction *Instructions(const Z80DecodedBlock &block) const
+    {
+        return &m_instructions[block.FirstInstruction];
+    }
+
+    // Adds a block at address made of the given instructions, replacing an existing one. The pages, IsWritable and
+    // AccessesIO are taken from the block passed in, the rest is filled in
+    Z80DecodedBlock *Add(uint16_t address, const Z80DecodedBlock &block, const std::vector<Z80DecodedInstruction> &instructions,
+        const PagedMemoryMap &memoryMap);
+};
@@ -2,26 +2,24 @@
 
 #include <string>
 
-class MemorySpace;
+class PagedMemoryMap;
 struct InstructionDefinition;
 
 class Z80Disassembler
 {
 private:
-    MemorySpace& m_memory;
+    PagedMemoryMap& m_memory;
     uint16_t m_instructionOrigin;
     uint16_t m_currentLocation;
-    static Z80Disassembler *m_instance;
 
 public:
-    Z80Disassembler(MemorySpace& memory);
+    Z80Disassembler(PagedMemoryMap& memory);
     Z80Disassembler(const Z80Disassembler &) = delete;
     Z80Disassembler(Z80Disassembler &&) = delete;
 
     Z80Disassembler &operator = (const Z80Disassembler &) = delete;
     Z80Disassembler &operator = (Z80Disassembler &&) = delete;
 
-    static Z80Disassembler *GetInstance();
     bool DisassembleInstruction(uint16_t address, uint8_t instructionSize, std::string &mnemonic);
 
     uint8_t GetInstructionByte();
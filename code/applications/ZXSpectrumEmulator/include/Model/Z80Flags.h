@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+// Flags
+constexpr uint8_t flagS  = 0x80;
+constexpr uint8_t flagZ  = 0x40;
+constexpr uint8_t flagHC = 0x10;
+constexpr uint8_t flagPV = 0x04;
+constexpr uint8_t flagN  = 0x02;
+constexpr uint8_t flagC  = 0x01;
+
+// Undocumented flags (copies of bit 3 and 5 of the result)
+constexpr uint8_t flagU1 = 0x08;
+constexpr uint8_t flagU2 = 0x20;
+
+// Precomputed flag values, so ALU operations can set F without branching.
+// The 8 entry half carry / overflow tables are indexed by combining bit 3 (half carry) or bit 7 (overflow) of both
+// operands and the result, see Z80FlagTables::Index
+struct Z80FlagTables
+{
+    // S and Z only
+    uint8_t SZ[256];
+    // S, Z and the undocumented bits
+    uint8_t SZ53[256];
+    // S, Z, the undocumented bits and parity
+    uint8_t SZ53P[256];
+    // INC r, indexed by the result, all flags except C
+    uint8_t Inc[256];
+    // DEC r, indexed by the result, all flags except C
+    uint8_t Dec[256];
+    uint8_t HalfCarryAdd[8];
+    uint8_t HalfCarrySub[8];
+    uint8_t OverflowAdd[8];
+    uint8_t OverflowSub[8];
+
+    // Half carry index in bits 0..2, overflow index in bits 4..6
+    static constexpr unsigned Index(unsigned op1, unsigned op2, unsigned result)
+    {
+        return ((op1 & 0x88) >> 3) | ((op2 & 0x88) >> 2) | ((result & 0x88) >> 1);
+    }
+};
+
+constexpr Z80FlagTables BuildZ80FlagTables()
+{
+    Z80FlagTables tables{};
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        uint8_t sz = static_cast<uint8_t>((i & flagS) | ((i == 0) ? flagZ : 0));
+        uint8_t sz53 = static_cast<uint8_t>(sz | (i & (flagU1 | flagU2)));
+        unsigned bits = i;
+        bits ^= bits >> 4;
+        bits ^= bits >> 2;
+        bits ^= bits >> 1;
+        uint8_t parity = ((bits & 1) == 0) ? flagPV : 0;
+        tables.SZ[i] = sz;
+        tables.SZ53[i] = sz53;
+        tables.SZ53P[i] = static_cast<uint8_t>(sz53 | parity);
+        tables.Inc[i] = static_cast<uint8_t>(sz53 | ((i == 0x80) ? flagPV : 0) | (((i & 0x0F) == 0x00) ? flagHC : 0));
+        tables.Dec[i] = static_cast<uint8_t>(sz53 | flagN | ((i == 0x7F) ? flagPV : 0) | (((i & 0x0F) == 0x0F) ? flagHC : 0));
+    }
+    constexpr uint8_t halfCarryAdd[8] = { 0, flagHC, flagHC, flagHC, 0, 0, 0, flagHC };
+    constexpr uint8_t halfCarrySub[8] = { 0, 0, flagHC, 0, flagHC, 0, flagHC, flagHC };
+    constexpr uint8_t overflowAdd[8] = { 0, 0, 0, flagPV, flagPV, 0, 0, 0 };
+    constexpr uint8_t overflowSub[8] = { 0, flagPV, 0, 0, 0, 0, flagPV, 0 };
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        tables.HalfCarryAdd[i] = halfCarryAdd[i];
+        tables.HalfCarrySub[i] = halfCarrySub[i];
+        tables.OverflowAdd[i] = overflowAdd[i];
+        tables.OverflowSub[i] = overflowSub[i];
+    }
+    return tables;
+}
+
+inline constexpr Z80FlagTables FlagTables = BuildZ80FlagTables();
+
+// All flag tables together should stay well within L1 cache
+static_assert(sizeof(Z80FlagTables) < 4096, "Z80 flag tables too large");
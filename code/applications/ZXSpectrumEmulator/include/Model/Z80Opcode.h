@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class Z80;
+struct Z80DecodedInstruction;
+
+// Opcode handlers receive the CPU they execute on, and are dispatched through flat 256 entry tables
+using OpcodeHandler = void (*)(Z80 &cpu);
+using OpcodeTable = std::array<OpcodeHandler, 256>;
+
+// Handlers for pre-decoded instructions take their operands from the decoded instruction instead of fetching them
+using DecodedOpcodeHandler = void (*)(Z80 &cpu, const Z80DecodedInstruction &instruction);
+
+// Pre-decoded handler of an opcode, with the T-states it takes after the prefixes up to its first data access (the not
+// taken path for conditional branches). Opcodes without operands run their normal handler after the opcode fetch, which
+// adds the rest, so these have 4
+struct DecodedOpcode
+{
+    DecodedOpcodeHandler Handler;
+    uint8_t TStates;
+};
+using DecodedOpcodeTable = std::array<DecodedOpcode, 256>;
+
+enum class OpcodePrefix : uint8_t
+{
+    None,
+    CB,
+    ED,
+    DD,
+    FD,
+    DDCB,
+    FDCB,
+    Count,
+};
+
+// Static properties of an opcode, used to pre-decode instructions
+struct OpcodeInfo
+{
+    // Number of operand bytes following the opcode (displacement and immediates)
+    uint8_t OperandLength;
+    // The first operand byte is the displacement of an (IX+d) / (IY+d) operand
+    bool HasDisplacement;
+    // Unconditional change of control flow, or a change of interrupt state
+    bool EndsBlock;
+    // Stores to memory, or writes to a port, which may switch banks. Either can overwrite the running block
+    bool MayWriteCode;
+    // IN / OUT, including the block I/O instructions
+    bool AccessesIO;
+    bool IsValid;
+};
+using OpcodeInfoTable = std::array<OpcodeInfo, 256>;
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "Model/Memory.h"
+#include "Model/Z80BlockCache.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define Z80_RECOMPILER_SUPPORTED 1
+#else
+#define Z80_RECOMPILER_SUPPORTED 0
+#endif
+
+// Offsets of the CPU state touched by generated code, relative to the Z80 object
+struct Z80NativeLayout
+{
+    // Z80Registers::Reg, the 8 bit registers are at their RegisterIndex from here
+    int32_t Registers;
+    int32_t PC;
+    int32_t R;
+    int32_t CPUClock;
+    int32_t InstructionCount;
+};
+
+// Translates decoded blocks into x86-64 code. LD r,r', LD r,n, INC r, DEC r and the 8 bit ALU operations on registers
+// and immediates are translated into host instructions working on A, F, B, C, D, E, H and L in host registers. The
+// registers are loaded when first used and written back before any other instruction, which calls its decoded handler
+// as the block loop does, and when the block is left. R and the clock are also only written back when needed, so the
+// state seen by handlers and after the block is the same as for the interpreter. Jumps back to the start of the block
+// and repeating block instructions loop inside the generated code, the instructions of the earlier passes are added to
+// the instruction count there
+class Z80Recompiler
+{
+public:
+    // The arena is mapped by the first Compile, so CPUs that never recompile do not map one. Each CPU has its own, so
+    // every machine of a MachinePool running the recompiler adds this much
+    static constexpr std::size_t ArenaSize = 1024 * 1024;
+    // Largest amount of code and data generated for a single block
+    static constexpr std::size_t MaxBlockCodeSize = 384 * Z80BlockCache::MaxBlockLength + 256;
+
+private:
+    // Machine state at a point in the generated code, the exit code there writes back what is still in host registers
+    struct ExitState
+    {
+        // Instructions executed, returned by the block
+        uint32_t Count;
+        // M1 cycles since the block was entered
+        uint8_t RefreshCount;
+        // Registers changed in host registers, bit n for r-field n
+        uint8_t DirtyRegisters;
+        // The clock is in rcx
+        bool ClockLoaded;
+        // PC still has to be set
+        bool StorePC;
+        uint16_t PC;
+    };
+    struct Exit
+    {
+        ExitState State;
+        // Positions of the rel32 jumps to this exit
+        std::vector<std::size_t> Jumps;
+    };
+    // A jump that may go back to the start of the block, or a repeating block instruction
+    struct LoopBranch
+    {
+        // Where the loop continues, in the Z80 address space and in the generated code
+        uint16_t Address;
+        std::size_t Start;
+        // Instructions and M1 cycles of a pass
+        uint32_t Count;
+        uint8_t RefreshCount;
+        // Position of the rel32 jump taken when the instruction branched
+        std::size_t Jump;
+        // Exit taken when the branch leaves the loop
+        std::size_t Exit;
+    };
+
+    Z80NativeLayout m_layout;
+    uint8_t *m_arena;
+    std::size_t m_arenaUsed;
+    bool m_arenaFailed;
+    std::vector<uint8_t> m_code;
+    std::vector<Exit> m_exits;
+    std::vector<LoopBranch> m_loopBranches;
+    // Positions of rel32 jumps to the epilogue
+    std::vector<std::size_t> m_epilogueJumps;
+    // Copies of the instructions run by their handlers, placed after the code, with the positions of the rip relative
+    // references to them
+    std::vector<Z80DecodedInstruction> m_instructionData;
+    std::vector<std::size_t> m_instructionReferences;
+    // Registers in host registers, bit n for r-field n
+    uint8_t m_loadedRegisters;
+    uint8_t m_dirtyRegisters;
+    bool m_clockLoaded;
+
+public:
+    explicit Z80Recompiler(const Z80NativeLayout &layout);
+    Z80Recompiler(const Z80Recompiler &) = delete;
+    Z80Recompiler(Z80Recompiler &&) = delete;
+    ~Z80Recompiler();
+
+    Z80Recompiler &operator = (const Z80Recompiler &) = delete;
+    Z80Recompiler &operator = (Z80Recompiler &&) = delete;
+
+    // False on hosts other than x86-64, or when no executable memory could be allocated
+    bool IsAvailable() const { return Z80_RECOMPILER_SUPPORTED && !m_arenaFailed; }
+    bool IsFull() const { return m_arenaUsed + MaxBlockCodeSize > ArenaSize; }
+    // Discards all generated code
+    void Flush();
+
+    // Returns nullptr for blocks that cannot be compiled (I/O), or when the arena is full
+    Z80NativeBlock Compile(const Z80DecodedBlock &block, const Z80DecodedInstruction *instructions, const PagedMemoryMap &memoryMap);
+
+private:
+    void Emit8(uint8_t value);
+    void Emit16(uint16_t value);
+    void Emit32(uint32_t value);
+    void Emit64(uint64_t value);
+    void EmitBytes(std::initializer_list<uint8_t> bytes);
+    // REX prefix for the given ModRM reg, SIB index and ModRM rm / SIB base registers. Forced for byte operations, so
+    // that registers 4 to 7 are spl, bpl, sil and dil
+    void EmitRex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force);
+    // Opcode byte(s) followed by a ModRM byte addressing [rbx + offset]
+    void EmitCPUOperand(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t offset, bool wide = false, bool byteRegister = false);
+    // Opcode byte(s) followed by a ModRM byte for two registers
+    void EmitRegisters(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm, bool wide = false, bool byteRegister = false);
+    // Opcode byte(s) followed by a ModRM byte addressing [r12 + index + offset], r12 points to the flag tables
+    void EmitFlagTableOperand(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t index, int32_t offset);
+    void EmitJump(uint8_t condition, std::size_t exit);
+    // Points the rel32 fields at the given positions to target
+    void Patch(const std::vector<std::size_t> &positions, std::size_t target);
+    bool CreateArena();
+    void EmitPrologue();
+    void EmitEpilogue();
+    void EmitExit(const ExitState &state);
+    ExitState CurrentState(uint32_t count, const Z80DecodedInstruction &instruction, bool storePC) const;
+    std::size_t AddExit(const ExitState &state);
+
+    void LoadRegister(uint8_t field);
+    void DefineRegister(uint8_t field);
+    void StoreRegisters(uint8_t registers);
+    void LoadClock();
+    void StoreClock();
+    void StoreRefresh(uint8_t count);
+    void WriteBack();
+
+    bool EmitNativeInstruction(const Z80DecodedInstruction &instruction, uint32_t count);
+    void EmitLoadRegister(uint8_t destination, uint8_t source);
+    void EmitLoadImmediate(uint8_t destination, uint8_t value);
+    void EmitALU(uint8_t operation, uint8_t source, bool immediate, uint8_t value);
+    void EmitIncDec(uint8_t field, bool decrement);
+    // The loop is taken when the instruction branches to its address, nullptr if it cannot loop
+    std::size_t EmitHandlerCall(const Z80DecodedInstruction &instruction, uint32_t count, const LoopBranch *loop);
+    void EmitGenerationChecks(const Z80DecodedBlock &block, const PagedMemoryMap &memoryMap, std::size_t exit);
+    void EmitGenerationCheck(const uint32_t *generation, uint32_t expected, std::size_t exit);
+    void EmitLoopBranch(const Z80DecodedBlock &block, const PagedMemoryMap &memoryMap, const LoopBranch &loop);
+};
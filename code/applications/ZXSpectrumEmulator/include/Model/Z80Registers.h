@@ -5,42 +5,81 @@
 
 #include "tracing/Tracing.h"
 
+// The host byte order decides where the high and low byte of a register pair live
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define Z80_HOST_BIG_ENDIAN 1
+#else
+#define Z80_HOST_BIG_ENDIAN 0
+#endif
+
+// Byte offsets of the 8 bit registers in Z80Registers::Reg. These are not the r-field values in the opcode, use
+// Z80Registers::RegisterByField to decode those
 enum RegisterIndex
 {
-    A = 0x7,
+#if Z80_HOST_BIG_ENDIAN
     B = 0x0,
     C = 0x1,
     D = 0x2,
     E = 0x3,
     H = 0x4,
     L = 0x5,
+    A = 0x6,
+    F = 0x7,
+#else
+    C = 0x0,
+    B = 0x1,
+    E = 0x2,
+    D = 0x3,
+    L = 0x4,
+    H = 0x5,
+    F = 0x6,
+    A = 0x7,
+#endif
 };
 
-__pragma(pack(push, 1))
-class Z80Registers
+// Offsets of the high and low byte inside a 16 bit register
+constexpr uint8_t PairHighByte = Z80_HOST_BIG_ENDIAN ? 0 : 1;
+constexpr uint8_t PairLowByte = Z80_HOST_BIG_ENDIAN ? 1 : 0;
+
+// Index in Z80Registers::Pair
+enum RegisterPairIndex
 {
-public:
-    // General-purpose register set (except Flags (= 6))
-    uint8_t Reg[8];
-    // Flags register
-    uint8_t F;
+    BC = 0x0,
+    DE = 0x1,
+    HL = 0x2,
+    AF = 0x3,
+};
 
-    // Alternate register set (except F')
-    uint8_t Reg_[8];
-    // Alternate Flags register
-    uint8_t F_;
+// Maps the 3 bit r-field of an opcode (B, C, D, E, H, L, (HL), A) to the register byte offset. (HL) maps to F, the
+// handlers for (HL) never use it
+constexpr uint8_t RegisterFieldOffset[8] =
+{
+    RegisterIndex::B, RegisterIndex::C, RegisterIndex::D, RegisterIndex::E,
+    RegisterIndex::H, RegisterIndex::L, RegisterIndex::F, RegisterIndex::A,
+};
 
-    // Interrupt page address register
-    uint8_t I;
-    // Index registers
-    uint16_t IX, IY;
+// Hot registers come first and all 16 bit registers are naturally aligned, so the whole working set fits in one
+// cache line
+class Z80Registers
+{
+public:
+    // General-purpose register set and flags, as bytes or as pairs
+    union
+    {
+        uint8_t Reg[8];
+        uint16_t Pair[4];
+    };
     // Program counter
     uint16_t PC;
-    // Memory refresh register
-    uint8_t R;
     // Stack pointer
     uint16_t SP;
+    // Index registers
+    uint16_t IX, IY;
 
+    // Interrupt page address register
+    uint8_t I;
+    // Memory refresh register
+    uint8_t R;
     // Interrupt flip-flops
     bool IFF1;
     bool IFF2;
@@ -52,18 +91,73 @@ public:
     bool IntPending;
     // A NMI is pending
     bool NMIPending;
-    // 0 / 0xDD / 0xFD
-    uint8_t Modifier;
     // Halted by the HALT instruction?
     bool Halted;
+    // 0 / 0xDD / 0xFD
+    uint8_t Modifier;
+
+    // Alternate register set, only touched by EX AF,AF' and EXX
+    union
+    {
+        uint8_t Reg_[8];
+        uint16_t Pair_[4];
+    };
 
     void Reset();
     std::string Dump();
-    void SetAF(uint16_t val);
-    void SetBC(uint16_t val);
-    void SetDE(uint16_t val);
-    void SetHL(uint16_t val);
-    void SetPC(uint16_t val);
-    void XOR(RegisterIndex op1, RegisterIndex op2, RegisterIndex result);
+
+    uint8_t &F() { return Reg[RegisterIndex::F]; }
+    uint8_t F() const { return Reg[RegisterIndex::F]; }
+    uint8_t &RegisterByField(uint8_t field) { return Reg[RegisterFieldOffset[field & 0x07]]; }
+
+    uint16_t GetAF() const { return Pair[RegisterPairIndex::AF]; }
+    uint16_t GetBC() const { return Pair[RegisterPairIndex::BC]; }
+    uint16_t GetDE() const { return Pair[RegisterPairIndex::DE]; }
+    uint16_t GetHL() const { return Pair[RegisterPairIndex::HL]; }
+    void SetAF(uint16_t val) { Pair[RegisterPairIndex::AF] = val; }
+    void SetBC(uint16_t val) { Pair[RegisterPairIndex::BC] = val; }
+    void SetDE(uint16_t val) { Pair[RegisterPairIndex::DE] = val; }
+    void SetHL(uint16_t val) { Pair[RegisterPairIndex::HL] = val; }
+    void SetPC(uint16_t val) { PC = val; }
+
+    // LD A,I / LD A,R: P/V reflects IFF2
+    void LoadInterruptRegister(uint8_t value);
+
+    // 8 bit arithmetic and logic on A, flags are set from the tables in Z80Flags.h
+    void Add8(uint8_t value);
+    void Adc8(uint8_t value);
+    void Sub8(uint8_t value);
+    void Sbc8(uint8_t value);
+    void Cp8(uint8_t value);
+    void And8(uint8_t value);
+    void Or8(uint8_t value);
+    void Xor8(uint8_t value);
+    uint8_t Inc8(uint8_t value);
+    uint8_t Dec8(uint8_t value);
+    void Daa();
+    void Cpl();
+    void Neg();
+    void Scf();
+    void Ccf();
+    // Rotates of A, these leave S, Z and P/V alone
+    void Rlca();
+    void Rrca();
+    void Rla();
+    void Rra();
+    // CB prefixed rotates and shifts
+    uint8_t Rlc(uint8_t value);
+    uint8_t Rrc(uint8_t value);
+    uint8_t Rl(uint8_t value);
+    uint8_t Rr(uint8_t value);
+    uint8_t Sla(uint8_t value);
+    uint8_t Sra(uint8_t value);
+    uint8_t Sll(uint8_t value);
+    uint8_t Srl(uint8_t value);
+    void Bit(uint8_t bit, uint8_t value);
+    // 16 bit arithmetic: ADD rr,rr returns the result, ADC/SBC operate on HL
+    uint16_t Add16(uint16_t op1, uint16_t op2);
+    void Adc16(uint16_t value);
+    void Sbc16(uint16_t value);
 };
-__pragma(pack(pop))
+
+static_assert(sizeof(Z80Registers) <= 64, "Z80 register file should fit in a cache line");
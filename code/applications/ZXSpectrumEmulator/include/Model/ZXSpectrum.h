@@ -5,14 +5,52 @@
 
 #include "tracing/Tracing.h"
 #include "Model/ISystem.h"
+#include "Model/AY38912.h"
+#include "Model/Beeper.h"
+#include "Model/KeyboardMatrix.h"
+#include "Model/MemoryBanks.h"
+#include "Model/PageSnapshots.h"
+#include "Model/ULAContention.h"
+#include "Model/ULAPort.h"
+#include "Model/ULARenderer.h"
+#include "Model/VideoBorder.h"
 #include "Model/Z80.h"
+#include "Model/ZXSpectrumModel.h"
 
-
+// The 48K Spectrum, and the parts shared by all models. One frame is run per 50 Hz interrupt
 class ZXSpectrum
     : public ISystem
 {
-private:
+public:
+    static constexpr uint16_t DisplayMemoryAddress = 0x4000;
+    // Display file and attributes, rounded up to whole memory pages
+    static constexpr uint16_t DisplayMemoryObservedSize = 0x1C00;
+    // Level of the AY in the mix, in 16 bit sample units. All three channels at full volume span the same range as the
+    // beeper
+    static constexpr float AYMixLevel = 0.5F * 32767;
+    // Layout version of SystemState::Data
+    static constexpr uint32_t StateVersion = 2;
+
+protected:
+    const ZXSpectrumModel &m_model;
     Z80 m_cpu;
+    MemoryBanks m_memory;
+    ULARenderer m_ula;
+
+private:
+    uint64_t m_frameEndClock;
+    uint64_t m_frameCount;
+    ULAContention m_contention;
+    VideoBorder m_border;
+    Beeper m_beeper;
+    KeyboardMatrix m_keyboard;
+    KeyEventQueue m_keyEvents;
+    ULAPort m_ulaPort;
+    AY38912 m_ay;
+    ULAScreen m_screen;
+    FrameMailbox m_frames;
+    AudioRingBuffer m_audio;
+    PageSnapshots m_snapshots;
 
 public:
     ZXSpectrum();
@@ -30,11 +68,35 @@ public:
 
     bool LoadROM(const ByteVector &romContents) override;
 
+    void SaveState(SystemState &state) override;
+    bool LoadState(const SystemState &state) override;
+    void SaveCPUState(ByteVector &buffer) override;
+
     bool Disassemble(std::string &mnemonic) override;
     bool ProcessInstruction() override;
+    RunExitReason RunFor(uint64_t tstates) override;
+    RunExitReason RunFrame() override;
+    uint64_t GetFrameTStates() override;
+    uint64_t GetFrameCount() override;
+    void SetExecutionMode(ExecutionMode mode) override;
+    FrameMailbox &GetFrames() override;
+    AudioRingBuffer &GetAudio() override;
+    uint64_t GetAudioSampleRate() override;
+    KeyEventQueue &GetKeyEvents() override;
+    const uint8_t *GetDisplayMemory() override;
 
     std::string DumpRegisters() override;
 
     uint64_t GetCPUClock() override;
     uint64_t GetCPUClockFreq() override;
+
+protected:
+    explicit ZXSpectrum(const ZXSpectrumModel &model);
+    // State of the devices a model adds, saved after the shared devices and loaded before the RAM
+    virtual void SaveModelState(ByteVector & /*buffer*/, std::size_t & /*offset*/) const {}
+    virtual bool LoadModelState(const ByteVector & /*buffer*/, std::size_t & /*offset*/) { return true; }
+
+private:
+    void ApplyKeyEvents();
+    void MixAudio(uint64_t frameTStates);
 };
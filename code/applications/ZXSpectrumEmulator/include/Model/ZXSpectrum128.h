@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Model/MemoryPaging.h"
+#include "Model/ZXSpectrum.h"
+
+// The 128K Spectrum (and +2): eight RAM banks and two ROMs switched through port 0x7FFD, a shadow screen in bank 7
+// and the AY-3-8912
+class ZXSpectrum128
+    : public ZXSpectrum
+{
+private:
+    MemoryPaging m_paging;
+
+public:
+    ZXSpectrum128();
+    ZXSpectrum128(const ZXSpectrum128 &) = delete;
+    ZXSpectrum128(ZXSpectrum128 &&) = delete;
+
+    ZXSpectrum128 &operator = (ZXSpectrum128 &) = delete;
+    ZXSpectrum128 &operator = (ZXSpectrum128 &&) = delete;
+
+    void Reset() override;
+
+    const MemoryPaging &GetPaging() const { return m_paging; }
+    const uint8_t *GetDisplayMemory() override;
+
+protected:
+    void SaveModelState(ByteVector &buffer, std::size_t &offset) const override;
+    bool LoadModelState(const ByteVector &buffer, std::size_t &offset) override;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// What differs between the Spectrum models: clock, frame timing and memory layout
+struct ZXSpectrumModel
+{
+    const char *Name;
+    const char *ROMFileName;
+    uint64_t CPUClockFreq;
+    uint32_t TStatesPerLine;
+    uint32_t LinesPerFrame;
+    // Lines from the interrupt to the first line of the display file
+    uint32_t FirstScreenLine;
+    // First T-state at which the ULA holds off the CPU, one display line takes 128 of the T-states of a line
+    uint32_t FirstContendedTState;
+    // T-states the ULA holds INT low at the start of the frame
+    uint64_t InterruptLength;
+    std::size_t ROMBankCount;
+    std::size_t RAMBankCount;
+    // RAM banks at 0x4000, 0x8000 and 0xC000 after reset
+    std::array<uint8_t, 3> InitialRAMBanks;
+    // RAM bank holding the display file after reset
+    uint8_t ScreenBank;
+    // RAM banks shared with the ULA, one bit per bank
+    uint8_t ContendedRAMBanks;
+    // Banks are switched through port 0x7FFD
+    bool HasMemoryPaging;
+    bool HasAY;
+
+    constexpr uint64_t TStatesPerFrame() const
+    {
+        return static_cast<uint64_t>(TStatesPerLine) * LinesPerFrame;
+    }
+    constexpr uint32_t FirstScreenLineTState() const
+    {
+        return FirstScreenLine * TStatesPerLine;
+    }
+};
+
+// 312 lines of 224 T-states, 48 KB of RAM laid out as three banks. Only the lower 16 KB is contended
+inline constexpr ZXSpectrumModel Spectrum48K
+{
+    "ZX Spectrum 48K", "spec48.rom", 3500000, 224, 312, 64, 14335, 32, 1, 3, { 0, 1, 2 }, 0, 0x01, false, false,
+};
+
+// 311 lines of 228 T-states, eight RAM banks and two ROMs (128K editor and 48K BASIC). Banks 5 and 2 are always at
+// 0x4000 and 0x8000, and bank 7 holds the shadow screen. The odd banks are contended
+inline constexpr ZXSpectrumModel Spectrum128K
+{
+    "ZX Spectrum 128K", "spec128.rom", 3546900, 228, 311, 63, 14361, 36, 2, 8, { 5, 2, 0 }, 5, 0xAA, true, true,
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "SDL3CPP/AudioStream.h"
+
+#include "Model/AudioRingBuffer.h"
+
+struct SDL_AudioStream;
+
+// Plays the PCM produced by the system on the default audio device. SDL asks for samples on its own audio thread,
+// they are taken from the system's ring buffer.
+// The emulation is paced by the host clock, which drifts against the clock of the audio device. The fill level of the
+// ring buffer shows the drift, and the playback rate is adjusted by a fraction of a percent to keep it at the target
+// level (dynamic rate control), so the buffer neither runs dry nor overflows. The pitch change is inaudible
+class AudioOutput
+{
+public:
+    // Fill level aimed for, in ms
+    static constexpr uint64_t TargetLatency = 50;
+    // Largest deviation of the playback rate from nominal
+    static constexpr float MaxRateAdjustment = 0.005F;
+
+private:
+    AudioRingBuffer *m_source;
+    std::unique_ptr<SDL3CPP::AudioStream> m_stream;
+    std::size_t m_targetFill;
+    float m_rate;
+    // Repeated when the ring buffer runs dry, dropping to zero would click
+    int16_t m_lastSample;
+    std::array<int16_t, 1024> m_chunk;
+
+public:
+    AudioOutput();
+    AudioOutput(const AudioOutput &) = delete;
+    AudioOutput(AudioOutput &&) = delete;
+
+    AudioOutput &operator = (const AudioOutput &) = delete;
+    AudioOutput &operator = (AudioOutput &&) = delete;
+
+    // Opens the default playback device for mono 16 bit samples from source, and starts playing
+    bool Open(AudioRingBuffer &source, uint64_t sampleRate);
+    void Close();
+
+private:
+    static void Callback(void *userdata, SDL_AudioStream *stream, int additionalAmount, int totalAmount);
+    void Fill(SDL_AudioStream *stream, int additionalAmount);
+    void UpdateRate();
+};
@@ -13,11 +13,11 @@
 #include "SDL3CPP/Window.h"
 
 #include "Model/ISystem.h"
+#include "Model/PixelKernels.h"
+#include "View/AudioOutput.h"
 
 class Model;
 
-constexpr int ScreenBufferDepth = 2;
-
 class MainView
 {
 private:
@@ -34,11 +34,10 @@ private:
 
     SDL3CPP::Texture m_infoPanelTexture;
 
-    SDL3CPP::Texture m_zxSpectumScreenBuffer[ScreenBufferDepth];
+    // Only touched by the render thread, frames from the emulation thread arrive through the system's mailbox
+    SDL3CPP::Texture m_zxSpectumScreenBuffer;
     int m_displayScreenWidth;
     int m_displayScreenHeight;
-    int m_zxSpectumScreenBufferIndex;
-    int m_zxSpectumScreenBufferIndexForUpdate;
     void *m_imageData;
     int m_imagePitch;
     float m_zxSpectrumZoom;
@@ -46,9 +45,12 @@ private:
     int m_zxSpectrumScreenHeight;
     SDL3CPP::FRect m_zxSpectrumImageRect;
     SDL3CPP::FRect m_zxSpectrumScreenRect;
-    SDL3CPP::Color m_borderColor;
+    // Number of the frame last copied into the texture
+    uint64_t m_uploadedFrameNumber;
+    const PixelKernels &m_pixelKernels;
+    AudioOutput m_audioOutput;
     bool m_quit;
-    SDL3CPP::Event m_keyDownEvent;
+    // Set on every key press, for single stepping in debug mode
     osal::ManualEvent m_keyDownEventTrigger;
 
 public:
@@ -67,14 +69,17 @@ public:
 
     bool Render();
 
-    void UpdateBuffer(uint8_t r, uint8_t g, uint8_t b);
+    void UpdateBuffer(const VideoFrame &frame);
     void SetPixel(int x, int y, SDL3CPP::Color color);
-    void SetBorderColor(uint8_t r, uint8_t g, uint8_t b);
-    bool LockTexture();
+    bool LockTexture(int firstLine, int lastLine);
     bool UnlockTexture();
 
     void Stop();
     bool Quit() const;
     void HandleEvent(const SDL3CPP::Event &e);
     void WaitForInput();
+
+private:
+    // Queues a Spectrum key going down or up, host keys without a Spectrum key are ignored
+    void PushKeyEvent(SDL_Keycode key, bool pressed);
 };
@@ -2,10 +2,12 @@
 
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <thread>
 #include "core/threading/Thread.h"
 #include <SDL3/SDL_keycode.h>
 #include "Model/ZXSpectrum.h"
+#include "Model/ZXSpectrum128.h"
 #include "View/MainView.h"
 
 class ZXSpectrumEmulatorThread
@@ -29,31 +31,20 @@ public:
 Controller::Controller(Model& model, MainView& view)
     : m_model{model}
     , m_mainView{view}
+    , m_machine{ &Spectrum48K }
     , m_system{}
+    , m_framePacer{}
     , m_debug{}
 {
 }
 
 bool Controller::Init()
 {
-    m_system  = std::make_shared<ZXSpectrum>();
-
-    std::filesystem::path romDir{ ROM_DIR };
-    std::filesystem::path romFilePath{(romDir / "spec48.rom").generic_string() };
-    auto fileSize = std::filesystem::file_size(romFilePath);
-    std::ifstream romFile{ romFilePath, std::ios::binary };
-    if (!romFile)
-        TRACE_FATAL("Can't open ROM file");
-    std::vector<uint8_t> romContents;
-    romContents.reserve(fileSize);
-    romContents.resize(fileSize);
-    romFile.read(reinterpret_cast<char *>(romContents.data()), static_cast<std::streamsize>(fileSize));
-
-    bool result = m_system->LoadROM(romContents);
-
+    m_system = CreateSystem(*m_machine, DefaultROMPath(*m_machine));
+    bool result = (m_system != nullptr);
     if (result)
     {
-        result = m_system->Init();
+        m_framePacer.SetFramePeriod(m_system->GetFrameTStates(), m_system->GetCPUClockFreq());
     }
     if (result)
     {
@@ -67,6 +58,55 @@ void Controller::SetDebug(bool on)
     m_debug = on;
 }
 
+void Controller::SetPacingMode(PacingMode mode)
+{
+    m_framePacer.SetMode(mode);
+}
+
+void Controller::SetMachine(const ZXSpectrumModel &machine)
+{
+    m_machine = &machine;
+}
+
+std::shared_ptr<ISystem> Controller::CreateSystem(const ZXSpectrumModel &machine, const std::string &romPath)
+{
+    ByteVector romContents;
+    if (!LoadROMFile(romPath, romContents))
+        return nullptr;
+    return CreateSystem(machine, romContents);
+}
+
+std::shared_ptr<ISystem> Controller::CreateSystem(const ZXSpectrumModel &machine, const ByteVector &romContents)
+{
+    std::shared_ptr<ISystem> system;
+    if (machine.HasMemoryPaging)
+        system = std::make_shared<ZXSpectrum128>();
+    else
+        system = std::make_shared<ZXSpectrum>();
+
+    if (!system->LoadROM(romContents) || !system->Init())
+        return nullptr;
+    return system;
+}
+
+bool Controller::LoadROMFile(const std::string &romPath, ByteVector &romContents)
+{
+    std::ifstream romFile{ romPath, std::ios::binary };
+    if (!romFile)
+    {
+        TRACE_ERROR("Can't open ROM file {}", romPath);
+        return false;
+    }
+    romContents.assign(std::istreambuf_iterator<char>(romFile), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::string Controller::DefaultROMPath(const ZXSpectrumModel &machine)
+{
+    std::filesystem::path romDir{ ROM_DIR };
+    return (romDir / machine.ROMFileName).generic_string();
+}
+
 bool Controller::Run()
 {
     ZXSpectrumEmulatorThread thread(*this);
@@ -86,17 +126,23 @@ bool Controller::Thread()
 
 bool Controller::DoRun()
 {
-    while (!m_system->IsHalted() && !m_mainView.Quit())
+    m_framePacer.Start();
+    while (!m_mainView.Quit())
     {
-        bool ok = m_system->ProcessInstruction();
-        if (!ok)
-            TRACE_ERROR("Instruction execution failed!");
+        auto exitReason = m_system->RunFrame();
         if (m_debug)
         {
             m_mainView.ShowRegisters();
         }
-        if (!ok)
+        if (exitReason == RunExitReason::Error)
+        {
+            TRACE_ERROR("Instruction execution failed!");
             return false;
+        }
+        if (exitReason == RunExitReason::Halted)
+            break;
+        if (exitReason == RunExitReason::BudgetSpent)
+            m_framePacer.WaitForNextFrame();
     }
     return true;
 }
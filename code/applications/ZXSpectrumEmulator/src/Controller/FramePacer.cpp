@@ -0,0 +1,69 @@
+#include "Controller/FramePacer.h"
+
+#include "SDL3CPP/Timers.h"
+
+using namespace SDL3CPP;
+
+static constexpr uint64_t NanoSecondsPerSecond = 1000000000;
+// Restart the schedule if we are this many frames behind
+static constexpr uint64_t MaxFramesBehind = 5;
+
+FramePacer::FramePacer()
+    : m_framePeriodNanoSeconds{ NanoSecondsPerSecond / 50 }
+    , m_mode{ PacingMode::RealTime }
+    , m_startTime{}
+    , m_frameCount{}
+{
+}
+
+void FramePacer::SetFramePeriod(uint64_t frameTStates, uint64_t cpuClockFreq)
+{
+    m_framePeriodNanoSeconds = frameTStates * NanoSecondsPerSecond / cpuClockFreq;
+    Start();
+}
+
+void FramePacer::SetMode(PacingMode mode)
+{
+    m_mode = mode;
+    Start();
+}
+
+void FramePacer::Start()
+{
+    m_startTime = Timers::GetTicksNanoSecond();
+    m_frameCount = 0;
+}
+
+void FramePacer::WaitForNextFrame()
+{
+    if (m_mode == PacingMode::Unthrottled)
+        return;
+
+    ++m_frameCount;
+    auto period = ScaledFramePeriod();
+    auto deadline = m_startTime + m_frameCount * period;
+    auto now = Timers::GetTicksNanoSecond();
+    if (now < deadline)
+    {
+        Timers::DelayPrecise(deadline - now);
+    }
+    else if (now - deadline > MaxFramesBehind * period)
+    {
+        Start();
+    }
+}
+
+uint64_t FramePacer::ScaledFramePeriod() const
+{
+    switch (m_mode)
+    {
+    case PacingMode::Double:
+        return m_framePeriodNanoSeconds / 2;
+    case PacingMode::Quadruple:
+        return m_framePeriodNanoSeconds / 4;
+    case PacingMode::RealTime:
+    case PacingMode::Unthrottled:
+    default:
+        return m_framePeriodNanoSeconds;
+    }
+}
@@ -0,0 +1,189 @@
+#include "Controller/HeadlessRunner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include "tracing/Tracing.h"
+#include "Controller/Controller.h"
+#include "Controller/MachinePool.h"
+#include "Model/ULARenderer.h"
+
+static const std::pair<const char *, ZXKey> KeyNames[] =
+{
+    { "CapsShift", ZXKey::CapsShift }, { "Z", ZXKey::Z }, { "X", ZXKey::X }, { "C", ZXKey::C }, { "V", ZXKey::V },
+    { "A", ZXKey::A }, { "S", ZXKey::S }, { "D", ZXKey::D }, { "F", ZXKey::F }, { "G", ZXKey::G },
+    { "Q", ZXKey::Q }, { "W", ZXKey::W }, { "E", ZXKey::E }, { "R", ZXKey::R }, { "T", ZXKey::T },
+    { "Key1", ZXKey::Key1 }, { "Key2", ZXKey::Key2 }, { "Key3", ZXKey::Key3 }, { "Key4", ZXKey::Key4 }, { "Key5", ZXKey::Key5 },
+    { "Key0", ZXKey::Key0 }, { "Key9", ZXKey::Key9 }, { "Key8", ZXKey::Key8 }, { "Key7", ZXKey::Key7 }, { "Key6", ZXKey::Key6 },
+    { "P", ZXKey::P }, { "O", ZXKey::O }, { "I", ZXKey::I }, { "U", ZXKey::U }, { "Y", ZXKey::Y },
+    { "Enter", ZXKey::Enter }, { "L", ZXKey::L }, { "K", ZXKey::K }, { "J", ZXKey::J }, { "H", ZXKey::H },
+    { "Space", ZXKey::Space }, { "SymbolShift", ZXKey::SymbolShift }, { "M", ZXKey::M }, { "N", ZXKey::N }, { "B", ZXKey::B },
+};
+
+static bool ParseKey(const std::string &name, ZXKey &key)
+{
+    for (const auto &keyName : KeyNames)
+    {
+        if (name == keyName.first)
+        {
+            key = keyName.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+HeadlessRunner::HeadlessRunner(std::ostream &output)
+    : m_output{ output }
+    , m_keyScript{}
+{
+}
+
+bool HeadlessRunner::LoadKeyScript(std::istream &script)
+{
+    m_keyScript.clear();
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(script, line))
+    {
+        ++lineNumber;
+        if (line.empty() || (line[0] == '#'))
+            continue;
+        std::istringstream fields{ line };
+        KeyEvent event{};
+        std::string keyName;
+        std::string direction;
+        if (!(fields >> event.Frame >> keyName >> direction) || !ParseKey(keyName, event.Key) || ((direction != "down") && (direction != "up")))
+        {
+            TRACE_ERROR("Invalid key event on line {}: {}", lineNumber, line);
+            return false;
+        }
+        event.Pressed = (direction == "down");
+        m_keyScript.push_back(event);
+    }
+    // Events of the same frame keep their order
+    std::stable_sort(m_keyScript.begin(), m_keyScript.end(), [](const KeyEvent &lhs, const KeyEvent &rhs) { return lhs.Frame < rhs.Frame; });
+    return true;
+}
+
+bool HeadlessRunner::Run(const HeadlessOptions &options)
+{
+    if (!options.KeyScriptPath.empty())
+    {
+        std::ifstream script{ options.KeyScriptPath };
+        if (!script)
+        {
+            TRACE_ERROR("Can't open key script {}", options.KeyScriptPath);
+            return false;
+        }
+        if (!LoadKeyScript(script))
+            return false;
+    }
+    const std::string romPath = options.ROMPath.empty() ? Controller::DefaultROMPath(*options.Machine) : options.ROMPath;
+    if (options.Instances > 1)
+        return RunInstances(options, romPath);
+    auto system = Controller::CreateSystem(*options.Machine, romPath);
+    if (system == nullptr)
+        return false;
+    system->SetExecutionMode(options.Mode);
+
+    std::size_t nextEvent = 0;
+    for (uint64_t frame = 1; frame <= options.FrameCount; ++frame)
+    {
+        FeedKeyEvents(*system, nextEvent, frame);
+        RunExitReason exitReason{};
+        // A breakpoint ends a run early, the frame is resumed
+        do
+        {
+            exitReason = system->RunFrame();
+        }
+        while (exitReason == RunExitReason::Breakpoint);
+        if (exitReason == RunExitReason::Error)
+        {
+            TRACE_ERROR("Instruction execution failed in frame {}", frame);
+            return false;
+        }
+        WriteHashes(frame, ScreenHash(*system), CPUHash(*system));
+        if (exitReason == RunExitReason::Halted)
+            break;
+    }
+    m_output.flush();
+    return true;
+}
+
+// Each instance runs the whole key script
+bool HeadlessRunner::RunInstances(const HeadlessOptions &options, const std::string &romPath)
+{
+    struct InstanceState
+    {
+        std::size_t NextEvent;
+        uint64_t ScreenHash;
+        uint64_t CPUHash;
+    };
+    std::vector<InstanceState> states(options.Instances);
+    std::vector<MachineJob> jobs;
+    for (auto &state : states)
+    {
+        jobs.push_back({ options.Machine, romPath, options.FrameCount, options.Mode,
+            [this, &state](ISystem &system, uint64_t frame) { FeedKeyEvents(system, state.NextEvent, frame); },
+            [&state](ISystem &system, uint64_t /*framesRun*/) { state.ScreenHash = ScreenHash(system); state.CPUHash = CPUHash(system); } });
+    }
+
+    MachinePool pool;
+    auto results = pool.Run(jobs);
+    bool result = true;
+    for (std::size_t instance = 0; instance < results.size(); ++instance)
+    {
+        if (!results[instance].Succeeded)
+        {
+            TRACE_ERROR("Instance {} failed after {} frames", instance, results[instance].FramesRun);
+            result = false;
+            continue;
+        }
+        WriteHashes(instance, states[instance].ScreenHash, states[instance].CPUHash);
+    }
+    m_output.flush();
+    return result;
+}
+
+void HeadlessRunner::WriteHashes(uint64_t index, uint64_t screenHash, uint64_t cpuHash)
+{
+    m_output << index << ' ' << std::hex << std::setfill('0') << std::setw(16) << screenHash << ' ' << std::setw(16) << cpuHash
+        << std::dec << std::setfill(' ') << '\n';
+}
+
+uint64_t HeadlessRunner::Hash(const uint8_t *data, std::size_t size, uint64_t hash)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * FNVPrime;
+    }
+    return hash;
+}
+
+uint64_t HeadlessRunner::ScreenHash(ISystem &system)
+{
+    return Hash(system.GetDisplayMemory(), ULARenderer::DisplayFileSize + ULARenderer::AttributeFileSize);
+}
+
+// Registers, all flag bits included, and clock as the little endian bytes of a saved state, so the hash is the same
+// on every host
+uint64_t HeadlessRunner::CPUHash(ISystem &system)
+{
+    ByteVector state;
+    system.SaveCPUState(state);
+    return Hash(state.data(), state.size());
+}
+
+// The queue holds a limited number of events, so they are handed over a frame at a time
+void HeadlessRunner::FeedKeyEvents(ISystem &system, std::size_t &nextEvent, uint64_t frame) const
+{
+    while ((nextEvent < m_keyScript.size()) && (m_keyScript[nextEvent].Frame <= frame))
+    {
+        if (!system.GetKeyEvents().Push(m_keyScript[nextEvent]))
+            break;
+        ++nextEvent;
+    }
+}
@@ -0,0 +1,112 @@
+#include "Controller/MachinePool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include "osal/utilities/ThreadFunctions.h"
+#include "tracing/Tracing.h"
+#include "Controller/Controller.h"
+
+MachinePool::MachinePool(std::size_t workerCount)
+    : m_workerCount{ workerCount }
+{
+    if (m_workerCount == 0)
+        m_workerCount = std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+std::size_t MachinePool::GetWorkerCount() const
+{
+    return m_workerCount;
+}
+
+std::vector<MachineResult> MachinePool::Run(const std::vector<MachineJob> &jobs)
+{
+    // Read on this thread, the workers only read the contents. A ROM that can't be read is kept as nullptr, and fails
+    // its jobs
+    std::map<std::string, std::unique_ptr<ByteVector>> roms;
+    std::vector<const ByteVector *> jobROMs(jobs.size());
+    for (std::size_t index = 0; index < jobs.size(); ++index)
+    {
+        const std::string romPath = jobs[index].ROMPath.empty() ? Controller::DefaultROMPath(*jobs[index].Machine) : jobs[index].ROMPath;
+        auto it = roms.find(romPath);
+        if (it == roms.end())
+        {
+            auto romContents = std::make_unique<ByteVector>();
+            if (!Controller::LoadROMFile(romPath, *romContents))
+                romContents.reset();
+            it = roms.emplace(romPath, std::move(romContents)).first;
+        }
+        jobROMs[index] = it->second.get();
+    }
+
+    std::vector<MachineResult> results(jobs.size());
+    std::atomic<std::size_t> nextJob{};
+    const std::size_t coreCount = std::max(std::thread::hardware_concurrency(), 1U);
+    auto worker = [&](std::size_t core)
+    {
+        try
+        {
+            osal::SetThreadAffinitySelf(core);
+        }
+        catch (const std::exception &)
+        {
+            TRACE_WARNING("Cannot pin worker to core {}", core);
+        }
+        for (std::size_t index = nextJob++; index < jobs.size(); index = nextJob++)
+        {
+            results[index] = RunJob(jobs[index], jobROMs[index]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const std::size_t workerCount = std::min(m_workerCount, jobs.size());
+    for (std::size_t core = 0; core < workerCount; ++core)
+    {
+        workers.emplace_back(worker, core % coreCount);
+    }
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    return results;
+}
+
+MachineResult MachinePool::RunJob(const MachineJob &job, const ByteVector *romContents)
+{
+    MachineResult result{};
+    if (romContents == nullptr)
+        return result;
+    auto system = Controller::CreateSystem(*job.Machine, *romContents);
+    if (system == nullptr)
+        return result;
+    system->SetExecutionMode(job.Mode);
+
+    result.Succeeded = true;
+    while (result.FramesRun < job.FrameCount)
+    {
+        const uint64_t frame = result.FramesRun + 1;
+        if (job.BeforeFrame)
+            job.BeforeFrame(*system, frame);
+        RunExitReason exitReason{};
+        // A breakpoint ends a run early, the frame is resumed
+        do
+        {
+            exitReason = system->RunFrame();
+        }
+        while (exitReason == RunExitReason::Breakpoint);
+        if (exitReason == RunExitReason::Error)
+        {
+            TRACE_ERROR("Instruction execution failed in frame {}", frame);
+            result.Succeeded = false;
+            break;
+        }
+        result.FramesRun = frame;
+        if (exitReason == RunExitReason::Halted)
+            break;
+    }
+    if (job.Finished)
+        job.Finished(*system, result.FramesRun);
+    return result;
+}
@@ -0,0 +1,379 @@
+#include "Model/AY38912.h"
+
+#include <algorithm>
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+// Decimation filter cutoff relative to the host sample rate
+static constexpr double CutoffFrequency = 0.45;
+
+// Bits in the data write mask that are implemented, per register
+static constexpr uint8_t RegisterMasks[AY38912::RegisterCount] =
+{
+    0xFF, 0x0F, 0xFF, 0x0F, 0xFF, 0x0F, 0x1F, 0xFF, 0x1F, 0x1F, 0x1F, 0xFF, 0xFF, 0x0F, 0xFF, 0xFF,
+};
+
+// Output level of the 16 amplitude steps, measured on a real chip, full scale is 1
+static constexpr float VolumeTable[16] =
+{
+    0.0F, 0.00999F, 0.01445F, 0.02106F, 0.03070F, 0.04555F, 0.06450F, 0.10736F,
+    0.12659F, 0.20498F, 0.29221F, 0.37275F, 0.49253F, 0.63532F, 0.80558F, 1.0F,
+};
+
+static constexpr uint8_t AmplitudeEnvelopeMode = 0x10;
+
+// The 128K decodes A15 and A1 for the AY, with A14 telling the register select and data ports apart
+static bool IsRegisterSelectPort(uint16_t address)
+{
+    return (address & 0xC002) == 0xC000;
+}
+
+static bool IsDataPort(uint16_t address)
+{
+    return (address & 0xC002) == 0x8000;
+}
+
+AY38912::AY38912(ICPU &cpu, uint64_t cpuClockFreq, uint64_t sampleRate, uint64_t maxFrameTStates)
+    : m_cpu{ cpu }
+    , m_cpuClockFreq{ cpuClockFreq }
+    , m_sampleRate{ sampleRate }
+    , m_registers{}
+    , m_selectedRegister{}
+    , m_tones{}
+    , m_noiseCounter{}
+    , m_noiseShift{ 1 }
+    , m_envelopeCounter{}
+    , m_envelopeStep{}
+    , m_envelopeAttack{}
+    , m_envelopeHold{}
+    , m_envelopeAlternate{}
+    , m_envelopeHolding{}
+    , m_toneGates{}
+    , m_noiseGates{}
+    , m_envelopeVolumes{}
+    , m_filter{}
+    , m_chipSamples{}
+    , m_ticksDone{}
+    , m_tickOffset{}
+    , m_frameStartClock{}
+    , m_frameStartFraction{}
+    , m_samples{}
+    , m_dcBlocker{}
+{
+    // An output sample at chip position i + phase / FilterPhases is made from the FilterTaps chip samples up to i,
+    // centred FilterTaps / 2 samples back, so only samples already generated are needed
+    const double chipRate = static_cast<double>(m_cpuClockFreq) / TStatesPerTick;
+    const double cutoff = CutoffFrequency * static_cast<double>(m_sampleRate) / chipRate;
+    for (std::size_t phase = 0; phase < FilterPhases; ++phase)
+    {
+        BuildWindowedSincKernel(cutoff, static_cast<double>(phase) / FilterPhases, m_filter[phase].data(), FilterTaps);
+    }
+    const std::size_t maxFrameTicks = static_cast<std::size_t>(maxFrameTStates / TStatesPerTick) + 1;
+    m_chipSamples.resize(FilterTaps + maxFrameTicks);
+    m_samples.resize(static_cast<std::size_t>((m_cpuClockFreq + maxFrameTStates * m_sampleRate) / m_cpuClockFreq) + 1);
+}
+
+void AY38912::Reset()
+{
+    m_registers.fill(0);
+    m_selectedRegister = {};
+    m_tones = {};
+    m_noiseCounter = {};
+    m_noiseShift = 1;
+    m_envelopeCounter = {};
+    ResetEnvelope();
+    std::fill(m_chipSamples.begin(), m_chipSamples.end(), 0.0F);
+    m_ticksDone = {};
+    m_tickOffset = {};
+    m_frameStartClock = {};
+    m_frameStartFraction = {};
+    m_dcBlocker.Reset();
+}
+
+void AY38912::StartFrame(uint64_t frameStartClock)
+{
+    m_frameStartClock = frameStartClock;
+}
+
+std::size_t AY38912::EndFrame(uint64_t frameTStates)
+{
+    frameTStates = std::min(frameTStates, static_cast<uint64_t>(m_chipSamples.size() - FilterTaps - 1) * TStatesPerTick);
+    RunUntil(frameTStates);
+
+    // Output sample i lies at the end of its interval on the sample grid, at T-state
+    // ((i + 1) * clock - frameStartFraction) / sampleRate. In chip samples that is the numerator below over
+    // TStatesPerTick * sampleRate. One unit is taken off, so a sample exactly at the frame end uses this frame's steps
+    const uint64_t end = m_frameStartFraction + frameTStates * m_sampleRate;
+    const std::size_t count = static_cast<std::size_t>(end / m_cpuClockFreq);
+    const int64_t denominator = static_cast<int64_t>(TStatesPerTick * m_sampleRate);
+    const int64_t start = -static_cast<int64_t>(m_frameStartFraction + m_tickOffset * m_sampleRate) - 1;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const int64_t position = start + static_cast<int64_t>((i + 1) * m_cpuClockFreq);
+        // Floor division, the first samples can lie just before the first step of the frame
+        int64_t index = position / denominator;
+        if (position < index * denominator)
+            --index;
+        const auto phase = static_cast<std::size_t>((position - index * denominator) * static_cast<int64_t>(FilterPhases) / denominator);
+        const float *input = &m_chipSamples[static_cast<std::size_t>(index + 1)];
+        const auto &filter = m_filter[phase];
+        float sum{};
+        for (std::size_t tap = 0; tap < FilterTaps; ++tap)
+        {
+            sum += input[tap] * filter[tap];
+        }
+        // Three channels at full volume make full scale
+        m_samples[i] = m_dcBlocker.Process(sum / 3.0F);
+    }
+
+    // Keep the last chip samples as filter history for the next frame
+    std::copy(m_chipSamples.begin() + static_cast<std::ptrdiff_t>(m_ticksDone),
+        m_chipSamples.begin() + static_cast<std::ptrdiff_t>(m_ticksDone + FilterTaps), m_chipSamples.begin());
+    m_tickOffset = m_tickOffset + m_ticksDone * TStatesPerTick - frameTStates;
+    m_frameStartFraction = end % m_cpuClockFreq;
+    m_ticksDone = 0;
+    return count;
+}
+
+void AY38912::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    using serialization::SerializeBinary;
+    for (uint8_t value : m_registers)
+        SerializeBinary(value, buffer, offset);
+    SerializeBinary(m_selectedRegister, buffer, offset);
+    for (const auto &tone : m_tones)
+    {
+        SerializeBinary(tone.Counter, buffer, offset);
+        SerializeBinary(tone.Output, buffer, offset);
+    }
+    SerializeBinary(m_noiseCounter, buffer, offset);
+    SerializeBinary(m_noiseShift, buffer, offset);
+    SerializeBinary(m_envelopeCounter, buffer, offset);
+    SerializeBinary(static_cast<int32_t>(m_envelopeStep), buffer, offset);
+    SerializeBinary(m_envelopeAttack, buffer, offset);
+    SerializeBinary(m_envelopeHold, buffer, offset);
+    SerializeBinary(m_envelopeAlternate, buffer, offset);
+    SerializeBinary(m_envelopeHolding, buffer, offset);
+    SerializeBinary(static_cast<uint64_t>(m_ticksDone), buffer, offset);
+    SerializeBinary(m_tickOffset, buffer, offset);
+    SerializeBinary(m_frameStartClock, buffer, offset);
+    SerializeBinary(m_frameStartFraction, buffer, offset);
+}
+
+// Loads straight into the generators. After a failure the chip is partly loaded and needs a reset
+bool AY38912::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    using serialization::DeserializeBinary;
+    bool ok{ true };
+    for (uint8_t &value : m_registers)
+        ok = ok && DeserializeBinary(value, buffer, offset);
+    ok = ok && DeserializeBinary(m_selectedRegister, buffer, offset);
+    for (auto &tone : m_tones)
+    {
+        ok = ok
+            && DeserializeBinary(tone.Counter, buffer, offset)
+            && DeserializeBinary(tone.Output, buffer, offset);
+    }
+    int32_t envelopeStep{};
+    uint64_t ticksDone{};
+    ok = ok
+        && DeserializeBinary(m_noiseCounter, buffer, offset)
+        && DeserializeBinary(m_noiseShift, buffer, offset)
+        && DeserializeBinary(m_envelopeCounter, buffer, offset)
+        && DeserializeBinary(envelopeStep, buffer, offset)
+        && DeserializeBinary(m_envelopeAttack, buffer, offset)
+        && DeserializeBinary(m_envelopeHold, buffer, offset)
+        && DeserializeBinary(m_envelopeAlternate, buffer, offset)
+        && DeserializeBinary(m_envelopeHolding, buffer, offset)
+        && DeserializeBinary(ticksDone, buffer, offset)
+        && DeserializeBinary(m_tickOffset, buffer, offset)
+        && DeserializeBinary(m_frameStartClock, buffer, offset)
+        && DeserializeBinary(m_frameStartFraction, buffer, offset);
+    if (!ok)
+        return false;
+    m_selectedRegister &= 0x0F;
+    m_envelopeStep = envelopeStep;
+    // Only the position in the frame is restored, the samples of the steps done so far are whatever the buffer holds
+    m_ticksDone = static_cast<std::size_t>(std::min<uint64_t>(ticksDone, m_chipSamples.size() - FilterTaps));
+    return true;
+}
+
+void AY38912::SetRegister(uint8_t index, uint8_t value)
+{
+    index &= 0x0F;
+    m_registers[index] = static_cast<uint8_t>(value & RegisterMasks[index]);
+    if (index == EnvelopeShape)
+        ResetEnvelope();
+}
+
+void AY38912::Write8(uint16_t address, uint8_t value)
+{
+    if (IsRegisterSelectPort(address))
+    {
+        m_selectedRegister = static_cast<uint8_t>(value & 0x0F);
+    }
+    else if (IsDataPort(address))
+    {
+        // Everything up to now was generated with the old register contents
+        RunUntil(m_cpu.GetCPUClock() - m_frameStartClock);
+        SetRegister(m_selectedRegister, value);
+    }
+}
+
+void AY38912::Read8(uint16_t address, uint8_t &value)
+{
+    if (IsRegisterSelectPort(address))
+        value = m_registers[m_selectedRegister];
+}
+
+void AY38912::RunUntil(uint64_t frameTState)
+{
+    // Steps of this frame are at m_tickOffset + n * TStatesPerTick
+    std::size_t ticks{};
+    if (frameTState > m_tickOffset)
+        ticks = static_cast<std::size_t>((frameTState - m_tickOffset + TStatesPerTick - 1) / TStatesPerTick);
+    // Writes while single stepping outside of a frame can be far past the frame end
+    ticks = std::min(ticks, m_chipSamples.size() - FilterTaps);
+    if (ticks > m_ticksDone)
+        RunTicks(ticks - m_ticksDone);
+}
+
+void AY38912::RunTicks(std::size_t count)
+{
+    while (count > 0)
+    {
+        const std::size_t blockSize = std::min(count, BlockSize);
+        RunBlock(&m_chipSamples[FilterTaps + m_ticksDone], blockSize);
+        m_ticksDone += blockSize;
+        count -= blockSize;
+    }
+}
+
+uint32_t AY38912::TonePeriod(std::size_t channel) const
+{
+    uint32_t period = m_registers[ToneAFine + 2 * channel] | (static_cast<uint32_t>(m_registers[ToneACoarse + 2 * channel]) << 8);
+    return std::max(period, 1u);
+}
+
+// The registers do not change during a block. Each generator fills its own buffer, then the channels are mixed
+void AY38912::RunBlock(float *output, std::size_t count)
+{
+    const uint8_t mixer = m_registers[Mixer];
+
+    // Tone: the output toggles every period steps
+    for (std::size_t channel = 0; channel < 3; ++channel)
+    {
+        auto &tone = m_tones[channel];
+        auto &gates = m_toneGates[channel];
+        const uint32_t period = TonePeriod(channel);
+        const bool disabled = (mixer & (1 << channel)) != 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (++tone.Counter >= period)
+            {
+                tone.Counter = 0;
+                tone.Output ^= 1;
+            }
+            gates[i] = (disabled || tone.Output) ? 1.0F : 0.0F;
+        }
+    }
+
+    // Noise: 17 bit LFSR, clocked at half the tone rate
+    const uint32_t noisePeriod = 2 * std::max<uint32_t>(m_registers[NoisePeriod], 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (++m_noiseCounter >= noisePeriod)
+        {
+            m_noiseCounter = 0;
+            m_noiseShift = (m_noiseShift >> 1) | (((m_noiseShift ^ (m_noiseShift >> 3)) & 1) << 16);
+        }
+        m_noiseGates[i] = (m_noiseShift & 1) ? 1.0F : 0.0F;
+    }
+
+    // Envelope: 16 steps per cycle, a step every two periods
+    const uint32_t envelopePeriod = 2 * std::max<uint32_t>(m_registers[EnvelopeFine] | (static_cast<uint32_t>(m_registers[EnvelopeCoarse]) << 8), 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (++m_envelopeCounter >= envelopePeriod)
+        {
+            m_envelopeCounter = 0;
+            if (!m_envelopeHolding && (--m_envelopeStep < 0))
+            {
+                if (m_envelopeHold)
+                {
+                    if (m_envelopeAlternate)
+                        m_envelopeAttack ^= 0x0F;
+                    m_envelopeHolding = true;
+                    m_envelopeStep = 0;
+                }
+                else
+                {
+                    if (m_envelopeAlternate)
+                        m_envelopeAttack ^= 0x0F;
+                    m_envelopeStep &= 0x0F;
+                }
+            }
+        }
+        m_envelopeVolumes[i] = VolumeTable[static_cast<uint8_t>(m_envelopeStep) ^ m_envelopeAttack];
+    }
+
+    // Mix: a channel sounds while both its tone and noise gates are open, disabled gates are always open
+    std::fill(output, output + count, 0.0F);
+    for (std::size_t channel = 0; channel < 3; ++channel)
+    {
+        const uint8_t amplitude = m_registers[AmplitudeA + channel];
+        const float *tone = m_toneGates[channel].data();
+        const bool noiseDisabled = (mixer & (0x08 << channel)) != 0;
+        if (amplitude & AmplitudeEnvelopeMode)
+        {
+            const float *volume = m_envelopeVolumes.data();
+            if (noiseDisabled)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    output[i] += volume[i] * tone[i];
+            }
+            else
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    output[i] += volume[i] * tone[i] * m_noiseGates[i];
+            }
+        }
+        else
+        {
+            const float volume = VolumeTable[amplitude & 0x0F];
+            if (volume == 0.0F)
+                continue;
+            if (noiseDisabled)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    output[i] += volume * tone[i];
+            }
+            else
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    output[i] += volume * tone[i] * m_noiseGates[i];
+            }
+        }
+    }
+}
+
+// Writing the shape register restarts the envelope. Shapes 0-7 are single cycles that end at zero, which are the same
+// as holding with alternate equal to attack
+void AY38912::ResetEnvelope()
+{
+    const uint8_t shape = m_registers[EnvelopeShape];
+    m_envelopeAttack = (shape & 0x04) ? 0x0F : 0x00;
+    if ((shape & 0x08) == 0)
+    {
+        m_envelopeHold = true;
+        m_envelopeAlternate = (m_envelopeAttack != 0);
+    }
+    else
+    {
+        m_envelopeHold = (shape & 0x01) != 0;
+        m_envelopeAlternate = (shape & 0x02) != 0;
+    }
+    m_envelopeStep = 0x0F;
+    m_envelopeHolding = false;
+    m_envelopeCounter = 0;
+}
@@ -0,0 +1,27 @@
+#include "Model/AudioFilters.h"
+
+#include <cmath>
+#include <vector>
+
+static constexpr double Pi = 3.14159265358979323846;
+
+void BuildWindowedSincKernel(double cutoff, double offset, float *taps, std::size_t tapCount)
+{
+    const double halfWidth = static_cast<double>(tapCount) / 2;
+    std::vector<double> values(tapCount);
+    double sum{};
+    for (std::size_t tap = 0; tap < tapCount; ++tap)
+    {
+        const double x = static_cast<double>(tap) - (halfWidth - 1) - offset;
+        const double y = 2 * cutoff * x;
+        const double sinc = (std::abs(y) < 1e-9) ? 1.0 : std::sin(Pi * y) / (Pi * y);
+        // Blackman window over -halfWidth..halfWidth
+        const double window = 0.42 + 0.5 * std::cos(Pi * x / halfWidth) + 0.08 * std::cos(2 * Pi * x / halfWidth);
+        values[tap] = sinc * window;
+        sum += values[tap];
+    }
+    for (std::size_t tap = 0; tap < tapCount; ++tap)
+    {
+        taps[tap] = static_cast<float>(values[tap] / sum);
+    }
+}
@@ -0,0 +1,43 @@
+#include "Model/AudioRingBuffer.h"
+
+#include <algorithm>
+
+AudioRingBuffer::AudioRingBuffer()
+    : m_samples{}
+    , m_writePosition{}
+    , m_readPosition{}
+{
+}
+
+std::size_t AudioRingBuffer::Write(const int16_t *samples, std::size_t count)
+{
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_relaxed);
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_acquire);
+    count = std::min(count, Capacity - static_cast<std::size_t>(writePosition - readPosition));
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_samples[static_cast<std::size_t>(writePosition + i) & IndexMask] = samples[i];
+    }
+    m_writePosition.store(writePosition + count, std::memory_order_release);
+    return count;
+}
+
+std::size_t AudioRingBuffer::Read(int16_t *samples, std::size_t count)
+{
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_relaxed);
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_acquire);
+    count = std::min(count, static_cast<std::size_t>(writePosition - readPosition));
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        samples[i] = m_samples[static_cast<std::size_t>(readPosition + i) & IndexMask];
+    }
+    m_readPosition.store(readPosition + count, std::memory_order_release);
+    return count;
+}
+
+std::size_t AudioRingBuffer::Available() const
+{
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_acquire);
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(writePosition - readPosition);
+}
@@ -0,0 +1,74 @@
+#include "Model/BandLimitedSynth.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Model/AudioFilters.h"
+
+// Kernel cutoff relative to the sample rate, a bit below Nyquist to leave room for the window's transition band
+static constexpr double CutoffFrequency = 0.45;
+// Full scale output level, leaves headroom for the overshoot of the steps
+static constexpr float OutputScale = 0.5F * 32767.0F;
+
+BandLimitedSynth::BandLimitedSynth(uint64_t clockRate, uint64_t sampleRate, uint64_t maxFrameClocks)
+    : m_clockRate{ clockRate }
+    , m_sampleRate{ sampleRate }
+    , m_maxFrameClocks{ maxFrameClocks }
+    , m_kernels{}
+    , m_deltas{}
+    , m_samples{}
+    , m_frameStartFraction{}
+    , m_level{}
+    , m_dcBlocker{}
+{
+    // Step centred between taps KernelWidth / 2 - 1 and KernelWidth / 2, moved right by the phase
+    for (std::size_t phase = 0; phase < PhaseCount; ++phase)
+    {
+        BuildWindowedSincKernel(CutoffFrequency, static_cast<double>(phase) / PhaseCount, m_kernels[phase].data(), KernelWidth);
+    }
+    const std::size_t maxFrameSamples = static_cast<std::size_t>((m_clockRate + m_maxFrameClocks * m_sampleRate) / m_clockRate) + 1;
+    m_samples.resize(maxFrameSamples);
+    m_deltas.resize(maxFrameSamples + KernelWidth);
+}
+
+void BandLimitedSynth::Reset()
+{
+    std::fill(m_deltas.begin(), m_deltas.end(), 0.0F);
+    m_frameStartFraction = {};
+    m_level = {};
+    m_dcBlocker.Reset();
+}
+
+void BandLimitedSynth::AddDelta(uint64_t clockTime, float delta)
+{
+    // Changes outside of a frame (single stepping) are put at its end
+    clockTime = std::min(clockTime, m_maxFrameClocks - 1);
+    const uint64_t position = m_frameStartFraction + clockTime * m_sampleRate;
+    const std::size_t index = static_cast<std::size_t>(position / m_clockRate);
+    const std::size_t phase = static_cast<std::size_t>((position % m_clockRate) * PhaseCount / m_clockRate);
+    const auto &kernel = m_kernels[phase];
+    for (std::size_t tap = 0; tap < KernelWidth; ++tap)
+    {
+        m_deltas[index + tap] += delta * kernel[tap];
+    }
+}
+
+std::size_t BandLimitedSynth::EndFrame(uint64_t frameClocks)
+{
+    frameClocks = std::min(frameClocks, m_maxFrameClocks);
+    const uint64_t end = m_frameStartFraction + frameClocks * m_sampleRate;
+    const std::size_t count = static_cast<std::size_t>(end / m_clockRate);
+    m_frameStartFraction = end % m_clockRate;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_level += m_deltas[i];
+        const float output = m_dcBlocker.Process(m_level);
+        const float sample = std::clamp(output * OutputScale, -32768.0F, 32767.0F);
+        m_samples[i] = static_cast<int16_t>(std::lround(sample));
+    }
+
+    // Keep the tail of the steps near the end of the frame for the next one
+    std::copy(m_deltas.begin() + static_cast<std::ptrdiff_t>(count), m_deltas.end(), m_deltas.begin());
+    std::fill(m_deltas.end() - static_cast<std::ptrdiff_t>(count), m_deltas.end(), 0.0F);
+    return count;
+}
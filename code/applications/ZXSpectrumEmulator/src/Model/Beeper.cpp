@@ -0,0 +1,65 @@
+#include "Model/Beeper.h"
+
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+// Speaker level for the combinations of EAR and MIC, indexed by EAR * 2 + MIC. EAR drives the speaker, MIC only
+// leaks into it a little
+static constexpr float SpeakerLevels[4] = { 0.0F, 0.1F, 0.9F, 1.0F };
+
+static float SpeakerLevel(uint8_t bits)
+{
+    return SpeakerLevels[((bits & Beeper::EARBit) ? 2 : 0) | ((bits & Beeper::MICBit) ? 1 : 0)];
+}
+
+Beeper::Beeper(ICPU &cpu, uint64_t cpuClockFreq, uint64_t maxFrameTStates)
+    : m_cpu{ cpu }
+    , m_synth{ cpuClockFreq, SampleRate, maxFrameTStates }
+    , m_frameStartClock{}
+    , m_bits{}
+{
+}
+
+void Beeper::Reset()
+{
+    m_synth.Reset();
+    m_frameStartClock = {};
+    m_bits = {};
+}
+
+void Beeper::StartFrame(uint64_t frameStartClock)
+{
+    m_frameStartClock = frameStartClock;
+}
+
+std::size_t Beeper::EndFrame(uint64_t frameTStates)
+{
+    return m_synth.EndFrame(frameTStates);
+}
+
+void Beeper::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    serialization::SerializeBinary(m_frameStartClock, buffer, offset);
+    serialization::SerializeBinary(m_bits, buffer, offset);
+}
+
+bool Beeper::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    uint64_t frameStartClock{};
+    uint8_t bits{};
+    if (!serialization::DeserializeBinary(frameStartClock, buffer, offset)
+        || !serialization::DeserializeBinary(bits, buffer, offset))
+        return false;
+    m_frameStartClock = frameStartClock;
+    Write8(0, bits);
+    return true;
+}
+
+void Beeper::Write8(uint16_t /*address*/, uint8_t value)
+{
+    auto bits = static_cast<uint8_t>(value & (EARBit | MICBit));
+    if (bits == m_bits)
+        return;
+    m_synth.AddDelta(m_cpu.GetCPUClock() - m_frameStartClock, SpeakerLevel(bits) - SpeakerLevel(m_bits));
+    m_bits = bits;
+}
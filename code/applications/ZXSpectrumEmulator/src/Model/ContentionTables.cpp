@@ -0,0 +1,49 @@
+#include "Model/ContentionTables.h"
+
+// Part of an I/O cycle: whether the ULA is checked at its start, and its length in T-states
+struct IOStep
+{
+    bool Contended;
+    uint8_t TStates;
+};
+
+using IOSteps = std::array<IOStep, 4>;
+
+// By IOContention. Steps of zero length are not taken
+static constexpr std::array<IOSteps, static_cast<std::size_t>(IOContention::Count)> IOCycleSteps
+{
+    IOSteps{ IOStep{ false, 1 }, IOStep{ true, 3 }, IOStep{ false, 0 }, IOStep{ false, 0 } },
+    IOSteps{ IOStep{ true, 1 }, IOStep{ true, 3 }, IOStep{ false, 0 }, IOStep{ false, 0 } },
+    IOSteps{ IOStep{ true, 1 }, IOStep{ true, 1 }, IOStep{ true, 1 }, IOStep{ true, 1 } },
+};
+
+ContentionTables::ContentionTables(const ZXSpectrumModel &model)
+    : m_frameTStates{ model.TStatesPerFrame() }
+    , m_memoryDelay(static_cast<std::size_t>(model.TStatesPerFrame()))
+    , m_ioDelay{}
+{
+    for (uint32_t line = 0; line < DisplayLines; ++line)
+    {
+        const std::size_t lineStart = model.FirstContendedTState + static_cast<std::size_t>(line) * model.TStatesPerLine;
+        for (uint32_t tstate = 0; tstate < ContendedTStatesPerLine; ++tstate)
+        {
+            m_memoryDelay[lineStart + tstate] = DelayPattern[tstate % DelayPattern.size()];
+        }
+    }
+    for (std::size_t contention = 0; contention < m_ioDelay.size(); ++contention)
+    {
+        auto &ioDelay = m_ioDelay[contention];
+        ioDelay.resize(m_memoryDelay.size());
+        for (std::size_t start = 0; start < ioDelay.size(); ++start)
+        {
+            uint64_t tstate = start;
+            for (const IOStep &step : IOCycleSteps[contention])
+            {
+                if (step.Contended)
+                    tstate += MemoryDelay(tstate);
+                tstate += step.TStates;
+            }
+            ioDelay[start] = static_cast<uint8_t>(tstate - start - 4);
+        }
+    }
+}
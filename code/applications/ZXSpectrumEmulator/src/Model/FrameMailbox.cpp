@@ -0,0 +1,46 @@
+#include "Model/FrameMailbox.h"
+
+#include <algorithm>
+
+FrameMailbox::FrameMailbox()
+    : m_slots{}
+    , m_slotPendingLines{}
+    , m_back{ 0 }
+    , m_ready{ 1 }
+    , m_front{ 2 }
+{
+    // Nothing has been copied into the slots yet
+    m_slotPendingLines.fill(ULADirtyLines{ 0, ULAFrameHeight - 1 });
+}
+
+void FrameMailbox::Publish(const ULAScreen &screen, const ULADirtyLines &changedLines, uint64_t frameNumber)
+{
+    for (auto &pendingLines : m_slotPendingLines)
+        pendingLines.Add(changedLines);
+
+    // The back slot last held a frame up to two publishes ago, bring it up to date
+    VideoFrame &frame = m_slots[m_back];
+    ULADirtyLines &pendingLines = m_slotPendingLines[m_back];
+    if (!pendingLines.IsEmpty())
+    {
+        const std::size_t first = static_cast<std::size_t>(pendingLines.First) * ULAFrameWidth;
+        const std::size_t last = static_cast<std::size_t>(pendingLines.Last + 1) * ULAFrameWidth;
+        std::copy(screen.begin() + first, screen.begin() + last, frame.Screen.begin() + first);
+        pendingLines = {};
+    }
+    frame.FrameNumber = frameNumber;
+    frame.ChangedLines = changedLines;
+
+    // Release the frame contents, and take the previous ready slot as the new back slot. If the consumer did not
+    // acquire it, that frame is dropped
+    m_back = m_ready.exchange(static_cast<uint8_t>(m_back | FreshFlag), std::memory_order_acq_rel) & IndexMask;
+}
+
+const VideoFrame *FrameMailbox::Acquire()
+{
+    if ((m_ready.load(std::memory_order_relaxed) & FreshFlag) == 0)
+        return nullptr;
+    // Acquire the frame contents, and hand back the slot that was read last
+    m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+    return &m_slots[m_front];
+}
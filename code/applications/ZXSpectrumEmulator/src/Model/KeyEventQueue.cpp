@@ -0,0 +1,40 @@
+#include "Model/KeyEventQueue.h"
+
+KeyEventQueue::KeyEventQueue()
+    : m_events{}
+    , m_writePosition{}
+    , m_readPosition{}
+{
+}
+
+bool KeyEventQueue::Push(const KeyEvent &event)
+{
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_relaxed);
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_acquire);
+    if (writePosition - readPosition >= Capacity)
+        return false;
+    m_events[static_cast<std::size_t>(writePosition) & IndexMask] = event;
+    m_writePosition.store(writePosition + 1, std::memory_order_release);
+    return true;
+}
+
+bool KeyEventQueue::PopDue(uint64_t frame, KeyEvent &event)
+{
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_relaxed);
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_acquire);
+    if (readPosition == writePosition)
+        return false;
+    const KeyEvent &next = m_events[static_cast<std::size_t>(readPosition) & IndexMask];
+    if (next.Frame > frame)
+        return false;
+    event = next;
+    m_readPosition.store(readPosition + 1, std::memory_order_release);
+    return true;
+}
+
+std::size_t KeyEventQueue::Available() const
+{
+    const uint64_t readPosition = m_readPosition.load(std::memory_order_acquire);
+    const uint64_t writePosition = m_writePosition.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(writePosition - readPosition);
+}
@@ -0,0 +1,66 @@
+#include "Model/KeyboardMatrix.h"
+
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+static std::size_t KeyRow(ZXKey key)
+{
+    return static_cast<std::size_t>(static_cast<uint8_t>(key) >> 4) & (KeyboardMatrix::RowCount - 1);
+}
+
+static uint8_t KeyMask(ZXKey key)
+{
+    return static_cast<uint8_t>(1 << (static_cast<uint8_t>(key) & 0x07));
+}
+
+KeyboardMatrix::KeyboardMatrix()
+    : m_rows{}
+{
+}
+
+void KeyboardMatrix::Reset()
+{
+    m_rows.fill(0);
+}
+
+void KeyboardMatrix::SetKey(ZXKey key, bool pressed)
+{
+    if (pressed)
+        m_rows[KeyRow(key)] |= KeyMask(key);
+    else
+        m_rows[KeyRow(key)] &= static_cast<uint8_t>(~KeyMask(key));
+}
+
+bool KeyboardMatrix::IsPressed(ZXKey key) const
+{
+    return (m_rows[KeyRow(key)] & KeyMask(key)) != 0;
+}
+
+uint8_t KeyboardMatrix::Read(uint8_t addressHigh) const
+{
+    uint8_t pressed{};
+    for (std::size_t row = 0; row < RowCount; ++row)
+    {
+        if ((addressHigh & (1 << row)) == 0)
+            pressed |= m_rows[row];
+    }
+    return static_cast<uint8_t>(~pressed | ~KeyBits);
+}
+
+void KeyboardMatrix::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    for (uint8_t row : m_rows)
+        serialization::SerializeBinary(row, buffer, offset);
+}
+
+bool KeyboardMatrix::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    std::array<uint8_t, RowCount> rows{};
+    for (uint8_t &row : rows)
+    {
+        if (!serialization::DeserializeBinary(row, buffer, offset))
+            return false;
+    }
+    m_rows = rows;
+    return true;
+}
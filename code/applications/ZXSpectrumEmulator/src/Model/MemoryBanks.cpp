@@ -0,0 +1,20 @@
+#include "Model/MemoryBanks.h"
+
+#include <algorithm>
+
+MemoryBanks::MemoryBanks(std::size_t romBankCount, std::size_t ramBankCount, uint8_t contendedRAMBanks)
+    : m_romBankCount{ romBankCount }
+    , m_ramBankCount{ ramBankCount }
+    , m_contendedRAMBanks{ contendedRAMBanks }
+    , m_rom(romBankCount * BankSize)
+    , m_ram(ramBankCount * BankSize)
+{
+}
+
+bool MemoryBanks::LoadROM(const ByteVector &contents)
+{
+    if (contents.size() > m_rom.size())
+        return false;
+    std::copy(contents.begin(), contents.end(), m_rom.begin());
+    return true;
+}
@@ -0,0 +1,79 @@
+#include "Model/MemoryPaging.h"
+
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+MemoryPaging::MemoryPaging(Z80 &cpu, MemoryBanks &memory, ULARenderer &ula, uint16_t displayAddress, uint16_t displaySize)
+    : m_cpu{ cpu }
+    , m_memory{ memory }
+    , m_ula{ ula }
+    , m_displayAddress{ displayAddress }
+    , m_displaySize{ displaySize }
+    , m_value{}
+    , m_locked{}
+{
+}
+
+void MemoryPaging::Reset()
+{
+    m_locked = false;
+    Select(0, true);
+}
+
+void MemoryPaging::Write8(uint16_t /*address*/, uint8_t value)
+{
+    if (!m_locked)
+        Select(value, false);
+}
+
+void MemoryPaging::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    serialization::SerializeBinary(m_value, buffer, offset);
+}
+
+bool MemoryPaging::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    uint8_t value{};
+    if (!serialization::DeserializeBinary(value, buffer, offset))
+        return false;
+    Select(value, false);
+    return true;
+}
+
+void MemoryPaging::OnMemoryWrite(uint16_t address)
+{
+    m_ula.OnMemoryWrite(static_cast<uint16_t>(address - PagedSlotAddress + m_displayAddress));
+}
+
+// Only what changed is remapped
+void MemoryPaging::Select(uint8_t value, bool remapAll)
+{
+    const uint8_t changed = static_cast<uint8_t>(value ^ m_value);
+    m_value = value;
+    m_locked = (value & LockBit) != 0;
+    if (remapAll || (changed & ROMSelectBit))
+    {
+        m_cpu.MapROM(0x0000, MemoryBanks::BankSize, m_memory.ROMBank((value & ROMSelectBit) ? 1 : 0));
+    }
+    if (remapAll || (changed & (RAMBankMask | ShadowScreenBit)))
+    {
+        MapPagedSlot();
+    }
+    if (remapAll || (changed & ShadowScreenBit))
+    {
+        // The other screen has not been tracked, draw it completely
+        m_ula.Invalidate();
+    }
+}
+
+// Remapping drops the write observer and the contention of the slot. Contention follows the bank, the observer is only
+// put back while the slot holds the displayed bank.
+// Writes to bank 5 at 0x4000 are always observed, while the shadow screen is shown they only cost a redundant redraw
+void MemoryPaging::MapPagedSlot()
+{
+    m_cpu.MapRAM(PagedSlotAddress, MemoryBanks::BankSize, m_memory.RAMBank(GetPagedBank()));
+    if (m_memory.IsContended(GetPagedBank()))
+        m_cpu.ContendAccesses(PagedSlotAddress, MemoryBanks::BankSize);
+    if (GetPagedBank() == GetDisplayBank())
+        m_cpu.ObserveWrites(PagedSlotAddress, m_displaySize, *this);
+}
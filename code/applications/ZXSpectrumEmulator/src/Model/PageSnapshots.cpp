@@ -0,0 +1,107 @@
+#include "Model/PageSnapshots.h"
+
+#include <cstring>
+
+PageSnapshots::PageSnapshots(Z80 &cpu, MemoryBanks &memory)
+    : m_cpu{ cpu }
+    , m_memory{ memory }
+    , m_pages(memory.RAMBankCount() * MemoryBanks::BankSize / PageSize)
+    , m_mappingGeneration{}
+    , m_mappedPages{}
+    , m_writeGenerations{}
+    , m_changed(m_pages.size())
+{
+    m_mappedPages.fill(NotMapped);
+}
+
+void PageSnapshots::Capture(std::vector<SystemState::Page> &pages)
+{
+    FindChangedPages();
+    for (std::size_t index = 0; index < m_pages.size(); ++index)
+    {
+        if (m_changed[index])
+        {
+            const uint8_t *data = RAMPage(index);
+            m_pages[index] = std::make_shared<const ByteVector>(data, data + PageSize);
+        }
+    }
+    pages = m_pages;
+    TrackWrites();
+}
+
+bool PageSnapshots::Restore(const std::vector<SystemState::Page> &pages)
+{
+    if (pages.size() != m_pages.size())
+        return false;
+    for (const auto &page : pages)
+    {
+        if ((page == nullptr) || (page->size() != PageSize))
+            return false;
+    }
+
+    // Pages still holding the contents of the state are left alone
+    FindChangedPages();
+    for (std::size_t index = 0; index < m_pages.size(); ++index)
+    {
+        m_changed[index] = m_changed[index] || (pages[index] != m_pages[index]);
+        if (m_changed[index])
+            std::memcpy(RAMPage(index), pages[index]->data(), PageSize);
+    }
+    for (std::size_t cpuPage = 0; cpuPage < PagedMemoryMap::PageCount; ++cpuPage)
+    {
+        const std::size_t index = MappedPage(cpuPage);
+        if ((index != NotMapped) && m_changed[index])
+            m_cpu.GetMemoryMap().InvalidatePage(cpuPage);
+    }
+    m_pages = pages;
+    TrackWrites();
+    return true;
+}
+
+std::size_t PageSnapshots::MappedPage(std::size_t cpuPage) const
+{
+    const uint8_t *data = m_cpu.GetMemoryMap().RAMPage(cpuPage);
+    const uint8_t *ram = m_memory.RAMBank(0);
+    if ((data == nullptr) || (data < ram) || (data >= ram + m_pages.size() * PageSize))
+        return NotMapped;
+    return static_cast<std::size_t>(data - ram) / PageSize;
+}
+
+// While the mapping is the same, a page can only have been written through the CPU pages it is mapped at
+void PageSnapshots::FindChangedPages()
+{
+    const PagedMemoryMap &memoryMap = m_cpu.GetMemoryMap();
+    if (memoryMap.MappingGeneration() != m_mappingGeneration)
+    {
+        for (std::size_t index = 0; index < m_pages.size(); ++index)
+        {
+            m_changed[index] = (m_pages[index] == nullptr) || (std::memcmp(RAMPage(index), m_pages[index]->data(), PageSize) != 0);
+        }
+        return;
+    }
+    for (std::size_t index = 0; index < m_pages.size(); ++index)
+    {
+        m_changed[index] = (m_pages[index] == nullptr);
+    }
+    for (std::size_t cpuPage = 0; cpuPage < PagedMemoryMap::PageCount; ++cpuPage)
+    {
+        const std::size_t index = m_mappedPages[cpuPage];
+        if ((index != NotMapped) && (memoryMap.WriteGeneration(cpuPage) != m_writeGenerations[cpuPage]))
+            m_changed[index] = true;
+    }
+}
+
+void PageSnapshots::TrackWrites()
+{
+    PagedMemoryMap &memoryMap = m_cpu.GetMemoryMap();
+    m_mappingGeneration = memoryMap.MappingGeneration();
+    for (std::size_t cpuPage = 0; cpuPage < PagedMemoryMap::PageCount; ++cpuPage)
+    {
+        m_mappedPages[cpuPage] = MappedPage(cpuPage);
+        if (m_mappedPages[cpuPage] != NotMapped)
+        {
+            memoryMap.TrapWrites(cpuPage);
+            m_writeGenerations[cpuPage] = memoryMap.WriteGeneration(cpuPage);
+        }
+    }
+}
@@ -0,0 +1,198 @@
+#include "Model/PixelKernels.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PIXEL_KERNELS_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set without compiler options
+#define PIXEL_KERNELS_TARGET_AVX2
+#else
+#define PIXEL_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define PIXEL_KERNELS_X64 0
+#endif
+
+static void ExpandCellScalar(const uint8_t *bitmap, uint32_t ink, uint32_t paper, uint32_t *pixels, std::size_t pitch)
+{
+    for (unsigned line = 0; line < 8; ++line)
+    {
+        const uint8_t byte = bitmap[line];
+        for (unsigned bit = 0; bit < 8; ++bit)
+        {
+            pixels[bit] = (byte & (0x80 >> bit)) ? ink : paper;
+        }
+        pixels += pitch;
+    }
+}
+
+static void FillScalar(uint32_t *pixels, std::size_t count, uint32_t value)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        pixels[i] = value;
+    }
+}
+
+static void CopyScalar(uint32_t *destination, const uint32_t *source, std::size_t count)
+{
+    std::memcpy(destination, source, count * sizeof(uint32_t));
+}
+
+#if PIXEL_KERNELS_X64
+
+// SSE2 is part of x86-64, so these need no CPU check
+
+static void ExpandCellSSE2(const uint8_t *bitmap, uint32_t ink, uint32_t paper, uint32_t *pixels, std::size_t pitch)
+{
+    const __m128i bitsLeft = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+    const __m128i bitsRight = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+    const __m128i inkPixels = _mm_set1_epi32(static_cast<int>(ink));
+    const __m128i paperPixels = _mm_set1_epi32(static_cast<int>(paper));
+    for (unsigned line = 0; line < 8; ++line)
+    {
+        const __m128i byte = _mm_set1_epi32(bitmap[line]);
+        const __m128i maskLeft = _mm_cmpeq_epi32(_mm_and_si128(byte, bitsLeft), bitsLeft);
+        const __m128i maskRight = _mm_cmpeq_epi32(_mm_and_si128(byte, bitsRight), bitsRight);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels),
+            _mm_or_si128(_mm_and_si128(maskLeft, inkPixels), _mm_andnot_si128(maskLeft, paperPixels)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + 4),
+            _mm_or_si128(_mm_and_si128(maskRight, inkPixels), _mm_andnot_si128(maskRight, paperPixels)));
+        pixels += pitch;
+    }
+}
+
+static void FillSSE2(uint32_t *pixels, std::size_t count, uint32_t value)
+{
+    const __m128i values = _mm_set1_epi32(static_cast<int>(value));
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), values);
+    }
+    FillScalar(pixels + i, count - i, value);
+}
+
+static void CopySSE2(uint32_t *destination, const uint32_t *source, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i)));
+    }
+    CopyScalar(destination + i, source + i, count - i);
+}
+
+PIXEL_KERNELS_TARGET_AVX2
+static void ExpandCellAVX2(const uint8_t *bitmap, uint32_t ink, uint32_t paper, uint32_t *pixels, std::size_t pitch)
+{
+    const __m256i bits = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m256i inkPixels = _mm256_set1_epi32(static_cast<int>(ink));
+    const __m256i paperPixels = _mm256_set1_epi32(static_cast<int>(paper));
+    for (unsigned line = 0; line < 8; ++line)
+    {
+        const __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bitmap[line]), bits), bits);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels), _mm256_blendv_epi8(paperPixels, inkPixels, mask));
+        pixels += pitch;
+    }
+}
+
+PIXEL_KERNELS_TARGET_AVX2
+static void FillAVX2(uint32_t *pixels, std::size_t count, uint32_t value)
+{
+    const __m256i values = _mm256_set1_epi32(static_cast<int>(value));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i), values);
+    }
+    FillScalar(pixels + i, count - i, value);
+}
+
+PIXEL_KERNELS_TARGET_AVX2
+static void CopyAVX2(uint32_t *destination, const uint32_t *source, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i)));
+    }
+    CopyScalar(destination + i, source + i, count - i);
+}
+
+static bool HostSupportsAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4]{};
+    __cpuid(info, 1);
+    // The OS must save the YMM registers (OSXSAVE and AVX, then XCR0 bits 1 and 2)
+    const bool osSavesYMM = ((info[2] & (1 << 27)) != 0) && ((info[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 0x06) == 0x06);
+    if (!osSavesYMM)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+static constexpr PixelKernels ScalarKernels{ ExpandCellScalar, FillScalar, CopyScalar };
+#if PIXEL_KERNELS_X64
+static constexpr PixelKernels SSE2Kernels{ ExpandCellSSE2, FillSSE2, CopySSE2 };
+static constexpr PixelKernels AVX2Kernels{ ExpandCellAVX2, FillAVX2, CopyAVX2 };
+#endif
+
+bool IsPixelKernelSetSupported(PixelKernelSet set)
+{
+    switch (set)
+    {
+    case PixelKernelSet::Scalar:
+        return true;
+#if PIXEL_KERNELS_X64
+    case PixelKernelSet::SSE2:
+        return true;
+    case PixelKernelSet::AVX2:
+        return HostSupportsAVX2();
+#endif
+    default:
+        return false;
+    }
+}
+
+PixelKernelSet BestPixelKernelSet()
+{
+    if (IsPixelKernelSetSupported(PixelKernelSet::AVX2))
+        return PixelKernelSet::AVX2;
+    if (IsPixelKernelSetSupported(PixelKernelSet::SSE2))
+        return PixelKernelSet::SSE2;
+    return PixelKernelSet::Scalar;
+}
+
+const PixelKernels &GetPixelKernels(PixelKernelSet set)
+{
+    if (!IsPixelKernelSetSupported(set))
+        return ScalarKernels;
+    switch (set)
+    {
+#if PIXEL_KERNELS_X64
+    case PixelKernelSet::SSE2:
+        return SSE2Kernels;
+    case PixelKernelSet::AVX2:
+        return AVX2Kernels;
+#endif
+    case PixelKernelSet::Scalar:
+    default:
+        return ScalarKernels;
+    }
+}
+
+const PixelKernels &GetPixelKernels()
+{
+    static const PixelKernels &kernels = GetPixelKernels(BestPixelKernelSet());
+    return kernels;
+}
@@ -0,0 +1,52 @@
+#include "Model/ULAContention.h"
+
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+ULAContention::ULAContention(Z80 &cpu, const ZXSpectrumModel &model)
+    : m_cpu{ cpu }
+    , m_tables{ model }
+    , m_frameStartClock{}
+{
+}
+
+void ULAContention::Reset()
+{
+    m_frameStartClock = {};
+}
+
+void ULAContention::StartFrame(uint64_t frameStartClock)
+{
+    m_frameStartClock = frameStartClock;
+}
+
+void ULAContention::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    serialization::SerializeBinary(m_frameStartClock, buffer, offset);
+}
+
+bool ULAContention::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    uint64_t frameStartClock{};
+    if (!serialization::DeserializeBinary(frameStartClock, buffer, offset))
+        return false;
+    m_frameStartClock = frameStartClock;
+    return true;
+}
+
+// Opcode fetches, memory cycles and internal T-states with a contended address are all held the same way
+void ULAContention::OnContendedAccess(uint16_t /*address*/, BusCycle /*cycle*/)
+{
+    m_cpu.IncrementCPUClock(m_tables.MemoryDelay(m_cpu.GetCPUClock() - m_frameStartClock));
+}
+
+// Ports with A0 high that are not in contended memory are never held
+void ULAContention::OnIOAccess(uint16_t port, bool addressContended)
+{
+    const bool isULAPort = (port & 0x0001) == 0;
+    if (!isULAPort && !addressContended)
+        return;
+    const IOContention contention = !addressContended ? IOContention::ULAPort :
+        isULAPort ? IOContention::ULAPortContendedAddress : IOContention::ContendedAddress;
+    m_cpu.IncrementCPUClock(m_tables.IODelay(contention, m_cpu.GetCPUClock() - m_frameStartClock));
+}
@@ -0,0 +1,106 @@
+#include "Model/ULARenderer.h"
+
+ULARenderer::ULARenderer(uint16_t displayAddress, const PixelKernels &kernels)
+    : m_lineOffsets{}
+    , m_colors{}
+    , m_kernels{ kernels }
+    , m_dirtyCells{}
+    , m_displayAddress{ displayAddress }
+    , m_fullRedraw{ true }
+    , m_flashPhase{}
+{
+    // The display file is split in thirds of 64 lines, within a third the lines are interleaved per character row
+    for (unsigned y = 0; y < ULAScreenHeight; ++y)
+    {
+        m_lineOffsets[y] = static_cast<uint16_t>(((y & 0xC0) << 5) | ((y & 0x07) << 8) | ((y & 0x38) << 2));
+    }
+    for (unsigned attribute = 0; attribute < 256; ++attribute)
+    {
+        const unsigned bright = (attribute & 0x40) ? 0x08 : 0x00;
+        const uint32_t ink = ULAPalette[bright | (attribute & 0x07)];
+        const uint32_t paper = ULAPalette[bright | ((attribute >> 3) & 0x07)];
+        m_colors[0][attribute] = InkPaper{ ink, paper };
+        m_colors[1][attribute] = (attribute & 0x80) ? InkPaper{ paper, ink } : InkPaper{ ink, paper };
+    }
+}
+
+void ULARenderer::OnMemoryWrite(uint16_t address)
+{
+    auto offset = static_cast<uint16_t>(address - m_displayAddress);
+    unsigned cell{};
+    if (offset < DisplayFileSize)
+    {
+        // 010 y7 y6 y2 y1 y0 | y5 y4 y3 x4 x3 x2 x1 x0, the character row is y7..y3
+        unsigned row = ((offset >> 8) & 0x18) | ((offset >> 5) & 0x07);
+        cell = row * 32 + (offset & 0x1F);
+    }
+    else if (offset < DisplayFileSize + AttributeFileSize)
+    {
+        cell = offset - DisplayFileSize;
+    }
+    else
+    {
+        return;
+    }
+    m_dirtyCells[cell / 64] |= uint64_t{ 1 } << (cell % 64);
+}
+
+ULADirtyLines ULARenderer::Render(const uint8_t *displayMemory, uint64_t frameCount, ULAScreen &screen)
+{
+    const uint64_t flashPhase = (frameCount / FlashPeriodFrames) & 0x01;
+    if (m_fullRedraw)
+    {
+        m_dirtyCells.fill(~uint64_t{});
+        m_fullRedraw = false;
+    }
+    else if (flashPhase != m_flashPhase)
+    {
+        MarkFlashingCells(displayMemory + DisplayFileSize);
+    }
+    m_flashPhase = flashPhase;
+
+    ULADirtyLines lines{};
+    const auto &colors = m_colors[flashPhase];
+    for (unsigned word = 0; word < m_dirtyCells.size(); ++word)
+    {
+        uint64_t bits = m_dirtyCells[word];
+        if (bits == 0)
+            continue;
+        m_dirtyCells[word] = 0;
+        for (unsigned bit = 0; bit < 64; ++bit)
+        {
+            if ((bits & (uint64_t{ 1 } << bit)) == 0)
+                continue;
+            unsigned cell = word * 64 + bit;
+            RenderCell(displayMemory, colors, cell, screen);
+            ULADirtyLines cellLines{};
+            cellLines.First = ULABorderHeight + static_cast<int>((cell / 32) * 8);
+            cellLines.Last = cellLines.First + 7;
+            lines.Add(cellLines);
+        }
+    }
+    return lines;
+}
+
+void ULARenderer::MarkFlashingCells(const uint8_t *attributes)
+{
+    for (unsigned cell = 0; cell < CellCount; ++cell)
+    {
+        if (attributes[cell] & 0x80)
+            m_dirtyCells[cell / 64] |= uint64_t{ 1 } << (cell % 64);
+    }
+}
+
+void ULARenderer::RenderCell(const uint8_t *displayMemory, const std::array<InkPaper, 256> &colors, unsigned cell, ULAScreen &screen) const
+{
+    const unsigned row = cell / 32;
+    const unsigned column = cell % 32;
+    uint8_t bitmap[8];
+    for (unsigned line = 0; line < 8; ++line)
+    {
+        bitmap[line] = displayMemory[m_lineOffsets[row * 8 + line] + column];
+    }
+    const InkPaper &color = colors[displayMemory[DisplayFileSize + cell]];
+    uint32_t *pixels = &screen[(ULABorderHeight + row * 8) * ULAFrameWidth + ULABorderWidth + column * 8];
+    m_kernels.ExpandCell(bitmap, color.Ink, color.Paper, pixels, ULAFrameWidth);
+}
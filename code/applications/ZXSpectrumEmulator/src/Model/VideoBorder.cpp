@@ -0,0 +1,138 @@
+#include "Model/VideoBorder.h"
+
+#include <algorithm>
+#include <limits>
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
+
+VideoBorder::VideoBorder(ICPU &cpu, uint32_t tstatesPerLine, uint32_t firstScreenLineTState, const PixelKernels &kernels)
+    : m_cpu{ cpu }
+    , m_kernels{ kernels }
+    , m_tstatesPerLine{ tstatesPerLine }
+    , m_firstVisibleTState{ firstScreenLineTState - ULABorderHeight * tstatesPerLine - ULABorderWidth / 2 }
+    , m_events{}
+    , m_frameStartClock{}
+    , m_color{}
+    , m_frameStartColor{}
+    , m_renderedColor{}
+    , m_renderedEvents{}
+    , m_fullRedraw{ true }
+{
+    // Reserved up front, recording an event never allocates
+    m_events.reserve(MaxEventsPerFrame);
+}
+
+void VideoBorder::Reset()
+{
+    m_events.clear();
+    m_frameStartClock = {};
+    m_color = {};
+    m_frameStartColor = {};
+    m_fullRedraw = true;
+}
+
+void VideoBorder::StartFrame(uint64_t frameStartClock)
+{
+    m_events.clear();
+    m_frameStartClock = frameStartClock;
+    m_frameStartColor = m_color;
+}
+
+void VideoBorder::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    serialization::SerializeBinary(m_frameStartClock, buffer, offset);
+    serialization::SerializeBinary(m_color, buffer, offset);
+    serialization::SerializeBinary(m_frameStartColor, buffer, offset);
+}
+
+bool VideoBorder::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    uint64_t frameStartClock{};
+    uint8_t color{};
+    uint8_t frameStartColor{};
+    if (!serialization::DeserializeBinary(frameStartClock, buffer, offset)
+        || !serialization::DeserializeBinary(color, buffer, offset)
+        || !serialization::DeserializeBinary(frameStartColor, buffer, offset))
+        return false;
+    m_events.clear();
+    m_frameStartClock = frameStartClock;
+    m_color = static_cast<uint8_t>(color & 0x07);
+    m_frameStartColor = static_cast<uint8_t>(frameStartColor & 0x07);
+    m_fullRedraw = true;
+    return true;
+}
+
+void VideoBorder::Write8(uint16_t /*address*/, uint8_t value)
+{
+    auto color = static_cast<uint8_t>(value & 0x07);
+    if (color == m_color)
+        return;
+    m_color = color;
+    if (m_events.size() < MaxEventsPerFrame)
+    {
+        // Writes while single stepping outside of a frame can be far past the frame start
+        uint64_t tstate = std::min<uint64_t>(m_cpu.GetCPUClock() - m_frameStartClock, std::numeric_limits<uint32_t>::max());
+        m_events.push_back(BorderEvent{ static_cast<uint32_t>(tstate), color });
+    }
+    else
+    {
+        m_events.back().Color = color;
+    }
+}
+
+ULADirtyLines VideoBorder::Render(ULAScreen &screen)
+{
+    // A border that had no changes in this frame nor in the last rendered one is one colour, and already on screen
+    if (!m_fullRedraw && m_events.empty() && !m_renderedEvents && (m_frameStartColor == m_renderedColor))
+        return {};
+
+    std::size_t next = 0;
+    uint32_t pixel = ULAPalette[m_frameStartColor];
+    for (int y = 0; y < ULAFrameHeight; ++y)
+    {
+        uint32_t *line = &screen[static_cast<std::size_t>(y) * ULAFrameWidth];
+        const bool paperLine = (y >= ULABorderHeight) && (y < ULABorderHeight + ULAScreenHeight);
+        const int64_t lineTState = m_firstVisibleTState + static_cast<int64_t>(y) * m_tstatesPerLine;
+        int x = 0;
+        while (x < ULAFrameWidth)
+        {
+            int endX = ULAFrameWidth;
+            if (next < m_events.size())
+            {
+                // 2 pixels per T-state. Changes before the start of the line take effect at its first pixel
+                int64_t changeX = (m_events[next].TState - lineTState) * 2;
+                if (changeX <= x)
+                {
+                    pixel = ULAPalette[m_events[next].Color];
+                    ++next;
+                    continue;
+                }
+                if (changeX < endX)
+                    endX = static_cast<int>(changeX);
+            }
+            FillLine(line, x, endX, pixel, paperLine);
+            x = endX;
+        }
+    }
+
+    m_renderedColor = m_color;
+    m_renderedEvents = !m_events.empty();
+    m_fullRedraw = false;
+    return ULADirtyLines{ 0, ULAFrameHeight - 1 };
+}
+
+// Fills pixels startX up to endX of a line, leaving the paper area alone
+void VideoBorder::FillLine(uint32_t *line, int startX, int endX, uint32_t pixel, bool paperLine) const
+{
+    if (!paperLine)
+    {
+        m_kernels.Fill(line + startX, static_cast<std::size_t>(endX - startX), pixel);
+        return;
+    }
+    const int leftEnd = std::min(endX, ULABorderWidth);
+    if (startX < leftEnd)
+        m_kernels.Fill(line + startX, static_cast<std::size_t>(leftEnd - startX), pixel);
+    const int rightStart = std::max(startX, ULABorderWidth + ULAScreenWidth);
+    if (rightStart < endX)
+        m_kernels.Fill(line + rightStart, static_cast<std::size_t>(endX - rightStart), pixel);
+}
@@ -1,560 +1,672 @@
 #include "Model/Z80.h"
 
 #include <algorithm>
+#include <cstring>
 #include "tracing/Tracing.h"
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
 
-static void HandlOpcodeNOP()
+Z80::Z80(uint64_t clockFreq)
+    : m_cpuFreq{ clockFreq }
+    , m_registers{}
+    , m_memoryMap{}
+    , m_ioMap{ IOMappingSet<uint16_t>{} }
+    , m_contention{}
+    , m_opcode{}
+    , m_displacement{}
+    , m_decodeError{}
+    , m_disassembler{ m_memoryMap }
+    , m_cpuClock{}
+    , m_instructionCount{}
+    , m_interruptEndClock{}
+    , m_breakpoints{}
+    , m_haveBreakpoints{}
+    , m_executionMode{ ExecutionMode::Interpreter }
+    , m_blockCache{}
+    , m_decodeBuffer{}
+    , m_recompiler{ NativeLayout() }
+    , m_lockstepMemoryBefore{}
+    , m_lockstepMemoryNative{}
 {
-    Z80 *instance = Z80::GetInstance();
-    instance->IncrementCPUClock(4);
 }
 
-static void HandleOpcodeLD_B_NN()
+bool Z80::Init()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::B] = operand;
-    instance->IncrementCPUClock(7);
+    return true;
 }
 
-static void HandleOpcodeLD_C_NN()
+void Z80::Reset()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::C] = operand;
-    instance->IncrementCPUClock(7);
+    m_registers.Reset();
+    m_cpuClock = {};
+    m_instructionCount = {};
+    FlushCodeCaches();
 }
 
-static void HandleOpcodeLD_DE_nn()
+bool Z80::IsHalted()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint16_t operand = instance->ReadWord();
-    regs.SetDE(operand);
-    instance->IncrementCPUClock(10);
+    return m_registers.Halted;
 }
 
-static void HandleOpcodeLD_D_NN()
+std::string Z80::DumpRegisters()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::D] = operand;
-    instance->IncrementCPUClock(7);
+    return m_registers.Dump();
 }
 
-static void HandleOpcodeLD_E_NN()
+bool Z80::ExecuteInstruction()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::E] = operand;
-    instance->IncrementCPUClock(7);
+    m_decodeError = false;
+    if (m_registers.IntLock)
+        m_registers.IntLock = false;
+    else if (m_registers.NMIPending || m_registers.IntPending)
+        AcceptInterrupt();
+    ++m_instructionCount;
+    if (m_registers.Halted)
+    {
+        IncrementRefresh(1);
+        IncrementCPUClock(4);
+        return true;
+    }
+    uint8_t opcode = ReadOpcodeByte();
+    Dispatch(OpcodePrefix::None, opcode);
+    return !m_decodeError;
 }
 
-static void HandleOpcodeLD_H_NN()
+RunExitReason Z80::ExecuteCycles(uint64_t tstates)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::H] = operand;
-    instance->IncrementCPUClock(7);
+    const uint64_t deadline = m_cpuClock + tstates;
+    m_decodeError = false;
+    while (m_cpuClock < deadline)
+    {
+        if (m_registers.IntLock)
+            m_registers.IntLock = false;
+        else if (m_registers.NMIPending || m_registers.IntPending)
+            AcceptInterrupt();
+        if (m_registers.Halted)
+        {
+            auto exitReason = FastForwardHalted(deadline);
+            if (exitReason != RunExitReason::BudgetSpent)
+                return exitReason;
+            continue;
+        }
+        auto exitReason = (m_executionMode != ExecutionMode::Interpreter) ? ExecuteNextBlock(deadline) : ExecuteNextInstruction(deadline);
+        if (exitReason != RunExitReason::BudgetSpent)
+            return exitReason;
+    }
+    return RunExitReason::BudgetSpent;
+}
+
+RunExitReason Z80::ExecuteNextInstruction(uint64_t deadline)
+{
+    uint16_t instructionAddress = m_registers.PC;
+    uint8_t opcode = ReadOpcodeByte();
+    Dispatch(OpcodePrefix::None, opcode);
+    ++m_instructionCount;
+    if (m_decodeError)
+        return RunExitReason::Error;
+    CheckIdleLoop(instructionAddress, opcode, deadline);
+    // Breakpoints are checked after an instruction, so that a run can be resumed from a breakpoint
+    if (m_haveBreakpoints && m_breakpoints[m_registers.PC])
+        return RunExitReason::Breakpoint;
+    return RunExitReason::BudgetSpent;
+}
+
+// Runs the cached blocks from PC. Instructions inside a block cannot change the interrupt state (EI, DI and RETN end a
+// block), so interrupts only need to be checked between blocks. Blocks follow each other here until the next one is
+// not cached yet, or the outer loop has something to do: the deadline is reached, EI was executed, an interrupt is
+// pending or the CPU halted
+RunExitReason Z80::ExecuteNextBlock(uint64_t deadline)
+{
+    Z80DecodedBlock *block = m_blockCache.Find(m_registers.PC, m_memoryMap);
+    if (block == nullptr)
+        block = DecodeBlock(m_registers.PC);
+    if (block == nullptr)
+        return ExecuteNextInstruction(deadline);
+    // Native code does not check breakpoints, blocks are interpreted while any are set
+    const bool runNative = UsesRecompiler();
+    while (true)
+    {
+        if (runNative && (block->NativeCode == nullptr) && (++block->ExecutionCount == RecompileThreshold))
+        {
+            if (m_recompiler.IsFull())
+            {
+                // Start over, the blocks that are still hot will be compiled again
+                FlushCodeCaches();
+                return RunExitReason::BudgetSpent;
+            }
+            block->NativeCode = m_recompiler.Compile(*block, m_blockCache.Instructions(*block), m_memoryMap);
+        }
+        if (runNative && (block->NativeCode != nullptr))
+        {
+            auto exitReason = ExecuteNativeBlock(*block, deadline);
+            if (exitReason != RunExitReason::BudgetSpent)
+                return exitReason;
+        }
+        else
+        {
+            bool notAtBreakpoint = (m_cpuClock + block->MaxTStates < deadline) ? RunDecodedBlock<false>(*block, deadline) :
+                RunDecodedBlock<true>(*block, deadline);
+            if (!notAtBreakpoint)
+                return RunExitReason::Breakpoint;
+        }
+        if ((m_cpuClock >= deadline) || m_registers.IntLock || m_registers.NMIPending || m_registers.IntPending || m_registers.Halted)
+            return RunExitReason::BudgetSpent;
+        block = m_blockCache.Find(m_registers.PC, m_memoryMap);
+        if (block == nullptr)
+            return RunExitReason::BudgetSpent;
+    }
 }
 
-static void HandleOpcodeLD_L_NN()
+// Branches are checked after every instruction, the deadline only when the block may reach it, and writes to the
+// block's own pages only after the instructions that can do them. Blocks end before an instruction following a
+// breakpoint, so breakpoints are only checked where the block is left. R is updated once, also when the block is left.
+// Returns false when stopped at a breakpoint
+template <bool CheckDeadline>
+bool Z80::RunDecodedBlock(const Z80DecodedBlock &block, uint64_t deadline)
+{
+    const Z80DecodedInstruction *instructions = m_blockCache.Instructions(block);
+    const std::size_t last = block.InstructionCount - 1;
+    std::size_t index = 0;
+    // M1 cycles and instructions of the loops taken inside the block, the refresh count before the instruction a loop
+    // restarts at, and the index it restarts at
+    uint32_t loopRefreshCount = 0;
+    uint8_t refreshBase = 0;
+    uint64_t loopInstructionCount = 0;
+    std::size_t passStart = 0;
+    while (true)
+    {
+        const Z80DecodedInstruction &instruction = instructions[index];
+        m_registers.PC = instruction.NextAddress;
+        instruction.Execute(*this, instruction);
+        if (m_registers.PC != instruction.NextAddress)
+        {
+            uint16_t instructionAddress = (index == 0) ? block.Address : instructions[index - 1].NextAddress;
+            CheckIdleLoop(instructionAddress, instruction.Opcode, deadline);
+            // Repeating block instructions and loops back to the start of the block continue here
+            std::size_t target{};
+            if (m_registers.PC == instructionAddress)
+                target = index;
+            else if (m_registers.PC == block.Address)
+                target = 0;
+            else
+                break;
+            if (!CanContinueBlock<CheckDeadline>(block, deadline))
+                break;
+            // Each pass of a loop counts towards recompiling the block, the count is kept by ExecuteNextBlock
+            if ((target == 0) && (block.ExecutionCount < RecompileThreshold) && UsesRecompiler())
+                break;
+            loopRefreshCount += static_cast<uint8_t>(instruction.RefreshCount - refreshBase);
+            refreshBase = (target == 0) ? 0 : instructions[target - 1].RefreshCount;
+            loopInstructionCount += index - passStart + 1;
+            passStart = target;
+            index = target;
+            continue;
+        }
+        if (index == last)
+            break;
+        if constexpr (CheckDeadline)
+        {
+            if (m_cpuClock >= deadline)
+                break;
+        }
+        if (instruction.MayWriteCode && !Z80BlockCache::IsValid(block, m_memoryMap))
+            break;
+        ++index;
+    }
+    IncrementRefresh(loopRefreshCount + static_cast<uint8_t>(instructions[index].RefreshCount - refreshBase));
+    m_instructionCount += loopInstructionCount + (index - passStart + 1);
+    return !(m_haveBreakpoints && m_breakpoints[m_registers.PC]);
+}
+
+RunExitReason Z80::ExecuteNativeBlock(const Z80DecodedBlock &block, uint64_t deadline)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::L] = operand;
-    instance->IncrementCPUClock(7);
+    uint32_t count = (m_executionMode == ExecutionMode::Lockstep) ? RunNativeBlockLockstep(block, deadline) : block.NativeCode(this, deadline);
+    if (count == 0)
+        return RunExitReason::Error;
+    m_instructionCount += count;
+    const Z80DecodedInstruction *instructions = m_blockCache.Instructions(block);
+    const Z80DecodedInstruction &last = instructions[count - 1];
+    if (m_registers.PC != last.NextAddress)
+    {
+        uint16_t instructionAddress = (count == 1) ? block.Address : instructions[count - 2].NextAddress;
+        CheckIdleLoop(instructionAddress, last.Opcode, deadline);
+    }
+    return RunExitReason::BudgetSpent;
 }
 
-static void HandleOpcodeLD_A_NN()
+static bool IsSameState(const Z80Registers &lhs, const Z80Registers &rhs)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    regs.Reg[RegisterIndex::A] = operand;
-    instance->IncrementCPUClock(7);
+    return (std::memcmp(lhs.Reg, rhs.Reg, sizeof(lhs.Reg)) == 0) && (std::memcmp(lhs.Reg_, rhs.Reg_, sizeof(lhs.Reg_)) == 0) &&
+        (lhs.PC == rhs.PC) && (lhs.SP == rhs.SP) && (lhs.IX == rhs.IX) && (lhs.IY == rhs.IY) &&
+        (lhs.I == rhs.I) && (lhs.R == rhs.R) && (lhs.IFF1 == rhs.IFF1) && (lhs.IFF2 == rhs.IFF2) &&
+        (lhs.IntMode == rhs.IntMode) && (lhs.Halted == rhs.Halted);
 }
 
-static void HandleOpcodeLD_B_r()
+// Runs the native block, then rewinds and runs the same number of instructions through the interpreter. Returns 0 if
+// registers, clock or RAM differ. Blocks with I/O are never compiled, so running twice has no side effects
+uint32_t Z80::RunNativeBlockLockstep(const Z80DecodedBlock &block, uint64_t deadline)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::B] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    const Z80Registers registersBefore = m_registers;
+    const uint64_t clockBefore = m_cpuClock;
+    const uint64_t instructionCountBefore = m_instructionCount;
+    SaveMappedRAM(m_lockstepMemoryBefore);
+
+    uint32_t count = block.NativeCode(this, deadline);
+    // Loops inside the block already counted their earlier passes
+    const uint64_t executed = m_instructionCount - instructionCountBefore + count;
+    const Z80Registers registersNative = m_registers;
+    const uint64_t clockNative = m_cpuClock;
+    SaveMappedRAM(m_lockstepMemoryNative);
+
+    m_registers = registersBefore;
+    m_cpuClock = clockBefore;
+    RestoreMappedRAM(m_lockstepMemoryBefore);
+    for (uint64_t index = 0; index < executed; ++index)
+    {
+        uint8_t opcode = ReadOpcodeByte();
+        Dispatch(OpcodePrefix::None, opcode);
+    }
+
+    // The saved state is no longer needed, the buffer is reused for the interpreter's result
+    SaveMappedRAM(m_lockstepMemoryBefore);
+    if (!IsSameState(m_registers, registersNative) || (m_cpuClock != clockNative) || (m_lockstepMemoryBefore != m_lockstepMemoryNative))
+    {
+        TRACE_ERROR("Recompiled block at {} differs from the interpreter", block.Address);
+        return 0;
+    }
+    return count;
 }
 
-static void HandleOpcodeLD_C_r()
+// Contents of the RAM pages in the address space, in page order
+void Z80::SaveMappedRAM(ByteVector &contents) const
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::C] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    contents.clear();
+    for (std::size_t page = 0; page < PagedMemoryMap::PageCount; ++page)
+    {
+        const uint8_t *data = m_memoryMap.RAMPage(page);
+        if (data != nullptr)
+            contents.insert(contents.end(), data, data + PagedMemoryMap::PageSize);
+    }
 }
 
-static void HandleOpcodeLD_D_r()
+void Z80::RestoreMappedRAM(const ByteVector &contents)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::D] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    std::size_t offset = 0;
+    for (std::size_t page = 0; page < PagedMemoryMap::PageCount; ++page)
+    {
+        uint8_t *data = m_memoryMap.RAMPage(page);
+        if (data != nullptr)
+        {
+            std::memcpy(data, contents.data() + offset, PagedMemoryMap::PageSize);
+            offset += PagedMemoryMap::PageSize;
+        }
+    }
+}
+
+Z80DecodedBlock *Z80::DecodeBlock(uint16_t address)
+{
+    // A block stays within two consecutive pages, so two write generations cover it
+    const auto firstPage = static_cast<uint16_t>(PagedMemoryMap::PageIndex(address));
+    uint16_t lastPage = firstPage;
+    uint16_t current = address;
+    uint8_t refreshCount = 0;
+    m_decodeBuffer.clear();
+    if (m_memoryMap.IsContended(firstPage))
+        return nullptr;
+    bool accessesIO = false;
+    // Bit n for instruction n that accesses a port
+    uint64_t ioInstructions = 0;
+    while (m_decodeBuffer.size() < Z80BlockCache::MaxBlockLength)
+    {
+        Z80DecodedInstruction instruction{};
+        uint16_t next = current;
+        auto prefix = OpcodePrefix::None;
+        uint8_t opcode = PeekMemory(next++);
+        uint8_t m1Count = 1;
+        // Walk the prefixes the same way the prefix dispatchers do
+        while (instruction.PrefixTStates < 16)
+        {
+            bool isIndexOrNone = (prefix == OpcodePrefix::None) || (prefix == OpcodePrefix::DD) || (prefix == OpcodePrefix::FD);
+            if (!isIndexOrNone)
+                break;
+            if ((opcode == 0xDD) || (opcode == 0xFD) || (opcode == 0xED) || ((opcode == 0xCB) && (prefix == OpcodePrefix::None)))
+            {
+                prefix = (opcode == 0xDD) ? OpcodePrefix::DD : (opcode == 0xFD) ? OpcodePrefix::FD : (opcode == 0xED) ? OpcodePrefix::ED : OpcodePrefix::CB;
+                instruction.PrefixTStates += 4;
+                ++m1Count;
+                opcode = PeekMemory(next++);
+            }
+            else if (opcode == 0xCB)
+            {
+                // DD CB d op: the displacement precedes the opcode, and the opcode is not an M1 fetch
+                prefix = (prefix == OpcodePrefix::DD) ? OpcodePrefix::DDCB : OpcodePrefix::FDCB;
+                instruction.PrefixTStates += 4;
+                instruction.Displacement = static_cast<int8_t>(PeekMemory(next++));
+                opcode = PeekMemory(next++);
+            }
+            else
+            {
+                break;
+            }
+        }
+        const OpcodeInfo &info = OpcodeInfos[static_cast<std::size_t>(prefix)][opcode];
+        bool isPrefix = (prefix == OpcodePrefix::None || prefix == OpcodePrefix::DD || prefix == OpcodePrefix::FD) &&
+            ((opcode == 0xCB) || (opcode == 0xDD) || (opcode == 0xED) || (opcode == 0xFD));
+        // LD R,A and LD A,R would see R before the block updates it
+        bool accessesRefresh = (prefix == OpcodePrefix::ED) && ((opcode == 0x4F) || (opcode == 0x5F));
+        // Blocks do not fetch their instructions through the memory map, an instruction with bytes in a contended page is
+        // left to the interpreter. The bytes span two pages at most
+        const auto lastByte = static_cast<uint16_t>(next - 1 + info.OperandLength);
+        const bool contended = m_memoryMap.IsContended(PagedMemoryMap::PageIndex(current)) ||
+            m_memoryMap.IsContended(PagedMemoryMap::PageIndex(lastByte));
+        if (!info.IsValid || isPrefix || accessesRefresh || contended)
+            break;
+        const DecodedOpcode &decoded = DecodedOpcodes[static_cast<std::size_t>(prefix)][opcode];
+        refreshCount = static_cast<uint8_t>((refreshCount + m1Count) & 0x7F);
+        instruction.Execute = decoded.Handler;
+        instruction.TStates = static_cast<uint8_t>(instruction.PrefixTStates + decoded.TStates);
+        instruction.RefreshCount = refreshCount;
+        instruction.MayWriteCode = info.MayWriteCode;
+        instruction.Repeats = (prefix == OpcodePrefix::ED) && ((opcode & 0xF4) == 0xB0);
+        instruction.Handler = OpcodeTables[static_cast<std::size_t>(prefix)][opcode];
+        instruction.Opcode = opcode;
+        instruction.OperandAddress = next;
+        instruction.NextAddress = static_cast<uint16_t>(next + info.OperandLength);
+        uint16_t operand = next;
+        if (info.HasDisplacement)
+            instruction.Displacement = static_cast<int8_t>(PeekMemory(operand++));
+        const auto operandLength = static_cast<uint16_t>(instruction.NextAddress - operand);
+        if (operandLength == 1)
+            instruction.Operand = PeekMemory(operand);
+        else if (operandLength == 2)
+            instruction.Operand = static_cast<uint16_t>(PeekMemory(operand) | (PeekMemory(static_cast<uint16_t>(operand + 1)) << 8));
+        accessesIO = accessesIO || info.AccessesIO;
+        if (info.AccessesIO)
+            ioInstructions |= uint64_t{ 1 } << m_decodeBuffer.size();
+        m_decodeBuffer.push_back(instruction);
+        lastPage = static_cast<uint16_t>(PagedMemoryMap::PageIndex(static_cast<uint16_t>(instruction.NextAddress - 1)));
+        current = instruction.NextAddress;
+        if (info.EndsBlock || (lastPage != firstPage) || (PagedMemoryMap::PageIndex(current) != firstPage) ||
+            (m_haveBreakpoints && m_breakpoints[current]))
+            break;
+    }
+    if (m_decodeBuffer.empty())
+        return nullptr;
+    m_memoryMap.TrapWrites(firstPage);
+    m_memoryMap.TrapWrites(lastPage);
+    Z80DecodedBlock block{};
+    block.FirstPage = firstPage;
+    block.LastPage = lastPage;
+    block.IsWritable = m_memoryMap.IsWriteTrapped(firstPage) || m_memoryMap.IsWriteTrapped(lastPage);
+    block.AccessesIO = accessesIO;
+    // Stores cannot change a block in ROM, but a port write can page other memory in under it
+    if (!block.IsWritable)
+    {
+        for (std::size_t index = 0; index < m_decodeBuffer.size(); ++index)
+            m_decodeBuffer[index].MayWriteCode = m_decodeBuffer[index].MayWriteCode && ((ioInstructions >> index) & 1);
+    }
+    return m_blockCache.Add(address, block, m_decodeBuffer, m_memoryMap);
+}
+
+void Z80::FlushCodeCaches()
+{
+    m_blockCache.Flush();
+    m_recompiler.Flush();
+}
+
+// Register pairs are stored as words, so the layout does not depend on the host byte order
+void Z80::SaveState(ByteVector &buffer, std::size_t &offset) const
+{
+    using serialization::SerializeBinary;
+    for (uint16_t pair : m_registers.Pair)
+        SerializeBinary(pair, buffer, offset);
+    for (uint16_t pair : m_registers.Pair_)
+        SerializeBinary(pair, buffer, offset);
+    SerializeBinary(m_registers.PC, buffer, offset);
+    SerializeBinary(m_registers.SP, buffer, offset);
+    SerializeBinary(m_registers.IX, buffer, offset);
+    SerializeBinary(m_registers.IY, buffer, offset);
+    SerializeBinary(m_registers.I, buffer, offset);
+    SerializeBinary(m_registers.R, buffer, offset);
+    SerializeBinary(m_registers.IFF1, buffer, offset);
+    SerializeBinary(m_registers.IFF2, buffer, offset);
+    SerializeBinary(m_registers.IntMode, buffer, offset);
+    SerializeBinary(m_registers.IntLock, buffer, offset);
+    SerializeBinary(m_registers.IntPending, buffer, offset);
+    SerializeBinary(m_registers.NMIPending, buffer, offset);
+    SerializeBinary(m_registers.Halted, buffer, offset);
+    SerializeBinary(m_registers.Modifier, buffer, offset);
+    SerializeBinary(m_cpuClock, buffer, offset);
+    SerializeBinary(m_instructionCount, buffer, offset);
+    SerializeBinary(m_interruptEndClock, buffer, offset);
+}
+
+// Decoded blocks stay valid, they only depend on the memory contents
+bool Z80::LoadState(const ByteVector &buffer, std::size_t &offset)
+{
+    using serialization::DeserializeBinary;
+    Z80Registers registers{};
+    bool ok{ true };
+    for (uint16_t &pair : registers.Pair)
+        ok = ok && DeserializeBinary(pair, buffer, offset);
+    for (uint16_t &pair : registers.Pair_)
+        ok = ok && DeserializeBinary(pair, buffer, offset);
+    uint64_t cpuClock{};
+    uint64_t instructionCount{};
+    uint64_t interruptEndClock{};
+    ok = ok
+        && DeserializeBinary(registers.PC, buffer, offset)
+        && DeserializeBinary(registers.SP, buffer, offset)
+        && DeserializeBinary(registers.IX, buffer, offset)
+        && DeserializeBinary(registers.IY, buffer, offset)
+        && DeserializeBinary(registers.I, buffer, offset)
+        && DeserializeBinary(registers.R, buffer, offset)
+        && DeserializeBinary(registers.IFF1, buffer, offset)
+        && DeserializeBinary(registers.IFF2, buffer, offset)
+        && DeserializeBinary(registers.IntMode, buffer, offset)
+        && DeserializeBinary(registers.IntLock, buffer, offset)
+        && DeserializeBinary(registers.IntPending, buffer, offset)
+        && DeserializeBinary(registers.NMIPending, buffer, offset)
+        && DeserializeBinary(registers.Halted, buffer, offset)
+        && DeserializeBinary(registers.Modifier, buffer, offset)
+        && DeserializeBinary(cpuClock, buffer, offset)
+        && DeserializeBinary(instructionCount, buffer, offset)
+        && DeserializeBinary(interruptEndClock, buffer, offset);
+    if (!ok)
+        return false;
+    m_registers = registers;
+    m_cpuClock = cpuClock;
+    m_instructionCount = instructionCount;
+    m_interruptEndClock = interruptEndClock;
+    return true;
 }
 
-static void HandleOpcodeLD_E_r()
+// Generated code addresses the CPU state relative to the Z80 object
+Z80NativeLayout Z80::NativeLayout() const
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::E] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    auto offset = [this](const void *member)
+    {
+        return static_cast<int32_t>(static_cast<const uint8_t *>(member) - reinterpret_cast<const uint8_t *>(this));
+    };
+    Z80NativeLayout layout{};
+    layout.Registers = offset(&m_registers.Reg[0]);
+    layout.PC = offset(&m_registers.PC);
+    layout.R = offset(&m_registers.R);
+    layout.CPUClock = offset(&m_cpuClock);
+    layout.InstructionCount = offset(&m_instructionCount);
+    return layout;
 }
 
-static void HandleOpcodeLD_H_r()
+void Z80::AcceptInterrupt()
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::H] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    if (m_registers.NMIPending)
+    {
+        m_registers.NMIPending = false;
+        m_registers.Halted = false;
+        m_registers.IFF1 = false;
+        IncrementRefresh(1);
+        IncrementCPUClock(5);
+        Push(m_registers.PC);
+        m_registers.SetPC(0x0066);
+        return;
+    }
+    if (m_cpuClock >= m_interruptEndClock)
+    {
+        // INT was released before interrupts were enabled
+        m_registers.IntPending = false;
+        return;
+    }
+    if (!m_registers.IFF1)
+        return;
+    m_registers.IntPending = false;
+    m_registers.Halted = false;
+    m_registers.IFF1 = m_registers.IFF2 = false;
+    IncrementRefresh(1);
+    // The acknowledge cycle, then the same as RST 38 in all modes
+    IncrementCPUClock(7);
+    Push(m_registers.PC);
+    switch (m_registers.IntMode)
+    {
+    case 2:
+        // The vector low byte comes from the data bus, which floats to 0xFF on the Spectrum
+        m_registers.SetPC(ReadMemoryWord(static_cast<uint16_t>((m_registers.I << 8) | 0xFF)));
+        break;
+    case 0:
+        // The instruction on the data bus is 0xFF (RST 38)
+    case 1:
+    default:
+        m_registers.SetPC(0x0038);
+        break;
+    }
 }
 
-static void HandleOpcodeLD_L_r()
+RunExitReason Z80::FastForwardHalted(uint64_t deadline)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::L] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    if (!m_registers.IFF1 && !m_registers.NMIPending)
+        return RunExitReason::Halted;
+    // The CPU executes NOPs until the next event, which is at the deadline at the earliest
+    uint64_t nopCount = (deadline - m_cpuClock + 3) / 4;
+    IncrementRefresh(nopCount);
+    m_cpuClock += nopCount * 4;
+    m_instructionCount += nopCount;
+    return RunExitReason::BudgetSpent;
 }
 
-static void HandleOpcodeLD_A_r()
+void Z80::FastForwardIdleLoop(uint64_t deadline, uint8_t instructionTStates)
 {
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.Reg[RegisterIndex::A] = regs.Reg[instance->GetOpcode() & 0x07];
-    instance->IncrementCPUClock(4);
+    if (m_cpuClock >= deadline)
+        return;
+    uint64_t iterations = (deadline - m_cpuClock + instructionTStates - 1) / instructionTStates;
+    IncrementRefresh(iterations);
+    m_cpuClock += iterations * instructionTStates;
+    m_instructionCount += iterations;
 }
 
-static void HandleOpcodeXOR_r()
-{
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.XOR(RegisterIndex::A, static_cast<RegisterIndex>(instance->GetOpcode() & 0x07), RegisterIndex::A);
-
-    instance->IncrementCPUClock(4);
-}
-
-static void HandleOpcodeJP_NNNN()
-{
-    Z80 *instance = Z80::GetInstance();
-    uint16_t address = instance->ReadWord();
-    auto &regs = instance->GetRegisters();
-    regs.SetPC(address);
-    instance->IncrementCPUClock(10);
-}
-
-static void HandleOpcodeOUT_IndNN_A()
-{
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    uint8_t operand = instance->ReadByte();
-    instance->Out(operand, regs.Reg[RegisterIndex::A]);
-}
-
-static void HandlOpcodeDI()
-{
-    Z80 *instance = Z80::GetInstance();
-    auto &regs = instance->GetRegisters();
-    regs.IFF1 = regs.IFF2 = false;
-    regs.IntLock = true;
-    instance->IncrementCPUClock(4);
-}
-
-#pragma warning(disable: 4365)
-#pragma warning(disable: 4242)
-#pragma warning(disable: 4244)
-const Z80::OpcodeFuncionLookup Z80::OpcodeLookup = {
-    { 0x00, HandlOpcodeNOP},
-    { 0x01, nullptr }, // ei_ld_BC_NN,
-    { 0x02, nullptr }, // ei_ld_iBC_A,
-    { 0x03, nullptr }, // ei_inc_BC,
-    { 0x04, nullptr }, // ei_inc_B,
-    { 0x05, nullptr }, // ei_dec_B,
-    { 0x06, HandleOpcodeLD_B_NN },
-    { 0x07, nullptr }, // ei_rlca,
-    { 0x08, nullptr }, // ei_ex_AF_xAF,
-    { 0x09, nullptr }, // ei_add_HL_BC,
-    { 0x0A, nullptr }, // ei_ld_A_iBC,
-    { 0x0B, nullptr }, // ei_dec_BC,
-    { 0x0C, nullptr }, // ei_inc_C,
-    { 0x0D, nullptr }, // ei_dec_C,
-    { 0x0E, HandleOpcodeLD_C_NN },
-    { 0x0F, nullptr }, // ei_rrca,
-    { 0x10, nullptr }, // ei_djnz,
-    { 0x11, HandleOpcodeLD_DE_nn},
-    { 0x12, nullptr }, // ei_ld_iDE_A,
-    { 0x13, nullptr }, // ei_inc_DE,
-    { 0x14, nullptr }, // ei_inc_D,
-    { 0x15, nullptr }, // ei_dec_D,
-    { 0x16, HandleOpcodeLD_D_NN },
-    { 0x17, nullptr }, // ei_rla,
-    { 0x18, nullptr }, // ei_jr_N,
-    { 0x19, nullptr }, // ei_add_HL_DE,
-    { 0x1A, nullptr }, // ei_ld_A_iDE,
-    { 0x1B, nullptr }, // ei_dec_DE,
-    { 0x1C, nullptr }, // ei_inc_E,
-    { 0x1D, nullptr }, // ei_dec_E,
-    { 0x1E, HandleOpcodeLD_E_NN },
-    { 0x1F, nullptr }, // ei_rra,
-    { 0x20, nullptr }, // ei_jr_NZ_N,
-    { 0x21, nullptr }, // ei_ld_HL_NN,
-    { 0x22, nullptr }, // ei_ld_iNN_HL,
-    { 0x23, nullptr }, // ei_inc_HL,
-    { 0x24, nullptr }, // ei_inc_H,
-    { 0x25, nullptr }, // ei_dec_H,
-    { 0x26, HandleOpcodeLD_H_NN },
-    { 0x27, nullptr }, // ei_daa,
-    { 0x28, nullptr }, // ei_jr_Z_N, // 0x28
-    { 0x29, nullptr }, // ei_add_HL_HL,
-    { 0x2A, nullptr }, // ei_ld_HL_iNN,
-    { 0x2B, nullptr }, // ei_dec_HL,
-    { 0x2C, nullptr }, // ei_inc_L, // 0x2C
-    { 0x2D, nullptr }, // ei_dec_L,
-    { 0x2E, HandleOpcodeLD_L_NN },
-    { 0x2F, nullptr }, // ei_cpl,
-    { 0x30, nullptr }, // ei_jr_NC_N, // 0x30
-    { 0x31, nullptr }, // ei_ld_SP_NN,
-    { 0x32, nullptr }, // ei_ld_iNN_A,
-    { 0x33, nullptr }, // ei_inc_SP,
-    { 0x34, nullptr }, // ei_inc_iHL, // 0x34
-    { 0x35, nullptr }, // ei_dec_iHL,
-    { 0x36, nullptr }, // ei_ld_iHL_N,
-    { 0x37, nullptr }, // ei_scf,
-    { 0x38, nullptr }, // ei_jr_C_N, // 0x38
-    { 0x39, nullptr }, // ei_add_HL_SP,
-    { 0x3A, nullptr }, // ei_ld_A_iNN,
-    { 0x3B, nullptr }, // ei_dec_SP,
-    { 0x3C, nullptr }, // ei_inc_A, // 0x3C
-    { 0x3D, nullptr }, // ei_dec_A,
-    { 0x3E, HandleOpcodeLD_A_NN },
-    { 0x3F, nullptr }, // ei_ccf,
-    { 0x40, HandleOpcodeLD_B_r }, // 0x40
-    { 0x41, HandleOpcodeLD_B_r }, // 0x41
-    { 0x42, HandleOpcodeLD_B_r }, // 0x42
-    { 0x43, HandleOpcodeLD_B_r }, // 0x43
-    { 0x44, HandleOpcodeLD_B_r }, // 0x44
-    { 0x45, HandleOpcodeLD_B_r }, // 0x45
-    { 0x46, nullptr }, // ei_ld_B_iHL,
-    { 0x47, HandleOpcodeLD_B_r }, // 0x47
-    { 0x48, HandleOpcodeLD_C_r }, // 0x48
-    { 0x49, HandleOpcodeLD_C_r }, // 0x49
-    { 0x4A, HandleOpcodeLD_C_r }, // 0x4A
-    { 0x4B, HandleOpcodeLD_C_r }, // 0x4B
-    { 0x4C, HandleOpcodeLD_C_r }, // 0x4C
-    { 0x4D, HandleOpcodeLD_C_r }, // 0x4D
-    { 0x4E, nullptr }, // ei_ld_C_iHL,
-    { 0x4F, HandleOpcodeLD_C_r }, // 0x4F
-    { 0x50, HandleOpcodeLD_D_r }, // 0x50
-    { 0x51, HandleOpcodeLD_D_r }, // 0x51
-    { 0x52, HandleOpcodeLD_D_r }, // 0x52
-    { 0x53, HandleOpcodeLD_D_r }, // 0x53
-    { 0x54, HandleOpcodeLD_D_r }, // 0x54
-    { 0x55, HandleOpcodeLD_D_r }, // 0x55
-    { 0x56, nullptr }, // ei_ld_D_iHL,
-    { 0x57, HandleOpcodeLD_D_r }, // 0x57
-    { 0x58, HandleOpcodeLD_E_r }, // 0x58
-    { 0x59, HandleOpcodeLD_E_r }, // 0x59
-    { 0x5A, HandleOpcodeLD_E_r }, // 0x5A
-    { 0x5B, HandleOpcodeLD_E_r }, // 0x5B
-    { 0x5C, HandleOpcodeLD_E_r }, // 0x5C
-    { 0x5D, HandleOpcodeLD_E_r }, // 0x5D
-    { 0x5E, nullptr }, // ei_ld_E_iHL,
-    { 0x5F, HandleOpcodeLD_E_r }, // 0x5F
-    { 0x60, HandleOpcodeLD_H_r }, // 0x60
-    { 0x61, HandleOpcodeLD_H_r }, // 0x61
-    { 0x62, HandleOpcodeLD_H_r }, // 0x62
-    { 0x63, HandleOpcodeLD_H_r }, // 0x63
-    { 0x64, HandleOpcodeLD_H_r }, // 0x64
-    { 0x65, HandleOpcodeLD_H_r }, // 0x65
-    { 0x66, nullptr }, // ei_ld_H_iHL,
-    { 0x67, HandleOpcodeLD_H_r }, // 0x67
-    { 0x68, HandleOpcodeLD_L_r }, // 0x68
-    { 0x69, HandleOpcodeLD_L_r }, // 0x69
-    { 0x6A, HandleOpcodeLD_L_r }, // 0x6A
-    { 0x6B, HandleOpcodeLD_L_r }, // 0x6B
-    { 0x6C, HandleOpcodeLD_L_r }, // 0x6C
-    { 0x6D, HandleOpcodeLD_L_r }, // 0x6D
-    { 0x6E, nullptr }, // ei_ld_L_iHL,
-    { 0x6F, HandleOpcodeLD_L_r }, // 0x6F
-    { 0x70, nullptr }, // ei_ld_iHL_r, // 0x70
-    { 0x71, nullptr }, // ei_ld_iHL_r,
-    { 0x72, nullptr }, // ei_ld_iHL_r,
-    { 0x73, nullptr }, // ei_ld_iHL_r,
-    { 0x74, nullptr }, // ei_ld_iHL_r, // 0x74
-    { 0x75, nullptr }, // ei_ld_iHL_r,
-    { 0x76, nullptr }, // ei_halt,
-    { 0x77, nullptr }, // ei_ld_iHL_r,
-    { 0x78, HandleOpcodeLD_A_r }, // 0x78
-    { 0x79, HandleOpcodeLD_A_r }, // 0x79
-    { 0x7A, HandleOpcodeLD_A_r }, // 0x7A
-    { 0x7B, HandleOpcodeLD_A_r }, // 0x7B
-    { 0x7C, HandleOpcodeLD_A_r }, // 0x7C
-    { 0x7D, HandleOpcodeLD_A_r }, // 0x7D
-    { 0x7E, nullptr }, // ei_ld_A_iHL,
-    { 0x7F, HandleOpcodeLD_A_r }, // 0x7F
-    { 0x80, nullptr }, // ei_add_A_r, //0x80
-    { 0x81, nullptr }, // ei_add_A_r,
-    { 0x82, nullptr }, // ei_add_A_r,
-    { 0x83, nullptr }, // ei_add_A_r,
-    { 0x84, nullptr }, // ei_add_A_r, //0x84
-    { 0x85, nullptr }, // ei_add_A_r,
-    { 0x86, nullptr }, // ei_add_A_iHL,
-    { 0x87, nullptr }, // ei_add_A_r,
-    { 0x88, nullptr }, // ei_adc_A_r, // 0x88
-    { 0x89, nullptr }, // ei_adc_A_r,
-    { 0x8A, nullptr }, // ei_adc_A_r,
-    { 0x8B, nullptr }, // ei_adc_A_r,
-    { 0x8C, nullptr }, // ei_adc_A_r, // 0x8C
-    { 0x8D, nullptr }, // ei_adc_A_r,
-    { 0x8E, nullptr }, // ei_adc_A_iHL,
-    { 0x8F, nullptr }, // ei_adc_A_r,
-    { 0x90, nullptr }, // ei_sub_r, // 0x90
-    { 0x91, nullptr }, // ei_sub_r,
-    { 0x92, nullptr }, // ei_sub_r,
-    { 0x93, nullptr }, // ei_sub_r,
-    { 0x94, nullptr }, // ei_sub_r, // 0x94
-    { 0x95, nullptr }, // ei_sub_r,
-    { 0x96, nullptr }, // ei_sub_iHL,
-    { 0x97, nullptr }, // ei_sub_r,
-    { 0x98, nullptr }, // ei_sbc_A_r, // 0x98
-    { 0x99, nullptr }, // ei_sbc_A_r,
-    { 0x9A, nullptr }, // ei_sbc_A_r,
-    { 0x9B, nullptr }, // ei_sbc_A_r,
-    { 0x9C, nullptr }, // ei_sbc_A_r, // 0x9C
-    { 0x9D, nullptr }, // ei_sbc_A_r,
-    { 0x9E, nullptr }, // ei_sbc_A_iHL,
-    { 0x9F, nullptr }, // ei_sbc_A_r,
-    { 0xA0, nullptr }, // ei_and_r, // 0xA0
-    { 0xA1, nullptr }, // ei_and_r,
-    { 0xA2, nullptr }, // ei_and_r,
-    { 0xA3, nullptr }, // ei_and_r,
-    { 0xA4, nullptr }, // ei_and_r, // 0xA4
-    { 0xA5, nullptr }, // ei_and_r,
-    { 0xA6, nullptr }, // ei_and_iHL,
-    { 0xA7, nullptr }, // ei_and_r,
-    { 0xA8, HandleOpcodeXOR_r },
-    { 0xA9, HandleOpcodeXOR_r },
-    { 0xAA, HandleOpcodeXOR_r },
-    { 0xAB, HandleOpcodeXOR_r },
-    { 0xAC, HandleOpcodeXOR_r },
-    { 0xAD, HandleOpcodeXOR_r },
-    { 0xAE, nullptr }, // ei_xor_iHL,
-    { 0xAF, HandleOpcodeXOR_r },
-    { 0xB0, nullptr }, // ei_or_r, // 0xB0
-    { 0xB1, nullptr }, // ei_or_r,
-    { 0xB2, nullptr }, // ei_or_r,
-    { 0xB3, nullptr }, // ei_or_r,
-    { 0xB4, nullptr }, // ei_or_r, // 0xB4
-    { 0xB5, nullptr }, // ei_or_r,
-    { 0xB6, nullptr }, // ei_or_iHL,
-    { 0xB7, nullptr }, // ei_or_r,
-    { 0xB8, nullptr }, // ei_cp_r, // 0xB8
-    { 0xB9, nullptr }, // ei_cp_r,
-    { 0xBA, nullptr }, // ei_cp_r,
-    { 0xBB, nullptr }, // ei_cp_r,
-    { 0xBC, nullptr }, // ei_cp_r, // 0xBC
-    { 0xBD, nullptr }, // ei_cp_r,
-    { 0xBE, nullptr }, // ei_cp_iHL,
-    { 0xBF, nullptr }, // ei_cp_r,
-    { 0xC0, nullptr }, // ei_ret_NZ, // 0xC0
-    { 0xC1, nullptr }, // ei_pop_BC,
-    { 0xC2, nullptr }, // ei_jp_NZ_NN,
-    { 0xC3, HandleOpcodeJP_NNNN },
-    { 0xC4, nullptr }, // ei_call_NZ_NN, // 0xC4
-    { 0xC5, nullptr }, // ei_push_BC,
-    { 0xC6, nullptr }, // ei_add_A_N,
-    { 0xC7, nullptr }, // ei_rst_0,
-    { 0xC8, nullptr }, // ei_ret_Z, // 0xC8
-    { 0xC9, nullptr }, // ei_ret,
-    { 0xCA, nullptr }, // ei_jp_Z_NN,
-    { 0xCB, nullptr }, // 0, // 0xCB
-    { 0xCC, nullptr }, // ei_call_Z_NN, // 0xCC
-    { 0xCD, nullptr }, // ei_call_NN,
-    { 0xCE, nullptr }, // ei_adc_A_N,
-    { 0xCF, nullptr }, // ei_rst_8,
-    { 0xD0, nullptr }, // ei_ret_NC, // 0xD0
-    { 0xD1, nullptr }, // ei_pop_DE,
-    { 0xD2, nullptr }, // ei_jp_NC_NN,
-    { 0xD3, HandleOpcodeOUT_IndNN_A },
-    { 0xD4, nullptr }, // ei_call_NC_NN, // 0xD4
-    { 0xD5, nullptr }, // ei_push_DE,
-    { 0xD6, nullptr }, // ei_sub_N,
-    { 0xD7, nullptr }, // ei_rst_10,
-    { 0xD8, nullptr }, // ei_ret_C, // 0xD8
-    { 0xD9, nullptr }, // ei_exx,
-    { 0xDA, nullptr }, // ei_jp_C_NN,
-    { 0xDB, nullptr }, // ei_in_A_iN,
-    { 0xDC, nullptr }, // ei_call_C_NN, // 0xDC
-    { 0xDD, nullptr }, // Mi_dd, // 0xDD
-    { 0xDE, nullptr }, // ei_sbc_A_N,
-    { 0xDF, nullptr }, // ei_rst_18,
-    { 0xE0, nullptr }, // ei_ret_PO, // 0xE0
-    { 0xE1, nullptr }, // ei_pop_HL,
-    { 0xE2, nullptr }, // ei_jp_PO_NN,
-    { 0xE3, nullptr }, // ei_ex_iSP_HL,
-    { 0xE4, nullptr }, // ei_call_PO_NN, // 0xE4
-    { 0xE5, nullptr }, // ei_push_HL,
-    { 0xE6, nullptr }, // ei_and_N,
-    { 0xE7, nullptr }, // ei_rst_20,
-    { 0xE8, nullptr }, // ei_ret_PE, // 0xE8
-    { 0xE9, nullptr }, // ei_jp_HL,
-    { 0xEA, nullptr }, // ei_jp_PE_NN,
-    { 0xEB, nullptr }, // ei_ex_DE_HL,
-    { 0xEC, nullptr }, // ei_call_PE_NN,// 0xEC
-    { 0xED, nullptr }, // 0, // 0xED
-    { 0xEE, nullptr }, // ei_xor_N,
-    { 0xEF, nullptr }, // ei_rst_28,
-    { 0xF0, nullptr }, // ei_ret_P, // 0xF0
-    { 0xF1, nullptr }, // ei_pop_AF,
-    { 0xF2, nullptr }, // ei_jp_P_NN,
-    { 0xF3, HandlOpcodeDI },
-    { 0xF4, nullptr }, // ei_call_P_NN, // 0xF4
-    { 0xF5, nullptr }, // ei_push_AF,
-    { 0xF6, nullptr }, // ei_or_N,
-    { 0xF7, nullptr }, // ei_rst_30,
-    { 0xF8, nullptr }, // ei_ret_M, // 0xF8
-    { 0xF9, nullptr }, // ei_ld_SP_HL,
-    { 0xFA, nullptr }, // ei_jp_M_NN,
-    { 0xFB, nullptr }, // ei_ei,
-    { 0xFC, nullptr }, // ei_call_M_NN, // 0xFC
-    { 0xFD, nullptr }, // Mi_fd, // 0xFD
-    { 0xFE, nullptr }, // ei_cp_N,
-    { 0xFF, nullptr }, // ei_rst_38
-};
-#pragma warning(default: 4365)
-#pragma warning(default: 4242)
-#pragma warning(default: 4244)
-
-Z80 *Z80::m_instance{};
-
-Z80::Z80(uint64_t clockFreq)
-    : m_cpuFreq{ clockFreq }
-    , m_registers{}
-    , m_memory{ 65535u }
-    , m_rom{ m_memory, 0, 16384 }
-    , m_ram{ m_memory, 16384, 49152 }
-    , m_memoryMap{ 
-        MemoryMappingSet<uint16_t>{ 
-                { m_memory, m_rom.StartAddress(), m_rom.EndAddress() }, 
-                { m_memory, m_ram.StartAddress(), m_ram.EndAddress()  }
-            }
-        }
-    , m_videoBorder{}
-    , m_ioMap{ 
-        IOMappingSet<uint8_t>{ 
-                { m_videoBorder, 0xFE, 0xFE }
-            }
-        }
-    , m_opcode{}
-    , m_disassembler{ m_memory }
-    , m_cpuClock{}
+void Z80::RequestInterrupt(uint64_t activeTStates)
 {
-    m_instance = this;
+    m_registers.IntPending = true;
+    m_interruptEndClock = m_cpuClock + activeTStates;
 }
 
-Z80 *Z80::GetInstance()
+void Z80::RequestNMI()
 {
-    return m_instance;
+    m_registers.NMIPending = true;
 }
 
-bool Z80::Init()
+void Z80::SetBreakpoint(uint64_t address)
 {
-    return true;
+    m_breakpoints.set(static_cast<std::size_t>(address & 0xFFFF));
+    m_haveBreakpoints = true;
+    // Blocks end at breakpoints, the ones decoded before may run past this one
+    FlushCodeCaches();
 }
 
-void Z80::Reset()
+void Z80::SetExecutionMode(ExecutionMode mode)
 {
-    m_registers.Reset();
-    m_cpuClock = {};
+    m_executionMode = mode;
+    FlushCodeCaches();
 }
 
-bool Z80::IsHalted()
+void Z80::ClearBreakpoint(uint64_t address)
 {
-    return false;
+    m_breakpoints.reset(static_cast<std::size_t>(address & 0xFFFF));
+    m_haveBreakpoints = m_breakpoints.any();
 }
 
-std::string Z80::DumpRegisters()
+void Z80::ExecutePrefixCB(Z80 &cpu)
 {
-    return m_registers.Dump();
+    uint8_t opcode = cpu.ReadOpcodeByte();
+    cpu.Dispatch(OpcodePrefix::CB, opcode);
 }
 
-bool Z80::LoadROM(const ByteVector &romContents)
+void Z80::ExecutePrefixED(Z80 &cpu)
 {
-    if (romContents.size() > m_rom.Size())
-        return false;
-    m_memory.Load(m_rom.StartAddress(), std::min(m_rom.Size(), static_cast<uint16_t>(romContents.size())), romContents);
-    return true;
+    uint8_t opcode = cpu.ReadOpcodeByte();
+    cpu.Dispatch(OpcodePrefix::ED, opcode);
 }
 
-bool Z80::ExecuteInstruction()
+void Z80::ExecutePrefixDD(Z80 &cpu)
 {
-    m_opcode = ReadOpcodeByte();
-    if (m_registers.Modifier == 0)
-    {
-        if (OpcodeLookup.at(m_opcode) != nullptr)
-        {
-            OpcodeLookup.at(m_opcode)();
-            return true;
-        }
-        else
-        {
-            TRACE_FATAL("Cannot decode instruction");
-        }
-        return false;
-    }
-    return false;
+    uint8_t opcode = cpu.ReadOpcodeByte();
+    cpu.Dispatch(OpcodePrefix::DD, opcode);
 }
 
-bool Z80::Disassemble(std::string &mnemonic)
+void Z80::ExecutePrefixFD(Z80 &cpu)
 {
-    uint8_t instructionSize{};
-    bool result = m_disassembler.DisassembleInstruction(m_registers.PC, instructionSize, mnemonic);
-    if (!result)
-        TRACE_ERROR("Cannot disassemble instruction");
-    return result;
+    uint8_t opcode = cpu.ReadOpcodeByte();
+    cpu.Dispatch(OpcodePrefix::FD, opcode);
 }
 
-void Z80::IncrementCPUClock(uint8_t increment)
+void Z80::ExecutePrefixDDCB(Z80 &cpu)
 {
-    m_cpuClock += increment;
+    // DD CB d op: the displacement precedes the opcode, and the opcode is not an M1 fetch. The address is calculated
+    // while the opcode is on the bus
+    cpu.m_displacement = static_cast<int8_t>(cpu.ReadByte());
+    cpu.m_opcode = cpu.ReadByte();
+    cpu.InternalCycles(static_cast<uint16_t>(cpu.m_registers.PC - 1), 2);
+    cpu.Dispatch(OpcodePrefix::DDCB, cpu.m_opcode);
 }
 
-uint8_t Z80::ReadOpcodeByte()
+void Z80::ExecutePrefixFDCB(Z80 &cpu)
 {
-    return ReadByte();
+    cpu.m_displacement = static_cast<int8_t>(cpu.ReadByte());
+    cpu.m_opcode = cpu.ReadByte();
+    cpu.InternalCycles(static_cast<uint16_t>(cpu.m_registers.PC - 1), 2);
+    cpu.Dispatch(OpcodePrefix::FDCB, cpu.m_opcode);
 }
 
-uint8_t Z80::ReadByte()
+void Z80::InvalidOpcode()
 {
-    uint8_t byte{};
-    m_memoryMap.Read8(m_registers.PC, byte);
-    m_registers.PC++;
-    return byte;
+    m_decodeError = true;
+    TRACE_FATAL("Cannot decode instruction");
 }
 
-uint16_t Z80::ReadWord()
+bool Z80::Disassemble(std::string &mnemonic)
 {
-    uint16_t word{};
-    m_memoryMap.Read16(m_registers.PC, word);
-    m_registers.PC += 2;
-    return word;
+    uint8_t instructionSize{};
+    bool result = m_disassembler.DisassembleInstruction(m_registers.PC, instructionSize, mnemonic);
+    if (!result)
+        TRACE_ERROR("Cannot disassemble instruction");
+    return result;
 }
 
-void Z80::Out(uint8_t port, uint8_t value)
+// Devices see the clock at the start of the I/O cycle, after the contention
+void Z80::Out(uint16_t port, uint8_t value)
 {
+    if (m_contention != nullptr)
+        m_contention->OnIOAccess(port, m_memoryMap.IsContended(PagedMemoryMap::PageIndex(port)));
     m_ioMap.Write8(port, value);
+    m_cpuClock += IOCycleTStates;
+}
+
+uint8_t Z80::In(uint16_t port)
+{
+    if (m_contention != nullptr)
+        m_contention->OnIOAccess(port, m_memoryMap.IsContended(PagedMemoryMap::PageIndex(port)));
+    uint8_t value{};
+    m_ioMap.Read8(port, value);
+    m_cpuClock += IOCycleTStates;
+    return value;
 }
 
 uint64_t Z80::GetCPUClock()
@@ -567,7 +679,3 @@ uint64_t Z80::GetCPUClockFreq()
     return m_cpuFreq;
 }
 
-uint8_t Z80::GetOpcode()
-{
-    return m_opcode;
-}
@@ -0,0 +1,39 @@
+#include "Model/Z80BlockCache.h"
+
+#include <algorithm>
+
+Z80BlockCache::Z80BlockCache()
+    : m_blockIndex(65536, NoBlock)
+    , m_blocks{}
+    , m_instructions{}
+{
+}
+
+void Z80BlockCache::Flush()
+{
+    std::fill(m_blockIndex.begin(), m_blockIndex.end(), NoBlock);
+    m_blocks.clear();
+    m_instructions.clear();
+}
+
+Z80DecodedBlock *Z80BlockCache::Add(uint16_t address, const Z80DecodedBlock &block, const std::vector<Z80DecodedInstruction> &instructions,
+    const PagedMemoryMap &memoryMap)
+{
+    if (m_instructions.size() + instructions.size() > MaxInstructions)
+        Flush();
+    Z80DecodedBlock newBlock{ block };
+    newBlock.Address = address;
+    newBlock.FirstInstruction = static_cast<uint32_t>(m_instructions.size());
+    newBlock.InstructionCount = static_cast<uint32_t>(instructions.size());
+    newBlock.MaxTStates = 0;
+    for (const auto &instruction : instructions)
+        newBlock.MaxTStates += instruction.PrefixTStates + MaxInstructionTStates;
+    newBlock.FirstPageGeneration = memoryMap.WriteGeneration(block.FirstPage);
+    newBlock.LastPageGeneration = memoryMap.WriteGeneration(block.LastPage);
+    newBlock.ExecutionCount = 0;
+    newBlock.NativeCode = nullptr;
+    m_instructions.insert(m_instructions.end(), instructions.begin(), instructions.end());
+    m_blockIndex[address] = static_cast<int32_t>(m_blocks.size());
+    m_blocks.push_back(newBlock);
+    return &m_blocks.back();
+}
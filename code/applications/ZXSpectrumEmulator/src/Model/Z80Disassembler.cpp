@@ -4,7 +4,7 @@
 
 #include "tracing/Tracing.h"
 #include "Model/Memory.h"
-#include "Utility/Serialization.h"
+#include "utility/Serialization.h"
 
 enum class InstructionName
 {
@@ -278,7 +278,7 @@ enum class InstructionPrefixEDCB
     CB,
 };
 
-using OperandFunction = std::function<std::string ()>;
+using OperandFunction = std::function<std::string (Z80Disassembler &)>;
 using OperatorTypeLookup = std::map<OperatorType, OperandFunction>;
 
 struct InstructionDefinition
@@ -294,57 +294,54 @@ using LookupTable2 = std::map<InstructionPrefixEDCB, const InstructionTable>;
 using LookupTable = std::map<InstructionPrefixDDFD, LookupTable2>;
 
 
-std::string HandleOperatorTypeTrivial()
+std::string HandleOperatorTypeTrivial(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
 
-std::string HandleOperatorTypeDirect8Bit()
+std::string HandleOperatorTypeDirect8Bit(Z80Disassembler &disassembler)
 {
-    auto instance = Z80Disassembler::GetInstance();
-    uint8_t byte = instance->GetInstructionByte();
+    uint8_t byte = disassembler.GetInstructionByte();
     return serialization::Serialize(byte, 2, 16);
 }
 
-std::string HandleOperatorTypeDirect16Bit()
+std::string HandleOperatorTypeDirect16Bit(Z80Disassembler &disassembler)
 {
-    auto instance = Z80Disassembler::GetInstance();
-    uint8_t lowByte = instance->GetInstructionByte();
-    uint8_t highByte = instance->GetInstructionByte();
+    uint8_t lowByte = disassembler.GetInstructionByte();
+    uint8_t highByte = disassembler.GetInstructionByte();
     uint16_t word = static_cast<uint16_t>(lowByte | (highByte << 8));
     return serialization::Serialize(word, 4, 16);
 }
 
-std::string HandleOperatorTypeAddress()
+std::string HandleOperatorTypeAddress(Z80Disassembler &disassembler)
 {
-    auto instance = Z80Disassembler::GetInstance();
-    uint8_t lowByte = instance->GetInstructionByte();
-    uint8_t highByte = instance->GetInstructionByte();
+    uint8_t lowByte = disassembler.GetInstructionByte();
+    uint8_t highByte = disassembler.GetInstructionByte();
     uint16_t word = static_cast<uint16_t>(lowByte | (highByte << 8));
     return serialization::Serialize(word, 4, 16);
 }
 
-std::string HandleOperatorTypeIndirect()
+std::string HandleOperatorTypeIndirect(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
 
-std::string HandleOperatorTypePCRelativeAddress()
+std::string HandleOperatorTypePCRelativeAddress(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
 
-std::string HandleOperatorTypeRestartAddress()
+std::string HandleOperatorTypeRestartAddress(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
 
-std::string HandleOperatorTypeIndirect8BitDisplacement()
+std::string HandleOperatorTypeIndirect8BitDisplacement(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
 
-std::string HandleOperatorTypePrefixedIndirect()
+std::string HandleOperatorTypePrefixedIndirect(Z80Disassembler & /*disassembler*/)
 {
     return {};
 }
@@ -633,7 +630,7 @@ static const InstructionTable OperatorsPrefixDDCB = {
 static const InstructionTable OperatorsPrefixFDCB = {
 };
 
-static LookupTable DisassemblyTable = {
+static const LookupTable DisassemblyTable = {
     { InstructionPrefixDDFD::None, {
         { InstructionPrefixEDCB::None, OperatorsStandard },
         { InstructionPrefixEDCB::ED, OperatorsPrefixED },
@@ -651,19 +648,11 @@ static LookupTable DisassemblyTable = {
     } },
 };
 
-Z80Disassembler *Z80Disassembler::m_instance{};
-
-Z80Disassembler::Z80Disassembler(MemorySpace& memory)
+Z80Disassembler::Z80Disassembler(PagedMemoryMap& memory)
     : m_memory{ memory }
     , m_instructionOrigin{}
     , m_currentLocation{}
 {
-    m_instance = this;
-}
-
-Z80Disassembler *Z80Disassembler::GetInstance()
-{
-    return m_instance;
 }
     
 bool Z80Disassembler::DisassembleInstruction(uint16_t address, uint8_t instructionSize, std::string &mnemonic)
@@ -709,7 +698,7 @@ bool Z80Disassembler::DecodeInstruction(std::string &mnemonic)
         displacement = opcode;
         opcode = GetInstructionByte();
     }
-    auto instructionTable = DisassemblyTable[prefixDDFD][prefixEDCB];
+    const auto &instructionTable = DisassemblyTable.at(prefixDDFD).at(prefixEDCB);
     if (instructionTable.size() < opcode)
     {
         TRACE_ERROR("Cannot lookup opcode, table not complete");
@@ -725,7 +714,7 @@ bool Z80Disassembler::DecodeInstruction(std::string &mnemonic)
 uint8_t Z80Disassembler::GetInstructionByte()
 {
     uint8_t value{};
-    m_memory.Read8(m_currentLocation++, value);
+    m_memory.Peek8(m_currentLocation++, value);
     return value;
 }
 
@@ -739,7 +728,7 @@ std::string Z80Disassembler::SerializeOperand(const InstructionDefinition &def,
         const char *pattern = "$";
         if (operandStr.find(pattern) != std::string::npos)
         {
-            operandStr.replace(operandStr.find(pattern) + 1, strlen(pattern) - 1, OperatorTypeHandlerLookup.at(def.operatorType)());
+            operandStr.replace(operandStr.find(pattern) + 1, strlen(pattern) - 1, OperatorTypeHandlerLookup.at(def.operatorType)(*this));
         }
         str = operandStr;
     }
@@ -0,0 +1,1860 @@
+#include "Model/Z80.h"
+
+#include <utility>
+#include "Model/Z80Flags.h"
+
+// The instruction set is written as handler templates, parameterized on the operand fields of the opcode. The
+// dispatch tables are generated at compile time by decoding every opcode into its template instance, so each handler
+// has its registers, condition or bit number as constants.
+//
+// Decoding follows the usual split of the opcode: x = bits 7-6, y = bits 5-3, z = bits 2-0, p = bits 5-4, q = bit 3.
+//
+// Timing: the opcode fetches, operand reads and data accesses advance the clock in the bus helpers of Z80, the
+// handlers add the internal T-states in between, at the point of the instruction where they occur. So each bus cycle
+// starts at its exact T-state, and contention is applied there. Internal T-states that put an address on the bus
+// (IR, PC, HL, SP, ...) are contended like memory cycles.
+
+// Which register pair stands in for HL: none, DD or FD prefix
+enum class IndexMode
+{
+    HL,
+    IX,
+    IY,
+};
+
+template <IndexMode Mode>
+static uint16_t &IndexPair(Z80Registers &regs)
+{
+    if constexpr (Mode == IndexMode::IX)
+        return regs.IX;
+    else if constexpr (Mode == IndexMode::IY)
+        return regs.IY;
+    else
+        return regs.Pair[RegisterPairIndex::HL];
+}
+
+// r-field operand. With a DD / FD prefix, H and L are replaced by the high and low half of the index register
+template <IndexMode Mode, uint8_t Field>
+static uint8_t &Register8(Z80Registers &regs)
+{
+    if constexpr ((Mode != IndexMode::HL) && (Field == 4))
+        return reinterpret_cast<uint8_t *>(&IndexPair<Mode>(regs))[PairHighByte];
+    else if constexpr ((Mode != IndexMode::HL) && (Field == 5))
+        return reinterpret_cast<uint8_t *>(&IndexPair<Mode>(regs))[PairLowByte];
+    else
+        return regs.Reg[RegisterFieldOffset[Field]];
+}
+
+// rp-field operand: BC, DE, HL, SP
+template <IndexMode Mode, uint8_t P>
+static uint16_t &RegisterPair(Z80Registers &regs)
+{
+    if constexpr (P == 0)
+        return regs.Pair[RegisterPairIndex::BC];
+    else if constexpr (P == 1)
+        return regs.Pair[RegisterPairIndex::DE];
+    else if constexpr (P == 2)
+        return IndexPair<Mode>(regs);
+    else
+        return regs.SP;
+}
+
+// rp2-field operand (PUSH / POP): BC, DE, HL, AF
+template <IndexMode Mode, uint8_t P>
+static uint16_t &RegisterPairAF(Z80Registers &regs)
+{
+    if constexpr (P == 3)
+        return regs.Pair[RegisterPairIndex::AF];
+    else
+        return RegisterPair<Mode, P>(regs);
+}
+
+// Address of the (HL) / (IX+d) / (IY+d) operand. The indexed forms read the displacement, and calculate the address in
+// 5 T-states with the displacement still on the bus
+template <IndexMode Mode>
+static uint16_t MemoryOperandAddress(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    if constexpr (Mode == IndexMode::HL)
+    {
+        return regs.GetHL();
+    }
+    else
+    {
+        auto displacement = static_cast<int8_t>(cpu.ReadByte());
+        cpu.InternalCycles(static_cast<uint16_t>(regs.PC - 1), 5);
+        return static_cast<uint16_t>(IndexPair<Mode>(regs) + displacement);
+    }
+}
+
+// Indexed memory operands take 8 more T-states for the displacement fetch and address calculation
+template <IndexMode Mode>
+constexpr uint8_t IndexedMemoryExtra = (Mode == IndexMode::HL) ? 0 : 8;
+
+// Address on the bus during internal T-states that do not use another one
+static uint16_t IRAddress(const Z80Registers &regs)
+{
+    return static_cast<uint16_t>((regs.I << 8) | regs.R);
+}
+
+// cc-field: NZ, Z, NC, C, PO, PE, P, M
+template <uint8_t Condition>
+static bool TestCondition(const Z80Registers &regs)
+{
+    constexpr uint8_t ConditionFlags[4] = { flagZ, flagC, flagPV, flagS };
+    bool isSet = (regs.F() & ConditionFlags[Condition >> 1]) != 0;
+    return (Condition & 1) ? isSet : !isSet;
+}
+
+// alu-field: ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+template <uint8_t Operation>
+static void Alu(Z80Registers &regs, uint8_t value)
+{
+    if constexpr (Operation == 0)
+        regs.Add8(value);
+    else if constexpr (Operation == 1)
+        regs.Adc8(value);
+    else if constexpr (Operation == 2)
+        regs.Sub8(value);
+    else if constexpr (Operation == 3)
+        regs.Sbc8(value);
+    else if constexpr (Operation == 4)
+        regs.And8(value);
+    else if constexpr (Operation == 5)
+        regs.Xor8(value);
+    else if constexpr (Operation == 6)
+        regs.Or8(value);
+    else
+        regs.Cp8(value);
+}
+
+// rot-field: RLC, RRC, RL, RR, SLA, SRA, SLL, SRL
+template <uint8_t Operation>
+static uint8_t Rotate(Z80Registers &regs, uint8_t value)
+{
+    if constexpr (Operation == 0)
+        return regs.Rlc(value);
+    else if constexpr (Operation == 1)
+        return regs.Rrc(value);
+    else if constexpr (Operation == 2)
+        return regs.Rl(value);
+    else if constexpr (Operation == 3)
+        return regs.Rr(value);
+    else if constexpr (Operation == 4)
+        return regs.Sla(value);
+    else if constexpr (Operation == 5)
+        return regs.Sra(value);
+    else if constexpr (Operation == 6)
+        return regs.Sll(value);
+    else
+        return regs.Srl(value);
+}
+
+static void HandleOpcodeInvalid(Z80 &cpu)
+{
+    cpu.InvalidOpcode();
+}
+
+static void HandlOpcodeNOP(Z80 & /*cpu*/)
+{
+}
+
+// 8 bit loads
+
+template <IndexMode Mode, uint8_t Destination, uint8_t Source>
+static void HandleOpcodeLD_r_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Register8<Mode, Destination>(regs) = Register8<Mode, Source>(regs);
+}
+
+template <IndexMode Mode, uint8_t Destination>
+static void HandleOpcodeLD_r_NN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Register8<Mode, Destination>(regs) = cpu.ReadByte();
+}
+
+// LD r,(HL) / LD r,(IX+d): the register operand is never replaced by an index register half
+template <IndexMode Mode, uint8_t Destination>
+static void HandleOpcodeLD_r_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = MemoryOperandAddress<Mode>(cpu);
+    Register8<IndexMode::HL, Destination>(regs) = cpu.ReadMemory(address);
+}
+
+template <IndexMode Mode, uint8_t Source>
+static void HandleOpcodeLD_IndHL_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = MemoryOperandAddress<Mode>(cpu);
+    cpu.WriteMemory(address, Register8<IndexMode::HL, Source>(regs));
+}
+
+// The displacement precedes the immediate operand, the address is calculated while the immediate is on the bus
+template <IndexMode Mode>
+static void HandleOpcodeLD_IndHL_NN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    if constexpr (Mode == IndexMode::HL)
+    {
+        uint8_t value = cpu.ReadByte();
+        cpu.WriteMemory(regs.GetHL(), value);
+    }
+    else
+    {
+        auto displacement = static_cast<int8_t>(cpu.ReadByte());
+        uint8_t value = cpu.ReadByte();
+        cpu.InternalCycles(static_cast<uint16_t>(regs.PC - 1), 2);
+        cpu.WriteMemory(static_cast<uint16_t>(IndexPair<Mode>(regs) + displacement), value);
+    }
+}
+
+// LD (BC),A / LD (DE),A
+template <uint8_t P>
+static void HandleOpcodeLD_IndRR_A(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.WriteMemory(RegisterPair<IndexMode::HL, P>(regs), regs.Reg[RegisterIndex::A]);
+}
+
+// LD A,(BC) / LD A,(DE)
+template <uint8_t P>
+static void HandleOpcodeLD_A_IndRR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Reg[RegisterIndex::A] = cpu.ReadMemory(RegisterPair<IndexMode::HL, P>(regs));
+}
+
+static void HandleOpcodeLD_IndNNNN_A(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.WriteMemory(cpu.ReadWord(), regs.Reg[RegisterIndex::A]);
+}
+
+static void HandleOpcodeLD_A_IndNNNN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Reg[RegisterIndex::A] = cpu.ReadMemory(cpu.ReadWord());
+}
+
+// 16 bit loads
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeLD_RR_NNNN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    RegisterPair<Mode, P>(regs) = cpu.ReadWord();
+}
+
+// LD (nn),HL and the ED prefixed LD (nn),rr
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeLD_IndNNNN_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.WriteMemoryWord(cpu.ReadWord(), RegisterPair<Mode, P>(regs));
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeLD_RR_IndNNNN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    RegisterPair<Mode, P>(regs) = cpu.ReadMemoryWord(cpu.ReadWord());
+}
+
+template <IndexMode Mode>
+static void HandleOpcodeLD_SP_HL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 2);
+    regs.SP = IndexPair<Mode>(regs);
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodePUSH_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    cpu.Push(RegisterPairAF<Mode, P>(regs));
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodePOP_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    RegisterPairAF<Mode, P>(regs) = cpu.Pop();
+}
+
+// Exchanges
+
+static void HandleOpcodeEX_AF_AF_(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    std::swap(regs.Pair[RegisterPairIndex::AF], regs.Pair_[RegisterPairIndex::AF]);
+}
+
+static void HandleOpcodeEXX(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    std::swap(regs.Pair[RegisterPairIndex::BC], regs.Pair_[RegisterPairIndex::BC]);
+    std::swap(regs.Pair[RegisterPairIndex::DE], regs.Pair_[RegisterPairIndex::DE]);
+    std::swap(regs.Pair[RegisterPairIndex::HL], regs.Pair_[RegisterPairIndex::HL]);
+}
+
+// EX DE,HL is not affected by a DD / FD prefix
+static void HandleOpcodeEX_DE_HL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    std::swap(regs.Pair[RegisterPairIndex::DE], regs.Pair[RegisterPairIndex::HL]);
+}
+
+// The high byte is written first, as for a push
+template <IndexMode Mode>
+static void HandleOpcodeEX_IndSP_HL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    const auto high = static_cast<uint16_t>(regs.SP + 1);
+    uint16_t value = cpu.ReadMemoryWord(regs.SP);
+    cpu.InternalCycles(high, 1);
+    uint16_t &pair = IndexPair<Mode>(regs);
+    cpu.WriteMemory(high, static_cast<uint8_t>(pair >> 8));
+    cpu.WriteMemory(regs.SP, static_cast<uint8_t>(pair & 0xFF));
+    cpu.InternalCycles(regs.SP, 2);
+    pair = value;
+}
+
+// 8 bit arithmetic and logic
+
+template <IndexMode Mode, uint8_t Operation, uint8_t Source>
+static void HandleOpcodeALU_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Alu<Operation>(regs, Register8<Mode, Source>(regs));
+}
+
+template <IndexMode Mode, uint8_t Operation>
+static void HandleOpcodeALU_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = MemoryOperandAddress<Mode>(cpu);
+    Alu<Operation>(regs, cpu.ReadMemory(address));
+}
+
+template <uint8_t Operation>
+static void HandleOpcodeALU_NN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Alu<Operation>(regs, cpu.ReadByte());
+}
+
+template <IndexMode Mode, uint8_t Field>
+static void HandleOpcodeINC_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t &reg = Register8<Mode, Field>(regs);
+    reg = regs.Inc8(reg);
+}
+
+template <IndexMode Mode, uint8_t Field>
+static void HandleOpcodeDEC_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t &reg = Register8<Mode, Field>(regs);
+    reg = regs.Dec8(reg);
+}
+
+template <IndexMode Mode>
+static void HandleOpcodeINC_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = MemoryOperandAddress<Mode>(cpu);
+    uint8_t value = regs.Inc8(cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+template <IndexMode Mode>
+static void HandleOpcodeDEC_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = MemoryOperandAddress<Mode>(cpu);
+    uint8_t value = regs.Dec8(cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+static void HandleOpcodeRLCA(Z80 &cpu)
+{
+    cpu.GetRegisters().Rlca();
+}
+
+static void HandleOpcodeRRCA(Z80 &cpu)
+{
+    cpu.GetRegisters().Rrca();
+}
+
+static void HandleOpcodeRLA(Z80 &cpu)
+{
+    cpu.GetRegisters().Rla();
+}
+
+static void HandleOpcodeRRA(Z80 &cpu)
+{
+    cpu.GetRegisters().Rra();
+}
+
+static void HandleOpcodeDAA(Z80 &cpu)
+{
+    cpu.GetRegisters().Daa();
+}
+
+static void HandleOpcodeCPL(Z80 &cpu)
+{
+    cpu.GetRegisters().Cpl();
+}
+
+static void HandleOpcodeSCF(Z80 &cpu)
+{
+    cpu.GetRegisters().Scf();
+}
+
+static void HandleOpcodeCCF(Z80 &cpu)
+{
+    cpu.GetRegisters().Ccf();
+}
+
+// 16 bit arithmetic
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeADD_HL_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &destination = IndexPair<Mode>(regs);
+    destination = regs.Add16(destination, RegisterPair<Mode, P>(regs));
+    cpu.InternalCycles(IRAddress(regs), 7);
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeINC_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &reg = RegisterPair<Mode, P>(regs);
+    reg = static_cast<uint16_t>(reg + 1);
+    cpu.InternalCycles(IRAddress(regs), 2);
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleOpcodeDEC_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &reg = RegisterPair<Mode, P>(regs);
+    reg = static_cast<uint16_t>(reg - 1);
+    cpu.InternalCycles(IRAddress(regs), 2);
+}
+
+template <uint8_t P>
+static void HandleOpcodeADC_HL_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Adc16(RegisterPair<IndexMode::HL, P>(regs));
+    cpu.InternalCycles(IRAddress(regs), 7);
+}
+
+template <uint8_t P>
+static void HandleOpcodeSBC_HL_RR(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Sbc16(RegisterPair<IndexMode::HL, P>(regs));
+    cpu.InternalCycles(IRAddress(regs), 7);
+}
+
+// Jumps, calls and returns
+
+static void HandleOpcodeJP_NNNN(Z80 &cpu)
+{
+    uint16_t address = cpu.ReadWord();
+    auto &regs = cpu.GetRegisters();
+    regs.SetPC(address);
+}
+
+template <uint8_t Condition>
+static void HandleOpcodeJP_cc_NNNN(Z80 &cpu)
+{
+    uint16_t address = cpu.ReadWord();
+    auto &regs = cpu.GetRegisters();
+    if (TestCondition<Condition>(regs))
+        regs.SetPC(address);
+}
+
+template <IndexMode Mode>
+static void HandleOpcodeJP_HL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.SetPC(IndexPair<Mode>(regs));
+}
+
+// A relative jump taken adds 5 T-states with the displacement still on the bus
+static void RelativeJump(Z80 &cpu, int8_t displacement)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(static_cast<uint16_t>(regs.PC - 1), 5);
+    regs.SetPC(static_cast<uint16_t>(regs.PC + displacement));
+}
+
+static void HandleOpcodeJR(Z80 &cpu)
+{
+    RelativeJump(cpu, static_cast<int8_t>(cpu.ReadByte()));
+}
+
+// JR NZ / Z / NC / C only
+template <uint8_t Condition>
+static void HandleOpcodeJR_cc(Z80 &cpu)
+{
+    auto displacement = static_cast<int8_t>(cpu.ReadByte());
+    if (TestCondition<Condition>(cpu.GetRegisters()))
+        RelativeJump(cpu, displacement);
+}
+
+static void HandleOpcodeDJNZ(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    auto displacement = static_cast<int8_t>(cpu.ReadByte());
+    if (--regs.Reg[RegisterIndex::B] != 0)
+        RelativeJump(cpu, displacement);
+}
+
+// The return address is pushed after one more T-state with the high byte of the target on the bus
+static void Call(Z80 &cpu, uint16_t address)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(static_cast<uint16_t>(regs.PC - 1), 1);
+    cpu.Push(regs.PC);
+    regs.SetPC(address);
+}
+
+static void HandleOpcodeCALL_NNNN(Z80 &cpu)
+{
+    Call(cpu, cpu.ReadWord());
+}
+
+template <uint8_t Condition>
+static void HandleOpcodeCALL_cc_NNNN(Z80 &cpu)
+{
+    uint16_t address = cpu.ReadWord();
+    if (TestCondition<Condition>(cpu.GetRegisters()))
+        Call(cpu, address);
+}
+
+static void HandleOpcodeRET(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.SetPC(cpu.Pop());
+}
+
+template <uint8_t Condition>
+static void HandleOpcodeRET_cc(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    if (TestCondition<Condition>(regs))
+        regs.SetPC(cpu.Pop());
+}
+
+template <uint16_t Address>
+static void HandleOpcodeRST(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    cpu.Push(regs.PC);
+    regs.SetPC(Address);
+}
+
+// Input and output
+
+static void HandleOpcodeOUT_IndNN_A(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t operand = cpu.ReadByte();
+    // A is put on the upper half of the address bus
+    cpu.Out(static_cast<uint16_t>((regs.Reg[RegisterIndex::A] << 8) | operand), regs.Reg[RegisterIndex::A]);
+}
+
+static void HandleOpcodeIN_A_IndNN(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t operand = cpu.ReadByte();
+    regs.Reg[RegisterIndex::A] = cpu.In(static_cast<uint16_t>((regs.Reg[RegisterIndex::A] << 8) | operand));
+}
+
+// IN r,(C). Field 6 is the undocumented IN F,(C), which only sets the flags
+template <uint8_t Field>
+static void HandleOpcodeIN_r_IndC(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t value = cpu.In(regs.GetBC());
+    if constexpr (Field != 6)
+        Register8<IndexMode::HL, Field>(regs) = value;
+    regs.F() = static_cast<uint8_t>((regs.F() & flagC) | FlagTables.SZ53P[value]);
+}
+
+// OUT (C),r. Field 6 is the undocumented OUT (C),0
+template <uint8_t Field>
+static void HandleOpcodeOUT_IndC_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    if constexpr (Field != 6)
+        cpu.Out(regs.GetBC(), Register8<IndexMode::HL, Field>(regs));
+    else
+        cpu.Out(regs.GetBC(), 0);
+}
+
+// CPU control
+
+static void HandlOpcodeDI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.IFF1 = regs.IFF2 = false;
+    regs.IntLock = true;
+}
+
+static void HandleOpcodeEI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.IFF1 = regs.IFF2 = true;
+    // Interrupts are only accepted after the next instruction
+    regs.IntLock = true;
+}
+
+static void HandleOpcodeHALT(Z80 &cpu)
+{
+    // PC stays on the instruction following HALT, the CPU executes NOPs until an interrupt arrives
+    auto &regs = cpu.GetRegisters();
+    regs.Halted = true;
+}
+
+template <uint8_t InterruptMode>
+static void HandleOpcodeIM(Z80 &cpu)
+{
+    cpu.GetRegisters().IntMode = InterruptMode;
+}
+
+static void HandleOpcodeRETN(Z80 &cpu)
+{
+    // RETI behaves the same as RETN on the Z80 itself, only peripherals decode it differently
+    auto &regs = cpu.GetRegisters();
+    regs.IFF1 = regs.IFF2;
+    regs.SetPC(cpu.Pop());
+}
+
+static void HandleOpcodeLD_I_A(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    regs.I = regs.Reg[RegisterIndex::A];
+}
+
+static void HandleOpcodeLD_R_A(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    regs.R = regs.Reg[RegisterIndex::A];
+}
+
+static void HandleOpcodeLD_A_I(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    regs.LoadInterruptRegister(regs.I);
+}
+
+static void HandleOpcodeLD_A_R(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.InternalCycles(IRAddress(regs), 1);
+    regs.LoadInterruptRegister(regs.R);
+}
+
+static void HandleOpcodeNEG(Z80 &cpu)
+{
+    cpu.GetRegisters().Neg();
+}
+
+static void HandleOpcodeRRD(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t &a = regs.Reg[RegisterIndex::A];
+    uint16_t address = regs.GetHL();
+    uint8_t value = cpu.ReadMemory(address);
+    cpu.InternalCycles(address, 4);
+    cpu.WriteMemory(address, static_cast<uint8_t>((a << 4) | (value >> 4)));
+    a = static_cast<uint8_t>((a & 0xF0) | (value & 0x0F));
+    regs.F() = static_cast<uint8_t>((regs.F() & flagC) | FlagTables.SZ53P[a]);
+}
+
+static void HandleOpcodeRLD(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t &a = regs.Reg[RegisterIndex::A];
+    uint16_t address = regs.GetHL();
+    uint8_t value = cpu.ReadMemory(address);
+    cpu.InternalCycles(address, 4);
+    cpu.WriteMemory(address, static_cast<uint8_t>((value << 4) | (a & 0x0F)));
+    a = static_cast<uint8_t>((a & 0xF0) | (value >> 4));
+    regs.F() = static_cast<uint8_t>((regs.F() & flagC) | FlagTables.SZ53P[a]);
+}
+
+// Undefined ED opcodes act as an 8 T-state NOP
+static void HandleOpcodeED_NOP(Z80 & /*cpu*/)
+{
+}
+
+// Block transfer, search and I/O. Step is +1 for the incrementing and -1 for the decrementing variants. Repeating
+// variants rewind PC onto themselves, so they are interruptible between iterations. A repeat takes 5 more T-states,
+// with the last address of the iteration on the bus
+
+template <int Step, bool Repeat>
+static void HandleOpcodeLDI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &bc = regs.Pair[RegisterPairIndex::BC];
+    uint16_t &de = regs.Pair[RegisterPairIndex::DE];
+    uint16_t &hl = regs.Pair[RegisterPairIndex::HL];
+    uint8_t value = cpu.ReadMemory(hl);
+    cpu.WriteMemory(de, value);
+    cpu.InternalCycles(de, 2);
+    --bc;
+    uint8_t n = static_cast<uint8_t>(value + regs.Reg[RegisterIndex::A]);
+    regs.F() = static_cast<uint8_t>((regs.F() & (flagS | flagZ | flagC)) | ((bc != 0) ? flagPV : 0) | (n & flagU1) | ((n & 0x02) ? flagU2 : 0));
+    if (Repeat && (bc != 0))
+    {
+        cpu.InternalCycles(de, 5);
+        regs.SetPC(static_cast<uint16_t>(regs.PC - 2));
+    }
+    hl = static_cast<uint16_t>(hl + Step);
+    de = static_cast<uint16_t>(de + Step);
+}
+
+template <int Step, bool Repeat>
+static void HandleOpcodeCPI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &bc = regs.Pair[RegisterPairIndex::BC];
+    uint16_t &hl = regs.Pair[RegisterPairIndex::HL];
+    uint8_t a = regs.Reg[RegisterIndex::A];
+    uint8_t value = cpu.ReadMemory(hl);
+    cpu.InternalCycles(hl, 5);
+    uint8_t result = static_cast<uint8_t>(a - value);
+    uint8_t halfCarry = FlagTables.HalfCarrySub[Z80FlagTables::Index(a, value, result) & 0x07];
+    --bc;
+    uint8_t n = static_cast<uint8_t>(result - (halfCarry ? 1 : 0));
+    regs.F() = static_cast<uint8_t>((regs.F() & flagC) | flagN | ((bc != 0) ? flagPV : 0) | halfCarry | FlagTables.SZ[result] |
+        (n & flagU1) | ((n & 0x02) ? flagU2 : 0));
+    if (Repeat && (bc != 0) && (result != 0))
+    {
+        cpu.InternalCycles(hl, 5);
+        regs.SetPC(static_cast<uint16_t>(regs.PC - 2));
+    }
+    hl = static_cast<uint16_t>(hl + Step);
+}
+
+template <int Step, bool Repeat>
+static void HandleOpcodeINI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &hl = regs.Pair[RegisterPairIndex::HL];
+    uint8_t &b = regs.Reg[RegisterIndex::B];
+    cpu.InternalCycles(IRAddress(regs), 1);
+    uint8_t value = cpu.In(regs.GetBC());
+    cpu.WriteMemory(hl, value);
+    --b;
+    unsigned k = value + static_cast<uint8_t>(regs.Reg[RegisterIndex::C] + Step);
+    regs.F() = static_cast<uint8_t>(((value & 0x80) ? flagN : 0) | ((k > 0xFF) ? (flagHC | flagC) : 0) |
+        (FlagTables.SZ53P[static_cast<uint8_t>((k & 0x07) ^ b)] & flagPV) | FlagTables.SZ53[b]);
+    if (Repeat && (b != 0))
+    {
+        cpu.InternalCycles(hl, 5);
+        regs.SetPC(static_cast<uint16_t>(regs.PC - 2));
+    }
+    hl = static_cast<uint16_t>(hl + Step);
+}
+
+template <int Step, bool Repeat>
+static void HandleOpcodeOUTI(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t &hl = regs.Pair[RegisterPairIndex::HL];
+    uint8_t &b = regs.Reg[RegisterIndex::B];
+    cpu.InternalCycles(IRAddress(regs), 1);
+    uint8_t value = cpu.ReadMemory(hl);
+    // B is decremented before it is put on the address bus
+    --b;
+    cpu.Out(regs.GetBC(), value);
+    hl = static_cast<uint16_t>(hl + Step);
+    unsigned k = value + regs.Reg[RegisterIndex::L];
+    regs.F() = static_cast<uint8_t>(((value & 0x80) ? flagN : 0) | ((k > 0xFF) ? (flagHC | flagC) : 0) |
+        (FlagTables.SZ53P[static_cast<uint8_t>((k & 0x07) ^ b)] & flagPV) | FlagTables.SZ53[b]);
+    if (Repeat && (b != 0))
+    {
+        cpu.InternalCycles(regs.GetBC(), 5);
+        regs.SetPC(static_cast<uint16_t>(regs.PC - 2));
+    }
+}
+
+// CB prefixed bit instructions
+
+template <uint8_t Operation, uint8_t Field>
+static void HandleOpcodeROT_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint8_t &reg = Register8<IndexMode::HL, Field>(regs);
+    reg = Rotate<Operation>(regs, reg);
+}
+
+template <uint8_t Operation>
+static void HandleOpcodeROT_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = regs.GetHL();
+    uint8_t value = Rotate<Operation>(regs, cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+template <uint8_t Bit, uint8_t Field>
+static void HandleOpcodeBIT_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Bit(Bit, Register8<IndexMode::HL, Field>(regs));
+}
+
+template <uint8_t Bit>
+static void HandleOpcodeBIT_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Bit(Bit, cpu.ReadMemory(regs.GetHL()));
+    cpu.InternalCycles(regs.GetHL(), 1);
+}
+
+template <uint8_t Bit, uint8_t Field>
+static void HandleOpcodeRES_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Register8<IndexMode::HL, Field>(regs) &= static_cast<uint8_t>(~(1 << Bit));
+}
+
+template <uint8_t Bit>
+static void HandleOpcodeRES_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = regs.GetHL();
+    auto value = static_cast<uint8_t>(cpu.ReadMemory(address) & ~(1 << Bit));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+template <uint8_t Bit, uint8_t Field>
+static void HandleOpcodeSET_r(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    Register8<IndexMode::HL, Field>(regs) |= static_cast<uint8_t>(1 << Bit);
+}
+
+template <uint8_t Bit>
+static void HandleOpcodeSET_IndHL(Z80 &cpu)
+{
+    auto &regs = cpu.GetRegisters();
+    uint16_t address = regs.GetHL();
+    auto value = static_cast<uint8_t>(cpu.ReadMemory(address) | (1 << Bit));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+// DD CB / FD CB prefixed bit instructions on (IX+d) / (IY+d). The displacement was read by the prefix dispatcher.
+// Except for BIT, the result is also copied to r when the r-field is not 6 (undocumented). The operand is read, and
+// held on the bus for one more T-state before the result is written
+
+template <IndexMode Mode>
+static uint16_t IndexedBitAddress(Z80 &cpu)
+{
+    return static_cast<uint16_t>(IndexPair<Mode>(cpu.GetRegisters()) + cpu.GetDisplacement());
+}
+
+template <uint8_t Field>
+static void StoreIndexedBitResult(Z80 &cpu, uint16_t address, uint8_t value)
+{
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+    if constexpr (Field != 6)
+        Register8<IndexMode::HL, Field>(cpu.GetRegisters()) = value;
+}
+
+// Shared with the pre-decoded variants, which take the address from the decoded displacement
+template <uint8_t Operation, uint8_t Field>
+static void RotateIndexed(Z80 &cpu, uint16_t address)
+{
+    StoreIndexedBitResult<Field>(cpu, address, Rotate<Operation>(cpu.GetRegisters(), cpu.ReadMemory(address)));
+}
+
+template <uint8_t Bit>
+static void TestIndexedBit(Z80 &cpu, uint16_t address)
+{
+    auto &regs = cpu.GetRegisters();
+    regs.Bit(Bit, cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    // The undocumented flags come from the high byte of the address
+    regs.F() = static_cast<uint8_t>((regs.F() & ~(flagU1 | flagU2)) | ((address >> 8) & (flagU1 | flagU2)));
+}
+
+template <IndexMode Mode, uint8_t Operation, uint8_t Field>
+static void HandleOpcodeROT_IndIndex(Z80 &cpu)
+{
+    RotateIndexed<Operation, Field>(cpu, IndexedBitAddress<Mode>(cpu));
+}
+
+template <IndexMode Mode, uint8_t Bit>
+static void HandleOpcodeBIT_IndIndex(Z80 &cpu)
+{
+    TestIndexedBit<Bit>(cpu, IndexedBitAddress<Mode>(cpu));
+}
+
+template <IndexMode Mode, uint8_t Bit, uint8_t Field>
+static void HandleOpcodeRES_IndIndex(Z80 &cpu)
+{
+    uint16_t address = IndexedBitAddress<Mode>(cpu);
+    StoreIndexedBitResult<Field>(cpu, address, static_cast<uint8_t>(cpu.ReadMemory(address) & ~(1 << Bit)));
+}
+
+template <IndexMode Mode, uint8_t Bit, uint8_t Field>
+static void HandleOpcodeSET_IndIndex(Z80 &cpu)
+{
+    uint16_t address = IndexedBitAddress<Mode>(cpu);
+    StoreIndexedBitResult<Field>(cpu, address, static_cast<uint8_t>(cpu.ReadMemory(address) | (1 << Bit)));
+}
+
+// Pre-decoded variants of the handlers with operands, used by the block cache. Immediate, displacement and T-states
+// come from the decoded instruction, and PC already points past the instruction. Blocks only hold code from pages
+// without contention, so the T-states of the instruction cover its prefixes, the opcode fetch, the operand reads and
+// the internal T-states with PC on the bus up to the first other bus cycle, which the handler goes through as usual
+
+// Runs the normal handler of an opcode without operands, or one that is rare enough to fetch them through PC. The
+// T-states are those of the prefix and opcode fetches
+template <OpcodeHandler Handler>
+static void HandleDecodedFetching(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.GetRegisters().PC = instruction.OperandAddress;
+    cpu.IncrementCPUClock(instruction.TStates);
+    Handler(cpu);
+}
+
+template <OpcodeHandler Handler>
+static void HandleDecodedPlain(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    Handler(cpu);
+}
+
+template <IndexMode Mode>
+static uint16_t DecodedMemoryOperandAddress(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    if constexpr (Mode == IndexMode::HL)
+        return regs.GetHL();
+    else
+        return static_cast<uint16_t>(IndexPair<Mode>(regs) + instruction.Displacement);
+}
+
+template <IndexMode Mode, uint8_t Destination>
+static void HandleDecodedLD_r_NN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    Register8<Mode, Destination>(cpu.GetRegisters()) = static_cast<uint8_t>(instruction.Operand);
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+template <IndexMode Mode, uint8_t Destination>
+static void HandleDecodedLD_r_IndHL(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    Register8<IndexMode::HL, Destination>(cpu.GetRegisters()) = cpu.ReadMemory(DecodedMemoryOperandAddress<Mode>(cpu, instruction));
+}
+
+template <IndexMode Mode, uint8_t Source>
+static void HandleDecodedLD_IndHL_r(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.WriteMemory(DecodedMemoryOperandAddress<Mode>(cpu, instruction), Register8<IndexMode::HL, Source>(cpu.GetRegisters()));
+}
+
+template <IndexMode Mode>
+static void HandleDecodedLD_IndHL_NN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.WriteMemory(DecodedMemoryOperandAddress<Mode>(cpu, instruction), static_cast<uint8_t>(instruction.Operand));
+}
+
+static void HandleDecodedLD_IndNNNN_A(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.WriteMemory(instruction.Operand, cpu.GetRegisters().Reg[RegisterIndex::A]);
+}
+
+static void HandleDecodedLD_A_IndNNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.GetRegisters().Reg[RegisterIndex::A] = cpu.ReadMemory(instruction.Operand);
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleDecodedLD_RR_NNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    RegisterPair<Mode, P>(cpu.GetRegisters()) = instruction.Operand;
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleDecodedLD_IndNNNN_RR(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.WriteMemoryWord(instruction.Operand, RegisterPair<Mode, P>(cpu.GetRegisters()));
+}
+
+template <IndexMode Mode, uint8_t P>
+static void HandleDecodedLD_RR_IndNNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    RegisterPair<Mode, P>(cpu.GetRegisters()) = cpu.ReadMemoryWord(instruction.Operand);
+}
+
+template <IndexMode Mode, uint8_t Operation>
+static void HandleDecodedALU_IndHL(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.IncrementCPUClock(instruction.TStates);
+    Alu<Operation>(regs, cpu.ReadMemory(DecodedMemoryOperandAddress<Mode>(cpu, instruction)));
+}
+
+template <uint8_t Operation>
+static void HandleDecodedALU_NN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    Alu<Operation>(cpu.GetRegisters(), static_cast<uint8_t>(instruction.Operand));
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+template <IndexMode Mode>
+static void HandleDecodedINC_IndHL(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.IncrementCPUClock(instruction.TStates);
+    uint16_t address = DecodedMemoryOperandAddress<Mode>(cpu, instruction);
+    uint8_t value = regs.Inc8(cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+template <IndexMode Mode>
+static void HandleDecodedDEC_IndHL(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.IncrementCPUClock(instruction.TStates);
+    uint16_t address = DecodedMemoryOperandAddress<Mode>(cpu, instruction);
+    uint8_t value = regs.Dec8(cpu.ReadMemory(address));
+    cpu.InternalCycles(address, 1);
+    cpu.WriteMemory(address, value);
+}
+
+static void HandleDecodedJP_NNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.GetRegisters().SetPC(instruction.Operand);
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+template <uint8_t Condition>
+static void HandleDecodedJP_cc_NNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    if (TestCondition<Condition>(regs))
+        regs.SetPC(instruction.Operand);
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+static uint16_t RelativeJumpTarget(const Z80DecodedInstruction &instruction)
+{
+    return static_cast<uint16_t>(instruction.NextAddress + static_cast<int8_t>(instruction.Operand));
+}
+
+static void HandleDecodedJR(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.GetRegisters().SetPC(RelativeJumpTarget(instruction));
+    cpu.IncrementCPUClock(instruction.TStates);
+}
+
+// The T-states are those of the branch not taken
+template <uint8_t Condition>
+static void HandleDecodedJR_cc(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    if (TestCondition<Condition>(regs))
+    {
+        regs.SetPC(RelativeJumpTarget(instruction));
+        cpu.IncrementCPUClock(static_cast<uint8_t>(instruction.TStates + 5));
+    }
+    else
+    {
+        cpu.IncrementCPUClock(instruction.TStates);
+    }
+}
+
+// The T-states are those of the opcode fetch, IR is on the bus before the displacement is read
+static void HandleDecodedDJNZ(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.InternalCycles(IRAddress(regs), 1);
+    if (--regs.Reg[RegisterIndex::B] != 0)
+    {
+        regs.SetPC(RelativeJumpTarget(instruction));
+        cpu.IncrementCPUClock(3 + 5);
+    }
+    else
+    {
+        cpu.IncrementCPUClock(3);
+    }
+}
+
+static void HandleDecodedCALL_NNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    cpu.IncrementCPUClock(instruction.TStates);
+    cpu.Push(regs.PC);
+    regs.SetPC(instruction.Operand);
+}
+
+// The T-states are those of the call not taken
+template <uint8_t Condition>
+static void HandleDecodedCALL_cc_NNNN(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    auto &regs = cpu.GetRegisters();
+    if (TestCondition<Condition>(regs))
+    {
+        cpu.IncrementCPUClock(static_cast<uint8_t>(instruction.TStates + 1));
+        cpu.Push(regs.PC);
+        regs.SetPC(instruction.Operand);
+    }
+    else
+    {
+        cpu.IncrementCPUClock(instruction.TStates);
+    }
+}
+
+template <IndexMode Mode>
+static uint16_t DecodedIndexedBitAddress(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    return static_cast<uint16_t>(IndexPair<Mode>(cpu.GetRegisters()) + instruction.Displacement);
+}
+
+template <IndexMode Mode, uint8_t Operation, uint8_t Field>
+static void HandleDecodedROT_IndIndex(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    RotateIndexed<Operation, Field>(cpu, DecodedIndexedBitAddress<Mode>(cpu, instruction));
+}
+
+template <IndexMode Mode, uint8_t Bit>
+static void HandleDecodedBIT_IndIndex(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    TestIndexedBit<Bit>(cpu, DecodedIndexedBitAddress<Mode>(cpu, instruction));
+}
+
+template <IndexMode Mode, uint8_t Bit, uint8_t Field>
+static void HandleDecodedRES_IndIndex(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    uint16_t address = DecodedIndexedBitAddress<Mode>(cpu, instruction);
+    StoreIndexedBitResult<Field>(cpu, address, static_cast<uint8_t>(cpu.ReadMemory(address) & ~(1 << Bit)));
+}
+
+template <IndexMode Mode, uint8_t Bit, uint8_t Field>
+static void HandleDecodedSET_IndIndex(Z80 &cpu, const Z80DecodedInstruction &instruction)
+{
+    cpu.IncrementCPUClock(instruction.TStates);
+    uint16_t address = DecodedIndexedBitAddress<Mode>(cpu, instruction);
+    StoreIndexedBitResult<Field>(cpu, address, static_cast<uint8_t>(cpu.ReadMemory(address) | (1 << Bit)));
+}
+
+// Decoders, mapping an opcode onto its handler instance. Prefix bytes decode to nullptr, the dispatchers for those are
+// filled in by Z80::BuildOpcodeTables
+
+// Returns true if a DD / FD prefix changes the meaning of the unprefixed opcode (HL, H, L or (HL) operand)
+static constexpr bool IsIndexRegisterOpcode(uint8_t opcode)
+{
+    if ((opcode >= 0x40) && (opcode < 0xC0))
+    {
+        if (opcode == 0x76)
+            return false;
+        uint8_t source = opcode & 0x07;
+        uint8_t destination = (opcode >> 3) & 0x07;
+        bool sourceIsHL = (source >= 4) && (source <= 6);
+        bool destinationIsHL = (opcode < 0x80) && (destination >= 4) && (destination <= 6);
+        return sourceIsHL || destinationIsHL;
+    }
+    switch (opcode)
+    {
+    case 0x09: case 0x19: case 0x21: case 0x22: case 0x23: case 0x24: case 0x25: case 0x26:
+    case 0x29: case 0x2A: case 0x2B: case 0x2C: case 0x2D: case 0x2E: case 0x34: case 0x35:
+    case 0x36: case 0x39: case 0xE1: case 0xE3: case 0xE5: case 0xE9: case 0xF9:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <IndexMode Mode, uint8_t Opcode>
+static constexpr OpcodeHandler DecodeUnprefixed()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+    if constexpr (x == 0)
+    {
+        if constexpr (z == 0)
+        {
+            if constexpr (y == 0)
+                return HandlOpcodeNOP;
+            else if constexpr (y == 1)
+                return HandleOpcodeEX_AF_AF_;
+            else if constexpr (y == 2)
+                return HandleOpcodeDJNZ;
+            else if constexpr (y == 3)
+                return HandleOpcodeJR;
+            else
+                return HandleOpcodeJR_cc<y - 4>;
+        }
+        else if constexpr (z == 1)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodeLD_RR_NNNN<Mode, p>;
+            else
+                return HandleOpcodeADD_HL_RR<Mode, p>;
+        }
+        else if constexpr (z == 2)
+        {
+            if constexpr (Opcode == 0x22)
+                return HandleOpcodeLD_IndNNNN_RR<Mode, 2>;
+            else if constexpr (Opcode == 0x2A)
+                return HandleOpcodeLD_RR_IndNNNN<Mode, 2>;
+            else if constexpr (Opcode == 0x32)
+                return HandleOpcodeLD_IndNNNN_A;
+            else if constexpr (Opcode == 0x3A)
+                return HandleOpcodeLD_A_IndNNNN;
+            else if constexpr (q == 0)
+                return HandleOpcodeLD_IndRR_A<p>;
+            else
+                return HandleOpcodeLD_A_IndRR<p>;
+        }
+        else if constexpr (z == 3)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodeINC_RR<Mode, p>;
+            else
+                return HandleOpcodeDEC_RR<Mode, p>;
+        }
+        else if constexpr (z == 4)
+        {
+            if constexpr (y == 6)
+                return HandleOpcodeINC_IndHL<Mode>;
+            else
+                return HandleOpcodeINC_r<Mode, y>;
+        }
+        else if constexpr (z == 5)
+        {
+            if constexpr (y == 6)
+                return HandleOpcodeDEC_IndHL<Mode>;
+            else
+                return HandleOpcodeDEC_r<Mode, y>;
+        }
+        else if constexpr (z == 6)
+        {
+            if constexpr (y == 6)
+                return HandleOpcodeLD_IndHL_NN<Mode>;
+            else
+                return HandleOpcodeLD_r_NN<Mode, y>;
+        }
+        else
+        {
+            constexpr OpcodeHandler handlers[8] = {
+                HandleOpcodeRLCA, HandleOpcodeRRCA, HandleOpcodeRLA, HandleOpcodeRRA,
+                HandleOpcodeDAA, HandleOpcodeCPL, HandleOpcodeSCF, HandleOpcodeCCF,
+            };
+            return handlers[y];
+        }
+    }
+    else if constexpr (x == 1)
+    {
+        if constexpr (Opcode == 0x76)
+            return HandleOpcodeHALT;
+        else if constexpr (z == 6)
+            return HandleOpcodeLD_r_IndHL<Mode, y>;
+        else if constexpr (y == 6)
+            return HandleOpcodeLD_IndHL_r<Mode, z>;
+        else
+            return HandleOpcodeLD_r_r<Mode, y, z>;
+    }
+    else if constexpr (x == 2)
+    {
+        if constexpr (z == 6)
+            return HandleOpcodeALU_IndHL<Mode, y>;
+        else
+            return HandleOpcodeALU_r<Mode, y, z>;
+    }
+    else
+    {
+        if constexpr (z == 0)
+        {
+            return HandleOpcodeRET_cc<y>;
+        }
+        else if constexpr (z == 1)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodePOP_RR<Mode, p>;
+            else if constexpr (p == 0)
+                return HandleOpcodeRET;
+            else if constexpr (p == 1)
+                return HandleOpcodeEXX;
+            else if constexpr (p == 2)
+                return HandleOpcodeJP_HL<Mode>;
+            else
+                return HandleOpcodeLD_SP_HL<Mode>;
+        }
+        else if constexpr (z == 2)
+        {
+            return HandleOpcodeJP_cc_NNNN<y>;
+        }
+        else if constexpr (z == 3)
+        {
+            constexpr OpcodeHandler handlers[8] = {
+                HandleOpcodeJP_NNNN, nullptr, HandleOpcodeOUT_IndNN_A, HandleOpcodeIN_A_IndNN,
+                HandleOpcodeEX_IndSP_HL<Mode>, HandleOpcodeEX_DE_HL, HandlOpcodeDI, HandleOpcodeEI,
+            };
+            return handlers[y];
+        }
+        else if constexpr (z == 4)
+        {
+            return HandleOpcodeCALL_cc_NNNN<y>;
+        }
+        else if constexpr (z == 5)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodePUSH_RR<Mode, p>;
+            else if constexpr (p == 0)
+                return HandleOpcodeCALL_NNNN;
+            else
+                return nullptr;
+        }
+        else if constexpr (z == 6)
+        {
+            return HandleOpcodeALU_NN<y>;
+        }
+        else
+        {
+            return HandleOpcodeRST<y * 8>;
+        }
+    }
+}
+
+// DD / FD: only opcodes using HL, H, L or (HL) get an index register instance, all others share the unprefixed one
+template <IndexMode Mode, uint8_t Opcode>
+static constexpr OpcodeHandler DecodeIndexed()
+{
+    if constexpr (IsIndexRegisterOpcode(Opcode))
+        return DecodeUnprefixed<Mode, Opcode>();
+    else
+        return DecodeUnprefixed<IndexMode::HL, Opcode>();
+}
+
+template <uint8_t Opcode>
+static constexpr OpcodeHandler DecodeCB()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    if constexpr (x == 0)
+    {
+        if constexpr (z == 6)
+            return HandleOpcodeROT_IndHL<y>;
+        else
+            return HandleOpcodeROT_r<y, z>;
+    }
+    else if constexpr (x == 1)
+    {
+        if constexpr (z == 6)
+            return HandleOpcodeBIT_IndHL<y>;
+        else
+            return HandleOpcodeBIT_r<y, z>;
+    }
+    else if constexpr (x == 2)
+    {
+        if constexpr (z == 6)
+            return HandleOpcodeRES_IndHL<y>;
+        else
+            return HandleOpcodeRES_r<y, z>;
+    }
+    else
+    {
+        if constexpr (z == 6)
+            return HandleOpcodeSET_IndHL<y>;
+        else
+            return HandleOpcodeSET_r<y, z>;
+    }
+}
+
+template <IndexMode Mode, uint8_t Opcode>
+static constexpr OpcodeHandler DecodeIndexedCB()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    if constexpr (x == 0)
+        return HandleOpcodeROT_IndIndex<Mode, y, z>;
+    else if constexpr (x == 1)
+        return HandleOpcodeBIT_IndIndex<Mode, y>;
+    else if constexpr (x == 2)
+        return HandleOpcodeRES_IndIndex<Mode, y, z>;
+    else
+        return HandleOpcodeSET_IndIndex<Mode, y, z>;
+}
+
+template <uint8_t Opcode>
+static constexpr OpcodeHandler DecodeED()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+    if constexpr (x == 1)
+    {
+        if constexpr (z == 0)
+        {
+            return HandleOpcodeIN_r_IndC<y>;
+        }
+        else if constexpr (z == 1)
+        {
+            return HandleOpcodeOUT_IndC_r<y>;
+        }
+        else if constexpr (z == 2)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodeSBC_HL_RR<p>;
+            else
+                return HandleOpcodeADC_HL_RR<p>;
+        }
+        else if constexpr (z == 3)
+        {
+            if constexpr (q == 0)
+                return HandleOpcodeLD_IndNNNN_RR<IndexMode::HL, p>;
+            else
+                return HandleOpcodeLD_RR_IndNNNN<IndexMode::HL, p>;
+        }
+        else if constexpr (z == 4)
+        {
+            return HandleOpcodeNEG;
+        }
+        else if constexpr (z == 5)
+        {
+            return HandleOpcodeRETN;
+        }
+        else if constexpr (z == 6)
+        {
+            // IM 0/1 at y = 1 and 5 is undefined, and behaves as IM 0
+            constexpr uint8_t InterruptModes[8] = { 0, 0, 1, 2, 0, 0, 1, 2 };
+            return HandleOpcodeIM<InterruptModes[y]>;
+        }
+        else
+        {
+            constexpr OpcodeHandler handlers[8] = {
+                HandleOpcodeLD_I_A, HandleOpcodeLD_R_A, HandleOpcodeLD_A_I, HandleOpcodeLD_A_R,
+                HandleOpcodeRRD, HandleOpcodeRLD, HandleOpcodeED_NOP, HandleOpcodeED_NOP,
+            };
+            return handlers[y];
+        }
+    }
+    else if constexpr ((x == 2) && (y >= 4) && (z <= 3))
+    {
+        constexpr int Step = (q == 0) ? 1 : -1;
+        constexpr bool Repeat = (y >= 6);
+        if constexpr (z == 0)
+            return HandleOpcodeLDI<Step, Repeat>;
+        else if constexpr (z == 1)
+            return HandleOpcodeCPI<Step, Repeat>;
+        else if constexpr (z == 2)
+            return HandleOpcodeINI<Step, Repeat>;
+        else
+            return HandleOpcodeOUTI<Step, Repeat>;
+    }
+    else
+    {
+        return HandleOpcodeED_NOP;
+    }
+}
+
+template <IndexMode Mode, std::size_t... Opcodes>
+static constexpr OpcodeTable MakeUnprefixedTable(std::index_sequence<Opcodes...>)
+{
+    return OpcodeTable{ { DecodeIndexed<Mode, static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+template <std::size_t... Opcodes>
+static constexpr OpcodeTable MakeCBTable(std::index_sequence<Opcodes...>)
+{
+    return OpcodeTable{ { DecodeCB<static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+template <IndexMode Mode, std::size_t... Opcodes>
+static constexpr OpcodeTable MakeIndexedCBTable(std::index_sequence<Opcodes...>)
+{
+    return OpcodeTable{ { DecodeIndexedCB<Mode, static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+template <std::size_t... Opcodes>
+static constexpr OpcodeTable MakeEDTable(std::index_sequence<Opcodes...>)
+{
+    return OpcodeTable{ { DecodeED<static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+using OpcodeSequence = std::make_index_sequence<256>;
+
+static OpcodeTable CompleteTable(OpcodeTable table)
+{
+    for (auto &handler : table)
+    {
+        if (handler == nullptr)
+            handler = HandleOpcodeInvalid;
+    }
+    return table;
+}
+
+Z80::OpcodeTableSet Z80::BuildOpcodeTables()
+{
+    OpcodeTableSet tables{};
+    auto &unprefixed = tables[static_cast<std::size_t>(OpcodePrefix::None)];
+    auto &prefixDD = tables[static_cast<std::size_t>(OpcodePrefix::DD)];
+    auto &prefixFD = tables[static_cast<std::size_t>(OpcodePrefix::FD)];
+    unprefixed = MakeUnprefixedTable<IndexMode::HL>(OpcodeSequence{});
+    prefixDD = MakeUnprefixedTable<IndexMode::IX>(OpcodeSequence{});
+    prefixFD = MakeUnprefixedTable<IndexMode::IY>(OpcodeSequence{});
+    // A prefix following DD / FD cancels it, so the prefix bytes dispatch the same in all three tables
+    for (auto *table : { &unprefixed, &prefixDD, &prefixFD })
+    {
+        (*table)[0xCB] = ExecutePrefixCB;
+        (*table)[0xDD] = ExecutePrefixDD;
+        (*table)[0xED] = ExecutePrefixED;
+        (*table)[0xFD] = ExecutePrefixFD;
+    }
+    prefixDD[0xCB] = ExecutePrefixDDCB;
+    prefixFD[0xCB] = ExecutePrefixFDCB;
+    tables[static_cast<std::size_t>(OpcodePrefix::CB)] = MakeCBTable(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::ED)] = MakeEDTable(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::DDCB)] = MakeIndexedCBTable<IndexMode::IX>(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::FDCB)] = MakeIndexedCBTable<IndexMode::IY>(OpcodeSequence{});
+    for (auto &table : tables)
+        table = CompleteTable(table);
+    return tables;
+}
+
+const Z80::OpcodeTableSet Z80::OpcodeTables = Z80::BuildOpcodeTables();
+
+// DD / FD prefixed opcodes with an (IX+d) / (IY+d) operand. DD CB / FD CB read their displacement with the prefix
+static constexpr bool HasDisplacement(OpcodePrefix prefix, uint8_t opcode)
+{
+    const uint8_t x = opcode >> 6;
+    const uint8_t y = (opcode >> 3) & 0x07;
+    const uint8_t z = opcode & 0x07;
+    bool isIndexed = (prefix == OpcodePrefix::DD) || (prefix == OpcodePrefix::FD);
+    bool usesMemoryOperand = (opcode == 0x34) || (opcode == 0x35) || (opcode == 0x36) ||
+        ((x == 1) && (opcode != 0x76) && ((y == 6) || (z == 6))) || ((x == 2) && (z == 6));
+    return isIndexed && usesMemoryOperand;
+}
+
+// Operand bytes of an unprefixed opcode, or of a DD / FD prefixed one including the displacement
+static constexpr uint8_t OperandLength(OpcodePrefix prefix, uint8_t opcode)
+{
+    const uint8_t x = opcode >> 6;
+    const uint8_t y = (opcode >> 3) & 0x07;
+    const uint8_t z = opcode & 0x07;
+    if (prefix == OpcodePrefix::ED)
+        return ((x == 1) && (z == 3)) ? 2 : 0;
+    if ((prefix == OpcodePrefix::CB) || (prefix == OpcodePrefix::DDCB) || (prefix == OpcodePrefix::FDCB))
+        return 0;
+    uint8_t length = 0;
+    if (x == 0)
+    {
+        if ((z == 0) && (y >= 2))
+            length = 1;
+        else if ((z == 1) && ((y & 0x01) == 0))
+            length = 2;
+        else if ((z == 2) && (y >= 4))
+            length = 2;
+        else if (z == 6)
+            length = 1;
+    }
+    else if (x == 3)
+    {
+        if ((z == 2) || (z == 4) || (opcode == 0xC3) || (opcode == 0xCD))
+            length = 2;
+        else if ((opcode == 0xD3) || (opcode == 0xDB) || (z == 6))
+            length = 1;
+    }
+    if (HasDisplacement(prefix, opcode))
+        ++length;
+    return length;
+}
+
+// Decoders for the pre-decoded handlers. Opcodes with operands map onto their variant and the T-states up to its first
+// data access, all others onto their normal handler and the opcode fetch
+
+template <OpcodeHandler Handler>
+static constexpr DecodedOpcode Fetching()
+{
+    if constexpr (Handler == nullptr)
+        return DecodedOpcode{ nullptr, 0 };
+    else
+        return DecodedOpcode{ HandleDecodedFetching<Handler>, Z80::OpcodeFetchTStates };
+}
+
+// Unprefixed opcodes without operands have nothing to restore, PC is already past them
+template <OpcodeHandler Handler, uint8_t Opcode>
+static constexpr DecodedOpcode FetchingUnprefixed()
+{
+    if constexpr ((Handler != nullptr) && (OperandLength(OpcodePrefix::None, Opcode) == 0))
+        return DecodedOpcode{ HandleDecodedPlain<Handler>, Z80::OpcodeFetchTStates };
+    else
+        return Fetching<Handler>();
+}
+
+template <IndexMode Mode, uint8_t Opcode, bool IsPrefixed = (Mode != IndexMode::HL)>
+static constexpr DecodedOpcode DecodeDecodedUnprefixed()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+    constexpr uint8_t MemoryTStates = 4 + IndexedMemoryExtra<Mode>;
+    if constexpr ((x == 0) && (z == 0) && (y == 2))
+        return DecodedOpcode{ HandleDecodedDJNZ, 4 };
+    else if constexpr ((x == 0) && (z == 0) && (y == 3))
+        return DecodedOpcode{ HandleDecodedJR, 12 };
+    else if constexpr ((x == 0) && (z == 0) && (y >= 4))
+        return DecodedOpcode{ HandleDecodedJR_cc<y - 4>, 7 };
+    else if constexpr ((x == 0) && (z == 1) && (q == 0))
+        return DecodedOpcode{ HandleDecodedLD_RR_NNNN<Mode, p>, 10 };
+    else if constexpr (Opcode == 0x22)
+        return DecodedOpcode{ HandleDecodedLD_IndNNNN_RR<Mode, 2>, 10 };
+    else if constexpr (Opcode == 0x2A)
+        return DecodedOpcode{ HandleDecodedLD_RR_IndNNNN<Mode, 2>, 10 };
+    else if constexpr (Opcode == 0x32)
+        return DecodedOpcode{ HandleDecodedLD_IndNNNN_A, 10 };
+    else if constexpr (Opcode == 0x3A)
+        return DecodedOpcode{ HandleDecodedLD_A_IndNNNN, 10 };
+    else if constexpr (Opcode == 0x34)
+        return DecodedOpcode{ HandleDecodedINC_IndHL<Mode>, MemoryTStates };
+    else if constexpr (Opcode == 0x35)
+        return DecodedOpcode{ HandleDecodedDEC_IndHL<Mode>, MemoryTStates };
+    else if constexpr (Opcode == 0x36)
+        return DecodedOpcode{ HandleDecodedLD_IndHL_NN<Mode>, (Mode == IndexMode::HL) ? 7 : 12 };
+    else if constexpr ((x == 0) && (z == 6))
+        return DecodedOpcode{ HandleDecodedLD_r_NN<Mode, y>, 7 };
+    else if constexpr ((x == 1) && (Opcode != 0x76) && (z == 6))
+        return DecodedOpcode{ HandleDecodedLD_r_IndHL<Mode, y>, MemoryTStates };
+    else if constexpr ((x == 1) && (Opcode != 0x76) && (y == 6))
+        return DecodedOpcode{ HandleDecodedLD_IndHL_r<Mode, z>, MemoryTStates };
+    else if constexpr ((x == 2) && (z == 6))
+        return DecodedOpcode{ HandleDecodedALU_IndHL<Mode, y>, MemoryTStates };
+    else if constexpr (Opcode == 0xC3)
+        return DecodedOpcode{ HandleDecodedJP_NNNN, 10 };
+    else if constexpr ((x == 3) && (z == 2))
+        return DecodedOpcode{ HandleDecodedJP_cc_NNNN<y>, 10 };
+    else if constexpr (Opcode == 0xCD)
+        return DecodedOpcode{ HandleDecodedCALL_NNNN, 11 };
+    else if constexpr ((x == 3) && (z == 4))
+        return DecodedOpcode{ HandleDecodedCALL_cc_NNNN<y>, 10 };
+    else if constexpr ((x == 3) && (z == 6))
+        return DecodedOpcode{ HandleDecodedALU_NN<y>, 7 };
+    else if constexpr (IsPrefixed)
+        return Fetching<DecodeUnprefixed<Mode, Opcode>()>();
+    else
+        return FetchingUnprefixed<DecodeUnprefixed<Mode, Opcode>(), Opcode>();
+}
+
+template <IndexMode Mode, uint8_t Opcode>
+static constexpr DecodedOpcode DecodeDecodedIndexed()
+{
+    if constexpr (IsIndexRegisterOpcode(Opcode))
+        return DecodeDecodedUnprefixed<Mode, Opcode>();
+    else
+        return DecodeDecodedUnprefixed<IndexMode::HL, Opcode, Mode != IndexMode::HL>();
+}
+
+template <IndexMode Mode, uint8_t Opcode>
+static constexpr DecodedOpcode DecodeDecodedIndexedCB()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    if constexpr (x == 0)
+        return DecodedOpcode{ HandleDecodedROT_IndIndex<Mode, y, z>, 8 };
+    else if constexpr (x == 1)
+        return DecodedOpcode{ HandleDecodedBIT_IndIndex<Mode, y>, 8 };
+    else if constexpr (x == 2)
+        return DecodedOpcode{ HandleDecodedRES_IndIndex<Mode, y, z>, 8 };
+    else
+        return DecodedOpcode{ HandleDecodedSET_IndIndex<Mode, y, z>, 8 };
+}
+
+template <uint8_t Opcode>
+static constexpr DecodedOpcode DecodeDecodedED()
+{
+    constexpr uint8_t x = Opcode >> 6;
+    constexpr uint8_t y = (Opcode >> 3) & 0x07;
+    constexpr uint8_t z = Opcode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+    if constexpr ((x == 1) && (z == 3) && (q == 0))
+        return DecodedOpcode{ HandleDecodedLD_IndNNNN_RR<IndexMode::HL, p>, 10 };
+    else if constexpr ((x == 1) && (z == 3))
+        return DecodedOpcode{ HandleDecodedLD_RR_IndNNNN<IndexMode::HL, p>, 10 };
+    else
+        return Fetching<DecodeED<Opcode>()>();
+}
+
+template <IndexMode Mode, std::size_t... Opcodes>
+static constexpr DecodedOpcodeTable MakeDecodedUnprefixedTable(std::index_sequence<Opcodes...>)
+{
+    return DecodedOpcodeTable{ { DecodeDecodedIndexed<Mode, static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+template <std::size_t... Opcodes>
+static constexpr DecodedOpcodeTable MakeDecodedCBTable(std::index_sequence<Opcodes...>)
+{
+    return DecodedOpcodeTable{ { Fetching<DecodeCB<static_cast<uint8_t>(Opcodes)>()>()... } };
+}
+
+template <IndexMode Mode, std::size_t... Opcodes>
+static constexpr DecodedOpcodeTable MakeDecodedIndexedCBTable(std::index_sequence<Opcodes...>)
+{
+    return DecodedOpcodeTable{ { DecodeDecodedIndexedCB<Mode, static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+template <std::size_t... Opcodes>
+static constexpr DecodedOpcodeTable MakeDecodedEDTable(std::index_sequence<Opcodes...>)
+{
+    return DecodedOpcodeTable{ { DecodeDecodedED<static_cast<uint8_t>(Opcodes)>()... } };
+}
+
+// Prefix bytes never end up in a decoded instruction, they are left as the invalid opcode
+Z80::DecodedOpcodeTableSet Z80::BuildDecodedOpcodes()
+{
+    DecodedOpcodeTableSet tables{};
+    tables[static_cast<std::size_t>(OpcodePrefix::None)] = MakeDecodedUnprefixedTable<IndexMode::HL>(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::DD)] = MakeDecodedUnprefixedTable<IndexMode::IX>(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::FD)] = MakeDecodedUnprefixedTable<IndexMode::IY>(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::CB)] = MakeDecodedCBTable(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::ED)] = MakeDecodedEDTable(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::DDCB)] = MakeDecodedIndexedCBTable<IndexMode::IX>(OpcodeSequence{});
+    tables[static_cast<std::size_t>(OpcodePrefix::FDCB)] = MakeDecodedIndexedCBTable<IndexMode::IY>(OpcodeSequence{});
+    for (auto &table : tables)
+    {
+        for (auto &decoded : table)
+        {
+            if (decoded.Handler == nullptr)
+                decoded = DecodedOpcode{ HandleDecodedFetching<HandleOpcodeInvalid>, OpcodeFetchTStates };
+        }
+    }
+    return tables;
+}
+
+const Z80::DecodedOpcodeTableSet Z80::DecodedOpcodes = Z80::BuildDecodedOpcodes();
+
+// Stores to memory: LD (rr),A, LD (nn),rr, LD (HL),r / n, INC / DEC (HL), PUSH, CALL, RST, EX (SP),HL, the CB and
+// DD CB / FD CB (HL) operations except BIT, RRD / RLD and the block transfer and input instructions. Port writes are
+// included, they may switch the bank a block runs from
+static constexpr bool MayWriteCode(OpcodePrefix prefix, uint8_t opcode)
+{
+    const uint8_t x = opcode >> 6;
+    const uint8_t y = (opcode >> 3) & 0x07;
+    const uint8_t z = opcode & 0x07;
+    switch (prefix)
+    {
+    case OpcodePrefix::ED:
+        return ((x == 1) && ((z == 1) || ((z == 3) && ((y & 0x01) == 0)) || (opcode == 0x67) || (opcode == 0x6F))) ||
+            ((x == 2) && (y >= 4) && (z != 1) && (z <= 3));
+    case OpcodePrefix::CB:
+        return (x != 1) && (z == 6);
+    case OpcodePrefix::DDCB:
+    case OpcodePrefix::FDCB:
+        return x != 1;
+    default:
+        break;
+    }
+    if (x == 0)
+        return (opcode == 0x02) || (opcode == 0x12) || (opcode == 0x22) || (opcode == 0x32) || (opcode == 0x34) ||
+            (opcode == 0x35) || (opcode == 0x36);
+    if (x == 1)
+        return (y == 6) && (opcode != 0x76);
+    if (x == 3)
+        return (z == 4) || (z == 7) || ((z == 5) && ((y & 0x01) == 0)) || (opcode == 0xCD) || (opcode == 0xD3) ||
+            (opcode == 0xE3);
+    return false;
+}
+
+static constexpr bool EndsBlock(OpcodePrefix prefix, uint8_t opcode)
+{
+    if (prefix == OpcodePrefix::ED)
+        return ((opcode & 0xC7) == 0x45);
+    if ((prefix == OpcodePrefix::None) || (prefix == OpcodePrefix::DD) || (prefix == OpcodePrefix::FD))
+    {
+        switch (opcode)
+        {
+        case 0x18: case 0x76: case 0xC3: case 0xC9: case 0xCD: case 0xE9: case 0xF3: case 0xFB:
+            return true;
+        default:
+            // RST
+            return (opcode & 0xC7) == 0xC7;
+        }
+    }
+    return false;
+}
+
+static constexpr bool AccessesIO(OpcodePrefix prefix, uint8_t opcode)
+{
+    if (prefix == OpcodePrefix::ED)
+        return ((opcode & 0xC6) == 0x40) || ((opcode & 0xE6) == 0xA2);
+    if ((prefix == OpcodePrefix::None) || (prefix == OpcodePrefix::DD) || (prefix == OpcodePrefix::FD))
+        return (opcode == 0xD3) || (opcode == 0xDB);
+    return false;
+}
+
+Z80::OpcodeInfoTableSet Z80::BuildOpcodeInfos()
+{
+    OpcodeInfoTableSet infos{};
+    for (std::size_t prefix = 0; prefix < infos.size(); ++prefix)
+    {
+        for (std::size_t opcode = 0; opcode < 256; ++opcode)
+        {
+            auto &info = infos[prefix][opcode];
+            info.OperandLength = OperandLength(static_cast<OpcodePrefix>(prefix), static_cast<uint8_t>(opcode));
+            info.HasDisplacement = HasDisplacement(static_cast<OpcodePrefix>(prefix), static_cast<uint8_t>(opcode));
+            info.EndsBlock = EndsBlock(static_cast<OpcodePrefix>(prefix), static_cast<uint8_t>(opcode));
+            info.MayWriteCode = MayWriteCode(static_cast<OpcodePrefix>(prefix), static_cast<uint8_t>(opcode));
+            info.AccessesIO = AccessesIO(static_cast<OpcodePrefix>(prefix), static_cast<uint8_t>(opcode));
+            info.IsValid = OpcodeTables[prefix][opcode] != HandleOpcodeInvalid;
+        }
+    }
+    return infos;
+}
+
+const Z80::OpcodeInfoTableSet Z80::OpcodeInfos = Z80::BuildOpcodeInfos();
@@ -0,0 +1,705 @@
+#include "Model/Z80Recompiler.h"
+
+#include <cstddef>
+#include <cstring>
+#if defined(PLATFORM_WINDOWS)
+#if _MSC_VER > 1900 // Versions after VS 2015
+#pragma warning(disable: 5039)
+#endif
+#include <windows.h>
+#if _MSC_VER > 1900 // Versions after VS 2015
+#pragma warning(default: 5039)
+#endif
+#else
+#include <sys/mman.h>
+#endif
+#include "tracing/Tracing.h"
+#include "Model/Z80Flags.h"
+#include "Model/Z80Registers.h"
+
+// Register usage of the generated code:
+//   rbx             Z80 object, state is addressed as [rbx + offset]
+//   rbp             deadline in T-states
+//   r12             FlagTables
+//   r8..r11, r13,   B, C, D, E, H, L, A and F of the Z80, zero extended to 32 bits
+//   r14, r15, rdi
+//   rcx             clock, while translated instructions run
+//   rax, rdx        scratch, eax is the return value, the number of instructions executed
+// rbx, rbp and r12..r15 are callee saved in both the Windows and the System V ABI, rdi only in the Windows one and is
+// saved in both. Z80 registers are written back before every handler call, so it does not matter that the call can
+// change the caller saved ones
+
+enum HostRegister : uint8_t
+{
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15,
+};
+
+#if defined(PLATFORM_WINDOWS)
+// Arguments in rcx, rdx, the caller reserves 32 bytes of shadow space
+static constexpr uint8_t FirstArgument = RCX;
+static constexpr uint8_t SecondArgument = RDX;
+#else
+// Arguments in rdi, rsi
+static constexpr uint8_t FirstArgument = RDI;
+static constexpr uint8_t SecondArgument = RSI;
+#endif
+
+// Host register by r-field (B, C, D, E, H, L, (HL), A). As in RegisterFieldOffset, F takes the place of (HL)
+static constexpr uint8_t HostRegisterByField[8] = { R8, R9, R10, R11, R13, R14, RDI, R15 };
+static constexpr uint8_t FieldF = 6;
+static constexpr uint8_t FieldA = 7;
+static constexpr uint8_t HostA = HostRegisterByField[FieldA];
+static constexpr uint8_t HostF = HostRegisterByField[FieldF];
+// movzx edi, ah cannot be encoded with a REX prefix
+static_assert(HostF == RDI, "F must be in a register that needs no REX prefix");
+
+// ALU operations by the y-field of the opcode
+static constexpr uint8_t OperationADD = 0;
+static constexpr uint8_t OperationADC = 1;
+static constexpr uint8_t OperationSUB = 2;
+static constexpr uint8_t OperationSBC = 3;
+static constexpr uint8_t OperationAND = 4;
+static constexpr uint8_t OperationXOR = 5;
+static constexpr uint8_t OperationOR = 6;
+static constexpr uint8_t OperationCP = 7;
+// op r/m8, r8, the op al, imm8 form is 4 higher
+static constexpr uint8_t ArithmeticOpcodes[8] = { 0x00, 0x10, 0x28, 0x18, 0x00, 0x00, 0x00, 0x38 };
+// op r/m32, r32 for AND, XOR and OR, and the ModRM reg field of op r/m32, imm32
+static constexpr uint8_t LogicOpcodes[3] = { 0x21, 0x31, 0x09 };
+static constexpr uint8_t LogicImmediateOperations[3] = { 4, 6, 1 };
+
+static constexpr uint8_t ConditionNotEqual = 0x85;
+static constexpr uint8_t ConditionAboveOrEqual = 0x83;
+static constexpr uint8_t Always = 0x00;
+
+// Protection is changed for the host pages written only
+static constexpr std::size_t HostPageSize = 4096;
+
+// Whether the instruction is a JR, DJNZ or JP with the given target, these are the ones closing loops
+static bool IsJumpTo(const Z80DecodedInstruction &instruction, uint16_t address)
+{
+    if (instruction.PrefixTStates != 0)
+        return false;
+    const uint8_t opcode = instruction.Opcode;
+    if ((opcode == 0x10) || (opcode == 0x18) || ((opcode & 0xE7) == 0x20))
+        return static_cast<uint16_t>(instruction.NextAddress + static_cast<int8_t>(instruction.Operand)) == address;
+    if ((opcode == 0xC3) || ((opcode & 0xC7) == 0xC2))
+        return instruction.Operand == address;
+    return false;
+}
+
+static uint8_t *AllocateArena(std::size_t size)
+{
+#if !Z80_RECOMPILER_SUPPORTED
+    (void)size;
+    return nullptr;
+#elif defined(PLATFORM_WINDOWS)
+    return static_cast<uint8_t *>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+    void *arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (arena == MAP_FAILED) ? nullptr : static_cast<uint8_t *>(arena);
+#endif
+}
+
+static void FreeArena(uint8_t *arena, std::size_t size)
+{
+#if defined(PLATFORM_WINDOWS)
+    (void)size;
+    VirtualFree(arena, 0, MEM_RELEASE);
+#else
+    munmap(arena, size);
+#endif
+}
+
+// The arena is never writable and executable at the same time
+static bool SetArenaExecutable(uint8_t *arena, std::size_t size, bool executable)
+{
+#if defined(PLATFORM_WINDOWS)
+    DWORD oldProtection{};
+    if (!VirtualProtect(arena, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &oldProtection))
+        return false;
+    if (executable)
+        FlushInstructionCache(GetCurrentProcess(), arena, size);
+    return true;
+#else
+    return mprotect(arena, size, executable ? (PROT_READ | PROT_EXEC) : (PROT_READ | PROT_WRITE)) == 0;
+#endif
+}
+
+Z80Recompiler::Z80Recompiler(const Z80NativeLayout &layout)
+    : m_layout{ layout }
+    , m_arena{}
+    , m_arenaUsed{}
+    , m_arenaFailed{}
+    , m_code{}
+    , m_exits{}
+    , m_loopBranches{}
+    , m_epilogueJumps{}
+    , m_instructionData{}
+    , m_instructionReferences{}
+    , m_loadedRegisters{}
+    , m_dirtyRegisters{}
+    , m_clockLoaded{}
+{
+}
+
+Z80Recompiler::~Z80Recompiler()
+{
+    if (m_arena != nullptr)
+        FreeArena(m_arena, ArenaSize);
+}
+
+void Z80Recompiler::Flush()
+{
+    m_arenaUsed = 0;
+}
+
+Z80NativeBlock Z80Recompiler::Compile(const Z80DecodedBlock &block, const Z80DecodedInstruction *instructions, const PagedMemoryMap &memoryMap)
+{
+    if (!IsAvailable() || IsFull() || block.AccessesIO)
+        return nullptr;
+    if ((m_arena == nullptr) && !CreateArena())
+        return nullptr;
+    m_code.clear();
+    m_exits.clear();
+    m_loopBranches.clear();
+    m_epilogueJumps.clear();
+    m_instructionData.clear();
+    m_instructionReferences.clear();
+    m_loadedRegisters = 0;
+    m_dirtyRegisters = 0;
+    m_clockLoaded = false;
+
+    EmitPrologue();
+    const std::size_t blockStart = m_code.size();
+    for (uint32_t index = 0; index < block.InstructionCount; ++index)
+    {
+        const Z80DecodedInstruction &instruction = instructions[index];
+        if (EmitNativeInstruction(instruction, index + 1))
+            continue;
+        // The state is in memory from here, so a repeating instruction can continue at its handler call. A jump to
+        // itself is left to the idle loop check after the block
+        WriteBack();
+        const uint16_t address = (index == 0) ? block.Address : instructions[index - 1].NextAddress;
+        const uint8_t refreshBefore = (index == 0) ? 0 : instructions[index - 1].RefreshCount;
+        LoopBranch loop{};
+        const LoopBranch *loopBranch = &loop;
+        if (instruction.Repeats)
+            loop = LoopBranch{ address, m_code.size(), 1, static_cast<uint8_t>((instruction.RefreshCount - refreshBefore) & 0x7F), 0, 0 };
+        else if ((index != 0) && IsJumpTo(instruction, block.Address))
+            loop = LoopBranch{ block.Address, blockStart, index + 1, instruction.RefreshCount, 0, 0 };
+        else
+            loopBranch = nullptr;
+        std::size_t exit = EmitHandlerCall(instruction, index + 1, loopBranch);
+        if (instruction.MayWriteCode)
+            EmitGenerationChecks(block, memoryMap, exit);
+    }
+    const Z80DecodedInstruction &last = instructions[block.InstructionCount - 1];
+    EmitExit(CurrentState(block.InstructionCount, last, true));
+    for (const auto &loop : m_loopBranches)
+        EmitLoopBranch(block, memoryMap, loop);
+    for (auto &exit : m_exits)
+    {
+        Patch(exit.Jumps, m_code.size());
+        EmitExit(exit.State);
+    }
+    Patch(m_epilogueJumps, m_code.size());
+    EmitEpilogue();
+
+    // The instructions run by handlers follow the code
+    while ((m_code.size() % alignof(Z80DecodedInstruction)) != 0)
+        Emit8(0xCC);                                                    // int3
+    for (std::size_t index = 0; index < m_instructionData.size(); ++index)
+    {
+        Patch({ m_instructionReferences[index] }, m_code.size());
+        const auto *data = reinterpret_cast<const uint8_t *>(&m_instructionData[index]);
+        m_code.insert(m_code.end(), data, data + sizeof(Z80DecodedInstruction));
+    }
+    if (m_code.size() > MaxBlockCodeSize)
+    {
+        TRACE_ERROR("Recompiled block at {} is too large", block.Address);
+        return nullptr;
+    }
+
+    // Only the host pages the code goes to lose their execute permission while it is copied
+    uint8_t *code = m_arena + m_arenaUsed;
+    const std::size_t firstPage = m_arenaUsed & ~(HostPageSize - 1);
+    const std::size_t endPage = (m_arenaUsed + m_code.size() + HostPageSize - 1) & ~(HostPageSize - 1);
+    if (!SetArenaExecutable(m_arena + firstPage, endPage - firstPage, false))
+        return nullptr;
+    std::memcpy(code, m_code.data(), m_code.size());
+    if (!SetArenaExecutable(m_arena + firstPage, endPage - firstPage, true))
+    {
+        TRACE_ERROR("Cannot make recompiled code executable");
+        return nullptr;
+    }
+    // Keep the next block 16 byte aligned
+    m_arenaUsed += (m_code.size() + 15) & ~std::size_t{ 15 };
+    return reinterpret_cast<Z80NativeBlock>(code);
+}
+
+bool Z80Recompiler::CreateArena()
+{
+    m_arena = AllocateArena(ArenaSize);
+    if ((m_arena != nullptr) && !SetArenaExecutable(m_arena, ArenaSize, true))
+    {
+        FreeArena(m_arena, ArenaSize);
+        m_arena = nullptr;
+    }
+    if (m_arena == nullptr)
+    {
+        TRACE_ERROR("Cannot allocate memory for recompiled code");
+        m_arenaFailed = true;
+    }
+    return !m_arenaFailed;
+}
+
+void Z80Recompiler::Emit8(uint8_t value)
+{
+    m_code.push_back(value);
+}
+
+void Z80Recompiler::Emit16(uint16_t value)
+{
+    Emit8(static_cast<uint8_t>(value & 0xFF));
+    Emit8(static_cast<uint8_t>(value >> 8));
+}
+
+void Z80Recompiler::Emit32(uint32_t value)
+{
+    Emit16(static_cast<uint16_t>(value & 0xFFFF));
+    Emit16(static_cast<uint16_t>(value >> 16));
+}
+
+void Z80Recompiler::Emit64(uint64_t value)
+{
+    Emit32(static_cast<uint32_t>(value & 0xFFFFFFFF));
+    Emit32(static_cast<uint32_t>(value >> 32));
+}
+
+void Z80Recompiler::EmitBytes(std::initializer_list<uint8_t> bytes)
+{
+    m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+}
+
+void Z80Recompiler::EmitRex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force)
+{
+    auto rex = static_cast<uint8_t>(0x40 | (wide ? 0x08 : 0) | ((reg & 0x08) >> 1) | ((index & 0x08) >> 2) | ((base & 0x08) >> 3));
+    if ((rex != 0x40) || force)
+        Emit8(rex);
+}
+
+void Z80Recompiler::EmitCPUOperand(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t offset, bool wide, bool byteRegister)
+{
+    // The operand size prefix goes before REX
+    auto byte = opcode.begin();
+    if (*byte == 0x66)
+        Emit8(*byte++);
+    EmitRex(wide, reg, 0, RBX, byteRegister);
+    for (; byte != opcode.end(); ++byte)
+        Emit8(*byte);
+    // rm = rbx, mod = 01 (disp8) or 10 (disp32)
+    if ((offset >= -128) && (offset <= 127))
+    {
+        Emit8(static_cast<uint8_t>(0x40 | ((reg & 0x07) << 3) | RBX));
+        Emit8(static_cast<uint8_t>(offset));
+    }
+    else
+    {
+        Emit8(static_cast<uint8_t>(0x80 | ((reg & 0x07) << 3) | RBX));
+        Emit32(static_cast<uint32_t>(offset));
+    }
+}
+
+void Z80Recompiler::EmitRegisters(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm, bool wide, bool byteRegister)
+{
+    EmitRex(wide, reg, 0, rm, byteRegister);
+    EmitBytes(opcode);
+    Emit8(static_cast<uint8_t>(0xC0 | ((reg & 0x07) << 3) | (rm & 0x07)));
+}
+
+void Z80Recompiler::EmitFlagTableOperand(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t index, int32_t offset)
+{
+    EmitRex(false, reg, index, R12, false);
+    EmitBytes(opcode);
+    // mod = 10 (disp32), rm = SIB, base = r12
+    Emit8(static_cast<uint8_t>(0x84 | ((reg & 0x07) << 3)));
+    Emit8(static_cast<uint8_t>(((index & 0x07) << 3) | (R12 & 0x07)));
+    Emit32(static_cast<uint32_t>(offset));
+}
+
+void Z80Recompiler::EmitJump(uint8_t condition, std::size_t exit)
+{
+    // jmp / jcc rel32, patched once the position of the exit is known
+    if (condition == Always)
+        Emit8(0xE9);
+    else
+        EmitBytes({ 0x0F, condition });
+    m_exits[exit].Jumps.push_back(m_code.size());
+    Emit32(0);
+}
+
+void Z80Recompiler::Patch(const std::vector<std::size_t> &positions, std::size_t target)
+{
+    for (auto position : positions)
+    {
+        auto relative = static_cast<int32_t>(target - (position + 4));
+        std::memcpy(&m_code[position], &relative, sizeof(relative));
+    }
+}
+
+void Z80Recompiler::EmitPrologue()
+{
+    EmitBytes({ 0x53 });                                                // push rbx
+    EmitBytes({ 0x55 });                                                // push rbp
+    EmitBytes({ 0x41, 0x54 });                                          // push r12
+    EmitBytes({ 0x41, 0x55 });                                          // push r13
+    EmitBytes({ 0x41, 0x56 });                                          // push r14
+    EmitBytes({ 0x41, 0x57 });                                          // push r15
+    EmitBytes({ 0x57 });                                                // push rdi
+    EmitBytes({ 0x48, 0x83, 0xEC, 0x20 });                              // sub rsp, 32 (shadow space, keeps rsp 16 byte aligned)
+    EmitRegisters({ 0x89 }, FirstArgument, RBX, true);                  // mov rbx, cpu
+    EmitRegisters({ 0x89 }, SecondArgument, RBP, true);                 // mov rbp, deadline
+    EmitBytes({ 0x49, 0xBC });                                          // mov r12, FlagTables
+    Emit64(reinterpret_cast<uint64_t>(&FlagTables));
+}
+
+void Z80Recompiler::EmitEpilogue()
+{
+    EmitBytes({ 0x48, 0x83, 0xC4, 0x20 });                              // add rsp, 32
+    EmitBytes({ 0x5F });                                                // pop rdi
+    EmitBytes({ 0x41, 0x5F });                                          // pop r15
+    EmitBytes({ 0x41, 0x5E });                                          // pop r14
+    EmitBytes({ 0x41, 0x5D });                                          // pop r13
+    EmitBytes({ 0x41, 0x5C });                                          // pop r12
+    EmitBytes({ 0x5D });                                                // pop rbp
+    EmitBytes({ 0x5B });                                                // pop rbx
+    EmitBytes({ 0xC3 });                                                // ret
+}
+
+// Completes the state in memory and returns the instruction count
+void Z80Recompiler::EmitExit(const ExitState &state)
+{
+    if (state.ClockLoaded)
+        EmitCPUOperand({ 0x89 }, RCX, m_layout.CPUClock, true);         // mov qword [clock], rcx
+    if (state.RefreshCount != 0)
+        StoreRefresh(state.RefreshCount);
+    if (state.StorePC)
+    {
+        EmitCPUOperand({ 0x66, 0xC7 }, 0, m_layout.PC);                 // mov word [PC], imm16
+        Emit16(state.PC);
+    }
+    StoreRegisters(state.DirtyRegisters);
+    Emit8(0xB8);                                                        // mov eax, count
+    Emit32(state.Count);
+    Emit8(0xE9);                                                        // jmp epilogue
+    m_epilogueJumps.push_back(m_code.size());
+    Emit32(0);
+}
+
+Z80Recompiler::ExitState Z80Recompiler::CurrentState(uint32_t count, const Z80DecodedInstruction &instruction, bool storePC) const
+{
+    return ExitState{ count, instruction.RefreshCount, m_dirtyRegisters, m_clockLoaded, storePC, instruction.NextAddress };
+}
+
+std::size_t Z80Recompiler::AddExit(const ExitState &state)
+{
+    m_exits.push_back(Exit{ state, {} });
+    return m_exits.size() - 1;
+}
+
+void Z80Recompiler::LoadRegister(uint8_t field)
+{
+    const auto bit = static_cast<uint8_t>(1 << field);
+    if ((m_loadedRegisters & bit) != 0)
+        return;
+    // movzx reg32, byte [register]
+    EmitCPUOperand({ 0x0F, 0xB6 }, HostRegisterByField[field], m_layout.Registers + RegisterFieldOffset[field]);
+    m_loadedRegisters |= bit;
+}
+
+// The register is written without being read first
+void Z80Recompiler::DefineRegister(uint8_t field)
+{
+    const auto bit = static_cast<uint8_t>(1 << field);
+    m_loadedRegisters |= bit;
+    m_dirtyRegisters |= bit;
+}
+
+void Z80Recompiler::StoreRegisters(uint8_t registers)
+{
+    for (uint8_t field = 0; field < 8; ++field)
+    {
+        // mov byte [register], reg8
+        if ((registers & (1 << field)) != 0)
+            EmitCPUOperand({ 0x88 }, HostRegisterByField[field], m_layout.Registers + RegisterFieldOffset[field], false, true);
+    }
+}
+
+void Z80Recompiler::LoadClock()
+{
+    if (m_clockLoaded)
+        return;
+    EmitCPUOperand({ 0x8B }, RCX, m_layout.CPUClock, true);             // mov rcx, qword [clock]
+    m_clockLoaded = true;
+}
+
+void Z80Recompiler::StoreClock()
+{
+    if (!m_clockLoaded)
+        return;
+    EmitCPUOperand({ 0x89 }, RCX, m_layout.CPUClock, true);             // mov qword [clock], rcx
+    m_clockLoaded = false;
+}
+
+// R = (R & 0x80) | ((R + count) & 0x7F)
+void Z80Recompiler::StoreRefresh(uint8_t count)
+{
+    EmitCPUOperand({ 0x0F, 0xB6 }, RAX, m_layout.R);                    // movzx eax, byte [R]
+    EmitBytes({ 0x8D, 0x50, count });                                   // lea edx, [rax + count]
+    EmitBytes({ 0x25, 0x80, 0x00, 0x00, 0x00 });                        // and eax, 0x80
+    EmitBytes({ 0x83, 0xE2, 0x7F });                                    // and edx, 0x7F
+    EmitBytes({ 0x09, 0xD0 });                                          // or eax, edx
+    EmitCPUOperand({ 0x88 }, RAX, m_layout.R);                          // mov byte [R], al
+}
+
+// Everything a handler may look at goes back to memory
+void Z80Recompiler::WriteBack()
+{
+    StoreRegisters(m_dirtyRegisters);
+    m_loadedRegisters = 0;
+    m_dirtyRegisters = 0;
+    StoreClock();
+}
+
+// Translates unprefixed register-only instructions, returns false for all others. These cannot branch or write memory,
+// so the deadline is the only way out
+bool Z80Recompiler::EmitNativeInstruction(const Z80DecodedInstruction &instruction, uint32_t count)
+{
+    if (instruction.PrefixTStates != 0)
+        return false;
+    const uint8_t opcode = instruction.Opcode;
+    const auto x = static_cast<uint8_t>(opcode >> 6);
+    const auto y = static_cast<uint8_t>((opcode >> 3) & 0x07);
+    const auto z = static_cast<uint8_t>(opcode & 0x07);
+    const auto operand = static_cast<uint8_t>(instruction.Operand & 0xFF);
+    // Field 6 is (HL), and 0x76 HALT. None of these has a data access, their T-states are those of the fetches
+    uint8_t tStates = 4;
+    if ((x == 1) && (y != 6) && (z != 6))
+        EmitLoadRegister(y, z);
+    else if ((x == 0) && (z == 6) && (y != 6))
+    {
+        EmitLoadImmediate(y, operand);
+        tStates = 7;
+    }
+    else if ((x == 0) && ((z == 4) || (z == 5)) && (y != 6))
+        EmitIncDec(y, z == 5);
+    else if ((x == 2) && (z != 6))
+        EmitALU(y, z, false, 0);
+    else if ((x == 3) && (z == 6))
+    {
+        EmitALU(y, 0, true, operand);
+        tStates = 7;
+    }
+    else
+        return false;
+    LoadClock();
+    EmitRegisters({ 0x83 }, 0, RCX, true);                              // add rcx, T-states
+    Emit8(tStates);
+    EmitRegisters({ 0x39 }, RBP, RCX, true);                            // cmp rcx, rbp
+    EmitJump(ConditionAboveOrEqual, AddExit(CurrentState(count, instruction, true)));
+    return true;
+}
+
+void Z80Recompiler::EmitLoadRegister(uint8_t destination, uint8_t source)
+{
+    if (destination == source)
+        return;
+    LoadRegister(source);
+    DefineRegister(destination);
+    EmitRegisters({ 0x89 }, HostRegisterByField[source], HostRegisterByField[destination]);    // mov dst32, src32
+}
+
+void Z80Recompiler::EmitLoadImmediate(uint8_t destination, uint8_t value)
+{
+    const uint8_t host = HostRegisterByField[destination];
+    DefineRegister(destination);
+    EmitRex(false, 0, 0, host, false);                                  // mov dst32, imm32
+    Emit8(static_cast<uint8_t>(0xB8 + (host & 0x07)));
+    Emit32(value);
+}
+
+// The flags are set as in Z80Registers. For the arithmetic operations x86 computes the same S, Z, H and C, with its
+// flags in the same bit positions (lahf), only P/V has to come from the overflow flag
+void Z80Recompiler::EmitALU(uint8_t operation, uint8_t source, bool immediate, uint8_t value)
+{
+    const uint8_t hostSource = HostRegisterByField[source];
+    LoadRegister(FieldA);
+    if (!immediate)
+        LoadRegister(source);
+    if ((operation == OperationAND) || (operation == OperationXOR) || (operation == OperationOR))
+    {
+        const std::size_t logic = operation - OperationAND;
+        if (immediate)
+        {
+            EmitRegisters({ 0x81 }, LogicImmediateOperations[logic], HostA);   // op r15d, imm32
+            Emit32(value);
+        }
+        else
+        {
+            EmitRegisters({ LogicOpcodes[logic] }, hostSource, HostA);  // op r15d, src32
+        }
+        DefineRegister(FieldA);
+        DefineRegister(FieldF);
+        // movzx edi, byte [SZ53P + r15]
+        EmitFlagTableOperand({ 0x0F, 0xB6 }, HostF, HostA, static_cast<int32_t>(offsetof(Z80FlagTables, SZ53P)));
+        if (operation == OperationAND)
+        {
+            EmitRegisters({ 0x83 }, 1, HostF);                          // or edi, H
+            Emit8(flagHC);
+        }
+        return;
+    }
+
+    const bool carryIn = (operation == OperationADC) || (operation == OperationSBC);
+    if (carryIn)
+        LoadRegister(FieldF);
+    EmitRegisters({ 0x31 }, RDX, RDX);                                  // xor edx, edx
+    EmitRegisters({ 0x89 }, HostA, RAX);                                // mov eax, r15d
+    if (carryIn)
+    {
+        EmitRegisters({ 0x0F, 0xBA }, 4, HostF);                        // bt edi, 0
+        Emit8(0);
+    }
+    if (immediate)
+    {
+        Emit8(static_cast<uint8_t>(ArithmeticOpcodes[operation] + 4)); // op al, imm8
+        Emit8(value);
+    }
+    else
+    {
+        EmitRegisters({ ArithmeticOpcodes[operation] }, hostSource, RAX, false, true);   // op al, src8
+    }
+    EmitBytes({ 0x9F });                                                // lahf
+    EmitBytes({ 0x0F, 0x90, 0xC2 });                                    // seto dl
+    EmitBytes({ 0x0F, 0xB6, 0xFC });                                    // movzx edi, ah
+    EmitRegisters({ 0x83 }, 4, HostF);                                  // and edi, S | Z | H | C
+    Emit8(flagS | flagZ | flagHC | flagC);
+    EmitBytes({ 0x8D, 0x3C, 0x97 });                                    // lea edi, [rdi + rdx * 4] (P/V)
+    // The undocumented bits come from the result, for CP from the operand
+    if ((operation == OperationCP) && immediate)
+    {
+        EmitRegisters({ 0x83 }, 1, HostF);                              // or edi, imm8
+        Emit8(static_cast<uint8_t>(value & (flagU1 | flagU2)));
+    }
+    else
+    {
+        EmitRegisters({ 0x89 }, (operation == OperationCP) ? hostSource : static_cast<uint8_t>(RAX), RDX);   // mov edx, result / src32
+        EmitRegisters({ 0x83 }, 4, RDX);                                // and edx, X | Y
+        Emit8(flagU1 | flagU2);
+        EmitRegisters({ 0x09 }, RDX, HostF);                            // or edi, edx
+    }
+    if (operation >= OperationSUB)
+    {
+        EmitRegisters({ 0x83 }, 1, HostF);                              // or edi, N
+        Emit8(flagN);
+    }
+    DefineRegister(FieldF);
+    if (operation != OperationCP)
+    {
+        EmitRegisters({ 0x0F, 0xB6 }, HostA, RAX, false, true);         // movzx r15d, al
+        DefineRegister(FieldA);
+    }
+}
+
+void Z80Recompiler::EmitIncDec(uint8_t field, bool decrement)
+{
+    const uint8_t host = HostRegisterByField[field];
+    LoadRegister(field);
+    LoadRegister(FieldF);
+    EmitRegisters({ 0x83 }, decrement ? 5 : 0, host);                   // add / sub reg32, 1
+    Emit8(1);
+    EmitRegisters({ 0x0F, 0xB6 }, host, host, false, true);             // movzx reg32, reg8
+    EmitRegisters({ 0x83 }, 4, HostF);                                  // and edi, C
+    Emit8(flagC);
+    // movzx eax, byte [Inc / Dec + reg]
+    EmitFlagTableOperand({ 0x0F, 0xB6 }, RAX, host,
+        static_cast<int32_t>(decrement ? offsetof(Z80FlagTables, Dec) : offsetof(Z80FlagTables, Inc)));
+    EmitRegisters({ 0x09 }, RAX, HostF);                                // or edi, eax
+    DefineRegister(field);
+    DefineRegister(FieldF);
+}
+
+// Calls the decoded handler as the block loop does, on a copy of the instruction placed after the code. Returns the exit
+// taken when the instruction branched or the deadline was reached
+std::size_t Z80Recompiler::EmitHandlerCall(const Z80DecodedInstruction &instruction, uint32_t count, const LoopBranch *loop)
+{
+    WriteBack();
+    EmitCPUOperand({ 0x66, 0xC7 }, 0, m_layout.PC);                     // mov word [PC], imm16
+    Emit16(instruction.NextAddress);
+    EmitRegisters({ 0x89 }, RBX, FirstArgument, true);                  // mov first argument, rbx
+    EmitRex(true, SecondArgument, 0, 0, false);                         // lea second argument, [rip + instruction]
+    EmitBytes({ 0x8D, static_cast<uint8_t>(0x05 | ((SecondArgument & 0x07) << 3)) });
+    m_instructionReferences.push_back(m_code.size());
+    m_instructionData.push_back(instruction);
+    Emit32(0);
+    EmitBytes({ 0x48, 0xB8 });                                          // mov rax, handler
+    Emit64(reinterpret_cast<uint64_t>(instruction.Execute));
+    EmitBytes({ 0xFF, 0xD0 });                                          // call rax
+    std::size_t exit = AddExit(CurrentState(count, instruction, false));
+    // A branch leaves the block, unless it is a loop staying inside
+    EmitCPUOperand({ 0x66, 0x81 }, 7, m_layout.PC);                     // cmp word [PC], imm16
+    Emit16(instruction.NextAddress);
+    if (loop != nullptr)
+    {
+        EmitBytes({ 0x0F, ConditionNotEqual });                         // jne loop branch
+        m_loopBranches.push_back(*loop);
+        m_loopBranches.back().Jump = m_code.size();
+        m_loopBranches.back().Exit = exit;
+        Emit32(0);
+    }
+    else
+    {
+        EmitJump(ConditionNotEqual, exit);
+    }
+    EmitCPUOperand({ 0x39 }, RBP, m_layout.CPUClock, true);             // cmp qword [clock], rbp
+    EmitJump(ConditionAboveOrEqual, exit);
+    return exit;
+}
+
+void Z80Recompiler::EmitGenerationChecks(const Z80DecodedBlock &block, const PagedMemoryMap &memoryMap, std::size_t exit)
+{
+    EmitGenerationCheck(memoryMap.WriteGenerationAddress(block.FirstPage), block.FirstPageGeneration, exit);
+    if (block.LastPage != block.FirstPage)
+        EmitGenerationCheck(memoryMap.WriteGenerationAddress(block.LastPage), block.LastPageGeneration, exit);
+}
+
+// Leaves the block when the instruction wrote to one of the pages the block was decoded from
+void Z80Recompiler::EmitGenerationCheck(const uint32_t *generation, uint32_t expected, std::size_t exit)
+{
+    EmitBytes({ 0x48, 0xB8 });                                          // mov rax, generation
+    Emit64(reinterpret_cast<uint64_t>(generation));
+    EmitBytes({ 0x81, 0x38 });                                          // cmp dword [rax], imm32
+    Emit32(expected);
+    EmitJump(ConditionNotEqual, exit);
+}
+
+// Continues the loop under the same conditions as the block loop of the interpreter. Nothing is in host registers after
+// a handler call, so the state at the start of the loop is the one in memory, apart from R and the instruction count
+void Z80Recompiler::EmitLoopBranch(const Z80DecodedBlock &block, const PagedMemoryMap &memoryMap, const LoopBranch &loop)
+{
+    Patch({ loop.Jump }, m_code.size());
+    EmitCPUOperand({ 0x66, 0x81 }, 7, m_layout.PC);                     // cmp word [PC], imm16
+    Emit16(loop.Address);
+    EmitJump(ConditionNotEqual, loop.Exit);
+    EmitCPUOperand({ 0x39 }, RBP, m_layout.CPUClock, true);             // cmp qword [clock], rbp
+    EmitJump(ConditionAboveOrEqual, loop.Exit);
+    if (block.IsWritable)
+        EmitGenerationChecks(block, memoryMap, loop.Exit);
+    StoreRefresh(loop.RefreshCount);
+    EmitCPUOperand({ 0x81 }, 0, m_layout.InstructionCount, true);       // add qword [instruction count], imm32
+    Emit32(loop.Count);
+    Emit8(0xE9);                                                        // jmp loop start
+    Emit32(static_cast<uint32_t>(static_cast<int32_t>(loop.Start - (m_code.size() + 4))));
+}
@@ -1,52 +1,16 @@
 #include "Model/Z80Registers.h"
 
+#include "Model/Z80Flags.h"
+
+#include <cstring>
 #include <iomanip>
 #include <sstream>
-#include "Utility/Serialization.h"
-
-// Fast flag computation lookup table
-static uint8_t FlagsLookupTable[256]; // OR,XOR and more
-
-// Flags
-#define flagS  0x80
-#define flagZ  0x40
-#define flagHC 0x10
-#define flagPV 0x04
-#define flagN  0x02
-#define flagC  0x01
-
-// Undocumented flags
-#define flagU1 0x08
-#define flagU2 0x20
-
-/* calculates an even parity for the given 8-bit number */
-static bool OddParity8(uint8_t x)
-{
-    x ^= x >> 4;
-    x ^= x >> 2;
-    x ^= x >> 1;
-    x ^= 1;
-
-    return (x & 1) != 0;
-}
-
-static void InitializeFlagsTable()
-{
-    for (unsigned i = 0; i < 256; ++i)
-    {
-        FlagsLookupTable[i] = static_cast<uint8_t>(i & (flagS | flagU1 | flagU2));
-        if (OddParity8(static_cast<uint8_t>(i)))
-            FlagsLookupTable[i] |= flagPV;
-    }
-    FlagsLookupTable[0] |= flagZ;
-}
+#include "utility/Serialization.h"
 
 void Z80Registers::Reset()
 {
-    std::memset(Reg, 0, sizeof(Reg));
-    F = {};
-    std::memset(Reg_, 0, sizeof(Reg_));
-    F_ = {};
+    std::memset(Pair, 0, sizeof(Pair));
+    std::memset(Pair_, 0, sizeof(Pair_));
     I = {};
     IX = {};
     IY = {};
@@ -62,7 +26,6 @@ void Z80Registers::Reset()
     NMIPending = {};
     Modifier    = {};
     Halted = {};
-    InitializeFlagsTable();
 }
 
 std::string LogValue(bool value)
@@ -87,7 +50,9 @@ std::string LogFlags(uint8_t value)
     std::ostringstream stream;
     stream << "S=" << LogValue(static_cast<bool>(value & 0x80)) << " ";
     stream << "Z=" << LogValue(static_cast<bool>(value & 0x40)) << " ";
-    stream << "N=" << LogValue(static_cast<bool>(value & 0x20)) << " ";
+    stream << "Y=" << LogValue(static_cast<bool>(value & 0x20)) << " ";
+    stream << "H=" << LogValue(static_cast<bool>(value & 0x10)) << " ";
+    stream << "X=" << LogValue(static_cast<bool>(value & 0x08)) << " ";
     stream << "P/V=" << LogValue(static_cast<bool>(value & 0x04)) << " ";
     stream << "N=" << LogValue(static_cast<bool>(value & 0x02)) << " ";
     stream << "C=" << LogValue(static_cast<bool>(value & 0x01)) << " ";
@@ -97,23 +62,23 @@ std::string LogFlags(uint8_t value)
 std::string Z80Registers::Dump()
 {
     std::ostringstream stream;
-    stream << "A  = " << LogValue(Reg[7]) << "\n";
-    stream << "B  = " << LogValue(Reg[0]) << "\n";
-    stream << "C  = " << LogValue(Reg[1]) << "\n";
-    stream << "D  = " << LogValue(Reg[2]) << "\n";
-    stream << "E  = " << LogValue(Reg[3]) << "\n";
-    stream << "H  = " << LogValue(Reg[4]) << "\n";
-    stream << "L  = " << LogValue(Reg[5]) << "\n";
-    stream << "F  = " << LogFlags(F) << "\n";
-
-    stream << "A' = " << LogValue(Reg_[7]) << "\n";
-    stream << "B' = " << LogValue(Reg_[0]) << "\n";
-    stream << "C' = " << LogValue(Reg_[1]) << "\n";
-    stream << "D' = " << LogValue(Reg_[2]) << "\n";
-    stream << "E' = " << LogValue(Reg_[3]) << "\n";
-    stream << "H' = " << LogValue(Reg_[4]) << "\n";
-    stream << "L' = " << LogValue(Reg_[5]) << "\n";
-    stream << "F' = " << LogFlags(F_) << "\n";
+    stream << "A  = " << LogValue(Reg[RegisterIndex::A]) << "\n";
+    stream << "B  = " << LogValue(Reg[RegisterIndex::B]) << "\n";
+    stream << "C  = " << LogValue(Reg[RegisterIndex::C]) << "\n";
+    stream << "D  = " << LogValue(Reg[RegisterIndex::D]) << "\n";
+    stream << "E  = " << LogValue(Reg[RegisterIndex::E]) << "\n";
+    stream << "H  = " << LogValue(Reg[RegisterIndex::H]) << "\n";
+    stream << "L  = " << LogValue(Reg[RegisterIndex::L]) << "\n";
+    stream << "F  = " << LogFlags(F()) << "\n";
+
+    stream << "A' = " << LogValue(Reg_[RegisterIndex::A]) << "\n";
+    stream << "B' = " << LogValue(Reg_[RegisterIndex::B]) << "\n";
+    stream << "C' = " << LogValue(Reg_[RegisterIndex::C]) << "\n";
+    stream << "D' = " << LogValue(Reg_[RegisterIndex::D]) << "\n";
+    stream << "E' = " << LogValue(Reg_[RegisterIndex::E]) << "\n";
+    stream << "H' = " << LogValue(Reg_[RegisterIndex::H]) << "\n";
+    stream << "L' = " << LogValue(Reg_[RegisterIndex::L]) << "\n";
+    stream << "F' = " << LogFlags(Reg_[RegisterIndex::F]) << "\n";
 
     stream << "I  = " << LogValue(I) << "\n";
     stream << "R  = " << LogValue(R) << "\n";
@@ -133,43 +98,259 @@ std::string Z80Registers::Dump()
     return stream.str();
 }
 
-void Z80Registers::SetAF(uint16_t val)
+void Z80Registers::LoadInterruptRegister(uint8_t value)
+{
+    Reg[RegisterIndex::A] = value;
+    F() = static_cast<uint8_t>((F() & flagC) | (FlagTables.SZ53[value]) | (IFF2 ? flagPV : 0));
+}
+
+void Z80Registers::Add8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    unsigned result = a + value;
+    unsigned index = Z80FlagTables::Index(a, value, result);
+    a = static_cast<uint8_t>(result);
+    F() = static_cast<uint8_t>(((result >> 8) & flagC) | FlagTables.HalfCarryAdd[index & 0x07] | FlagTables.OverflowAdd[index >> 4] | FlagTables.SZ53[a]);
+}
+
+void Z80Registers::Adc8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    unsigned result = a + value + (F() & flagC);
+    unsigned index = Z80FlagTables::Index(a, value, result);
+    a = static_cast<uint8_t>(result);
+    F() = static_cast<uint8_t>(((result >> 8) & flagC) | FlagTables.HalfCarryAdd[index & 0x07] | FlagTables.OverflowAdd[index >> 4] | FlagTables.SZ53[a]);
+}
+
+void Z80Registers::Sub8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    unsigned result = a - value;
+    unsigned index = Z80FlagTables::Index(a, value, result);
+    a = static_cast<uint8_t>(result);
+    F() = static_cast<uint8_t>(((result >> 8) & flagC) | flagN | FlagTables.HalfCarrySub[index & 0x07] | FlagTables.OverflowSub[index >> 4] | FlagTables.SZ53[a]);
+}
+
+void Z80Registers::Sbc8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    unsigned result = a - value - (F() & flagC);
+    unsigned index = Z80FlagTables::Index(a, value, result);
+    a = static_cast<uint8_t>(result);
+    F() = static_cast<uint8_t>(((result >> 8) & flagC) | flagN | FlagTables.HalfCarrySub[index & 0x07] | FlagTables.OverflowSub[index >> 4] | FlagTables.SZ53[a]);
+}
+
+void Z80Registers::Cp8(uint8_t value)
+{
+    // The undocumented bits are copied from the operand, not the result
+    uint8_t a = Reg[RegisterIndex::A];
+    unsigned result = a - value;
+    unsigned index = Z80FlagTables::Index(a, value, result);
+    F() = static_cast<uint8_t>(((result >> 8) & flagC) | flagN | FlagTables.HalfCarrySub[index & 0x07] | FlagTables.OverflowSub[index >> 4] |
+        FlagTables.SZ[result & 0xFF] | (value & (flagU1 | flagU2)));
+}
+
+void Z80Registers::And8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    a &= value;
+    F() = static_cast<uint8_t>(flagHC | FlagTables.SZ53P[a]);
+}
+
+void Z80Registers::Or8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    a |= value;
+    F() = FlagTables.SZ53P[a];
+}
+
+void Z80Registers::Xor8(uint8_t value)
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    a ^= value;
+    F() = FlagTables.SZ53P[a];
+}
+
+uint8_t Z80Registers::Inc8(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>(value + 1);
+    F() = static_cast<uint8_t>((F() & flagC) | FlagTables.Inc[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Dec8(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>(value - 1);
+    F() = static_cast<uint8_t>((F() & flagC) | FlagTables.Dec[result]);
+    return result;
+}
+
+void Z80Registers::Daa()
+{
+    // The correction is computed from compares instead of a 2048 entry table, which would not fit the flag table budget
+    uint8_t &a = Reg[RegisterIndex::A];
+    uint8_t original = a;
+    bool lowAdjust = ((F() & flagHC) != 0) | ((original & 0x0F) > 9);
+    bool highAdjust = ((F() & flagC) != 0) | (original > 0x99);
+    uint8_t correction = static_cast<uint8_t>((lowAdjust ? 0x06 : 0x00) | (highAdjust ? 0x60 : 0x00));
+    uint8_t halfCarry;
+    if (F() & flagN)
+    {
+        a = static_cast<uint8_t>(original - correction);
+        halfCarry = (lowAdjust && ((original & 0x0F) < 6)) ? flagHC : 0;
+    }
+    else
+    {
+        a = static_cast<uint8_t>(original + correction);
+        halfCarry = ((original & 0x0F) > 9) ? flagHC : 0;
+    }
+    F() = static_cast<uint8_t>((F() & flagN) | (highAdjust ? flagC : 0) | halfCarry | FlagTables.SZ53P[a]);
+}
+
+void Z80Registers::Cpl()
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    a = static_cast<uint8_t>(~a);
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV | flagC)) | flagHC | flagN | (a & (flagU1 | flagU2)));
+}
+
+void Z80Registers::Neg()
+{
+    uint8_t value = Reg[RegisterIndex::A];
+    Reg[RegisterIndex::A] = 0;
+    Sub8(value);
+}
+
+void Z80Registers::Scf()
+{
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | flagC | (Reg[RegisterIndex::A] & (flagU1 | flagU2)));
+}
+
+void Z80Registers::Ccf()
+{
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | ((F() & flagC) ? flagHC : flagC) | (Reg[RegisterIndex::A] & (flagU1 | flagU2)));
+}
+
+void Z80Registers::Rlca()
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    a = static_cast<uint8_t>((a << 1) | (a >> 7));
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | (a & (flagC | flagU1 | flagU2)));
+}
+
+void Z80Registers::Rrca()
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    uint8_t carry = a & flagC;
+    a = static_cast<uint8_t>((a >> 1) | (a << 7));
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | carry | (a & (flagU1 | flagU2)));
+}
+
+void Z80Registers::Rla()
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    uint8_t carry = static_cast<uint8_t>(a >> 7);
+    a = static_cast<uint8_t>((a << 1) | (F() & flagC));
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | carry | (a & (flagU1 | flagU2)));
+}
+
+void Z80Registers::Rra()
+{
+    uint8_t &a = Reg[RegisterIndex::A];
+    uint8_t carry = a & flagC;
+    a = static_cast<uint8_t>((a >> 1) | (F() << 7));
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | carry | (a & (flagU1 | flagU2)));
+}
+
+uint8_t Z80Registers::Rlc(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>((value << 1) | (value >> 7));
+    F() = static_cast<uint8_t>((result & flagC) | FlagTables.SZ53P[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Rrc(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>((value >> 1) | (value << 7));
+    F() = static_cast<uint8_t>((value & flagC) | FlagTables.SZ53P[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Rl(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>((value << 1) | (F() & flagC));
+    F() = static_cast<uint8_t>((value >> 7) | FlagTables.SZ53P[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Rr(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>((value >> 1) | (F() << 7));
+    F() = static_cast<uint8_t>((value & flagC) | FlagTables.SZ53P[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Sla(uint8_t value)
+{
+    uint8_t result = static_cast<uint8_t>(value << 1);
+    F() = static_cast<uint8_t>((value >> 7) | FlagTables.SZ53P[result]);
+    return result;
+}
+
+uint8_t Z80Registers::Sra(uint8_t value)
 {
-    Reg[RegisterIndex::A] = static_cast<uint8_t>(val >> 8);
-    F = static_cast<uint8_t>(val & 0xFF);
+    uint8_t result = static_cast<uint8_t>((value & 0x80) | (value >> 1));
+    F() = static_cast<uint8_t>((value & flagC) | FlagTables.SZ53P[result]);
+    return result;
 }
 
-void Z80Registers::SetBC(uint16_t val)
+uint8_t Z80Registers::Sll(uint8_t value)
 {
-    Reg[RegisterIndex::B] = static_cast<uint8_t>(val >> 8);
-    Reg[RegisterIndex::C] = static_cast<uint8_t>(val & 0xFF);
+    // Undocumented: shifts in a 1
+    uint8_t result = static_cast<uint8_t>((value << 1) | 0x01);
+    F() = static_cast<uint8_t>((value >> 7) | FlagTables.SZ53P[result]);
+    return result;
 }
 
-void Z80Registers::SetDE(uint16_t val)
+uint8_t Z80Registers::Srl(uint8_t value)
 {
-    Reg[RegisterIndex::D] = static_cast<uint8_t>(val >> 8);
-    Reg[RegisterIndex::E] = static_cast<uint8_t>(val & 0xFF);
+    uint8_t result = static_cast<uint8_t>(value >> 1);
+    F() = static_cast<uint8_t>((value & flagC) | FlagTables.SZ53P[result]);
+    return result;
 }
 
-void Z80Registers::SetHL(uint16_t val)
+void Z80Registers::Bit(uint8_t bit, uint8_t value)
 {
-    Reg[RegisterIndex::H] = static_cast<uint8_t>(val >> 8);
-    Reg[RegisterIndex::L] = static_cast<uint8_t>(val & 0xFF);
+    // The tested bit alone has odd parity when set, so P/V ends up equal to Z
+    uint8_t tested = static_cast<uint8_t>(value & (1 << bit));
+    F() = static_cast<uint8_t>((F() & flagC) | flagHC | (value & (flagU1 | flagU2)) | (FlagTables.SZ53P[tested] & (flagS | flagZ | flagPV)));
 }
 
-void Z80Registers::SetPC(uint16_t val)
+uint16_t Z80Registers::Add16(uint16_t op1, uint16_t op2)
 {
-    PC = val;
+    unsigned result = op1 + op2;
+    unsigned index = Z80FlagTables::Index(op1 >> 8, op2 >> 8, result >> 8);
+    F() = static_cast<uint8_t>((F() & (flagS | flagZ | flagPV)) | ((result >> 16) & flagC) | ((result >> 8) & (flagU1 | flagU2)) |
+        FlagTables.HalfCarryAdd[index & 0x07]);
+    return static_cast<uint16_t>(result);
 }
 
-static uint8_t xor8(uint8_t a, uint8_t b)
+void Z80Registers::Adc16(uint16_t value)
 {
-    return static_cast<uint8_t>(a ^ b);
+    uint16_t hl = GetHL();
+    unsigned result = hl + value + (F() & flagC);
+    unsigned index = Z80FlagTables::Index(hl >> 8, value >> 8, result >> 8);
+    SetHL(static_cast<uint16_t>(result));
+    F() = static_cast<uint8_t>(((result >> 16) & flagC) | FlagTables.OverflowAdd[index >> 4] | ((result >> 8) & (flagS | flagU1 | flagU2)) |
+        FlagTables.HalfCarryAdd[index & 0x07] | (((result & 0xFFFF) == 0) ? flagZ : 0));
 }
 
-void Z80Registers::XOR(RegisterIndex op1, RegisterIndex op2, RegisterIndex result)
+void Z80Registers::Sbc16(uint16_t value)
 {
-    uint8_t res = xor8(Reg[op1], Reg[op2]);
-    Reg[result] = res;
-    F = FlagsLookupTable[res];
+    uint16_t hl = GetHL();
+    unsigned result = hl - value - (F() & flagC);
+    unsigned index = Z80FlagTables::Index(hl >> 8, value >> 8, result >> 8);
+    SetHL(static_cast<uint16_t>(result));
+    F() = static_cast<uint8_t>(((result >> 16) & flagC) | flagN | FlagTables.OverflowSub[index >> 4] | ((result >> 8) & (flagS | flagU1 | flagU2)) |
+        FlagTables.HalfCarrySub[index & 0x07] | (((result & 0xFFFF) == 0) ? flagZ : 0));
 }
@@ -1,16 +1,51 @@
 #include "Model/ZXSpectrum.h"
 
-#include <Windows.h>
+#include <algorithm>
+#include <array>
+#include "utility/Deserialization.h"
+#include "utility/Serialization.h"
 
-void WaitForInput()
+ZXSpectrum::ZXSpectrum()
+    : ZXSpectrum(Spectrum48K)
 {
-    while ((GetKeyState(VK_RETURN) & 0x8000) == 0);
-    while ((GetKeyState(VK_RETURN) & 0x8000) != 0);
 }
 
-ZXSpectrum::ZXSpectrum()
-    : m_cpu{ 3500000 }
+ZXSpectrum::ZXSpectrum(const ZXSpectrumModel &model)
+    : m_model{ model }
+    , m_cpu{ model.CPUClockFreq }
+    , m_memory{ model.ROMBankCount, model.RAMBankCount, model.ContendedRAMBanks }
+    , m_ula{ DisplayMemoryAddress }
+    , m_frameEndClock{}
+    , m_frameCount{}
+    , m_contention{ m_cpu, model }
+    , m_border{ m_cpu, model.TStatesPerLine, model.FirstScreenLineTState() }
+    , m_beeper{ m_cpu, model.CPUClockFreq, model.TStatesPerFrame() }
+    , m_keyboard{}
+    , m_keyEvents{}
+    , m_ulaPort{ m_border, m_beeper, m_keyboard }
+    , m_ay{ m_cpu, model.CPUClockFreq, Beeper::SampleRate, model.TStatesPerFrame() }
+    , m_screen{}
+    , m_frames{}
+    , m_audio{}
+    , m_snapshots{ m_cpu, m_memory }
 {
+    m_cpu.SetContention(&m_contention);
+    m_cpu.MapROM(0x0000, MemoryBanks::BankSize, m_memory.ROMBank(0));
+    for (std::size_t slot = 0; slot < m_model.InitialRAMBanks.size(); ++slot)
+    {
+        const auto address = static_cast<uint16_t>((slot + 1) * MemoryBanks::BankSize);
+        const std::size_t bank = m_model.InitialRAMBanks[slot];
+        m_cpu.MapRAM(address, MemoryBanks::BankSize, m_memory.RAMBank(bank));
+        if (m_memory.IsContended(bank))
+            m_cpu.ContendAccesses(address, MemoryBanks::BankSize);
+    }
+    m_cpu.ObserveWrites(DisplayMemoryAddress, DisplayMemoryObservedSize, m_ula);
+    // The ULA answers on all even ports
+    m_cpu.AddIOMapping(IOMapping<uint16_t>{ m_ulaPort, IOAddressDecode<uint16_t>{ 0x0001, 0x0000 } });
+    // AY ports 0xFFFD and 0xBFFD: A15 set, A1 clear. A0 is checked as well, so the ULA and AY never share a port.
+    // Without the chip the AY stays silent
+    if (m_model.HasAY)
+        m_cpu.AddIOMapping(IOMapping<uint16_t>{ m_ay, IOAddressDecode<uint16_t>{ 0x8003, 0x8001 } });
 }
 
 bool ZXSpectrum::Init()
@@ -23,11 +58,78 @@ bool ZXSpectrum::Init()
 void ZXSpectrum::Reset()
 {
     m_cpu.Reset();
+    m_frameEndClock = {};
+    m_frameCount = {};
+    m_contention.Reset();
+    m_ula.Invalidate();
+    m_border.Reset();
+    m_beeper.Reset();
+    m_ay.Reset();
+    m_keyboard.Reset();
 }
 
 bool ZXSpectrum::LoadROM(const ByteVector &romContents)
 {
-    return m_cpu.LoadROM(romContents);
+    if (!m_memory.LoadROM(romContents))
+        return false;
+    m_cpu.FlushCodeCaches();
+    return true;
+}
+
+void ZXSpectrum::SaveState(SystemState &state)
+{
+    std::size_t offset{};
+    state.Data.clear();
+    serialization::SerializeBinary(StateVersion, state.Data, offset);
+    serialization::SerializeBinary(std::string{ m_model.Name }, state.Data, offset);
+    m_cpu.SaveState(state.Data, offset);
+    serialization::SerializeBinary(m_frameEndClock, state.Data, offset);
+    serialization::SerializeBinary(m_frameCount, state.Data, offset);
+    m_contention.SaveState(state.Data, offset);
+    m_border.SaveState(state.Data, offset);
+    m_beeper.SaveState(state.Data, offset);
+    m_ay.SaveState(state.Data, offset);
+    m_keyboard.SaveState(state.Data, offset);
+    SaveModelState(state.Data, offset);
+    m_snapshots.Capture(state.Pages);
+}
+
+// The CPU goes first, the beeper needs its clock. Paging goes before the RAM, so the restored pages are invalidated
+// where they are mapped now. A state that passes the header checks but is cut short leaves the machine reset
+bool ZXSpectrum::LoadState(const SystemState &state)
+{
+    std::size_t offset{};
+    uint32_t version{};
+    std::string model;
+    if (!serialization::DeserializeBinary(version, state.Data, offset) || (version != StateVersion)
+        || !serialization::DeserializeBinary(model, state.Data, offset) || (model != m_model.Name)
+        || (state.Pages.size() != m_snapshots.PageCount()))
+        return false;
+    const bool loaded = m_cpu.LoadState(state.Data, offset)
+        && serialization::DeserializeBinary(m_frameEndClock, state.Data, offset)
+        && serialization::DeserializeBinary(m_frameCount, state.Data, offset)
+        && m_contention.LoadState(state.Data, offset)
+        && m_border.LoadState(state.Data, offset)
+        && m_beeper.LoadState(state.Data, offset)
+        && m_ay.LoadState(state.Data, offset)
+        && m_keyboard.LoadState(state.Data, offset)
+        && LoadModelState(state.Data, offset)
+        && m_snapshots.Restore(state.Pages);
+    if (!loaded)
+    {
+        TRACE_ERROR("Saved state is incomplete, machine reset");
+        Reset();
+        return false;
+    }
+    m_ula.Invalidate();
+    return true;
+}
+
+void ZXSpectrum::SaveCPUState(ByteVector &buffer)
+{
+    std::size_t offset{};
+    buffer.clear();
+    m_cpu.SaveState(buffer, offset);
 }
 
 bool ZXSpectrum::IsHalted()
@@ -42,9 +144,115 @@ bool ZXSpectrum::Disassemble(std::string &mnemonic)
 
 bool ZXSpectrum::ProcessInstruction()
 {
+    ApplyKeyEvents();
     return m_cpu.ExecuteInstruction();
 }
 
+RunExitReason ZXSpectrum::RunFor(uint64_t tstates)
+{
+    ApplyKeyEvents();
+    return m_cpu.ExecuteCycles(tstates);
+}
+
+RunExitReason ZXSpectrum::RunFrame()
+{
+    // A frame interrupted by a breakpoint is resumed, otherwise a new frame starts with the ULA interrupt
+    if (m_cpu.GetCPUClock() >= m_frameEndClock)
+    {
+        // Instructions overrunning the previous frame end are carried into this frame
+        const uint64_t frameTStates = m_model.TStatesPerFrame();
+        m_frameEndClock += frameTStates;
+        m_cpu.RequestInterrupt(m_model.InterruptLength);
+        m_contention.StartFrame(m_frameEndClock - frameTStates);
+        m_border.StartFrame(m_frameEndClock - frameTStates);
+        m_beeper.StartFrame(m_frameEndClock - frameTStates);
+        m_ay.StartFrame(m_frameEndClock - frameTStates);
+    }
+    ApplyKeyEvents();
+    auto exitReason = m_cpu.ExecuteCycles(m_frameEndClock - m_cpu.GetCPUClock());
+    if (exitReason == RunExitReason::BudgetSpent)
+    {
+        ++m_frameCount;
+        ULADirtyLines changedLines = m_ula.Render(GetDisplayMemory(), m_frameCount, m_screen);
+        changedLines.Add(m_border.Render(m_screen));
+        m_frames.Publish(m_screen, changedLines, m_frameCount);
+        MixAudio(m_model.TStatesPerFrame());
+    }
+    return exitReason;
+}
+
+uint64_t ZXSpectrum::GetFrameTStates()
+{
+    return m_model.TStatesPerFrame();
+}
+
+uint64_t ZXSpectrum::GetFrameCount()
+{
+    return m_frameCount;
+}
+
+void ZXSpectrum::SetExecutionMode(ExecutionMode mode)
+{
+    m_cpu.SetExecutionMode(mode);
+}
+
+FrameMailbox &ZXSpectrum::GetFrames()
+{
+    return m_frames;
+}
+
+AudioRingBuffer &ZXSpectrum::GetAudio()
+{
+    return m_audio;
+}
+
+uint64_t ZXSpectrum::GetAudioSampleRate()
+{
+    return Beeper::SampleRate;
+}
+
+const uint8_t *ZXSpectrum::GetDisplayMemory()
+{
+    return m_memory.RAMBank(m_model.ScreenBank);
+}
+
+// Beeper and AY produce samples on the same grid, so they are added sample by sample
+void ZXSpectrum::MixAudio(uint64_t frameTStates)
+{
+    const std::size_t beeperCount = m_beeper.EndFrame(frameTStates);
+    const std::size_t ayCount = m_ay.EndFrame(frameTStates);
+    const std::size_t count = std::min(beeperCount, ayCount);
+    const int16_t *beeper = m_beeper.Samples();
+    const float *ay = m_ay.Samples();
+    std::array<int16_t, 512> mix;
+    for (std::size_t offset = 0; offset < count; offset += mix.size())
+    {
+        const std::size_t chunkSize = std::min(count - offset, mix.size());
+        for (std::size_t i = 0; i < chunkSize; ++i)
+        {
+            const float sample = static_cast<float>(beeper[offset + i]) + ay[offset + i] * AYMixLevel;
+            mix[i] = static_cast<int16_t>(std::clamp(sample, -32768.0F, 32767.0F));
+        }
+        // If the consumer falls behind (or the emulation runs faster than real time) the samples that do not fit are lost
+        m_audio.Write(mix.data(), chunkSize);
+    }
+}
+
+KeyEventQueue &ZXSpectrum::GetKeyEvents()
+{
+    return m_keyEvents;
+}
+
+// Frame numbers start at 1, the frame being run is one past the frames completed. Events for later frames stay queued
+void ZXSpectrum::ApplyKeyEvents()
+{
+    KeyEvent event{};
+    while (m_keyEvents.PopDue(m_frameCount + 1, event))
+    {
+        m_keyboard.SetKey(event.Key, event.Pressed);
+    }
+}
+
 std::string ZXSpectrum::DumpRegisters()
 {
     return m_cpu.DumpRegisters();
@@ -0,0 +1,30 @@
+#include "Model/ZXSpectrum128.h"
+
+ZXSpectrum128::ZXSpectrum128()
+    : ZXSpectrum(Spectrum128K)
+    , m_paging{ m_cpu, m_memory, m_ula, DisplayMemoryAddress, DisplayMemoryObservedSize }
+{
+    // A15 and A1 low. A0 is checked as well, so the ULA and the paging register never share a port
+    m_cpu.AddIOMapping(IOMapping<uint16_t>{ m_paging, IOAddressDecode<uint16_t>{ 0x8003, 0x0001 } });
+}
+
+void ZXSpectrum128::Reset()
+{
+    ZXSpectrum::Reset();
+    m_paging.Reset();
+}
+
+const uint8_t *ZXSpectrum128::GetDisplayMemory()
+{
+    return m_paging.GetDisplayMemory();
+}
+
+void ZXSpectrum128::SaveModelState(ByteVector &buffer, std::size_t &offset) const
+{
+    m_paging.SaveState(buffer, offset);
+}
+
+bool ZXSpectrum128::LoadModelState(const ByteVector &buffer, std::size_t &offset)
+{
+    return m_paging.LoadState(buffer, offset);
+}
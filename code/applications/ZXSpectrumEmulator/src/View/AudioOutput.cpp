@@ -0,0 +1,76 @@
+#include "View/AudioOutput.h"
+
+#include <algorithm>
+#include <cmath>
+#include <SDL3/SDL_audio.h>
+
+using namespace SDL3CPP;
+
+// Smallest rate change passed on to SDL
+static constexpr float RateResolution = 0.0005F;
+
+AudioOutput::AudioOutput()
+    : m_source{}
+    , m_stream{}
+    , m_targetFill{}
+    , m_rate{ 1.0F }
+    , m_lastSample{}
+    , m_chunk{}
+{
+}
+
+bool AudioOutput::Open(AudioRingBuffer &source, uint64_t sampleRate)
+{
+    m_source = &source;
+    m_targetFill = static_cast<std::size_t>(sampleRate * TargetLatency / 1000);
+    m_rate = 1.0F;
+    AudioDeviceSpec spec{ AudioFormat::SInt16LE, 1, static_cast<int>(sampleRate) };
+    m_stream = std::make_unique<AudioStream>(DefaultPlaybackAudioDeviceID, spec, &AudioOutput::Callback, this);
+    if (m_stream->IsEmpty())
+    {
+        m_stream.reset();
+        return false;
+    }
+    // Streams opened on a device start paused
+    return m_stream->Resume();
+}
+
+void AudioOutput::Close()
+{
+    m_stream.reset();
+}
+
+void AudioOutput::Callback(void *userdata, SDL_AudioStream *stream, int additionalAmount, int /*totalAmount*/)
+{
+    static_cast<AudioOutput *>(userdata)->Fill(stream, additionalAmount);
+}
+
+void AudioOutput::Fill(SDL_AudioStream *stream, int additionalAmount)
+{
+    UpdateRate();
+    auto needed = static_cast<std::size_t>(additionalAmount) / sizeof(int16_t);
+    while (needed > 0)
+    {
+        const std::size_t count = std::min(needed, m_chunk.size());
+        const std::size_t available = m_source->Read(m_chunk.data(), count);
+        if (available > 0)
+            m_lastSample = m_chunk[available - 1];
+        std::fill(m_chunk.begin() + static_cast<std::ptrdiff_t>(available), m_chunk.begin() + static_cast<std::ptrdiff_t>(count), m_lastSample);
+        SDL_PutAudioStreamData(stream, m_chunk.data(), static_cast<int>(count * sizeof(int16_t)));
+        needed -= count;
+    }
+}
+
+// Plays faster when more than the target is buffered, slower when less is
+void AudioOutput::UpdateRate()
+{
+    const float fill = static_cast<float>(m_source->Available());
+    const float target = static_cast<float>(m_targetFill);
+    const float error = std::clamp((fill - target) / target, -1.0F, 1.0F);
+    const float rate = 1.0F + MaxRateAdjustment * error;
+    if (std::abs(rate - m_rate) >= RateResolution)
+    {
+        m_stream->SetSampleFrequencyRatio(rate);
+        m_rate = rate;
+    }
+}
@@ -13,10 +13,9 @@
 using namespace tracing;
 using namespace SDL3CPP;
 
-static constexpr int ZXSpectrumScreenWidth = 256;
-static constexpr int ZXSpectrumScreenHeight = 192;
-static constexpr int ZXSpectrumScreenBorderWidth = 48;
-static constexpr int ZXSpectrumScreenBorderHeight = 48;
+// The machine renders the border as well
+static constexpr int ZXSpectrumFrameWidth = ULAFrameWidth;
+static constexpr int ZXSpectrumFrameHeight = ULAFrameHeight;
 
 using KeyboardShortcutMap = std::map<SDL_Keycode, SDL3CPP::Event>;
 
@@ -24,6 +23,24 @@ KeyboardShortcutMap s_shortcuts{
     { SDLK_ESCAPE, SDL3CPP::QuitEvent{} },
 };
 
+using ZXKeyMap = std::map<SDL_Keycode, ZXKey>;
+
+// Host keys for the Spectrum keys. The shift keys are Caps Shift, the control keys Symbol Shift
+ZXKeyMap s_zxKeys{
+    { SDLK_LSHIFT, ZXKey::CapsShift }, { SDLK_RSHIFT, ZXKey::CapsShift },
+    { SDLK_LCTRL, ZXKey::SymbolShift }, { SDLK_RCTRL, ZXKey::SymbolShift },
+    { SDLK_RETURN, ZXKey::Enter }, { SDLK_SPACE, ZXKey::Space },
+    { SDLK_0, ZXKey::Key0 }, { SDLK_1, ZXKey::Key1 }, { SDLK_2, ZXKey::Key2 }, { SDLK_3, ZXKey::Key3 },
+    { SDLK_4, ZXKey::Key4 }, { SDLK_5, ZXKey::Key5 }, { SDLK_6, ZXKey::Key6 }, { SDLK_7, ZXKey::Key7 },
+    { SDLK_8, ZXKey::Key8 }, { SDLK_9, ZXKey::Key9 },
+    { SDLK_A, ZXKey::A }, { SDLK_B, ZXKey::B }, { SDLK_C, ZXKey::C }, { SDLK_D, ZXKey::D }, { SDLK_E, ZXKey::E },
+    { SDLK_F, ZXKey::F }, { SDLK_G, ZXKey::G }, { SDLK_H, ZXKey::H }, { SDLK_I, ZXKey::I }, { SDLK_J, ZXKey::J },
+    { SDLK_K, ZXKey::K }, { SDLK_L, ZXKey::L }, { SDLK_M, ZXKey::M }, { SDLK_N, ZXKey::N }, { SDLK_O, ZXKey::O },
+    { SDLK_P, ZXKey::P }, { SDLK_Q, ZXKey::Q }, { SDLK_R, ZXKey::R }, { SDLK_S, ZXKey::S }, { SDLK_T, ZXKey::T },
+    { SDLK_U, ZXKey::U }, { SDLK_V, ZXKey::V }, { SDLK_W, ZXKey::W }, { SDLK_X, ZXKey::X }, { SDLK_Y, ZXKey::Y },
+    { SDLK_Z, ZXKey::Z },
+};
+
 MainView::MainView(Model& model)
     : m_model{model}
     , m_system{}
@@ -34,26 +51,25 @@ MainView::MainView(Model& model)
     , m_zxSpectumScreenBuffer{}
     , m_displayScreenWidth{}
     , m_displayScreenHeight{}
-    , m_zxSpectumScreenBufferIndex{}
-    , m_zxSpectumScreenBufferIndexForUpdate{}
     , m_imageData{}
     , m_imagePitch{}
     , m_zxSpectrumZoom{4.0F}
-    , m_zxSpectrumScreenWidth{ static_cast<int>(m_zxSpectrumZoom * (ZXSpectrumScreenWidth + 2 * ZXSpectrumScreenBorderWidth)) }
-    , m_zxSpectrumScreenHeight{ static_cast<int>(m_zxSpectrumZoom * (ZXSpectrumScreenHeight + 2 * ZXSpectrumScreenBorderHeight)) }
+    , m_zxSpectrumScreenWidth{ static_cast<int>(m_zxSpectrumZoom * ZXSpectrumFrameWidth) }
+    , m_zxSpectrumScreenHeight{ static_cast<int>(m_zxSpectrumZoom * ZXSpectrumFrameHeight) }
     , m_zxSpectrumImageRect{ 
-        static_cast<float>(ZXSpectrumScreenBorderWidth), 
-        static_cast<float>(ZXSpectrumScreenBorderHeight), 
-        static_cast<float>(ZXSpectrumScreenWidth),
-        static_cast<float>(ZXSpectrumScreenHeight) }
+        0.0F, 
+        0.0F, 
+        static_cast<float>(ZXSpectrumFrameWidth),
+        static_cast<float>(ZXSpectrumFrameHeight) }
     , m_zxSpectrumScreenRect{ 
         0.0F, 
         0.0F,
         static_cast<float>(m_zxSpectrumScreenWidth),
         static_cast<float>(m_zxSpectrumScreenHeight) }
-    , m_borderColor{}
+    , m_uploadedFrameNumber{}
+    , m_pixelKernels{ GetPixelKernels() }
+    , m_audioOutput{}
     , m_quit{}
-    , m_keyDownEvent{}
     , m_keyDownEventTrigger{}
 {
     
@@ -65,7 +81,7 @@ bool MainView::Init(std::shared_ptr<ISystem> system)
     m_system = system;
     try
     {
-        SDL &sdl = GetSDL(SDLInitFlags::Video | SDLInitFlags::Mixer);
+        SDL &sdl = GetSDL(SDLInitFlags::Video | SDLInitFlags::Audio | SDLInitFlags::Mixer);
 
         auto displayConfiguration = sdl.GetDisplayConfiguration();
         DisplayInfo displayInfo{};
@@ -96,13 +112,16 @@ bool MainView::Init(std::shared_ptr<ISystem> system)
             Texture(m_renderer, SDL_PixelFormat::SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING,
                               m_displayScreenWidth - m_zxSpectrumScreenWidth, m_displayScreenHeight);
 
-        for (int i = 0; i < ScreenBufferDepth; ++i)
+        // The texture holds the border as well, 32 bit pixels so that they can be written with vector stores
+        m_zxSpectumScreenBuffer =
+            std::move(Texture(m_renderer, SDL_PixelFormat::SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_STREAMING,
+                              ZXSpectrumFrameWidth, ZXSpectrumFrameHeight));
+
+        // The emulator runs without sound if there is no audio device
+        if (!m_audioOutput.Open(m_system->GetAudio(), m_system->GetAudioSampleRate()))
         {
-            m_zxSpectumScreenBuffer[i] =
-                std::move(Texture(m_renderer, SDL_PixelFormat::SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING,
-                                  ZXSpectrumScreenWidth, ZXSpectrumScreenHeight));
+            sdl.Log("Audio could not be opened: {}", SDL_GetError());
         }
-        m_borderColor = Color(0x80, 0x80, 0x80);
     }
 
     catch (std::exception &e)
@@ -153,6 +172,13 @@ void MainView::ShowCPUClock()
 
 bool MainView::Render()
 {
+    // Frames completed while the last one was shown are skipped, only the latest is uploaded
+    const VideoFrame *frame = m_system->GetFrames().Acquire();
+    if (frame != nullptr)
+    {
+        UpdateBuffer(*frame);
+    }
+
     // Clear screen
     m_renderer.SetDrawColor(0x0, 0x0, 0x0, 0xFF);
     m_renderer.Clear();
@@ -162,12 +188,10 @@ bool MainView::Render()
         0, 0, m_zxSpectrumScreenWidth, m_zxSpectrumScreenHeight
     };
     m_renderer.SetViewport(zxSpectumScreenViewport);
-    m_renderer.SetDrawColor(m_borderColor);
-    m_renderer.FillRect(m_zxSpectrumScreenRect);
     m_renderer.SetScale(m_zxSpectrumZoom, m_zxSpectrumZoom);
 
     // Render texture to screen
-    m_renderer.Copy(m_zxSpectumScreenBuffer[m_zxSpectumScreenBufferIndex], NullOpt, m_zxSpectrumImageRect);
+    m_renderer.Copy(m_zxSpectumScreenBuffer, NullOpt, m_zxSpectrumImageRect);
 
     m_renderer.SetScale(1.0F, 1.0F);
 
@@ -187,63 +211,50 @@ bool MainView::Render()
     return true;
 }
 
-struct RGB
-{
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-};
-
-void MainView::SetBorderColor(uint8_t r, uint8_t g, uint8_t b)
+static uint32_t ToPixel(const Color &color)
 {
-    m_borderColor.SetRed(r);
-    m_borderColor.SetGreen(g);
-    m_borderColor.SetBlue(b);
+    return (static_cast<uint32_t>(color.r) << 16) | (static_cast<uint32_t>(color.g) << 8) | color.b;
 }
 
-void MainView::UpdateBuffer(uint8_t r, uint8_t g, uint8_t b)
+// Only the lines changed since the frame in the texture are uploaded. If frames were skipped, the lines they changed
+// are not known, so the whole frame is uploaded
+void MainView::UpdateBuffer(const VideoFrame &frame)
 {
-    if (LockTexture())
+    ULADirtyLines lines = frame.ChangedLines;
+    if ((m_uploadedFrameNumber == 0) || (frame.FrameNumber != m_uploadedFrameNumber + 1))
+        lines = ULADirtyLines{ 0, ZXSpectrumFrameHeight - 1 };
+    m_uploadedFrameNumber = frame.FrameNumber;
+    if (lines.IsEmpty())
+        return;
+    if (LockTexture(lines.First, lines.Last))
     {
-        for (int y = 0; y < ZXSpectrumScreenHeight; ++y)
+        for (int y = lines.First; y <= lines.Last; ++y)
         {
-            RGB* imagePtr = reinterpret_cast<RGB *>(reinterpret_cast<uint8_t *>(m_imageData) + y * m_imagePitch);
-            for (int x = 0; x < ZXSpectrumScreenWidth; ++x)
-            {
-                *imagePtr++ = RGB{ r, g, b };
-            }
+            uint32_t *imagePtr = reinterpret_cast<uint32_t *>(reinterpret_cast<uint8_t *>(m_imageData) + (y - lines.First) * m_imagePitch);
+            m_pixelKernels.Copy(imagePtr, frame.Screen.data() + y * ZXSpectrumFrameWidth, ZXSpectrumFrameWidth);
         }
-        SetPixel(0, 0, Color{ 0x00, 0x00, 0x00 });
-        SetPixel(255, 0, Color{ 0x00, 0x00, 0x00 });
-        SetPixel(0, 191, Color{ 0x00, 0x00, 0x00 });
-        SetPixel(255, 191, Color{ 0x00, 0x00, 0x00 });
         UnlockTexture();
     }
 }
 
 void MainView::SetPixel(int x, int y, Color color)
 {
-    RGB* imagePtr = reinterpret_cast<RGB *>(reinterpret_cast<uint8_t *>(m_imageData) + y * m_imagePitch) + x;
-    *imagePtr++ = RGB{ color.r, color.g, color.b };
+    uint32_t *imagePtr = reinterpret_cast<uint32_t *>(reinterpret_cast<uint8_t *>(m_imageData) + y * m_imagePitch) + x;
+    *imagePtr = ToPixel(color);
 }
 
-bool MainView::LockTexture()
+// Locks the given lines of the texture
+bool MainView::LockTexture(int firstLine, int lastLine)
 {
-    m_zxSpectumScreenBufferIndexForUpdate = (m_zxSpectumScreenBufferIndex + 1) % ScreenBufferDepth;
-    auto &bufferTexture = m_zxSpectumScreenBuffer[m_zxSpectumScreenBufferIndexForUpdate];
-    if (bufferTexture.GetAccess() != SDL_TEXTUREACCESS_STREAMING)
+    if (m_zxSpectumScreenBuffer.GetAccess() != SDL_TEXTUREACCESS_STREAMING)
         return false;
-    Rect bufferRect{ Point{0, 0}, bufferTexture.GetSizeInt() };
-    SDL_LockTexture(bufferTexture.Get(), &bufferRect, &m_imageData, &m_imagePitch);
-    return true;
+    Rect bufferRect{ 0, firstLine, m_zxSpectumScreenBuffer.GetSizeInt().x, lastLine - firstLine + 1 };
+    return SDL_LockTexture(m_zxSpectumScreenBuffer.Get(), &bufferRect, &m_imageData, &m_imagePitch);
 }
 
 bool MainView::UnlockTexture()
 {
-    m_zxSpectumScreenBufferIndexForUpdate = (m_zxSpectumScreenBufferIndex + 1) % ScreenBufferDepth;
-    auto &bufferTexture = m_zxSpectumScreenBuffer[m_zxSpectumScreenBufferIndexForUpdate];
-    SDL_UnlockTexture(bufferTexture.Get());
-    m_zxSpectumScreenBufferIndex = m_zxSpectumScreenBufferIndexForUpdate;
+    SDL_UnlockTexture(m_zxSpectumScreenBuffer.Get());
     return true;
 }
 
@@ -272,18 +283,17 @@ void MainView::HandleEvent(const SDL3CPP::Event &e)
             {
                 SDL3CPP::Events::PushEvent(s_shortcuts[e.Key()]);
             }
-            else
+            else if (!e.IsKeyRepeat())
             {
-                switch (e.Key())
-                {
-                case SDLK_ESCAPE:
-                default:
-                    m_keyDownEvent = e;
-                    m_keyDownEventTrigger.Set();
-                    break;
-                }
+                PushKeyEvent(e.Key(), true);
+                // Single steps in debug mode
+                m_keyDownEventTrigger.Set();
             }
             break;
+        // User releases a key
+        case SDL_EVENT_KEY_UP:
+            PushKeyEvent(e.Key(), false);
+            break;
         case SDL_EVENT_MOUSE_MOTION:
             break;
         case SDL_EVENT_MOUSE_BUTTON_DOWN:
@@ -295,6 +305,17 @@ void MainView::HandleEvent(const SDL3CPP::Event &e)
     }
 }
 
+// The key applies from the frame after the one on screen, so the delay between what the user sees and the key taking
+// effect does not depend on how far the emulation thread happens to be
+void MainView::PushKeyEvent(SDL_Keycode key, bool pressed)
+{
+    auto it = s_zxKeys.find(key);
+    if (it == s_zxKeys.end())
+        return;
+    // A full queue means the emulation is not running, the key is lost
+    m_system->GetKeyEvents().Push(KeyEvent{ m_uploadedFrameNumber + 1, it->second, pressed });
+}
+
 void MainView::WaitForInput()
 {
     m_keyDownEventTrigger.Wait();
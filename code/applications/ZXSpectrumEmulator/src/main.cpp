@@ -1,15 +1,106 @@
 #define SDL_MAIN_HANDLED
 
 #include <iostream>
+#include <string>
 #include "Application.h"
+#include "Controller/HeadlessRunner.h"
+
+static void Usage()
+{
+    std::cout << "Usage: zxspectrum-emu [--headless --frames <count> [--machine 48k|128k] [--rom <file>] [--keys <file>]\n"
+        "                      [--mode interpreter|blockcache|recompiler|lockstep] [--instances <count>]]\n"
+        "  --headless   run without window, video or audio, and print a hash of the screen and CPU state per frame\n"
+        "  --frames     number of frames to run, required with --headless\n"
+        "  --mode       how the CPU runs, blockcache by default\n"
+        "  --instances  run independent machines on all cores, and print the hashes after the last frame per machine\n";
+}
+
+static bool ParseMachine(const std::string &name, const ZXSpectrumModel *&machine)
+{
+    if (name == "48k")
+        machine = &Spectrum48K;
+    else if (name == "128k")
+        machine = &Spectrum128K;
+    else
+        return false;
+    return true;
+}
+
+static bool ParseMode(const std::string &name, ExecutionMode &mode)
+{
+    if (name == "interpreter")
+        mode = ExecutionMode::Interpreter;
+    else if (name == "blockcache")
+        mode = ExecutionMode::BlockCache;
+    else if (name == "recompiler")
+        mode = ExecutionMode::Recompiler;
+    else if (name == "lockstep")
+        mode = ExecutionMode::Lockstep;
+    else
+        return false;
+    return true;
+}
+
+// Returns false on an unknown or incomplete option, or when --headless is given without a frame count
+static bool ParseCommandLine(int argc, char *argv[], bool &headless, HeadlessOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option{ argv[i] };
+        if (option == "--headless")
+        {
+            headless = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        std::string value{ argv[++i] };
+        if (option == "--frames")
+            options.FrameCount = std::stoull(value);
+        else if (option == "--machine")
+        {
+            if (!ParseMachine(value, options.Machine))
+                return false;
+        }
+        else if (option == "--rom")
+            options.ROMPath = value;
+        else if (option == "--keys")
+            options.KeyScriptPath = value;
+        else if (option == "--instances")
+            options.Instances = std::stoull(value);
+        else if (option == "--mode")
+        {
+            if (!ParseMode(value, options.Mode))
+                return false;
+        }
+        else
+            return false;
+    }
+    return !headless || (options.FrameCount > 0);
+}
 
 // You must include the command line parameters for your main function to be recognized by SDL
-int main(int /*argc*/, char* /*argv*/[])
+int main(int argc, char* argv[])
 {
     tracing::ConsoleTraceLineWriter traceLineWriter{};
     tracing::TraceWriter traceWriter{ traceLineWriter };
+    bool headless{};
+    HeadlessOptions options{ &Spectrum48K, {}, 0, {}, ExecutionMode::BlockCache, 1 };
     try
     {
+        if (!ParseCommandLine(argc, argv, headless, options))
+        {
+            Usage();
+            return 1;
+        }
+        if (headless)
+        {
+            // No SDL, so this runs on hosts without a display
+            tracing::Tracing::SetTraceWriter(&traceWriter);
+            HeadlessRunner runner{ std::cout };
+            return runner.Run(options) ? 0 : 1;
+        }
+
         Application app;
 
         app.Init(&traceWriter);
@@ -21,7 +112,7 @@ int main(int /*argc*/, char* /*argv*/[])
         std::cout << e.what() << std::endl;
         return 1;
     }
-    
+
     // End the program
     return 0;
 }
@@ -0,0 +1,236 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : AY38912Test.cpp
+//
+// Namespace   : -
+//
+// Class       : AY38912Test
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "Model/AY38912.h"
+
+static constexpr uint64_t ClockRate = 3500000;
+static constexpr uint64_t SampleRate = 48000;
+static constexpr uint64_t FrameClocks = 69888;
+static constexpr uint16_t RegisterSelectPort = 0xFFFD;
+static constexpr uint16_t DataPort = 0xBFFD;
+
+// Only the clock is used by the AY
+class FakeCPU
+    : public ICPU
+{
+public:
+    uint64_t Clock{};
+
+    bool Init() override { return true; }
+    void Reset() override {}
+    bool IsHalted() override { return false; }
+    std::string DumpRegisters() override { return {}; }
+    bool ExecuteInstruction() override { return true; }
+    RunExitReason ExecuteCycles(uint64_t /*tstates*/) override { return RunExitReason::BudgetSpent; }
+    void RequestInterrupt(uint64_t /*activeTStates*/) override {}
+    void RequestNMI() override {}
+    void SetBreakpoint(uint64_t /*address*/) override {}
+    void ClearBreakpoint(uint64_t /*address*/) override {}
+    void SetExecutionMode(ExecutionMode /*mode*/) override {}
+    uint64_t GetCPUClock() override { return Clock; }
+    uint64_t GetCPUClockFreq() override { return ClockRate; }
+};
+
+static void WriteRegister(AY38912 &ay, uint8_t index, uint8_t value)
+{
+    ay.Write8(RegisterSelectPort, index);
+    ay.Write8(DataPort, value);
+}
+
+// Runs the given number of frames, returns all samples
+static std::vector<float> RunFrames(FakeCPU &cpu, AY38912 &ay, int frames)
+{
+    std::vector<float> samples;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        ay.StartFrame(cpu.Clock);
+        cpu.Clock += FrameClocks;
+        std::size_t count = ay.EndFrame(FrameClocks);
+        samples.insert(samples.end(), ay.Samples(), ay.Samples() + count);
+    }
+    return samples;
+}
+
+TEST(AY38912Test, RegistersReadBackThroughSelectPort)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    WriteRegister(*ay, AY38912::ToneACoarse, 0xFF);
+    WriteRegister(*ay, AY38912::NoisePeriod, 0xFF);
+    WriteRegister(*ay, AY38912::Mixer, 0xFF);
+    WriteRegister(*ay, AY38912::AmplitudeB, 0xFF);
+    WriteRegister(*ay, AY38912::EnvelopeShape, 0xFF);
+
+    uint8_t value{};
+    ay->Write8(RegisterSelectPort, AY38912::ToneACoarse);
+    ay->Read8(RegisterSelectPort, value);
+    EXPECT_EQ(0x0F, value);
+    ay->Write8(RegisterSelectPort, AY38912::NoisePeriod);
+    ay->Read8(RegisterSelectPort, value);
+    EXPECT_EQ(0x1F, value);
+    ay->Write8(RegisterSelectPort, AY38912::Mixer);
+    ay->Read8(RegisterSelectPort, value);
+    EXPECT_EQ(0xFF, value);
+    ay->Write8(RegisterSelectPort, AY38912::AmplitudeB);
+    ay->Read8(RegisterSelectPort, value);
+    EXPECT_EQ(0x1F, value);
+    EXPECT_EQ(0x0F, ay->GetRegister(AY38912::EnvelopeShape));
+}
+
+TEST(AY38912Test, FramesProduceTheExactNumberOfSamples)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    auto samples = RunFrames(cpu, *ay, 1000);
+    // Same sample grid as the beeper
+    EXPECT_EQ(static_cast<std::size_t>(1000 * FrameClocks * SampleRate / ClockRate), samples.size());
+}
+
+TEST(AY38912Test, SilenceAfterReset)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    for (float sample : RunFrames(cpu, *ay, 10))
+    {
+        EXPECT_EQ(0.0F, sample);
+    }
+}
+
+TEST(AY38912Test, ToneHasProgrammedFrequency)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    // Period 100: 3500000 / (16 * 2 * 100) = 1093.75 Hz
+    WriteRegister(*ay, AY38912::ToneAFine, 100);
+    WriteRegister(*ay, AY38912::Mixer, 0x3E);
+    WriteRegister(*ay, AY38912::AmplitudeA, 0x0F);
+    auto samples = RunFrames(cpu, *ay, 100);
+
+    // Count rising zero crossings in the last second, after the DC filter has settled
+    std::size_t start = samples.size() - SampleRate;
+    int crossings = 0;
+    for (std::size_t i = start + 1; i < samples.size(); ++i)
+    {
+        if ((samples[i - 1] < 0.0F) && (samples[i] >= 0.0F))
+            ++crossings;
+    }
+    EXPECT_NEAR(1093.75, crossings, 2);
+}
+
+TEST(AY38912Test, RegisterWriteTakesEffectAtItsTState)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    WriteRegister(*ay, AY38912::Mixer, 0x3F);
+    ay->StartFrame(cpu.Clock);
+    // Channel A at a constant level from the middle of the frame
+    cpu.Clock += FrameClocks / 2;
+    WriteRegister(*ay, AY38912::AmplitudeA, 0x0F);
+    cpu.Clock += FrameClocks / 2;
+    std::size_t count = ay->EndFrame(FrameClocks);
+    const float *samples = ay->Samples();
+    EXPECT_NEAR(0.0F, samples[count / 2 - 20], 1e-6F);
+    EXPECT_GT(samples[count / 2 + 20], 0.25F);
+}
+
+TEST(AY38912Test, DecayingEnvelopeEndsInSilence)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    // Shape 0 decays once and holds at zero: 16 steps of 2 * 16 * 100 T-states take 15 ms
+    WriteRegister(*ay, AY38912::ToneAFine, 20);
+    WriteRegister(*ay, AY38912::Mixer, 0x3E);
+    WriteRegister(*ay, AY38912::AmplitudeA, 0x10);
+    WriteRegister(*ay, AY38912::EnvelopeFine, 100);
+    WriteRegister(*ay, AY38912::EnvelopeShape, 0x00);
+    auto samples = RunFrames(cpu, *ay, 20);
+
+    float early{};
+    for (std::size_t i = 0; i < 240; ++i)
+        early = std::max(early, std::abs(samples[i]));
+    float late{};
+    for (std::size_t i = samples.size() - 240; i < samples.size(); ++i)
+        late = std::max(late, std::abs(samples[i]));
+    EXPECT_GT(early, 0.1F);
+    EXPECT_LT(late, 0.01F);
+}
+
+TEST(AY38912Test, SavedStateContinuesInAnotherChip)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    WriteRegister(*ay, AY38912::ToneAFine, 100);
+    WriteRegister(*ay, AY38912::NoisePeriod, 7);
+    WriteRegister(*ay, AY38912::Mixer, 0x36);
+    WriteRegister(*ay, AY38912::AmplitudeA, 0x10);
+    WriteRegister(*ay, AY38912::EnvelopeFine, 50);
+    WriteRegister(*ay, AY38912::EnvelopeShape, 0x0E);
+    RunFrames(cpu, *ay, 3);
+    // Halfway into a frame
+    ay->StartFrame(cpu.Clock);
+    cpu.Clock += FrameClocks / 2;
+    WriteRegister(*ay, AY38912::ToneBFine, 30);
+    ByteVector saved;
+    std::size_t offset{};
+    ay->SaveState(saved, offset);
+
+    FakeCPU otherCPU;
+    otherCPU.Clock = cpu.Clock;
+    auto other = std::make_unique<AY38912>(otherCPU, ClockRate, SampleRate, FrameClocks);
+    other->Reset();
+    offset = 0;
+    ASSERT_TRUE(other->LoadState(saved, offset));
+    EXPECT_EQ(saved.size(), offset);
+    EXPECT_EQ(30, other->GetRegister(AY38912::ToneBFine));
+    EXPECT_EQ(0x0E, other->GetRegister(AY38912::EnvelopeShape));
+
+    // Both generators go on in step
+    cpu.Clock += FrameClocks / 2;
+    otherCPU.Clock += FrameClocks / 2;
+    ay->EndFrame(FrameClocks);
+    other->EndFrame(FrameClocks);
+    RunFrames(cpu, *ay, 2);
+    RunFrames(otherCPU, *other, 2);
+    ByteVector expected;
+    ByteVector actual;
+    offset = 0;
+    ay->SaveState(expected, offset);
+    offset = 0;
+    other->SaveState(actual, offset);
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(AY38912Test, LoadingShortStateFails)
+{
+    FakeCPU cpu;
+    auto ay = std::make_unique<AY38912>(cpu, ClockRate, SampleRate, FrameClocks);
+    ay->Reset();
+    ByteVector saved;
+    std::size_t offset{};
+    ay->SaveState(saved, offset);
+    saved.pop_back();
+    offset = 0;
+    EXPECT_FALSE(ay->LoadState(saved, offset));
+}
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : AudioRingBufferTest.cpp
+//
+// Namespace   : -
+//
+// Class       : AudioRingBufferTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Model/AudioRingBuffer.h"
+
+TEST(AudioRingBufferTest, EmptyAfterConstruction)
+{
+    auto buffer = std::make_unique<AudioRingBuffer>();
+    int16_t sample{};
+    EXPECT_EQ(std::size_t{ 0 }, buffer->Available());
+    EXPECT_EQ(std::size_t{ 0 }, buffer->Read(&sample, 1));
+}
+
+TEST(AudioRingBufferTest, ReadReturnsSamplesInOrderAcrossWrap)
+{
+    auto buffer = std::make_unique<AudioRingBuffer>();
+    std::vector<int16_t> samples(1000);
+    std::vector<int16_t> read(1000);
+    int16_t next = 0;
+    int16_t expected = 0;
+    // Enough rounds to wrap around several times
+    for (int round = 0; round < 100; ++round)
+    {
+        for (auto &sample : samples)
+            sample = next++;
+        EXPECT_EQ(samples.size(), buffer->Write(samples.data(), samples.size()));
+        EXPECT_EQ(samples.size(), buffer->Available());
+        EXPECT_EQ(read.size(), buffer->Read(read.data(), read.size()));
+        for (auto sample : read)
+            EXPECT_EQ(expected++, sample);
+    }
+}
+
+TEST(AudioRingBufferTest, WriteDropsSamplesThatDoNotFit)
+{
+    auto buffer = std::make_unique<AudioRingBuffer>();
+    std::vector<int16_t> samples(AudioRingBuffer::Capacity + 100, 1);
+    EXPECT_EQ(AudioRingBuffer::Capacity, buffer->Write(samples.data(), samples.size()));
+    EXPECT_EQ(std::size_t{ 0 }, buffer->Write(samples.data(), 1));
+    EXPECT_EQ(AudioRingBuffer::Capacity, buffer->Available());
+}
+
+TEST(AudioRingBufferTest, ConcurrentWriterAndReader)
+{
+    static constexpr int SampleCount = 1000000;
+    auto buffer = std::make_unique<AudioRingBuffer>();
+
+    std::thread writer([&buffer]()
+    {
+        int16_t chunk[500];
+        int next = 0;
+        while (next < SampleCount)
+        {
+            for (auto &sample : chunk)
+                sample = static_cast<int16_t>(next++);
+            std::size_t written = 0;
+            while (written < 500)
+                written += buffer->Write(chunk + written, 500 - written);
+        }
+    });
+
+    int expected = 0;
+    bool inOrder = true;
+    int16_t chunk[300];
+    while (expected < SampleCount)
+    {
+        std::size_t count = buffer->Read(chunk, 300);
+        for (std::size_t i = 0; i < count; ++i)
+            inOrder = inOrder && (chunk[i] == static_cast<int16_t>(expected++));
+    }
+    writer.join();
+    EXPECT_TRUE(inOrder);
+}
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : BandLimitedSynthTest.cpp
+//
+// Namespace   : -
+//
+// Class       : BandLimitedSynthTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include "Model/BandLimitedSynth.h"
+
+static constexpr uint64_t ClockRate = 3500000;
+static constexpr uint64_t SampleRate = 48000;
+static constexpr uint64_t FrameClocks = 69888;
+
+TEST(BandLimitedSynthTest, FramesProduceTheExactNumberOfSamples)
+{
+    BandLimitedSynth synth(ClockRate, SampleRate, FrameClocks);
+    std::size_t total = 0;
+    for (int frame = 0; frame < 1000; ++frame)
+    {
+        std::size_t count = synth.EndFrame(FrameClocks);
+        EXPECT_TRUE((count == 958) || (count == 959));
+        total += count;
+    }
+    // No samples are lost or gained by rounding
+    EXPECT_EQ(static_cast<std::size_t>(1000 * FrameClocks * SampleRate / ClockRate), total);
+}
+
+TEST(BandLimitedSynthTest, SilenceWithoutChanges)
+{
+    BandLimitedSynth synth(ClockRate, SampleRate, FrameClocks);
+    std::size_t count = synth.EndFrame(FrameClocks);
+    EXPECT_TRUE(std::all_of(synth.Samples(), synth.Samples() + count, [](int16_t sample) { return sample == 0; }));
+}
+
+TEST(BandLimitedSynthTest, StepRisesAndDecaysToSilence)
+{
+    BandLimitedSynth synth(ClockRate, SampleRate, FrameClocks);
+    synth.AddDelta(FrameClocks / 2, 1.0F);
+    std::size_t count = synth.EndFrame(FrameClocks);
+    const int16_t *samples = synth.Samples();
+    // Before the step, the output is silent
+    EXPECT_EQ(0, samples[0]);
+    EXPECT_EQ(0, samples[count / 2 - 16]);
+    // Just after the step, close to full scale
+    EXPECT_GT(samples[count / 2 + 16], 15000);
+    // The DC blocker brings a constant level back to silence
+    for (int frame = 0; frame < 100; ++frame)
+        count = synth.EndFrame(FrameClocks);
+    EXPECT_LT(std::abs(synth.Samples()[count - 1]), 10);
+}
+
+TEST(BandLimitedSynthTest, StepsAreBandLimited)
+{
+    BandLimitedSynth synth(ClockRate, SampleRate, FrameClocks);
+    synth.AddDelta(1000, 1.0F);
+    std::size_t count = synth.EndFrame(FrameClocks);
+    const int16_t *samples = synth.Samples();
+    // A naive step jumps by full scale in one sample, the band-limited one is spread over several
+    int largestJump = 0;
+    for (std::size_t i = 1; i < count; ++i)
+        largestJump = std::max(largestJump, std::abs(samples[i] - samples[i - 1]));
+    EXPECT_GT(largestJump, 0);
+    EXPECT_LT(largestJump, 16383);
+}
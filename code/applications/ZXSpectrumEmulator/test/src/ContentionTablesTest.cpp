@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : ContentionTablesTest.cpp
+//
+// Namespace   : -
+//
+// Class       : ContentionTablesTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <memory>
+#include <vector>
+#include "Model/ContentionTables.h"
+#include "Model/ULAContention.h"
+#include "Model/Z80.h"
+
+TEST(ContentionTablesTest, DisplayLinesFollowDelayPattern)
+{
+    auto tables = std::make_unique<ContentionTables>(Spectrum48K);
+    EXPECT_EQ(0, tables->MemoryDelay(14334));
+    const uint8_t expected[] = { 6, 5, 4, 3, 2, 1, 0, 0, 6 };
+    for (uint32_t offset = 0; offset < sizeof(expected); ++offset)
+    {
+        EXPECT_EQ(expected[offset], tables->MemoryDelay(14335 + offset));
+    }
+    // The ULA lets go during the border and retrace part of the line
+    EXPECT_EQ(0, tables->MemoryDelay(14335 + 128));
+    EXPECT_EQ(6, tables->MemoryDelay(14335 + 224));
+    EXPECT_EQ(0, tables->MemoryDelay(14335 + 192 * 224));
+}
+
+TEST(ContentionTablesTest, TimingFollowsModel)
+{
+    auto tables = std::make_unique<ContentionTables>(Spectrum128K);
+    EXPECT_EQ(0, tables->MemoryDelay(14360));
+    EXPECT_EQ(6, tables->MemoryDelay(14361));
+    EXPECT_EQ(6, tables->MemoryDelay(14361 + 228));
+    // Next frame
+    EXPECT_EQ(6, tables->MemoryDelay(Spectrum128K.TStatesPerFrame() + 14361));
+}
+
+TEST(ContentionTablesTest, IOCycleDelays)
+{
+    auto tables = std::make_unique<ContentionTables>(Spectrum48K);
+    // ULA port: contention is checked after the first T-state
+    EXPECT_EQ(6, tables->IODelay(IOContention::ULAPort, 14334));
+    EXPECT_EQ(5, tables->IODelay(IOContention::ULAPort, 14335));
+    // Contended address and ULA port: checked at the start and after the first T-state
+    EXPECT_EQ(6, tables->IODelay(IOContention::ULAPortContendedAddress, 14335));
+    EXPECT_EQ(6, tables->IODelay(IOContention::ULAPortContendedAddress, 14334));
+    // Contended address, odd port: checked at each of the four T-states
+    EXPECT_EQ(12, tables->IODelay(IOContention::ContendedAddress, 14334));
+    EXPECT_EQ(6, tables->IODelay(IOContention::ContendedAddress, 14333));
+    // No contention in the border
+    for (auto contention : { IOContention::ULAPort, IOContention::ULAPortContendedAddress, IOContention::ContendedAddress })
+    {
+        EXPECT_EQ(0, tables->IODelay(contention, 1000));
+    }
+}
+
+// A 48K address space with the ULA contending 0x4000 - 0x7FFF. The CPU runs NOPs from uncontended memory first, so the
+// frame can start before the instruction under test
+class ULAContentionTest
+    : public ::testing::Test
+{
+protected:
+    static constexpr uint16_t ContendedAddress = 0x4000;
+    static constexpr uint16_t UncontendedAddress = 0x8000;
+    std::vector<uint8_t> m_memory;
+    std::unique_ptr<Z80> m_cpu;
+    std::unique_ptr<ULAContention> m_contention;
+
+    void SetUp() override
+    {
+        m_memory.assign(0x10000, 0x00);
+        m_cpu = std::make_unique<Z80>(Spectrum48K.CPUClockFreq);
+        m_cpu->MapRAM(0x0000, m_memory.size(), m_memory.data());
+        m_contention = std::make_unique<ULAContention>(*m_cpu, Spectrum48K);
+        m_cpu->SetContention(m_contention.get());
+        m_cpu->ContendAccesses(0x4000, 0x4000);
+        m_cpu->Reset();
+        m_cpu->GetRegisters().PC = 0xC000;
+        m_cpu->ExecuteCycles(Spectrum48K.TStatesPerFrame());
+    }
+    // Runs the code as a single instruction starting at the given T-state of the frame, returns the T-states it took
+    uint64_t Run(uint16_t address, const std::vector<uint8_t> &code, uint64_t frameTState)
+    {
+        std::copy(code.begin(), code.end(), m_memory.begin() + address);
+        m_cpu->GetRegisters().PC = address;
+        const uint64_t start = m_cpu->GetCPUClock();
+        m_contention->StartFrame(start - frameTState);
+        EXPECT_TRUE(m_cpu->ExecuteInstruction());
+        return m_cpu->GetCPUClock() - start;
+    }
+};
+
+TEST_F(ULAContentionTest, OpcodeFetchIsHeldAtItsTState)
+{
+    EXPECT_EQ(4u + 6u, Run(ContendedAddress, { 0x00 }, 14335));
+    EXPECT_EQ(4u + 1u, Run(ContendedAddress, { 0x00 }, 14340));
+    EXPECT_EQ(4u, Run(ContendedAddress, { 0x00 }, 14341));
+    EXPECT_EQ(4u, Run(ContendedAddress, { 0x00 }, 1000));
+    EXPECT_EQ(4u, Run(UncontendedAddress, { 0x00 }, 14335));
+}
+
+TEST_F(ULAContentionTest, MemoryReadIsHeldAfterTheFetch)
+{
+    m_cpu->GetRegisters().SetHL(ContendedAddress);
+    // LD A,(HL): the read starts 4 T-states into the instruction
+    EXPECT_EQ(7u + 6u, Run(UncontendedAddress, { 0x7E }, 14331));
+    EXPECT_EQ(7u, Run(UncontendedAddress, { 0x7E }, 14337));
+    // Fetch held for 6, the read then starts at 14345, which is held for 4
+    EXPECT_EQ(7u + 6u + 4u, Run(ContendedAddress + 0x100, { 0x7E }, 14335));
+    // LD A,(nn): the read starts after the two operand reads, 10 T-states into the instruction
+    EXPECT_EQ(13u + 6u, Run(UncontendedAddress, { 0x3A, 0x00, 0x40 }, 14325));
+}
+
+TEST_F(ULAContentionTest, InternalCyclesOnContendedAddressesAreHeld)
+{
+    // INC (HL): read at 14335 held for 6, the internal T-state at 14344 for 5, the write at 14350 is free
+    m_cpu->GetRegisters().SetHL(ContendedAddress);
+    EXPECT_EQ(11u + 6u + 5u, Run(UncontendedAddress, { 0x34 }, 14331));
+    // LDIR repeating onto the screen: the write, the 2 internal T-states and the 5 of the repeat are at DE
+    auto &regs = m_cpu->GetRegisters();
+    regs.SetHL(0x8100);
+    regs.SetDE(ContendedAddress);
+    regs.SetBC(2);
+    EXPECT_EQ(21u + 3u + 5u + 6u + 6u + 6u, Run(UncontendedAddress, { 0xED, 0xB0 }, 14327));
+    EXPECT_EQ(UncontendedAddress, regs.PC);
+}
+
+TEST_F(ULAContentionTest, IOCycleIsHeldAfterTheOperandRead)
+{
+    // OUT (n),A: the I/O cycle starts 7 T-states into the instruction
+    auto &regs = m_cpu->GetRegisters();
+    regs.Reg[RegisterIndex::A] = 0x00;
+    EXPECT_EQ(11u + 5u, Run(UncontendedAddress, { 0xD3, 0xFE }, 14328));
+    regs.Reg[RegisterIndex::A] = 0x40;
+    EXPECT_EQ(11u + 6u, Run(UncontendedAddress, { 0xD3, 0xFE }, 14328));
+    EXPECT_EQ(11u + 12u, Run(UncontendedAddress, { 0xD3, 0xFF }, 14327));
+    // Not the ULA and not in contended memory
+    regs.Reg[RegisterIndex::A] = 0x80;
+    EXPECT_EQ(11u, Run(UncontendedAddress, { 0xD3, 0xFF }, 14328));
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : FrameMailboxTest.cpp
+//
+// Namespace   : -
+//
+// Class       : FrameMailboxTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include "Model/FrameMailbox.h"
+
+static constexpr ULADirtyLines AllLines{ 0, ULAFrameHeight - 1 };
+
+// Every pixel of a frame holds its frame number, so a torn frame can be detected
+static void FillScreen(ULAScreen &screen, uint64_t frameNumber)
+{
+    screen.fill(static_cast<uint32_t>(frameNumber));
+}
+
+static bool IsFrameComplete(const VideoFrame &frame)
+{
+    const uint32_t expected = static_cast<uint32_t>(frame.FrameNumber);
+    return std::all_of(frame.Screen.begin(), frame.Screen.end(), [expected](uint32_t pixel) { return pixel == expected; });
+}
+
+TEST(FrameMailboxTest, NoFrameBeforePublish)
+{
+    auto mailbox = std::make_unique<FrameMailbox>();
+    EXPECT_EQ(nullptr, mailbox->Acquire());
+}
+
+TEST(FrameMailboxTest, FrameIsAcquiredOnce)
+{
+    auto mailbox = std::make_unique<FrameMailbox>();
+    auto screen = std::make_unique<ULAScreen>();
+    FillScreen(*screen, 1);
+    mailbox->Publish(*screen, AllLines, 1);
+
+    const VideoFrame *frame = mailbox->Acquire();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(uint64_t{ 1 }, frame->FrameNumber);
+    EXPECT_EQ(AllLines.First, frame->ChangedLines.First);
+    EXPECT_EQ(AllLines.Last, frame->ChangedLines.Last);
+    EXPECT_TRUE(IsFrameComplete(*frame));
+    EXPECT_EQ(nullptr, mailbox->Acquire());
+}
+
+TEST(FrameMailboxTest, StaleFramesAreDropped)
+{
+    auto mailbox = std::make_unique<FrameMailbox>();
+    auto screen = std::make_unique<ULAScreen>();
+    for (uint64_t frameNumber = 1; frameNumber <= 5; ++frameNumber)
+    {
+        FillScreen(*screen, frameNumber);
+        mailbox->Publish(*screen, AllLines, frameNumber);
+    }
+
+    const VideoFrame *frame = mailbox->Acquire();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(uint64_t{ 5 }, frame->FrameNumber);
+    EXPECT_TRUE(IsFrameComplete(*frame));
+    EXPECT_EQ(nullptr, mailbox->Acquire());
+}
+
+TEST(FrameMailboxTest, OnlyChangedLinesAreNeededToKeepSlotsCurrent)
+{
+    auto mailbox = std::make_unique<FrameMailbox>();
+    auto screen = std::make_unique<ULAScreen>();
+    FillScreen(*screen, 0);
+    mailbox->Publish(*screen, AllLines, 1);
+    for (uint64_t frameNumber = 2; frameNumber <= 7; ++frameNumber)
+    {
+        // One line changes per frame, every slot must still end up identical to the screen
+        const int line = static_cast<int>(frameNumber) * 10;
+        std::fill_n(screen->begin() + line * ULAFrameWidth, ULAFrameWidth, static_cast<uint32_t>(frameNumber));
+        mailbox->Publish(*screen, ULADirtyLines{ line, line }, frameNumber);
+        const VideoFrame *frame = mailbox->Acquire();
+        ASSERT_NE(nullptr, frame);
+        EXPECT_EQ(frameNumber, frame->FrameNumber);
+        EXPECT_TRUE(frame->Screen == *screen);
+    }
+}
+
+TEST(FrameMailboxTest, ConcurrentProducerAndConsumer)
+{
+    static constexpr uint64_t FrameCount = 500;
+    auto mailbox = std::make_unique<FrameMailbox>();
+
+    std::thread producer([&mailbox]()
+    {
+        auto screen = std::make_unique<ULAScreen>();
+        for (uint64_t frameNumber = 1; frameNumber <= FrameCount; ++frameNumber)
+        {
+            FillScreen(*screen, frameNumber);
+            mailbox->Publish(*screen, AllLines, frameNumber);
+        }
+    });
+
+    uint64_t lastFrameNumber = 0;
+    bool allComplete = true;
+    while (lastFrameNumber < FrameCount)
+    {
+        const VideoFrame *frame = mailbox->Acquire();
+        if (frame == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_GT(frame->FrameNumber, lastFrameNumber);
+        allComplete = allComplete && IsFrameComplete(*frame);
+        lastFrameNumber = frame->FrameNumber;
+    }
+    producer.join();
+    EXPECT_TRUE(allComplete);
+}
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : KeyEventQueueTest.cpp
+//
+// Namespace   : -
+//
+// Class       : KeyEventQueueTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <memory>
+#include <thread>
+#include "Model/KeyEventQueue.h"
+
+TEST(KeyEventQueueTest, EmptyAfterConstruction)
+{
+    auto queue = std::make_unique<KeyEventQueue>();
+    KeyEvent event{};
+    EXPECT_EQ(std::size_t{ 0 }, queue->Available());
+    EXPECT_FALSE(queue->PopDue(1000, event));
+}
+
+TEST(KeyEventQueueTest, EventsArePoppedInOrderWhenDue)
+{
+    auto queue = std::make_unique<KeyEventQueue>();
+    EXPECT_TRUE(queue->Push(KeyEvent{ 5, ZXKey::A, true }));
+    EXPECT_TRUE(queue->Push(KeyEvent{ 5, ZXKey::B, true }));
+    EXPECT_TRUE(queue->Push(KeyEvent{ 7, ZXKey::A, false }));
+
+    KeyEvent event{};
+    EXPECT_FALSE(queue->PopDue(4, event));
+    EXPECT_TRUE(queue->PopDue(5, event));
+    EXPECT_EQ(ZXKey::A, event.Key);
+    EXPECT_TRUE(event.Pressed);
+    EXPECT_TRUE(queue->PopDue(5, event));
+    EXPECT_EQ(ZXKey::B, event.Key);
+    EXPECT_FALSE(queue->PopDue(6, event));
+    // Events for frames that have passed are still delivered
+    EXPECT_TRUE(queue->PopDue(10, event));
+    EXPECT_EQ(ZXKey::A, event.Key);
+    EXPECT_FALSE(event.Pressed);
+    EXPECT_EQ(std::size_t{ 0 }, queue->Available());
+}
+
+TEST(KeyEventQueueTest, PushFailsWhenFull)
+{
+    auto queue = std::make_unique<KeyEventQueue>();
+    for (std::size_t i = 0; i < KeyEventQueue::Capacity; ++i)
+        EXPECT_TRUE(queue->Push(KeyEvent{ i, ZXKey::Space, true }));
+    EXPECT_FALSE(queue->Push(KeyEvent{ 0, ZXKey::Space, true }));
+    KeyEvent event{};
+    EXPECT_TRUE(queue->PopDue(0, event));
+    EXPECT_TRUE(queue->Push(KeyEvent{ 0, ZXKey::Space, true }));
+}
+
+TEST(KeyEventQueueTest, ConcurrentProducerAndConsumer)
+{
+    static constexpr uint64_t EventCount = 100000;
+    auto queue = std::make_unique<KeyEventQueue>();
+
+    std::thread producer([&queue]()
+    {
+        for (uint64_t frame = 0; frame < EventCount; ++frame)
+        {
+            while (!queue->Push(KeyEvent{ frame, ZXKey::Enter, (frame & 1) != 0 }))
+                std::this_thread::yield();
+        }
+    });
+
+    uint64_t expected = 0;
+    bool inOrder = true;
+    KeyEvent event{};
+    while (expected < EventCount)
+    {
+        if (queue->PopDue(expected, event))
+        {
+            inOrder = inOrder && (event.Frame == expected) && (event.Pressed == ((expected & 1) != 0));
+            ++expected;
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(inOrder);
+}
@@ -0,0 +1,79 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : KeyboardMatrixTest.cpp
+//
+// Namespace   : -
+//
+// Class       : KeyboardMatrixTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include "Model/KeyboardMatrix.h"
+
+TEST(KeyboardMatrixTest, NoKeysPressedReadsAllOnes)
+{
+    KeyboardMatrix keyboard;
+    EXPECT_EQ(0xFF, keyboard.Read(0x00));
+    EXPECT_EQ(0xFF, keyboard.Read(0xFE));
+}
+
+TEST(KeyboardMatrixTest, KeyIsReadInItsHalfRowOnly)
+{
+    KeyboardMatrix keyboard;
+    keyboard.SetKey(ZXKey::Q, true);
+    // Q is bit 0 of half-row 0xFB
+    EXPECT_EQ(0xFE, keyboard.Read(0xFB));
+    EXPECT_EQ(0xFF, keyboard.Read(0xFD));
+    EXPECT_EQ(0xFF, keyboard.Read(0x7F));
+    EXPECT_TRUE(keyboard.IsPressed(ZXKey::Q));
+    EXPECT_FALSE(keyboard.IsPressed(ZXKey::W));
+}
+
+TEST(KeyboardMatrixTest, SelectingSeveralHalfRowsCombinesThem)
+{
+    KeyboardMatrix keyboard;
+    keyboard.SetKey(ZXKey::CapsShift, true);
+    keyboard.SetKey(ZXKey::Space, true);
+    keyboard.SetKey(ZXKey::B, true);
+    EXPECT_EQ(0xFE, keyboard.Read(0xFE));
+    EXPECT_EQ(0xEE, keyboard.Read(0x7F));
+    EXPECT_EQ(0xEE, keyboard.Read(0x7E));
+    // All half-rows selected, as the ROM does to check for any key
+    EXPECT_EQ(0xEE, keyboard.Read(0x00));
+}
+
+TEST(KeyboardMatrixTest, ReleaseAndReset)
+{
+    KeyboardMatrix keyboard;
+    keyboard.SetKey(ZXKey::Enter, true);
+    keyboard.SetKey(ZXKey::L, true);
+    keyboard.SetKey(ZXKey::Enter, false);
+    EXPECT_EQ(0xFD, keyboard.Read(0xBF));
+    keyboard.Reset();
+    EXPECT_EQ(0xFF, keyboard.Read(0xBF));
+}
+
+TEST(KeyboardMatrixTest, SavedStateKeepsPressedKeys)
+{
+    KeyboardMatrix keyboard;
+    keyboard.SetKey(ZXKey::SymbolShift, true);
+    keyboard.SetKey(ZXKey::P, true);
+    ByteVector saved;
+    std::size_t offset{};
+    keyboard.SaveState(saved, offset);
+
+    KeyboardMatrix other;
+    offset = 0;
+    EXPECT_TRUE(other.LoadState(saved, offset));
+    EXPECT_TRUE(other.IsPressed(ZXKey::SymbolShift));
+    EXPECT_TRUE(other.IsPressed(ZXKey::P));
+    EXPECT_FALSE(other.IsPressed(ZXKey::Space));
+    saved.pop_back();
+    offset = 0;
+    EXPECT_FALSE(other.LoadState(saved, offset));
+}
@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : MemoryBanksTest.cpp
+//
+// Namespace   : -
+//
+// Class       : MemoryBanksTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <memory>
+#include "Model/MemoryBanks.h"
+#include "Model/MemoryGeneric.h"
+
+using TestMemoryMap = GenericPagedMemoryMap<uint16_t, 10>;
+
+static constexpr uint16_t PagedSlotAddress = 0xC000;
+
+TEST(MemoryBanksTest, LoadROMFillsBanksInOrder)
+{
+    MemoryBanks banks(2, 8, 0xAA);
+    ByteVector contents(2 * MemoryBanks::BankSize);
+    contents[0] = 0x12;
+    contents[MemoryBanks::BankSize] = 0x34;
+    EXPECT_TRUE(banks.LoadROM(contents));
+    EXPECT_EQ(0x12, banks.ROMBank(0)[0]);
+    EXPECT_EQ(0x34, banks.ROMBank(1)[0]);
+}
+
+TEST(MemoryBanksTest, LoadROMFailsIfContentsDoNotFit)
+{
+    MemoryBanks banks(1, 3, 0x01);
+    EXPECT_FALSE(banks.LoadROM(ByteVector(MemoryBanks::BankSize + 1)));
+}
+
+TEST(MemoryBanksTest, RemappedSlotKeepsEachBankContents)
+{
+    MemoryBanks banks(1, 8, 0xAA);
+    auto map = std::make_unique<TestMemoryMap>();
+    for (std::size_t bank = 0; bank < banks.RAMBankCount(); ++bank)
+    {
+        map->MapReadWrite(PagedSlotAddress, MemoryBanks::BankSize, banks.RAMBank(bank));
+        map->Write8(PagedSlotAddress + 0x1234, static_cast<uint8_t>(0xA0 + bank));
+    }
+    for (std::size_t bank = 0; bank < banks.RAMBankCount(); ++bank)
+    {
+        map->MapReadWrite(PagedSlotAddress, MemoryBanks::BankSize, banks.RAMBank(bank));
+        uint8_t value{};
+        map->Read8(PagedSlotAddress + 0x1234, value);
+        EXPECT_EQ(0xA0 + bank, value);
+        EXPECT_EQ(0xA0 + bank, banks.RAMBank(bank)[0x1234]);
+    }
+}
+
+TEST(MemoryBanksTest, BankMappedTwiceIsShared)
+{
+    MemoryBanks banks(1, 8, 0xAA);
+    auto map = std::make_unique<TestMemoryMap>();
+    map->MapReadWrite(0x4000, MemoryBanks::BankSize, banks.RAMBank(5));
+    map->MapReadWrite(PagedSlotAddress, MemoryBanks::BankSize, banks.RAMBank(5));
+    map->Write8(PagedSlotAddress, 0x55);
+    uint8_t value{};
+    map->Read8(0x4000, value);
+    EXPECT_EQ(0x55, value);
+}
@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : MemoryGenericTest.cpp
+//
+// Namespace   : -
+//
+// Class       : GenericPagedMemoryMapTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <memory>
+#include <vector>
+#include "Model/MemoryGeneric.h"
+
+using TestMemoryMap = GenericPagedMemoryMap<uint16_t, 10>;
+
+static constexpr std::size_t PageSize = TestMemoryMap::PageSize;
+
+// Reads return the low byte of the address, the last write is kept
+class TestDevice
+    : public IMemoryAccess<uint16_t>
+{
+public:
+    uint16_t WrittenAddress{};
+    uint8_t WrittenValue{};
+    int WriteCount{};
+
+    void Write8(uint16_t address, uint8_t value) override { WrittenAddress = address; WrittenValue = value; ++WriteCount; }
+    void Read8(uint16_t address, uint8_t &value) override { value = static_cast<uint8_t>(address); }
+    void Read16(uint16_t /*address*/, uint16_t &value) override { value = 0xFFFF; }
+    void Read32(uint16_t /*address*/, uint32_t &value) override { value = 0xFFFFFFFF; }
+    void Read64(uint16_t /*address*/, uint64_t &value) override { value = 0xFFFFFFFFFFFFFFFF; }
+};
+
+class GenericPagedMemoryMapTest
+    : public ::testing::Test
+{
+protected:
+    std::unique_ptr<TestMemoryMap> m_map;
+    std::vector<uint8_t> m_memory;
+
+    void SetUp() override
+    {
+        m_map = std::make_unique<TestMemoryMap>();
+        m_memory.resize(4 * PageSize);
+    }
+    uint8_t Read8(uint16_t address)
+    {
+        uint8_t value{};
+        m_map->Read8(address, value);
+        return value;
+    }
+    uint16_t Read16(uint16_t address)
+    {
+        uint16_t value{};
+        m_map->Read16(address, value);
+        return value;
+    }
+};
+
+TEST_F(GenericPagedMemoryMapTest, ReadWritePagesAccessTheMappedData)
+{
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    m_map->Write8(0x4001, 0x12);
+    m_map->Write8(0x4C00, 0x34);
+    EXPECT_EQ(0x12, m_memory[0x0001]);
+    EXPECT_EQ(0x34, m_memory[0x0C00]);
+    EXPECT_EQ(0x12, Read8(0x4001));
+    EXPECT_EQ(0x34, Read8(0x4C00));
+}
+
+TEST_F(GenericPagedMemoryMapTest, WordAccessCrossesPageBoundary)
+{
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    m_map->Write16(0x43FF, 0xBEEF);
+    EXPECT_EQ(0xEF, m_memory[0x03FF]);
+    EXPECT_EQ(0xBE, m_memory[0x0400]);
+    EXPECT_EQ(0xBEEF, Read16(0x43FF));
+}
+
+TEST_F(GenericPagedMemoryMapTest, WordAccessWrapsAroundTheAddressSpace)
+{
+    m_map->MapReadWrite(0x0000, m_memory.size(), m_memory.data());
+    std::vector<uint8_t> top(PageSize);
+    m_map->MapReadWrite(static_cast<uint16_t>(0x10000 - PageSize), top.size(), top.data());
+    m_map->Write16(0xFFFF, 0x1234);
+    EXPECT_EQ(0x34, top[PageSize - 1]);
+    EXPECT_EQ(0x12, m_memory[0]);
+    EXPECT_EQ(0x1234, Read16(0xFFFF));
+}
+
+TEST_F(GenericPagedMemoryMapTest, WritesToReadOnlyPagesGoToTheSinkPage)
+{
+    m_memory[0x0005] = 0x5A;
+    m_map->MapReadOnly(0x0000, m_memory.size(), m_memory.data());
+    m_map->Write8(0x0005, 0xA5);
+    m_map->Write16(0x0400, 0xFFFF);
+    EXPECT_EQ(0x5A, m_memory[0x0005]);
+    EXPECT_EQ(0x00, m_memory[0x0400]);
+    EXPECT_EQ(0x5A, Read8(0x0005));
+}
+
+TEST_F(GenericPagedMemoryMapTest, UnmappedReadsReturnFF)
+{
+    EXPECT_EQ(0xFF, Read8(0x8000));
+    EXPECT_EQ(0xFFFF, Read16(0x8000));
+    m_map->Write8(0x8000, 0x00);
+    EXPECT_EQ(0xFF, Read8(0x8000));
+}
+
+TEST_F(GenericPagedMemoryMapTest, UnmapRemovesPages)
+{
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    m_map->Unmap(0x4400, PageSize);
+    m_map->Write8(0x4400, 0x12);
+    EXPECT_EQ(0x00, m_memory[0x0400]);
+    EXPECT_EQ(0xFF, Read8(0x4400));
+    EXPECT_EQ(0x00, Read8(0x4000));
+}
+
+TEST_F(GenericPagedMemoryMapTest, HandlerPagesGoToTheDevice)
+{
+    TestDevice device;
+    m_map->MapHandler(0x8000, PageSize, device);
+    m_map->Write8(0x8123, 0x45);
+    EXPECT_EQ(0x8123, device.WrittenAddress);
+    EXPECT_EQ(0x45, device.WrittenValue);
+    EXPECT_EQ(0x23, Read8(0x8123));
+    // Word accesses are split into byte accesses on the device
+    m_map->Write16(0x8010, 0xABCD);
+    EXPECT_EQ(3, device.WriteCount);
+    EXPECT_EQ(0x1110, Read16(0x8010));
+    // The next page is not mapped to the device
+    EXPECT_EQ(0xFF, Read8(0x8400));
+}
+
+TEST_F(GenericPagedMemoryMapTest, MappingReplacesEarlierMapping)
+{
+    TestDevice device;
+    m_map->MapHandler(0x4000, m_memory.size(), device);
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    m_map->Write8(0x4000, 0x77);
+    EXPECT_EQ(0, device.WriteCount);
+    EXPECT_EQ(0x77, m_memory[0]);
+}
+
+TEST(MemoryMappingTest, IsHitOnlyInsideRange)
+{
+    TestDevice device;
+    MemoryMapping<uint16_t> mapping{ device, 0x4000, 0x7FFF };
+    EXPECT_FALSE(mapping.IsHit(0x3FFF));
+    EXPECT_TRUE(mapping.IsHit(0x4000));
+    EXPECT_TRUE(mapping.IsHit(0x7FFF));
+    EXPECT_FALSE(mapping.IsHit(0x8000));
+    EXPECT_FALSE(mapping.IsHit(0x0000));
+    EXPECT_FALSE(mapping.IsHit(0xFFFF));
+}
+
+TEST_F(GenericPagedMemoryMapTest, TrappedWriteBumpsGenerationOnce)
+{
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    const std::size_t page = TestMemoryMap::PageIndex(0x4400);
+    const uint32_t generation = m_map->WriteGeneration(page);
+    m_map->TrapWrites(page);
+    EXPECT_TRUE(m_map->IsWriteTrapped(page));
+    m_map->Write8(0x4401, 0x12);
+    EXPECT_EQ(0x12, m_memory[0x0401]);
+    EXPECT_EQ(generation + 1, m_map->WriteGeneration(page));
+    EXPECT_FALSE(m_map->IsWriteTrapped(page));
+    // The trap is disarmed by the first write
+    m_map->Write8(0x4402, 0x34);
+    EXPECT_EQ(0x34, m_memory[0x0402]);
+    EXPECT_EQ(generation + 1, m_map->WriteGeneration(page));
+    // Other pages are not trapped
+    m_map->Write8(0x4000, 0x56);
+    EXPECT_EQ(0x56, m_memory[0x0000]);
+    EXPECT_EQ(generation + 1, m_map->WriteGeneration(page));
+}
+
+TEST_F(GenericPagedMemoryMapTest, RemapBumpsGenerationAndRemovesTrap)
+{
+    m_map->MapReadWrite(0x4000, m_memory.size(), m_memory.data());
+    const std::size_t page = TestMemoryMap::PageIndex(0x4000);
+    const uint32_t generation = m_map->WriteGeneration(page);
+    m_map->TrapWrites(page);
+    m_map->MapReadWrite(0x4000, PageSize, m_memory.data() + PageSize);
+    EXPECT_FALSE(m_map->IsWriteTrapped(page));
+    EXPECT_EQ(generation + 1, m_map->WriteGeneration(page));
+    m_map->Write8(0x4000, 0x12);
+    EXPECT_EQ(0x12, m_memory[PageSize]);
+    EXPECT_EQ(generation + 1, m_map->WriteGeneration(page));
+}
+
+TEST_F(GenericPagedMemoryMapTest, ReadOnlyAndHandlerPagesAreNotTrapped)
+{
+    TestDevice device;
+    m_map->MapReadOnly(0x0000, PageSize, m_memory.data());
+    m_map->MapHandler(0x8000, PageSize, device);
+    m_map->TrapWrites(TestMemoryMap::PageIndex(0x0000));
+    m_map->TrapWrites(TestMemoryMap::PageIndex(0x8000));
+    EXPECT_FALSE(m_map->IsWriteTrapped(TestMemoryMap::PageIndex(0x0000)));
+    EXPECT_FALSE(m_map->IsWriteTrapped(TestMemoryMap::PageIndex(0x8000)));
+    m_map->Write8(0x8000, 0x12);
+    EXPECT_EQ(1, device.WriteCount);
+}
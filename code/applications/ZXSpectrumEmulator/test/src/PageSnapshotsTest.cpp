@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : PageSnapshotsTest.cpp
+//
+// Namespace   : -
+//
+// Class       : PageSnapshotsTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <vector>
+#include "Model/PageSnapshots.h"
+#include "Model/ZXSpectrum.h"
+#include "Model/ZXSpectrum128.h"
+
+static constexpr std::size_t PagesPerBank = MemoryBanks::BankSize / PageSnapshots::PageSize;
+static constexpr uint16_t CodeAddress = 0x8000;
+
+// RAM page index in SystemState::Pages
+static std::size_t PageIndex(std::size_t bank, std::size_t page)
+{
+    return bank * PagesPerBank + page;
+}
+
+// Indices of the pages that are not the same object in both states
+static std::vector<std::size_t> CopiedPages(const SystemState &first, const SystemState &second)
+{
+    std::vector<std::size_t> result;
+    for (std::size_t index = 0; index < first.Pages.size(); ++index)
+    {
+        if (first.Pages[index] != second.Pages[index])
+            result.push_back(index);
+    }
+    return result;
+}
+
+// 48K layout on a bare CPU, so the test can remap banks itself
+class PageSnapshotsTest
+    : public ::testing::Test
+{
+protected:
+    Z80 m_cpu;
+    MemoryBanks m_memory;
+    PageSnapshots m_snapshots;
+
+    PageSnapshotsTest()
+        : m_cpu{ 3500000 }
+        , m_memory{ 1, 4, 0 }
+        , m_snapshots{ m_cpu, m_memory }
+    {
+        m_cpu.MapROM(0x0000, MemoryBanks::BankSize, m_memory.ROMBank(0));
+        for (std::size_t bank = 0; bank < 3; ++bank)
+        {
+            m_cpu.MapRAM(static_cast<uint16_t>((bank + 1) * MemoryBanks::BankSize), MemoryBanks::BankSize, m_memory.RAMBank(bank));
+        }
+        m_cpu.SetExecutionMode(ExecutionMode::BlockCache);
+    }
+    // INC A or DEC A, then HALT. The opcode differs, so a stale block cannot pick up the new code through its operands
+    void WriteCode(uint8_t opcode)
+    {
+        m_cpu.WriteMemory(CodeAddress, opcode);
+        m_cpu.WriteMemory(CodeAddress + 1, 0x76);
+    }
+    uint8_t RunCode()
+    {
+        auto &registers = m_cpu.GetRegisters();
+        registers.Reg[RegisterIndex::A] = 0x10;
+        registers.PC = CodeAddress;
+        registers.Halted = false;
+        m_cpu.ExecuteCycles(8);
+        return registers.Reg[RegisterIndex::A];
+    }
+};
+
+class TestSpectrum
+    : public ZXSpectrum
+{
+public:
+    Z80 &GetCPU() { return m_cpu; }
+};
+
+class TestSpectrum128
+    : public ZXSpectrum128
+{
+public:
+    Z80 &GetCPU() { return m_cpu; }
+};
+
+TEST_F(PageSnapshotsTest, UnchangedPagesAreShared)
+{
+    SystemState first;
+    SystemState second;
+    m_snapshots.Capture(first.Pages);
+    m_snapshots.Capture(second.Pages);
+
+    EXPECT_EQ(4 * PagesPerBank, first.Pages.size());
+    EXPECT_EQ(first.Pages, second.Pages);
+}
+
+TEST_F(PageSnapshotsTest, OnlyWrittenPagesAreCopied)
+{
+    SystemState first;
+    SystemState second;
+    m_snapshots.Capture(first.Pages);
+    m_cpu.WriteMemory(0x8401, 0x55);
+    m_snapshots.Capture(second.Pages);
+
+    EXPECT_EQ(std::vector<std::size_t>{ PageIndex(1, 1) }, CopiedPages(first, second));
+    EXPECT_EQ(0x00, (*first.Pages[PageIndex(1, 1)])[1]);
+    EXPECT_EQ(0x55, (*second.Pages[PageIndex(1, 1)])[1]);
+}
+
+// The bank switched out was written before the switch, the bank switched in after it
+TEST_F(PageSnapshotsTest, OnlyWrittenPagesAreCopiedAfterBankSwitch)
+{
+    SystemState first;
+    SystemState second;
+    m_snapshots.Capture(first.Pages);
+    m_cpu.WriteMemory(0xC000, 0x11);
+    m_cpu.MapRAM(0xC000, MemoryBanks::BankSize, m_memory.RAMBank(3));
+    m_cpu.WriteMemory(0xC800, 0x22);
+    m_snapshots.Capture(second.Pages);
+
+    std::vector<std::size_t> expected{ PageIndex(2, 0), PageIndex(3, 2) };
+    EXPECT_EQ(expected, CopiedPages(first, second));
+    EXPECT_EQ(0x11, (*second.Pages[PageIndex(2, 0)])[0]);
+    EXPECT_EQ(0x22, (*second.Pages[PageIndex(3, 2)])[0]);
+}
+
+TEST_F(PageSnapshotsTest, RestoreCopiesBackChangedPages)
+{
+    SystemState state;
+    m_cpu.WriteMemory(0x4000, 0x11);
+    m_snapshots.Capture(state.Pages);
+    m_cpu.WriteMemory(0x4000, 0x22);
+
+    EXPECT_TRUE(m_snapshots.Restore(state.Pages));
+    EXPECT_EQ(0x11, m_cpu.PeekMemory(0x4000));
+}
+
+// The block decoded from the code written after the capture must be dropped on restore
+TEST_F(PageSnapshotsTest, RestoredPageDropsCachedBlock)
+{
+    SystemState state;
+    WriteCode(0x3C);
+    m_snapshots.Capture(state.Pages);
+    EXPECT_EQ(0x11, RunCode());
+    WriteCode(0x3D);
+    EXPECT_EQ(0x0F, RunCode());
+
+    EXPECT_TRUE(m_snapshots.Restore(state.Pages));
+    EXPECT_EQ(0x11, RunCode());
+}
+
+TEST_F(PageSnapshotsTest, RestoreRejectsWrongPageCount)
+{
+    SystemState state;
+    m_snapshots.Capture(state.Pages);
+    m_cpu.WriteMemory(0x4000, 0x22);
+    state.Pages.pop_back();
+
+    EXPECT_FALSE(m_snapshots.Restore(state.Pages));
+    EXPECT_EQ(0x22, m_cpu.PeekMemory(0x4000));
+}
+
+TEST(ZXSpectrumStateTest, BankSwitchCopiesOnlyWrittenPages)
+{
+    TestSpectrum128 system;
+    Z80 &cpu = system.GetCPU();
+    SystemState first;
+    SystemState second;
+    system.SaveState(first);
+    // Bank 0 at 0xC000 is written, then bank 3 is paged in and written
+    cpu.WriteMemory(0xC000, 0x11);
+    cpu.Out(0x7FFD, 0x03);
+    cpu.WriteMemory(0xC400, 0x22);
+    system.SaveState(second);
+
+    std::vector<std::size_t> expected{ PageIndex(0, 0), PageIndex(3, 1) };
+    EXPECT_EQ(expected, CopiedPages(first, second));
+
+    EXPECT_TRUE(system.LoadState(first));
+    EXPECT_EQ(0u, system.GetPaging().GetPagedBank());
+    EXPECT_EQ(0x00, cpu.PeekMemory(0xC000));
+}
+
+TEST(ZXSpectrumStateTest, LoadStateRejectsOtherModel)
+{
+    TestSpectrum system48;
+    TestSpectrum128 system128;
+    SystemState state;
+    system48.SaveState(state);
+
+    EXPECT_FALSE(system128.LoadState(state));
+}
+
+TEST(ZXSpectrumStateTest, LoadStateRejectsWrongPageCount)
+{
+    TestSpectrum system;
+    SystemState state;
+    system.SaveState(state);
+    state.Pages.pop_back();
+
+    EXPECT_FALSE(system.LoadState(state));
+}
+
+TEST(ZXSpectrumStateTest, LoadStateResetsOnTruncatedState)
+{
+    TestSpectrum system;
+    for (int i = 0; i < 10; ++i)
+    {
+        system.ProcessInstruction();
+    }
+    SystemState state;
+    system.SaveState(state);
+    state.Data.resize(state.Data.size() - 1);
+
+    EXPECT_FALSE(system.LoadState(state));
+    EXPECT_EQ(0u, system.GetCPUClock());
+    EXPECT_EQ(0x0000, system.GetCPU().GetRegisters().PC);
+}
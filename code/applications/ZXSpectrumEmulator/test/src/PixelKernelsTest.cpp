@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : PixelKernelsTest.cpp
+//
+// Namespace   : -
+//
+// Class       : PixelKernelsTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <vector>
+#include "Model/PixelKernels.h"
+
+static const PixelKernelSet AllKernelSets[] = { PixelKernelSet::Scalar, PixelKernelSet::SSE2, PixelKernelSet::AVX2 };
+
+static constexpr uint32_t Ink = 0x00D7D700;
+static constexpr uint32_t Paper = 0x000000FF;
+// Pixels outside the written area must keep this value
+static constexpr uint32_t Guard = 0xDEADBEEF;
+
+TEST(PixelKernelsTest, ScalarIsAlwaysSupported)
+{
+    EXPECT_TRUE(IsPixelKernelSetSupported(PixelKernelSet::Scalar));
+    EXPECT_TRUE(IsPixelKernelSetSupported(BestPixelKernelSet()));
+}
+
+TEST(PixelKernelsTest, ScalarExpandCell)
+{
+    const uint8_t bitmap[8] = { 0x80, 0x01, 0xFF, 0x00, 0xAA, 0x55, 0x0F, 0xF0 };
+    std::vector<uint32_t> pixels(8 * 10, Guard);
+    GetPixelKernels(PixelKernelSet::Scalar).ExpandCell(bitmap, Ink, Paper, pixels.data() + 1, 10);
+    for (unsigned line = 0; line < 8; ++line)
+    {
+        EXPECT_EQ(Guard, pixels[line * 10]);
+        for (unsigned x = 0; x < 8; ++x)
+        {
+            const uint32_t expected = (bitmap[line] & (0x80 >> x)) ? Ink : Paper;
+            EXPECT_EQ(expected, pixels[line * 10 + 1 + x]) << "line " << line << " x " << x;
+        }
+        EXPECT_EQ(Guard, pixels[line * 10 + 9]);
+    }
+}
+
+TEST(PixelKernelsTest, ExpandCellIsIdenticalForAllSets)
+{
+    const auto &reference = GetPixelKernels(PixelKernelSet::Scalar);
+    for (auto set : AllKernelSets)
+    {
+        if (!IsPixelKernelSetSupported(set))
+            continue;
+        const auto &kernels = GetPixelKernels(set);
+        // All 256 bitmap bytes, 8 per cell
+        for (unsigned first = 0; first < 256; first += 8)
+        {
+            uint8_t bitmap[8];
+            for (unsigned line = 0; line < 8; ++line)
+                bitmap[line] = static_cast<uint8_t>(first + line);
+            std::vector<uint32_t> expected(8 * 13, Guard);
+            std::vector<uint32_t> actual(8 * 13, Guard);
+            reference.ExpandCell(bitmap, Ink, Paper, expected.data() + 3, 13);
+            kernels.ExpandCell(bitmap, Ink, Paper, actual.data() + 3, 13);
+            EXPECT_EQ(expected, actual) << "set " << static_cast<int>(set) << " bytes from " << first;
+        }
+    }
+}
+
+TEST(PixelKernelsTest, FillIsIdenticalForAllSets)
+{
+    for (auto set : AllKernelSets)
+    {
+        if (!IsPixelKernelSetSupported(set))
+            continue;
+        const auto &kernels = GetPixelKernels(set);
+        // Every length up to a few vectors, at every alignment within a vector
+        for (std::size_t offset = 0; offset < 8; ++offset)
+        {
+            for (std::size_t count = 0; count < 40; ++count)
+            {
+                std::vector<uint32_t> pixels(offset + count + 8, Guard);
+                kernels.Fill(pixels.data() + offset, count, Ink);
+                for (std::size_t i = 0; i < pixels.size(); ++i)
+                {
+                    const bool inside = (i >= offset) && (i < offset + count);
+                    EXPECT_EQ(inside ? Ink : Guard, pixels[i]) << "set " << static_cast<int>(set) << " offset " << offset << " count " << count;
+                }
+            }
+        }
+    }
+}
+
+TEST(PixelKernelsTest, CopyIsIdenticalForAllSets)
+{
+    std::vector<uint32_t> source(64);
+    for (std::size_t i = 0; i < source.size(); ++i)
+        source[i] = static_cast<uint32_t>(i * 0x01030507);
+    for (auto set : AllKernelSets)
+    {
+        if (!IsPixelKernelSetSupported(set))
+            continue;
+        const auto &kernels = GetPixelKernels(set);
+        for (std::size_t offset = 0; offset < 8; ++offset)
+        {
+            for (std::size_t count = 0; count < 40; ++count)
+            {
+                std::vector<uint32_t> pixels(offset + count + 8, Guard);
+                kernels.Copy(pixels.data() + offset, source.data() + offset, count);
+                for (std::size_t i = 0; i < pixels.size(); ++i)
+                {
+                    const bool inside = (i >= offset) && (i < offset + count);
+                    EXPECT_EQ(inside ? source[i] : Guard, pixels[i]) << "set " << static_cast<int>(set) << " offset " << offset << " count " << count;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : ULARendererTest.cpp
+//
+// Namespace   : -
+//
+// Class       : ULARendererTest
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "Model/ULARenderer.h"
+
+static constexpr uint16_t DisplayAddress = 0x4000;
+static constexpr uint16_t DisplayMemorySize = ULARenderer::DisplayFileSize + ULARenderer::AttributeFileSize;
+// White ink on black paper, not bright
+static constexpr uint8_t WhiteOnBlack = 0x07;
+
+class ULARendererTest
+    : public ::testing::Test
+{
+protected:
+    std::vector<uint8_t> m_displayMemory;
+    std::unique_ptr<ULARenderer> m_renderer;
+    std::unique_ptr<ULAScreen> m_screen;
+
+    void SetUp() override
+    {
+        m_displayMemory.assign(DisplayMemorySize, 0x00);
+        std::fill(m_displayMemory.begin() + ULARenderer::DisplayFileSize, m_displayMemory.end(), WhiteOnBlack);
+        m_renderer = std::make_unique<ULARenderer>(DisplayAddress);
+        m_screen = std::make_unique<ULAScreen>();
+    }
+    ULADirtyLines Render(uint64_t frameCount = 0)
+    {
+        return m_renderer->Render(m_displayMemory.data(), frameCount, *m_screen);
+    }
+    // x and y within the paper area
+    uint32_t Pixel(int x, int y) const
+    {
+        return (*m_screen)[(ULABorderHeight + y) * ULAFrameWidth + ULABorderWidth + x];
+    }
+};
+
+// The display file is split in thirds of 64 lines, within a third the lines are interleaved per character row
+TEST_F(ULARendererTest, PixelLinesComeFromTheInterleavedDisplayFile)
+{
+    struct LineOffset
+    {
+        int Y;
+        uint16_t Offset;
+    };
+    const LineOffset lineOffsets[] =
+    {
+        { 0, 0x0000 },
+        { 7, 0x0700 },
+        { 8, 0x0020 },
+        { 64, 0x0800 },
+        { 191, 0x17E0 },
+    };
+    for (const auto &lineOffset : lineOffsets)
+    {
+        SetUp();
+        m_displayMemory[lineOffset.Offset] = 0x81;
+        Render();
+        for (int y = 0; y < ULAScreenHeight; ++y)
+        {
+            const bool isLine = (y == lineOffset.Y);
+            EXPECT_EQ(isLine ? ULAPalette[7] : ULAPalette[0], Pixel(0, y)) << "line " << lineOffset.Y << " y " << y;
+            EXPECT_EQ(ULAPalette[0], Pixel(1, y)) << "line " << lineOffset.Y << " y " << y;
+            EXPECT_EQ(isLine ? ULAPalette[7] : ULAPalette[0], Pixel(7, y)) << "line " << lineOffset.Y << " y " << y;
+            EXPECT_EQ(ULAPalette[0], Pixel(8, y)) << "line " << lineOffset.Y << " y " << y;
+        }
+    }
+}
+
+TEST_F(ULARendererTest, BrightAttributeUsesTheBrightPalette)
+{
+    // BRIGHT, paper red, ink yellow
+    m_displayMemory[ULARenderer::DisplayFileSize] = 0x40 | (2 << 3) | 6;
+    m_displayMemory[0x0000] = 0xF0;
+    Render();
+    EXPECT_EQ(0xFFFF00u, Pixel(0, 0));
+    EXPECT_EQ(0xFF0000u, Pixel(4, 0));
+    // The next cell is not bright
+    m_displayMemory[ULARenderer::DisplayFileSize + 1] = (2 << 3) | 6;
+    m_displayMemory[0x0001] = 0xF0;
+    m_renderer->Invalidate();
+    Render();
+    EXPECT_EQ(0xD7D700u, Pixel(8, 0));
+    EXPECT_EQ(0xD70000u, Pixel(12, 0));
+}
+
+TEST_F(ULARendererTest, FlashingAttributeSwapsInkAndPaperEvery16Frames)
+{
+    // FLASH, paper blue, ink white
+    m_displayMemory[ULARenderer::DisplayFileSize] = 0x80 | (1 << 3) | 7;
+    m_displayMemory[0x0000] = 0x80;
+    Render(0);
+    EXPECT_EQ(0xD7D7D7u, Pixel(0, 0));
+    EXPECT_EQ(0x0000D7u, Pixel(1, 0));
+    Render(ULARenderer::FlashPeriodFrames - 1);
+    EXPECT_EQ(0xD7D7D7u, Pixel(0, 0));
+    Render(ULARenderer::FlashPeriodFrames);
+    EXPECT_EQ(0x0000D7u, Pixel(0, 0));
+    EXPECT_EQ(0xD7D7D7u, Pixel(1, 0));
+    Render(2 * ULARenderer::FlashPeriodFrames);
+    EXPECT_EQ(0xD7D7D7u, Pixel(0, 0));
+    EXPECT_EQ(0x0000D7u, Pixel(1, 0));
+}
+
+// Only the cell written is converted again, changes to other cells stay unseen until they are written too
+TEST_F(ULARendererTest, DisplayFileWriteRedrawsOnlyItsCell)
+{
+    Render();
+    // Third 1, character row 1 (row 9), pixel line 0, column 5
+    const uint16_t offset = 0x0825;
+    m_displayMemory[offset] = 0xFF;
+    m_displayMemory[offset + 1] = 0xFF;
+    m_displayMemory[0x0000] = 0xFF;
+    m_renderer->OnMemoryWrite(DisplayAddress + offset);
+    const ULADirtyLines lines = Render();
+    EXPECT_EQ(ULABorderHeight + 9 * 8, lines.First);
+    EXPECT_EQ(ULABorderHeight + 9 * 8 + 7, lines.Last);
+    EXPECT_EQ(ULAPalette[7], Pixel(5 * 8, 9 * 8));
+    EXPECT_EQ(ULAPalette[7], Pixel(5 * 8 + 7, 9 * 8));
+    EXPECT_EQ(ULAPalette[0], Pixel(6 * 8, 9 * 8));
+    EXPECT_EQ(ULAPalette[0], Pixel(0, 0));
+    // Nothing was written since
+    EXPECT_TRUE(Render().IsEmpty());
+}
+
+TEST_F(ULARendererTest, AttributeWriteRedrawsOnlyItsCell)
+{
+    Render();
+    // Row 21, column 28
+    const unsigned cell = 21 * 32 + 28;
+    m_displayMemory[ULARenderer::DisplayFileSize + cell] = 2 << 3;
+    m_displayMemory[ULARenderer::DisplayFileSize + cell + 1] = 2 << 3;
+    m_renderer->OnMemoryWrite(static_cast<uint16_t>(DisplayAddress + ULARenderer::DisplayFileSize + cell));
+    const ULADirtyLines lines = Render();
+    EXPECT_EQ(ULABorderHeight + 21 * 8, lines.First);
+    EXPECT_EQ(ULABorderHeight + 21 * 8 + 7, lines.Last);
+    EXPECT_EQ(ULAPalette[2], Pixel(28 * 8, 21 * 8));
+    EXPECT_EQ(ULAPalette[2], Pixel(28 * 8 + 7, 21 * 8 + 7));
+    EXPECT_EQ(ULAPalette[0], Pixel(29 * 8, 21 * 8));
+    EXPECT_EQ(ULAPalette[0], Pixel(27 * 8 + 7, 21 * 8));
+}
+
+TEST_F(ULARendererTest, WritesOutsideDisplayMemoryAreIgnored)
+{
+    Render();
+    m_renderer->OnMemoryWrite(DisplayAddress - 1);
+    m_renderer->OnMemoryWrite(DisplayAddress + DisplayMemorySize);
+    m_renderer->OnMemoryWrite(0xFFFF);
+    EXPECT_TRUE(Render().IsEmpty());
+}
+
+TEST_F(ULARendererTest, DirtyLinesCoverAllCellsWritten)
+{
+    Render();
+    m_renderer->OnMemoryWrite(DisplayAddress + 0x0020);
+    m_renderer->OnMemoryWrite(static_cast<uint16_t>(DisplayAddress + ULARenderer::DisplayFileSize + 10 * 32 + 31));
+    const ULADirtyLines lines = Render();
+    EXPECT_EQ(ULABorderHeight + 8, lines.First);
+    EXPECT_EQ(ULABorderHeight + 10 * 8 + 7, lines.Last);
+    m_renderer->Invalidate();
+    const ULADirtyLines all = Render();
+    EXPECT_EQ(ULABorderHeight, all.First);
+    EXPECT_EQ(ULABorderHeight + ULAScreenHeight - 1, all.Last);
+}
+
+// On a FLASH phase change only the cells with a flashing attribute are converted again
+TEST_F(ULARendererTest, FlashPhaseChangeRedrawsOnlyFlashingCells)
+{
+    const unsigned flashingCell = 3 * 32 + 4;
+    m_displayMemory[ULARenderer::DisplayFileSize + flashingCell] = 0x80 | WhiteOnBlack;
+    Render(0);
+    // Changes to both cells without writes, only the flashing one is converted
+    const uint16_t flashingOffset = 0x0064;
+    m_displayMemory[flashingOffset] = 0xFF;
+    m_displayMemory[0x0000] = 0xFF;
+    EXPECT_TRUE(Render(ULARenderer::FlashPeriodFrames - 1).IsEmpty());
+    const ULADirtyLines lines = Render(ULARenderer::FlashPeriodFrames);
+    EXPECT_EQ(ULABorderHeight + 3 * 8, lines.First);
+    EXPECT_EQ(ULABorderHeight + 3 * 8 + 7, lines.Last);
+    // Inverted: the set pixels show the paper
+    EXPECT_EQ(ULAPalette[0], Pixel(4 * 8, 3 * 8));
+    EXPECT_EQ(ULAPalette[7], Pixel(4 * 8, 3 * 8 + 1));
+    EXPECT_EQ(ULAPalette[0], Pixel(0, 0));
+    // Same phase, nothing to do
+    EXPECT_TRUE(Render(ULARenderer::FlashPeriodFrames + 1).IsEmpty());
+}
+
+// Writes over several frames, across FLASH phase changes, converted incrementally and in full
+TEST_F(ULARendererTest, IncrementalRenderMatchesFullRender)
+{
+    ULARenderer fullRenderer{ DisplayAddress };
+    auto fullScreen = std::make_unique<ULAScreen>();
+    uint32_t random = 12345;
+    auto next = [&random]() { random = random * 1103515245 + 12345; return random >> 16; };
+    for (uint64_t frame = 0; frame < 4 * ULARenderer::FlashPeriodFrames; ++frame)
+    {
+        for (int i = 0; i < 50; ++i)
+        {
+            const uint16_t offset = static_cast<uint16_t>(next() % DisplayMemorySize);
+            m_displayMemory[offset] = static_cast<uint8_t>(next());
+            m_renderer->OnMemoryWrite(DisplayAddress + offset);
+        }
+        Render(frame);
+        fullRenderer.Invalidate();
+        fullRenderer.Render(m_displayMemory.data(), frame, *fullScreen);
+        ASSERT_TRUE(*m_screen == *fullScreen) << "frame " << frame;
+    }
+}
@@ -0,0 +1,348 @@
+//------------------------------------------------------------------------------
+// Copyright   : Copyright(c) 2024 Rene Barto
+//
+// File        : Z80Test.cpp
+//
+// Namespace   : -
+//
+// Class       : Z80Test
+//
+// Description :
+//
+//------------------------------------------------------------------------------
+
+#include "test-platform/GoogleTest.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Model/Z80.h"
+
+static constexpr uint64_t ClockFreq = 3500000;
+static constexpr uint16_t CodeAddress = 0x8000;
+static constexpr uint16_t StackAddress = 0xFF00;
+
+// Every port reads Value, the last write is kept and passed to OnWrite when set
+class TestPort
+    : public IIOAccess<uint16_t>
+{
+public:
+    uint8_t Value{ 0xFF };
+    uint16_t WrittenPort{};
+    uint8_t WrittenValue{};
+    std::function<void(uint8_t)> OnWrite;
+
+    void Write8(uint16_t address, uint8_t value) override
+    {
+        WrittenPort = address;
+        WrittenValue = value;
+        if (OnWrite)
+            OnWrite(value);
+    }
+    void Read8(uint16_t /*address*/, uint8_t &value) override { value = Value; }
+    void Read16(uint16_t /*address*/, uint16_t &value) override { value = 0xFFFF; }
+    void Read32(uint16_t /*address*/, uint32_t &value) override { value = 0xFFFFFFFF; }
+    void Read64(uint16_t /*address*/, uint64_t &value) override { value = 0xFFFFFFFFFFFFFFFF; }
+};
+
+class Z80Test
+    : public ::testing::Test
+{
+protected:
+    std::vector<uint8_t> m_memory;
+    TestPort m_port;
+    std::unique_ptr<Z80> m_cpu;
+
+    void SetUp() override
+    {
+        m_memory.assign(0x10000, 0x00);
+        m_cpu = std::make_unique<Z80>(ClockFreq);
+        m_cpu->MapRAM(0x0000, m_memory.size(), m_memory.data());
+        m_cpu->AddIOMapping(IOMapping<uint16_t>{ m_port, IOAddressDecode<uint16_t>{ 0x0000, 0x0000 } });
+        m_cpu->Reset();
+        m_cpu->GetRegisters().PC = CodeAddress;
+        m_cpu->GetRegisters().SP = StackAddress;
+    }
+    void Load(uint16_t address, const std::vector<uint8_t> &code)
+    {
+        std::copy(code.begin(), code.end(), m_memory.begin() + address);
+    }
+};
+
+// One instruction at CodeAddress. Address is the memory operand, (HL) or (IX+d), PortValue what IN reads
+struct InstructionCase
+{
+    const char *Name;
+    std::vector<uint8_t> Code;
+    uint16_t AF, BC, DE, HL, IX;
+    uint16_t Address;
+    uint8_t Memory;
+    uint8_t PortValue;
+    uint16_t ExpectedAF, ExpectedBC, ExpectedDE, ExpectedHL;
+    uint8_t ExpectedMemory;
+    uint64_t TStates;
+};
+
+// Flags as in "The Undocumented Z80 Documented", including bits 3 (X) and 5 (Y)
+static const InstructionCase InstructionCases[] =
+{
+    //  Name                     Code                          AF      BC      DE      HL      IX      Address Mem   Port  AF'     BC'     DE'     HL'     Mem'  T
+    { "DAA after add",           { 0x27 },                     0x9A00, 0x0000, 0x0000, 0x0000, 0x0000, 0x9005, 0x00, 0xFF, 0x0055, 0x0000, 0x0000, 0x0000, 0x00, 4 },
+    { "DAA after sub",           { 0x27 },                     0x0F12, 0x0000, 0x0000, 0x0000, 0x0000, 0x9005, 0x00, 0xFF, 0x090E, 0x0000, 0x0000, 0x0000, 0x00, 4 },
+    { "DAA after sub, borrow",   { 0x27 },                     0xFA03, 0x0000, 0x0000, 0x0000, 0x0000, 0x9005, 0x00, 0xFF, 0x9483, 0x0000, 0x0000, 0x0000, 0x00, 4 },
+    { "ADC HL,BC overflow",      { 0xED, 0x4A },               0x0001, 0x0000, 0x0000, 0x7FFF, 0x0000, 0x9005, 0x00, 0xFF, 0x0094, 0x0000, 0x0000, 0x8000, 0x00, 15 },
+    { "ADC HL,BC zero",          { 0xED, 0x4A },               0x0001, 0x0000, 0x0000, 0xFFFF, 0x0000, 0x9005, 0x00, 0xFF, 0x0051, 0x0000, 0x0000, 0x0000, 0x00, 15 },
+    { "SBC HL,DE overflow",      { 0xED, 0x52 },               0x0000, 0x0000, 0x0001, 0x8000, 0x0000, 0x9005, 0x00, 0xFF, 0x003E, 0x0000, 0x0001, 0x7FFF, 0x00, 15 },
+    { "SBC HL,DE borrow",        { 0xED, 0x52 },               0x0001, 0x0000, 0x0000, 0x0000, 0x0000, 0x9005, 0x00, 0xFF, 0x00BB, 0x0000, 0x0000, 0xFFFF, 0x00, 15 },
+    { "LDI",                     { 0xED, 0xA0 },               0x10FF, 0x0002, 0xA000, 0x9005, 0x0000, 0x9005, 0x2A, 0xFF, 0x10ED, 0x0001, 0xA001, 0x9006, 0x2A, 16 },
+    { "CPI",                     { 0xED, 0xA1 },               0x1001, 0x0001, 0x0000, 0x9005, 0x0000, 0x9005, 0x01, 0xFF, 0x103B, 0x0000, 0x0000, 0x9006, 0x01, 16 },
+    { "INI",                     { 0xED, 0xA2 },               0x0000, 0x0210, 0x0000, 0x9005, 0x0000, 0x9005, 0x00, 0xF5, 0x0013, 0x0110, 0x0000, 0x9006, 0xF5, 16 },
+    { "OUTI",                    { 0xED, 0xA3 },               0x0000, 0x0110, 0x0000, 0x9005, 0x0000, 0x9005, 0x80, 0xFF, 0x0046, 0x0010, 0x0000, 0x9006, 0x80, 16 },
+    { "RLC (IX+d),B",            { 0xDD, 0xCB, 0x05, 0x00 },   0x0000, 0x0000, 0x0000, 0x0000, 0x9000, 0x9005, 0x81, 0xFF, 0x0005, 0x0300, 0x0000, 0x0000, 0x03, 23 },
+    { "SET 0,(IX+d),A",          { 0xDD, 0xCB, 0x05, 0xC7 },   0x00D7, 0x0000, 0x0000, 0x0000, 0x9000, 0x9005, 0x80, 0xFF, 0x81D7, 0x0000, 0x0000, 0x0000, 0x81, 23 },
+    { "SRL (IY+d),L",            { 0xFD, 0xCB, 0xFE, 0x3D },   0x0000, 0x0000, 0x0000, 0x00FF, 0x0000, 0x9005, 0x01, 0xFF, 0x0045, 0x0000, 0x0000, 0x0000, 0x00, 23 },
+    { "BIT 0,(IX+d) set",        { 0xDD, 0xCB, 0x05, 0x46 },   0x0001, 0x0000, 0x0000, 0x0000, 0x2800, 0x2805, 0x01, 0xFF, 0x0039, 0x0000, 0x0000, 0x0000, 0x01, 20 },
+    { "BIT 7,(IX+d) set",        { 0xDD, 0xCB, 0x05, 0x7E },   0x0000, 0x0000, 0x0000, 0x0000, 0x2800, 0x2805, 0x80, 0xFF, 0x00B8, 0x0000, 0x0000, 0x0000, 0x80, 20 },
+    { "BIT 1,(IX+d) clear",      { 0xDD, 0xCB, 0x05, 0x4E },   0x0000, 0x0000, 0x0000, 0x0000, 0x2800, 0x2805, 0x00, 0xFF, 0x007C, 0x0000, 0x0000, 0x0000, 0x00, 20 },
+    { "BIT 1,(IX+d) no X/Y",     { 0xDD, 0xCB, 0x05, 0x4E },   0x0000, 0x0000, 0x0000, 0x0000, 0x9000, 0x9005, 0x02, 0xFF, 0x0010, 0x0000, 0x0000, 0x0000, 0x02, 20 },
+};
+
+TEST_F(Z80Test, InstructionFlagsAndTStates)
+{
+    for (const auto &testCase : InstructionCases)
+    {
+        SCOPED_TRACE(testCase.Name);
+        SetUp();
+        Load(CodeAddress, testCase.Code);
+        m_memory[testCase.Address] = testCase.Memory;
+        m_port.Value = testCase.PortValue;
+        auto &registers = m_cpu->GetRegisters();
+        registers.SetAF(testCase.AF);
+        registers.SetBC(testCase.BC);
+        registers.SetDE(testCase.DE);
+        registers.SetHL(testCase.HL);
+        registers.IX = testCase.IX;
+        // SRL (IY-2) reaches the same operand
+        registers.IY = static_cast<uint16_t>(testCase.Address + 2);
+
+        EXPECT_TRUE(m_cpu->ExecuteInstruction());
+        EXPECT_EQ(testCase.ExpectedAF, registers.GetAF());
+        EXPECT_EQ(testCase.ExpectedBC, registers.GetBC());
+        EXPECT_EQ(testCase.ExpectedDE, registers.GetDE());
+        EXPECT_EQ(testCase.ExpectedHL, registers.GetHL());
+        EXPECT_EQ(testCase.ExpectedMemory, m_memory[testCase.Address]);
+        EXPECT_EQ(testCase.TStates, m_cpu->GetCPUClock());
+        EXPECT_EQ(CodeAddress + testCase.Code.size(), registers.PC);
+    }
+}
+
+// OUTI decrements B before the port is put on the bus
+TEST_F(Z80Test, OUTIWritesToPortWithDecrementedB)
+{
+    Load(CodeAddress, { 0xED, 0xA3 });
+    m_memory[0x9005] = 0x5A;
+    m_cpu->GetRegisters().SetBC(0x0310);
+    m_cpu->GetRegisters().SetHL(0x9005);
+    m_cpu->ExecuteInstruction();
+    EXPECT_EQ(0x0210, m_port.WrittenPort);
+    EXPECT_EQ(0x5A, m_port.WrittenValue);
+}
+
+// The vector is read from I * 256 + 0xFF, as the data bus floats high
+TEST_F(Z80Test, IM2InterruptJumpsThroughVectorTable)
+{
+    Load(0x1234, { 0x00 });
+    m_memory[0x90FF] = 0x34;
+    m_memory[0x9100] = 0x12;
+    auto &registers = m_cpu->GetRegisters();
+    registers.I = 0x90;
+    registers.IntMode = 2;
+    registers.IFF1 = registers.IFF2 = true;
+    m_cpu->RequestInterrupt(32);
+
+    // Acceptance and the NOP at the vector
+    EXPECT_TRUE(m_cpu->ExecuteInstruction());
+    EXPECT_EQ(19u + 4u, m_cpu->GetCPUClock());
+    EXPECT_EQ(0x1235, registers.PC);
+    EXPECT_EQ(StackAddress - 2, registers.SP);
+    EXPECT_EQ(0x00, m_memory[StackAddress - 2]);
+    EXPECT_EQ(0x80, m_memory[StackAddress - 1]);
+    EXPECT_FALSE(registers.IFF1);
+    EXPECT_FALSE(registers.IFF2);
+    EXPECT_FALSE(registers.IntPending);
+}
+
+// The instruction after EI runs before a pending interrupt is accepted
+TEST_F(Z80Test, InterruptIsAcceptedOneInstructionAfterEI)
+{
+    Load(CodeAddress, { 0xFB, 0x00, 0x00 });
+    auto &registers = m_cpu->GetRegisters();
+    registers.IntMode = 1;
+    m_cpu->RequestInterrupt(32);
+    m_cpu->ExecuteInstruction();
+    m_cpu->ExecuteInstruction();
+    EXPECT_EQ(CodeAddress + 2, registers.PC);
+    m_cpu->ExecuteInstruction();
+    EXPECT_EQ(0x0039, registers.PC);
+    EXPECT_EQ(4u + 4u + 13u + 4u, m_cpu->GetCPUClock());
+}
+
+// HALT runs NOPs at 4 T-states each, and the interrupt returns to the instruction after the HALT
+TEST_F(Z80Test, HALTWaitsForInterrupt)
+{
+    Load(CodeAddress, { 0x76 });
+    auto &registers = m_cpu->GetRegisters();
+    registers.IntMode = 1;
+    registers.IFF1 = registers.IFF2 = true;
+    m_cpu->ExecuteInstruction();
+    EXPECT_TRUE(m_cpu->IsHalted());
+    const uint8_t refresh = registers.R;
+    m_cpu->ExecuteInstruction();
+    m_cpu->ExecuteInstruction();
+    EXPECT_TRUE(m_cpu->IsHalted());
+    EXPECT_EQ(12u, m_cpu->GetCPUClock());
+    EXPECT_EQ(static_cast<uint8_t>(refresh + 2), registers.R);
+
+    m_cpu->RequestInterrupt(32);
+    m_cpu->ExecuteInstruction();
+    EXPECT_FALSE(m_cpu->IsHalted());
+    EXPECT_EQ(0x0039, registers.PC);
+    EXPECT_EQ(0x01, m_memory[StackAddress - 2]);
+    EXPECT_EQ(0x80, m_memory[StackAddress - 1]);
+    EXPECT_EQ(12u + 13u + 4u, m_cpu->GetCPUClock());
+}
+
+// With interrupts disabled an interrupt does not end HALT, it is dropped when INT is released
+TEST_F(Z80Test, HALTWithInterruptsDisabledStaysHalted)
+{
+    Load(CodeAddress, { 0x76 });
+    m_cpu->GetRegisters().IntMode = 1;
+    m_cpu->ExecuteInstruction();
+    m_cpu->RequestInterrupt(32);
+    for (int i = 0; i < 10; ++i)
+        m_cpu->ExecuteInstruction();
+    EXPECT_TRUE(m_cpu->IsHalted());
+    EXPECT_EQ(CodeAddress + 1, m_cpu->GetRegisters().PC);
+    EXPECT_FALSE(m_cpu->GetRegisters().IntPending);
+}
+
+// The loop patches its own NOP into INC A after its block was decoded, and ends in LD A,R, which is left out of blocks
+TEST_F(Z80Test, BlockCacheMatchesInterpreterOnSelfModifyingCode)
+{
+    const std::vector<uint8_t> code
+    {
+        0x21, 0x0B, 0x80,       // LD HL,800B
+        0x36, 0x3C,             // LD (HL),3C
+        0x06, 0x05,             // LD B,5
+        0xDD, 0x34, 0x02,       // loop: INC (IX+2)
+        0x87,                   // ADD A,A
+        0x00,                   // NOP, becomes INC A
+        0x10, 0xF9,             // DJNZ loop
+        0x4F,                   // LD C,A
+        0xED, 0x5F,             // LD A,R
+        0x76,                   // HALT
+    };
+    std::vector<Z80Registers> results;
+    std::vector<uint64_t> clocks;
+    for (auto mode : { ExecutionMode::Interpreter, ExecutionMode::BlockCache })
+    {
+        SetUp();
+        m_cpu->SetExecutionMode(mode);
+        Load(CodeAddress, code);
+        auto &registers = m_cpu->GetRegisters();
+        registers.SetAF(0x0000);
+        registers.IX = 0x9000;
+        EXPECT_EQ(RunExitReason::Halted, m_cpu->ExecuteCycles(1000));
+        EXPECT_EQ(0x1F, registers.GetBC());
+        EXPECT_EQ(0x05, m_memory[0x9002]);
+        results.push_back(registers);
+        clocks.push_back(m_cpu->GetCPUClock());
+    }
+    EXPECT_EQ(results[0].GetAF(), results[1].GetAF());
+    EXPECT_EQ(results[0].GetHL(), results[1].GetHL());
+    EXPECT_EQ(results[0].R, results[1].R);
+    EXPECT_EQ(results[0].PC, results[1].PC);
+    EXPECT_EQ(clocks[0], clocks[1]);
+
+    // The OUT pages in another ROM under its own block, the LD B,n after it has to come from the new ROM
+    std::vector<uint8_t> firstROM(0x4000, 0x00);
+    std::vector<uint8_t> secondROM(0x4000, 0x00);
+    const std::vector<uint8_t> romCode
+    {
+        0x3E, 0x01,             // LD A,1
+        0xD3, 0xFE,             // OUT (FE),A
+        0x06, 0xAA,             // LD B,AA, LD B,BB in the second ROM
+        0x76,                   // HALT
+    };
+    std::copy(romCode.begin(), romCode.end(), firstROM.begin());
+    std::copy(romCode.begin(), romCode.end(), secondROM.begin());
+    secondROM[5] = 0xBB;
+    for (auto mode : { ExecutionMode::Interpreter, ExecutionMode::BlockCache })
+    {
+        SetUp();
+        m_cpu->SetExecutionMode(mode);
+        m_cpu->MapROM(0x0000, firstROM.size(), firstROM.data());
+        m_port.OnWrite = [this, &secondROM](uint8_t /*value*/) { m_cpu->MapROM(0x0000, secondROM.size(), secondROM.data()); };
+        m_cpu->GetRegisters().PC = 0x0000;
+        EXPECT_EQ(RunExitReason::Halted, m_cpu->ExecuteCycles(1000));
+        EXPECT_EQ(0xBB, m_cpu->GetRegisters().GetBC() >> 8);
+        m_port.OnWrite = nullptr;
+    }
+}
+
+// The first loop runs often enough to be recompiled, then is run again storing into its own ADD operand, which leaves
+// the native code after every store. The last loop does I/O, which is never recompiled. Lockstep compares every native
+// block with the interpreter and fails the run on a difference
+TEST_F(Z80Test, LockstepMatchesInterpreterOnSelfModifyingCodeAndIO)
+{
+    const std::vector<uint8_t> code
+    {
+        0x21, 0x00, 0x90,       // LD HL,9000
+        0x06, 0x14,             // LD B,20
+        0x77,                   // loop: LD (HL),A
+        0xC6, 0x01,             // ADD A,1
+        0x10, 0xFB,             // DJNZ loop
+        0x15,                   // DEC D
+        0x28, 0x07,             // JR Z,io
+        0x21, 0x07, 0x80,       // LD HL,8007 (the ADD operand)
+        0x06, 0x05,             // LD B,5
+        0x18, 0xF1,             // JR loop
+        0x06, 0x20,             // io: LD B,32
+        0xDB, 0xFE,             // ioloop: IN A,(FE)
+        0x81,                   // ADD A,C
+        0x4F,                   // LD C,A
+        0xD3, 0xFE,             // OUT (FE),A
+        0x10, 0xF8,             // DJNZ ioloop
+        0x76,                   // HALT
+    };
+    std::vector<Z80Registers> results;
+    std::vector<uint64_t> clocks;
+    std::vector<std::vector<uint8_t>> memories;
+    std::vector<uint8_t> written;
+    for (auto mode : { ExecutionMode::Interpreter, ExecutionMode::Lockstep })
+    {
+        SetUp();
+        m_cpu->SetExecutionMode(mode);
+        m_port.Value = 0x11;
+        Load(CodeAddress, code);
+        auto &registers = m_cpu->GetRegisters();
+        registers.SetAF(0x0000);
+        registers.SetDE(0x0200);
+        const RunExitReason reason = m_cpu->ExecuteCycles(100000);
+        EXPECT_NE(RunExitReason::Error, reason);
+        EXPECT_EQ(RunExitReason::Halted, reason);
+        results.push_back(registers);
+        clocks.push_back(m_cpu->GetCPUClock());
+        memories.push_back(m_memory);
+        written.push_back(m_port.WrittenValue);
+    }
+    EXPECT_EQ(results[0].GetAF(), results[1].GetAF());
+    EXPECT_EQ(results[0].GetBC(), results[1].GetBC());
+    EXPECT_EQ(results[0].GetDE(), results[1].GetDE());
+    EXPECT_EQ(results[0].GetHL(), results[1].GetHL());
+    EXPECT_EQ(results[0].R, results[1].R);
+    EXPECT_EQ(results[0].PC, results[1].PC);
+    EXPECT_EQ(clocks[0], clocks[1]);
+    EXPECT_TRUE(memories[0] == memories[1]);
+    EXPECT_EQ(written[0], written[1]);
+}
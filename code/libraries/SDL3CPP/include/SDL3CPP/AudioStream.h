@@ -17,10 +17,11 @@ private:
     bool m_isPaused;
 
 public:
-    AudioStream(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback);
+    // userdata is passed to the callback
+    AudioStream(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback, void *userdata = nullptr);
     virtual ~AudioStream();
 
-    bool Open(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback);
+    bool Open(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback, void *userdata = nullptr);
     bool IsEmpty() const;
 
     float GetSampleFrequencyRatio() const;
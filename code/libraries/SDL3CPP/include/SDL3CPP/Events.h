@@ -27,6 +27,10 @@ public:
     {
         return m_event.key.key;
     }
+    bool IsKeyRepeat() const
+    {
+        return m_event.key.repeat;
+    }
 };
 
 class QuitEvent
@@ -4,11 +4,11 @@
 
 using namespace SDL3CPP;
 
-AudioStream::AudioStream(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback)
+AudioStream::AudioStream(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback, void *userdata)
     : m_stream{}
     , m_isPaused{}
 {
-    Open(id, audioSpec, callback);
+    Open(id, audioSpec, callback, userdata);
 }
 
 AudioStream::~AudioStream()
@@ -18,10 +18,10 @@ AudioStream::~AudioStream()
 }
 
 
-bool AudioStream::Open(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback)
+bool AudioStream::Open(AudioDeviceID id, const AudioDeviceSpec &audioSpec, AudioDeviceCallback callback, void *userdata)
 {
     SDL_AudioSpec spec { static_cast<SDL_AudioFormat>(audioSpec.sampleFormat), audioSpec.channels, audioSpec.sampleFreq };
-    m_stream = SDL_OpenAudioDeviceStream(id, &spec, callback, nullptr);
+    m_stream = SDL_OpenAudioDeviceStream(id, &spec, callback, userdata);
     if (m_stream == nullptr)
     {
         SDL_Log("Cannot open stream %u, error %s", id, SDL_GetError());
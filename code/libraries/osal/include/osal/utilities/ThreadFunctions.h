@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <thread>
 #include <string>
 
@@ -41,4 +42,7 @@ ThreadPriority GetThreadPriority(std::thread& thread);
 void SetThreadPrioritySelf(ThreadPriority priority);
 void SetThreadPriority(std::thread& thread, ThreadPriority priority);
 
+// Restricts the calling thread to the given logical core
+void SetThreadAffinitySelf(std::size_t core);
+
 } // namespace osal
@@ -187,6 +187,19 @@ void SetThreadPriority(std::thread& thread, ThreadPriority priority)
         throw std::runtime_error("Failed to set the given thread priority!");
 }
 
+void SetThreadAffinitySelf(std::size_t core)
+{
+    if (core >= CPU_SETSIZE)
+        throw std::runtime_error("Failed to set the current thread affinity!");
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (result != 0)
+        throw std::runtime_error("Failed to set the current thread affinity!");
+}
+
 #elif defined(PLATFORM_WINDOWS)
 
 static const DWORD MS_VC_EXCEPTION = 0x406D1388;
@@ -335,6 +348,15 @@ void SetThreadPriority(std::thread& thread, ThreadPriority priority)
         throw std::runtime_error("Failed to set the given thread priority!");
 }
 
+void SetThreadAffinitySelf(std::size_t core)
+{
+    if (core >= sizeof(DWORD_PTR) * 8)
+        throw std::runtime_error("Failed to set the current thread affinity!");
+
+    if (!::SetThreadAffinityMask(::GetCurrentThread(), static_cast<DWORD_PTR>(1) << core))
+        throw std::runtime_error("Failed to set the current thread affinity!");
+}
+
 #else
 
 #error Unsupported platform
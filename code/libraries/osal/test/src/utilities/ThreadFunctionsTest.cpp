@@ -35,5 +35,24 @@ TEST(ThreadTest, IfTheMainThreadIsNameItIsInTheMap)
     EXPECT_EQ("Main", GetThreadNameSelf());
 }
 
+TEST(ThreadTest, ThreadCanBePinnedToFirstCore)
+{
+    bool pinned{};
+    std::thread thread([&pinned]()
+    {
+        try
+        {
+            SetThreadAffinitySelf(0);
+            pinned = true;
+        }
+        catch (const std::exception &)
+        {
+        }
+    });
+    thread.join();
+
+    EXPECT_TRUE(pinned);
+}
+
 } // namespace osal
 